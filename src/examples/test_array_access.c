@@ -0,0 +1,314 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by Kyle Hayes                                      *
+ *   Author Kyle Hayes  kyle.hayes@gmail.com                               *
+ *                                                                         *
+ * This software is available under either the Mozilla Public License      *
+ * version 2.0 or the GNU LGPL version 2 (or later) license, whichever     *
+ * you choose.                                                             *
+ *                                                                         *
+ * MPL 2.0:                                                                *
+ *                                                                         *
+ *   This Source Code Form is subject to the terms of the Mozilla Public   *
+ *   License, v. 2.0. If a copy of the MPL was not distributed with this   *
+ *   file, You can obtain one at http://mozilla.org/MPL/2.0/.              *
+ *                                                                         *
+ *                                                                         *
+ * LGPL 2:                                                                 *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU Library General Public License as       *
+ *   published by the Free Software Foundation; either version 2 of the    *
+ *   License, or (at your option) any later version.                       *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU Library General Public     *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "../lib/libplctag.h"
+#include "utils.h"
+
+#define REQUIRED_VERSION 2,1,4
+
+#define TAG_PATH_BASE "protocol=ab-eip&gateway=127.0.0.1&path=1,0&cpu=LGX"
+#define TAG_PATH TAG_PATH_BASE "&elem_size=4&elem_count=100&name=TestBigArray"
+#define DATA_TIMEOUT 5000
+
+#define ELEM_COUNT (100)
+
+/*
+ * Check that the typed array accessors agree with the single element
+ * accessors, including when the byte order is overridden.
+ */
+
+static const char *byte_orders[] = {
+    "",
+    "&int16_byte_order=10&int32_byte_order=3210&int64_byte_order=76543210",
+    "&float32_byte_order=2301&float64_byte_order=67452301",
+    "&int32_byte_order=1032&int64_byte_order=10325476",
+    "&double_buffer=1",
+    "&double_buffer=1&int32_byte_order=1032&int64_byte_order=10325476"
+};
+
+
+static int check_tag(int32_t tag)
+{
+    int32_t i32[ELEM_COUNT];
+    int32_t i32_back[ELEM_COUNT];
+    int16_t i16[ELEM_COUNT * 2];
+    int16_t i16_back[ELEM_COUNT * 2];
+    int64_t i64[ELEM_COUNT / 2];
+    int64_t i64_back[ELEM_COUNT / 2];
+    float f32[ELEM_COUNT];
+    float f32_back[ELEM_COUNT];
+    double f64[ELEM_COUNT / 2];
+    double f64_back[ELEM_COUNT / 2];
+    uint8_t u8[ELEM_COUNT * 4];
+    int rc = PLCTAG_STATUS_OK;
+    plc_tag_handle_t handle = NULL;
+
+    /* 32-bit integers. */
+    for(int i=0; i < ELEM_COUNT; i++) {
+        i32[i] = (int32_t)(0x01020304 * (i + 1));
+    }
+
+    rc = plc_tag_set_int32_array(tag, 0, i32, ELEM_COUNT);
+    if(rc != PLCTAG_STATUS_OK) {
+        printf("ERROR: %s: unable to set int32 array!\n", plc_tag_decode_error(rc));
+        return 1;
+    }
+
+    rc = plc_tag_get_int32_array(tag, 0, i32_back, ELEM_COUNT);
+    if(rc != PLCTAG_STATUS_OK) {
+        printf("ERROR: %s: unable to get int32 array!\n", plc_tag_decode_error(rc));
+        return 1;
+    }
+
+    handle = plc_tag_pin(tag);
+    if(!handle) {
+        printf("ERROR: unable to pin tag!\n");
+        return 1;
+    }
+
+    for(int i=0; i < ELEM_COUNT; i++) {
+        if(i32_back[i] != i32[i] || plc_tag_get_int32(tag, i * 4) != i32[i] || plc_tag_pinned_get_int32(handle, i * 4) != i32[i]) {
+            printf("ERROR: int32 element %d does not match!\n", i);
+            plc_tag_unpin(handle);
+            return 1;
+        }
+    }
+
+    plc_tag_unpin(handle);
+
+    /* 16-bit integers. */
+    for(int i=0; i < ELEM_COUNT * 2; i++) {
+        i16[i] = (int16_t)(0x0102 * (i + 1));
+    }
+
+    plc_tag_set_int16_array(tag, 0, i16, ELEM_COUNT * 2);
+    plc_tag_get_int16_array(tag, 0, i16_back, ELEM_COUNT * 2);
+
+    for(int i=0; i < ELEM_COUNT * 2; i++) {
+        if(i16_back[i] != i16[i] || plc_tag_get_int16(tag, i * 2) != i16[i]) {
+            printf("ERROR: int16 element %d does not match!\n", i);
+            return 1;
+        }
+    }
+
+    /* 64-bit integers. */
+    for(int i=0; i < ELEM_COUNT / 2; i++) {
+        i64[i] = (int64_t)(0x0102030405060708LL * (i + 1));
+    }
+
+    plc_tag_set_int64_array(tag, 0, i64, ELEM_COUNT / 2);
+    plc_tag_get_int64_array(tag, 0, i64_back, ELEM_COUNT / 2);
+
+    for(int i=0; i < ELEM_COUNT / 2; i++) {
+        if(i64_back[i] != i64[i] || plc_tag_get_int64(tag, i * 8) != i64[i]) {
+            printf("ERROR: int64 element %d does not match!\n", i);
+            return 1;
+        }
+    }
+
+    /* floats, set them one at a time and read them back as an array. */
+    for(int i=0; i < ELEM_COUNT; i++) {
+        f32[i] = (float)i * 1.5f;
+        plc_tag_set_float32(tag, i * 4, f32[i]);
+    }
+
+    plc_tag_get_float32_array(tag, 0, f32_back, ELEM_COUNT);
+
+    for(int i=0; i < ELEM_COUNT; i++) {
+        if(f32_back[i] != f32[i]) {
+            printf("ERROR: float32 element %d does not match!\n", i);
+            return 1;
+        }
+    }
+
+    for(int i=0; i < ELEM_COUNT / 2; i++) {
+        f64[i] = (double)i * 2.25;
+        plc_tag_set_float64(tag, i * 8, f64[i]);
+    }
+
+    plc_tag_get_float64_array(tag, 0, f64_back, ELEM_COUNT / 2);
+
+    for(int i=0; i < ELEM_COUNT / 2; i++) {
+        if(f64_back[i] != f64[i]) {
+            printf("ERROR: float64 element %d does not match!\n", i);
+            return 1;
+        }
+    }
+
+    /* round trip through the PLC. */
+    rc = plc_tag_write(tag, DATA_TIMEOUT);
+    if(rc == PLCTAG_STATUS_OK) {
+        rc = plc_tag_read(tag, DATA_TIMEOUT);
+    }
+
+    if(rc != PLCTAG_STATUS_OK) {
+        printf("ERROR: %s: unable to write and read back the tag!\n", plc_tag_decode_error(rc));
+        return 1;
+    }
+
+    plc_tag_get_float64_array(tag, 0, f64_back, ELEM_COUNT / 2);
+
+    for(int i=0; i < ELEM_COUNT / 2; i++) {
+        if(f64_back[i] != f64[i]) {
+            printf("ERROR: float64 element %d does not match after read!\n", i);
+            return 1;
+        }
+    }
+
+    /* bytes are never reordered. */
+    rc = plc_tag_get_uint8_array(tag, 0, u8, ELEM_COUNT * 4);
+    if(rc != PLCTAG_STATUS_OK || u8[5] != plc_tag_get_uint8(tag, 5)) {
+        printf("ERROR: uint8 array does not match!\n");
+        return 1;
+    }
+
+    /* the whole run must fit. */
+    rc = plc_tag_get_int32_array(tag, 4, i32_back, ELEM_COUNT);
+    if(rc != PLCTAG_ERR_OUT_OF_BOUNDS) {
+        printf("ERROR: expected PLCTAG_ERR_OUT_OF_BOUNDS but got %s!\n", plc_tag_decode_error(rc));
+        return 1;
+    }
+
+    return 0;
+}
+
+
+/*
+ * A bit tag reads as 0 or 1 through every integer getter.
+ */
+
+static int check_bit_tag(void)
+{
+    int32_t word_tag = 0;
+    int rc = 0;
+
+    word_tag = plc_tag_create(TAG_PATH_BASE "&elem_size=4&elem_count=1&name=TestBigArray[10]", DATA_TIMEOUT);
+    if(word_tag < 0) {
+        printf("ERROR %s: Could not create the word tag!\n", plc_tag_decode_error(word_tag));
+        return 1;
+    }
+
+    /* bits 3 and 5 set. */
+    plc_tag_set_int32(word_tag, 0, 0x28);
+    rc = plc_tag_write(word_tag, DATA_TIMEOUT);
+    plc_tag_destroy(word_tag);
+
+    if(rc != PLCTAG_STATUS_OK) {
+        printf("ERROR: %s: unable to write the word tag!\n", plc_tag_decode_error(rc));
+        return 1;
+    }
+
+    for(int bit=3; bit <= 4; bit++) {
+        char tag_path[256];
+        int32_t bit_tag = 0;
+        int expected = (bit == 3 ? 1 : 0);
+
+        snprintf(tag_path, sizeof(tag_path), TAG_PATH_BASE "&elem_count=1&name=TestBigArray[10].%d", bit);
+
+        bit_tag = plc_tag_create(tag_path, DATA_TIMEOUT);
+        if(bit_tag < 0) {
+            printf("ERROR %s: Could not create bit tag!\n", plc_tag_decode_error(bit_tag));
+            return 1;
+        }
+
+        rc = 0;
+
+        if(plc_tag_get_bit(bit_tag, 0) != expected
+           || plc_tag_get_int32(bit_tag, 0) != expected || plc_tag_get_uint32(bit_tag, 0) != (uint32_t)expected
+           || plc_tag_get_int16(bit_tag, 0) != expected || plc_tag_get_uint16(bit_tag, 0) != (uint16_t)expected
+           || plc_tag_get_int8(bit_tag, 0) != expected || plc_tag_get_uint8(bit_tag, 0) != (uint8_t)expected) {
+            printf("ERROR: bit %d does not read as %d through every getter!\n", bit, expected);
+            rc = 1;
+        }
+
+        plc_tag_destroy(bit_tag);
+
+        if(rc) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+
+int main()
+{
+    int version_major = plc_tag_get_int_attribute(0, "version_major", 0);
+    int version_minor = plc_tag_get_int_attribute(0, "version_minor", 0);
+    int version_patch = plc_tag_get_int_attribute(0, "version_patch", 0);
+
+    /* check the library version. */
+    if(plc_tag_check_lib_version(REQUIRED_VERSION) != PLCTAG_STATUS_OK) {
+        printf("Required compatible library version %d.%d.%d not available, found %d.%d.%d!\n", REQUIRED_VERSION, version_major, version_minor, version_patch);
+        return 1;
+    }
+
+    printf("Starting with library version %d.%d.%d.\n", version_major, version_minor, version_patch);
+
+    for(int i=0; i < (int)(sizeof(byte_orders)/sizeof(byte_orders[0])); i++) {
+        char tag_path[256];
+        int32_t tag = 0;
+        int rc = 0;
+
+        snprintf(tag_path, sizeof(tag_path), "%s%s", TAG_PATH, byte_orders[i]);
+
+        printf("Testing tag %s\n", tag_path);
+
+        tag = plc_tag_create(tag_path, DATA_TIMEOUT);
+        if(tag < 0) {
+            printf("ERROR %s: Could not create tag!\n", plc_tag_decode_error(tag));
+            return 1;
+        }
+
+        rc = check_tag(tag);
+
+        plc_tag_destroy(tag);
+
+        if(rc) {
+            return 1;
+        }
+    }
+
+    printf("Testing bit tags.\n");
+
+    if(check_bit_tag()) {
+        return 1;
+    }
+
+    printf("SUCCESS!\n");
+
+    return 0;
+}
@@ -0,0 +1,166 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by Kyle Hayes                                      *
+ *   Author Kyle Hayes  kyle.hayes@gmail.com                               *
+ *                                                                         *
+ * This software is available under either the Mozilla Public License      *
+ * version 2.0 or the GNU LGPL version 2 (or later) license, whichever     *
+ * you choose.                                                             *
+ *                                                                         *
+ * MPL 2.0:                                                                *
+ *                                                                         *
+ *   This Source Code Form is subject to the terms of the Mozilla Public   *
+ *   License, v. 2.0. If a copy of the MPL was not distributed with this   *
+ *   file, You can obtain one at http://mozilla.org/MPL/2.0/.              *
+ *                                                                         *
+ *                                                                         *
+ * LGPL 2:                                                                 *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU Library General Public License as       *
+ *   published by the Free Software Foundation; either version 2 of the    *
+ *   License, or (at your option) any later version.                       *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU Library General Public     *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include "../lib/libplctag.h"
+#include "utils.h"
+
+#define REQUIRED_VERSION 2,1,4
+
+#define TAG_PATH "protocol=ab-eip&gateway=127.0.0.1&path=1,0&cpu=LGX&elem_size=4&elem_count=1&name=TestBigArray[%d]"
+#define DATA_TIMEOUT 5000
+
+#define NUM_TAGS (20)
+#define AUTO_SYNC_MS (100)
+
+/*
+ * Check batch callbacks.  Each tag gets its own context and one batch read
+ * should come back as one call with all the tags in it.
+ */
+
+struct tag_info_t {
+    int32_t tag_id;
+    volatile int read_count;
+};
+
+static struct tag_info_t tag_info[NUM_TAGS];
+static volatile int max_batch_size = 0;
+static volatile int bad_context = 0;
+
+
+static void batch_callback(const plc_tag_callback_event_t *events, int num_events)
+{
+    if(num_events > max_batch_size) {
+        max_batch_size = num_events;
+    }
+
+    for(int i=0; i < num_events; i++) {
+        struct tag_info_t *info = (struct tag_info_t *)events[i].context;
+
+        if(!info || info->tag_id != events[i].tag_id) {
+            bad_context = 1;
+            continue;
+        }
+
+        if(events[i].event == PLCTAG_EVENT_READ_COMPLETED && events[i].status == PLCTAG_STATUS_OK) {
+            info->read_count++;
+        }
+    }
+}
+
+
+int main()
+{
+    int32_t tags[NUM_TAGS] = {0};
+    int counts[NUM_TAGS] = {0};
+    int statuses[NUM_TAGS];
+    char tag_path[256];
+    int version_major = plc_tag_get_int_attribute(0, "version_major", 0);
+    int version_minor = plc_tag_get_int_attribute(0, "version_minor", 0);
+    int version_patch = plc_tag_get_int_attribute(0, "version_patch", 0);
+    int rc = PLCTAG_STATUS_OK;
+
+    /* check the library version. */
+    if(plc_tag_check_lib_version(REQUIRED_VERSION) != PLCTAG_STATUS_OK) {
+        printf("Required compatible library version %d.%d.%d not available, found %d.%d.%d!\n", REQUIRED_VERSION, version_major, version_minor, version_patch);
+        return 1;
+    }
+
+    printf("Starting with library version %d.%d.%d.\n", version_major, version_minor, version_patch);
+
+    for(int i=0; i < NUM_TAGS && rc == PLCTAG_STATUS_OK; i++) {
+        snprintf(tag_path, sizeof(tag_path), TAG_PATH, i);
+
+        tags[i] = plc_tag_create(tag_path, DATA_TIMEOUT);
+        if(tags[i] < 0) {
+            printf("ERROR %s: Could not create tag %d!\n", plc_tag_decode_error(tags[i]), i);
+            rc = tags[i];
+        } else {
+            tag_info[i].tag_id = tags[i];
+            rc = plc_tag_register_batch_callback(tags[i], batch_callback, &tag_info[i]);
+        }
+    }
+
+    /* only one kind of callback at a time. */
+    if(rc == PLCTAG_STATUS_OK && plc_tag_register_batch_callback(tags[0], batch_callback, NULL) != PLCTAG_ERR_DUPLICATE) {
+        printf("ERROR: registering a second batch callback did not fail!\n");
+        rc = PLCTAG_ERR_DUPLICATE;
+    }
+
+    /* a batch read is delivered as a single batch. */
+    if(rc == PLCTAG_STATUS_OK) {
+        rc = plc_tag_read_many(tags, statuses, NUM_TAGS, DATA_TIMEOUT);
+        if(rc != PLCTAG_STATUS_OK) {
+            printf("ERROR: %s: unable to read tags!\n", plc_tag_decode_error(rc));
+        } else if(max_batch_size != NUM_TAGS) {
+            printf("ERROR: largest batch had %d events, expected %d!\n", max_batch_size, NUM_TAGS);
+            rc = PLCTAG_ERR_BAD_DATA;
+        }
+    }
+
+    /* automatic reads are delivered by the library's thread. */
+    if(rc == PLCTAG_STATUS_OK) {
+        for(int i=0; i < NUM_TAGS; i++) {
+            counts[i] = tag_info[i].read_count;
+            plc_tag_set_int_attribute(tags[i], "auto_sync_read_ms", AUTO_SYNC_MS);
+        }
+
+        util_sleep_ms(AUTO_SYNC_MS * 5);
+
+        for(int i=0; i < NUM_TAGS && rc == PLCTAG_STATUS_OK; i++) {
+            if(tag_info[i].read_count <= counts[i]) {
+                printf("ERROR: no automatic read callbacks for tag %d!\n", i);
+                rc = PLCTAG_ERR_BAD_DATA;
+            }
+        }
+    }
+
+    if(rc == PLCTAG_STATUS_OK && bad_context) {
+        printf("ERROR: an event had the wrong context!\n");
+        rc = PLCTAG_ERR_BAD_DATA;
+    }
+
+    for(int i=0; i < NUM_TAGS; i++) {
+        if(tags[i] > 0) {
+            plc_tag_destroy(tags[i]);
+        }
+    }
+
+    if(rc != PLCTAG_STATUS_OK) {
+        return 1;
+    }
+
+    printf("SUCCESS!\n");
+
+    return 0;
+}
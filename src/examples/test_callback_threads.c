@@ -0,0 +1,163 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by Kyle Hayes                                      *
+ *   Author Kyle Hayes  kyle.hayes@gmail.com                               *
+ *                                                                         *
+ * This software is available under either the Mozilla Public License      *
+ * version 2.0 or the GNU LGPL version 2 (or later) license, whichever     *
+ * you choose.                                                             *
+ *                                                                         *
+ * MPL 2.0:                                                                *
+ *                                                                         *
+ *   This Source Code Form is subject to the terms of the Mozilla Public   *
+ *   License, v. 2.0. If a copy of the MPL was not distributed with this   *
+ *   file, You can obtain one at http://mozilla.org/MPL/2.0/.              *
+ *                                                                         *
+ *                                                                         *
+ * LGPL 2:                                                                 *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU Library General Public License as       *
+ *   published by the Free Software Foundation; either version 2 of the    *
+ *   License, or (at your option) any later version.                       *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU Library General Public     *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include "../lib/libplctag.h"
+#include "utils.h"
+
+#define REQUIRED_VERSION 2,1,4
+
+#define TAG_PATH "protocol=ab-eip&gateway=127.0.0.1&path=1,0&cpu=LGX&elem_size=4&elem_count=1&name=TestBigArray[%d]"
+#define DATA_TIMEOUT 5000
+
+#define NUM_TAGS (8)
+#define NUM_READS (5)
+#define SLOW_CALLBACK_MS (200)
+
+/*
+ * Check that callbacks run on the callback threads.  The first tag has a
+ * slow callback.  That must not hold up the reads of the other tags.
+ */
+
+static int32_t tags[NUM_TAGS] = {0};
+static volatile int read_counts[NUM_TAGS] = {0};
+
+
+static void tag_callback(int32_t tag_id, int event, int status)
+{
+    if(event == PLCTAG_EVENT_READ_COMPLETED && status == PLCTAG_STATUS_OK) {
+        /* each tag's callbacks run on one thread at a time. */
+        for(int i=0; i < NUM_TAGS; i++) {
+            if(tags[i] == tag_id) {
+                read_counts[i]++;
+
+                if(i == 0) {
+                    util_sleep_ms(SLOW_CALLBACK_MS);
+                }
+            }
+        }
+    }
+}
+
+
+static int check_counts(void)
+{
+    /* the read done when the tag is created may also show up. */
+    for(int i=0; i < NUM_TAGS; i++) {
+        if(read_counts[i] < NUM_READS) {
+            printf("ERROR: tag %d had %d read callbacks, expected at least %d!\n", i, read_counts[i], NUM_READS);
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+
+int main()
+{
+    char tag_path[256];
+    int version_major = plc_tag_get_int_attribute(0, "version_major", 0);
+    int version_minor = plc_tag_get_int_attribute(0, "version_minor", 0);
+    int version_patch = plc_tag_get_int_attribute(0, "version_patch", 0);
+    int64_t start = 0;
+    int64_t elapsed = 0;
+    int rc = PLCTAG_STATUS_OK;
+
+    /* check the library version. */
+    if(plc_tag_check_lib_version(REQUIRED_VERSION) != PLCTAG_STATUS_OK) {
+        printf("Required compatible library version %d.%d.%d not available, found %d.%d.%d!\n", REQUIRED_VERSION, version_major, version_minor, version_patch);
+        return 1;
+    }
+
+    printf("Starting with library version %d.%d.%d.\n", version_major, version_minor, version_patch);
+
+    rc = plc_tag_set_int_attribute(0, "callback_threads", 4);
+    if(rc != PLCTAG_STATUS_OK) {
+        printf("ERROR: %s: unable to start the callback threads!\n", plc_tag_decode_error(rc));
+        return 1;
+    }
+
+    for(int i=0; i < NUM_TAGS && rc == PLCTAG_STATUS_OK; i++) {
+        snprintf(tag_path, sizeof(tag_path), TAG_PATH, i);
+
+        tags[i] = plc_tag_create(tag_path, DATA_TIMEOUT);
+        if(tags[i] < 0) {
+            printf("ERROR %s: Could not create tag %d!\n", plc_tag_decode_error(tags[i]), i);
+            rc = tags[i];
+        } else {
+            rc = plc_tag_register_callback(tags[i], tag_callback);
+        }
+    }
+
+    start = util_time_ms();
+
+    for(int count=0; count < NUM_READS && rc == PLCTAG_STATUS_OK; count++) {
+        for(int i=0; i < NUM_TAGS && rc == PLCTAG_STATUS_OK; i++) {
+            rc = plc_tag_read(tags[i], DATA_TIMEOUT);
+            if(rc != PLCTAG_STATUS_OK) {
+                printf("ERROR: %s: unable to read tag %d!\n", plc_tag_decode_error(rc), i);
+            }
+        }
+    }
+
+    elapsed = util_time_ms() - start;
+
+    printf("%d reads took %dms.\n", NUM_TAGS * NUM_READS, (int)elapsed);
+
+    if(rc == PLCTAG_STATUS_OK && elapsed >= NUM_READS * SLOW_CALLBACK_MS) {
+        printf("ERROR: the slow callback held up the reads!\n");
+        rc = PLCTAG_ERR_TIMEOUT;
+    }
+
+    /* turning the threads off runs the callbacks that are still queued. */
+    plc_tag_set_int_attribute(0, "callback_threads", 0);
+
+    if(rc == PLCTAG_STATUS_OK && check_counts()) {
+        rc = PLCTAG_ERR_BAD_DATA;
+    }
+
+    for(int i=0; i < NUM_TAGS; i++) {
+        if(tags[i] > 0) {
+            plc_tag_destroy(tags[i]);
+        }
+    }
+
+    if(rc != PLCTAG_STATUS_OK) {
+        return 1;
+    }
+
+    printf("SUCCESS!\n");
+
+    return 0;
+}
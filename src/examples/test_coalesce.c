@@ -0,0 +1,261 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by Kyle Hayes                                      *
+ *   Author Kyle Hayes  kyle.hayes@gmail.com                               *
+ *                                                                         *
+ * This software is available under either the Mozilla Public License      *
+ * version 2.0 or the GNU LGPL version 2 (or later) license, whichever     *
+ * you choose.                                                             *
+ *                                                                         *
+ * MPL 2.0:                                                                *
+ *                                                                         *
+ *   This Source Code Form is subject to the terms of the Mozilla Public   *
+ *   License, v. 2.0. If a copy of the MPL was not distributed with this   *
+ *   file, You can obtain one at http://mozilla.org/MPL/2.0/.              *
+ *                                                                         *
+ *                                                                         *
+ * LGPL 2:                                                                 *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU Library General Public License as       *
+ *   published by the Free Software Foundation; either version 2 of the    *
+ *   License, or (at your option) any later version.                       *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU Library General Public     *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include "../lib/libplctag.h"
+#include "utils.h"
+
+#define REQUIRED_VERSION 2,1,4
+
+#define TAG_ATTRIBS "protocol=ab-eip&gateway=127.0.0.1&path=1,0&cpu=LGX&elem_size=4"
+#define NUM_TAGS (8)
+#define FIRST_INDEX (100)
+#define TAG_ELEMS (5)
+#define ALL_ELEMS (NUM_TAGS * TAG_ELEMS)
+#define DATA_TIMEOUT 5000
+
+/*
+ * Read slices of the same array from several tags at once.  The slices
+ * are adjacent or overlap, so the library reads them with one request.
+ * Check that each tag gets its own part of the array, both after a write
+ * through a tag that does not coalesce and after a write through one of
+ * the slices.
+ */
+
+static int32_t all_tag = 0;
+static int32_t tags[NUM_TAGS] = {0};
+
+
+static int32_t value_at(int index, int32_t base)
+{
+    return base + (index * 7);
+}
+
+
+/* the last tag overlaps the one before it and runs to the end. */
+static int tag_start(int i)
+{
+    return (i < NUM_TAGS - 1 ? i * TAG_ELEMS : (i - 1) * TAG_ELEMS + 2);
+}
+
+
+static int create_tags(void)
+{
+    char attribs[256];
+
+    snprintf(attribs, sizeof(attribs), TAG_ATTRIBS "&name=TestBigArray[%d]&elem_count=%d&coalesce=0", FIRST_INDEX, ALL_ELEMS);
+
+    all_tag = plc_tag_create(attribs, DATA_TIMEOUT);
+    if(all_tag < 0) {
+        printf("ERROR %s: Could not create the tag for the whole range!\n", plc_tag_decode_error(all_tag));
+        return all_tag;
+    }
+
+    for(int i=0; i < NUM_TAGS; i++) {
+        int start = tag_start(i);
+        int count = (i < NUM_TAGS - 1 ? TAG_ELEMS : ALL_ELEMS - start);
+
+        snprintf(attribs, sizeof(attribs), TAG_ATTRIBS "&name=TestBigArray[%d]&elem_count=%d", FIRST_INDEX + start, count);
+
+        tags[i] = plc_tag_create(attribs, DATA_TIMEOUT);
+        if(tags[i] < 0) {
+            printf("ERROR %s: Could not create tag %d!\n", plc_tag_decode_error(tags[i]), i);
+            return tags[i];
+        }
+    }
+
+    return PLCTAG_STATUS_OK;
+}
+
+
+static int read_all(void)
+{
+    int rc = PLCTAG_STATUS_OK;
+    int64_t end_time = util_time_ms() + DATA_TIMEOUT;
+    int pending = 0;
+
+    for(int i=0; i < NUM_TAGS; i++) {
+        rc = plc_tag_read(tags[i], 0);
+        if(rc != PLCTAG_STATUS_OK && rc != PLCTAG_STATUS_PENDING) {
+            printf("ERROR: %s: unable to start the read of tag %d!\n", plc_tag_decode_error(rc), i);
+            return rc;
+        }
+    }
+
+    do {
+        pending = 0;
+
+        for(int i=0; i < NUM_TAGS; i++) {
+            rc = plc_tag_status(tags[i]);
+            if(rc == PLCTAG_STATUS_PENDING) {
+                pending = 1;
+            } else if(rc != PLCTAG_STATUS_OK) {
+                printf("ERROR: %s: read of tag %d failed!\n", plc_tag_decode_error(rc), i);
+                return rc;
+            }
+        }
+
+        if(pending) {
+            util_sleep_ms(1);
+        }
+    } while(pending && util_time_ms() < end_time);
+
+    if(pending) {
+        printf("ERROR: timed out waiting for the reads!\n");
+        return PLCTAG_ERR_TIMEOUT;
+    }
+
+    return PLCTAG_STATUS_OK;
+}
+
+
+static int check_values(int32_t base)
+{
+    int rc = read_all();
+
+    if(rc != PLCTAG_STATUS_OK) {
+        return rc;
+    }
+
+    for(int i=0; i < NUM_TAGS; i++) {
+        int start = tag_start(i);
+        int count = plc_tag_get_int_attribute(tags[i], "elem_count", 0);
+
+        if(plc_tag_get_size(tags[i]) != count * 4) {
+            printf("ERROR: tag %d has %d bytes of data, expected %d!\n", i, plc_tag_get_size(tags[i]), count * 4);
+            return PLCTAG_ERR_BAD_DATA;
+        }
+
+        for(int j=0; j < count; j++) {
+            int32_t value = plc_tag_get_int32(tags[i], j * 4);
+
+            if(value != value_at(start + j, base)) {
+                printf("ERROR: tag %d element %d is %d, expected %d!\n", i, j, value, value_at(start + j, base));
+                return PLCTAG_ERR_BAD_DATA;
+            }
+        }
+    }
+
+    return PLCTAG_STATUS_OK;
+}
+
+
+static int run_test(void)
+{
+    int rc = PLCTAG_STATUS_OK;
+    int32_t base = (int32_t)(util_time_ms() % 1000);
+
+    /* write the whole range through the tag that reads alone. */
+    for(int i=0; i < ALL_ELEMS; i++) {
+        plc_tag_set_int32(all_tag, i * 4, value_at(i, base));
+    }
+
+    rc = plc_tag_write(all_tag, DATA_TIMEOUT);
+    if(rc != PLCTAG_STATUS_OK) {
+        printf("ERROR: %s: unable to write the whole range!\n", plc_tag_decode_error(rc));
+        return rc;
+    }
+
+    if((rc = check_values(base)) != PLCTAG_STATUS_OK) {
+        return rc;
+    }
+
+    printf("Each tag got its part of the array.\n");
+
+    /* write through one of the slices and make sure everyone sees it. */
+    base += 1000;
+
+    for(int i=0; i < NUM_TAGS; i++) {
+        int start = tag_start(i);
+        int count = plc_tag_get_int_attribute(tags[i], "elem_count", 0);
+
+        for(int j=0; j < count; j++) {
+            plc_tag_set_int32(tags[i], j * 4, value_at(start + j, base));
+        }
+
+        rc = plc_tag_write(tags[i], DATA_TIMEOUT);
+        if(rc != PLCTAG_STATUS_OK) {
+            printf("ERROR: %s: unable to write tag %d!\n", plc_tag_decode_error(rc), i);
+            return rc;
+        }
+    }
+
+    if((rc = check_values(base)) != PLCTAG_STATUS_OK) {
+        return rc;
+    }
+
+    printf("Each tag saw the writes through the other tags.\n");
+
+    return PLCTAG_STATUS_OK;
+}
+
+
+int main()
+{
+    int version_major = plc_tag_get_int_attribute(0, "version_major", 0);
+    int version_minor = plc_tag_get_int_attribute(0, "version_minor", 0);
+    int version_patch = plc_tag_get_int_attribute(0, "version_patch", 0);
+    int rc = PLCTAG_STATUS_OK;
+
+    /* check the library version. */
+    if(plc_tag_check_lib_version(REQUIRED_VERSION) != PLCTAG_STATUS_OK) {
+        printf("Required compatible library version %d.%d.%d not available, found %d.%d.%d!\n", REQUIRED_VERSION, version_major, version_minor, version_patch);
+        return 1;
+    }
+
+    printf("Starting with library version %d.%d.%d.\n", version_major, version_minor, version_patch);
+
+    rc = create_tags();
+
+    if(rc == PLCTAG_STATUS_OK) {
+        rc = run_test();
+    }
+
+    for(int i=0; i < NUM_TAGS; i++) {
+        if(tags[i] > 0) {
+            plc_tag_destroy(tags[i]);
+        }
+    }
+
+    if(all_tag > 0) {
+        plc_tag_destroy(all_tag);
+    }
+
+    if(rc != PLCTAG_STATUS_OK) {
+        return 1;
+    }
+
+    printf("SUCCESS!\n");
+
+    return 0;
+}
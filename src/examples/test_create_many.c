@@ -0,0 +1,139 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by Kyle Hayes                                      *
+ *   Author Kyle Hayes  kyle.hayes@gmail.com                               *
+ *                                                                         *
+ * This software is available under either the Mozilla Public License      *
+ * version 2.0 or the GNU LGPL version 2 (or later) license, whichever     *
+ * you choose.                                                             *
+ *                                                                         *
+ * MPL 2.0:                                                                *
+ *                                                                         *
+ *   This Source Code Form is subject to the terms of the Mozilla Public   *
+ *   License, v. 2.0. If a copy of the MPL was not distributed with this   *
+ *   file, You can obtain one at http://mozilla.org/MPL/2.0/.              *
+ *                                                                         *
+ *                                                                         *
+ * LGPL 2:                                                                 *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU Library General Public License as       *
+ *   published by the Free Software Foundation; either version 2 of the    *
+ *   License, or (at your option) any later version.                       *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU Library General Public     *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include "../lib/libplctag.h"
+#include "utils.h"
+
+#define REQUIRED_VERSION 2,1,4
+
+#define TAG_ATTRIBS "protocol=ab-eip&gateway=127.0.0.1&path=1,0&cpu=LGX&elem_size=4&elem_count=1"
+#define NUM_TAGS (200)
+#define BAD_TAG (NUM_TAGS / 2)
+#define DATA_TIMEOUT 5000
+
+/*
+ * Create many tags at once with one missing from the PLC.  All the good
+ * tags must be created and readable and the missing one must get an
+ * error in its place.
+ */
+
+static char attrib_bufs[NUM_TAGS][256];
+static const char *attrib_strs[NUM_TAGS];
+static int32_t tags[NUM_TAGS];
+
+
+static int run_test(void)
+{
+    int rc = PLCTAG_STATUS_OK;
+    int64_t start = 0;
+
+    for(int i=0; i < NUM_TAGS; i++) {
+        if(i == BAD_TAG) {
+            snprintf(attrib_bufs[i], sizeof(attrib_bufs[i]), TAG_ATTRIBS "&name=NoSuchTag");
+        } else {
+            snprintf(attrib_bufs[i], sizeof(attrib_bufs[i]), TAG_ATTRIBS "&name=TestBigArray[%d]", i);
+        }
+
+        attrib_strs[i] = attrib_bufs[i];
+    }
+
+    start = util_time_ms();
+
+    rc = plc_tag_create_many(attrib_strs, NUM_TAGS, tags, DATA_TIMEOUT);
+
+    printf("Created %d tags in %dms.\n", NUM_TAGS, (int)(util_time_ms() - start));
+
+    if(rc != PLCTAG_ERR_PARTIAL) {
+        printf("ERROR: expected PLCTAG_ERR_PARTIAL, got %s!\n", plc_tag_decode_error(rc));
+        return PLCTAG_ERR_BAD_STATUS;
+    }
+
+    for(int i=0; i < NUM_TAGS; i++) {
+        if(i == BAD_TAG) {
+            if(tags[i] >= 0) {
+                printf("ERROR: the missing tag got a handle!\n");
+                return PLCTAG_ERR_BAD_STATUS;
+            }
+
+            printf("The missing tag got %s.\n", plc_tag_decode_error(tags[i]));
+        } else if(tags[i] <= 0) {
+            printf("ERROR: %s: tag %d was not created!\n", plc_tag_decode_error(tags[i]), i);
+            return tags[i];
+        } else if(plc_tag_status(tags[i]) != PLCTAG_STATUS_OK || plc_tag_get_size(tags[i]) != 4) {
+            printf("ERROR: tag %d is not ready!\n", i);
+            return PLCTAG_ERR_BAD_STATUS;
+        }
+    }
+
+    /* a bad argument does not create anything. */
+    if(plc_tag_create_many(attrib_strs, 0, tags, DATA_TIMEOUT) != PLCTAG_ERR_BAD_PARAM) {
+        printf("ERROR: creating no tags did not fail!\n");
+        return PLCTAG_ERR_BAD_STATUS;
+    }
+
+    return PLCTAG_STATUS_OK;
+}
+
+
+int main()
+{
+    int version_major = plc_tag_get_int_attribute(0, "version_major", 0);
+    int version_minor = plc_tag_get_int_attribute(0, "version_minor", 0);
+    int version_patch = plc_tag_get_int_attribute(0, "version_patch", 0);
+    int rc = PLCTAG_STATUS_OK;
+
+    /* check the library version. */
+    if(plc_tag_check_lib_version(REQUIRED_VERSION) != PLCTAG_STATUS_OK) {
+        printf("Required compatible library version %d.%d.%d not available, found %d.%d.%d!\n", REQUIRED_VERSION, version_major, version_minor, version_patch);
+        return 1;
+    }
+
+    printf("Starting with library version %d.%d.%d.\n", version_major, version_minor, version_patch);
+
+    rc = run_test();
+
+    for(int i=0; i < NUM_TAGS; i++) {
+        if(tags[i] > 0) {
+            plc_tag_destroy(tags[i]);
+        }
+    }
+
+    if(rc != PLCTAG_STATUS_OK) {
+        return 1;
+    }
+
+    printf("SUCCESS!\n");
+
+    return 0;
+}
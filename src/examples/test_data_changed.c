@@ -0,0 +1,328 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by Kyle Hayes                                      *
+ *   Author Kyle Hayes  kyle.hayes@gmail.com                               *
+ *                                                                         *
+ * This software is available under either the Mozilla Public License      *
+ * version 2.0 or the GNU LGPL version 2 (or later) license, whichever     *
+ * you choose.                                                             *
+ *                                                                         *
+ * MPL 2.0:                                                                *
+ *                                                                         *
+ *   This Source Code Form is subject to the terms of the Mozilla Public   *
+ *   License, v. 2.0. If a copy of the MPL was not distributed with this   *
+ *   file, You can obtain one at http://mozilla.org/MPL/2.0/.              *
+ *                                                                         *
+ *                                                                         *
+ * LGPL 2:                                                                 *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU Library General Public License as       *
+ *   published by the Free Software Foundation; either version 2 of the    *
+ *   License, or (at your option) any later version.                       *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU Library General Public     *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include "../lib/libplctag.h"
+#include "utils.h"
+
+#define REQUIRED_VERSION 2,1,4
+
+#define WRITE_TAG_PATH "protocol=ab-eip&gateway=127.0.0.1&path=1,0&cpu=LGX&elem_size=4&elem_count=4&name=TestBigArray[10]"
+#define WATCH_TAG_PATH WRITE_TAG_PATH "&auto_sync_read_ms=50&change_deadband=1.0"
+#define ARRAY_TAG_PATH "protocol=ab-eip&gateway=127.0.0.1&path=1,0&cpu=LGX&elem_size=4&elem_count=100&name=TestBigArray&change_detect=1"
+#define ARRAY_ELEMS (100)
+#define ADAPTIVE_TAG_PATH "protocol=ab-eip&gateway=127.0.0.1&path=1,0&cpu=LGX&elem_size=4&elem_count=1&name=TestBigArray[20]&auto_sync_read_ms=20&auto_sync_read_max_ms=640"
+#define DATA_TIMEOUT 5000
+#define SETTLE_MS (400)
+
+/*
+ * Check that automatic reads on a tag with change detection only report
+ * changes and that changes inside the deadband are not reported.  The
+ * DINT array is used as REAL data.
+ *
+ * Then check that only the elements that changed are reported and that
+ * adaptive automatic reads slow down and speed up again.
+ */
+
+static volatile int read_completed = 0;
+static volatile int data_changed = 0;
+
+
+static void tag_callback(int32_t tag_id, int event, int status)
+{
+    (void)tag_id;
+
+    if(event == PLCTAG_EVENT_READ_COMPLETED) {
+        read_completed++;
+    } else if(event == PLCTAG_EVENT_DATA_CHANGED && status == PLCTAG_STATUS_OK) {
+        data_changed++;
+    }
+}
+
+
+static int write_value(int32_t tag, float val)
+{
+    int rc = plc_tag_set_float32(tag, 0, val);
+
+    if(rc == PLCTAG_STATUS_OK) {
+        rc = plc_tag_write(tag, DATA_TIMEOUT);
+    }
+
+    if(rc != PLCTAG_STATUS_OK) {
+        printf("ERROR: %s: unable to write %f!\n", plc_tag_decode_error(rc), (double)val);
+    }
+
+    util_sleep_ms(SETTLE_MS);
+
+    return rc;
+}
+
+
+static int check_counts(const char *what, int expect_changed, int expect_completed)
+{
+    printf("After %s: %d changes and %d read completions.\n", what, data_changed, read_completed);
+
+    if(data_changed != expect_changed || read_completed != expect_completed) {
+        printf("ERROR: expected %d changes and %d read completions!\n", expect_changed, expect_completed);
+        return PLCTAG_ERR_BAD_DATA;
+    }
+
+    return PLCTAG_STATUS_OK;
+}
+
+
+static int check_changed_elements(void)
+{
+    uint8_t bitmap[(ARRAY_ELEMS + 7) / 8];
+    int32_t array_tag = plc_tag_create(ARRAY_TAG_PATH, DATA_TIMEOUT);
+    int rc = PLCTAG_STATUS_OK;
+
+    if(array_tag < 0) {
+        printf("ERROR %s: Could not create array tag!\n", plc_tag_decode_error(array_tag));
+        return array_tag;
+    }
+
+    /* the first read changes everything. */
+    rc = plc_tag_read(array_tag, DATA_TIMEOUT);
+    if(rc == PLCTAG_STATUS_OK && (rc = plc_tag_get_changed_elements(array_tag, bitmap, (int)sizeof(bitmap))) != ARRAY_ELEMS) {
+        printf("ERROR: expected all %d elements to change on the first read, got %d!\n", ARRAY_ELEMS, rc);
+        rc = PLCTAG_ERR_BAD_DATA;
+    } else if(rc == ARRAY_ELEMS) {
+        rc = PLCTAG_STATUS_OK;
+    }
+
+    if(rc == PLCTAG_STATUS_OK && plc_tag_get_changed_elements(array_tag, bitmap, 1) != PLCTAG_ERR_TOO_SMALL) {
+        printf("ERROR: a short bitmap should not be allowed!\n");
+        rc = PLCTAG_ERR_BAD_DATA;
+    }
+
+    /* change two elements behind the tag's back. */
+    if(rc == PLCTAG_STATUS_OK) {
+        int32_t elem_3 = plc_tag_get_int32(array_tag, 3 * 4);
+        int32_t elem_70 = plc_tag_get_int32(array_tag, 70 * 4);
+
+        plc_tag_set_int32(array_tag, 3 * 4, elem_3 + 1);
+        plc_tag_set_int32(array_tag, 70 * 4, elem_70 + 1);
+
+        rc = plc_tag_write(array_tag, DATA_TIMEOUT);
+    }
+
+    if(rc == PLCTAG_STATUS_OK) {
+        rc = plc_tag_read(array_tag, DATA_TIMEOUT);
+    }
+
+    if(rc == PLCTAG_STATUS_OK) {
+        rc = plc_tag_get_changed_elements(array_tag, bitmap, (int)sizeof(bitmap));
+
+        printf("After writing two elements, %d elements changed.\n", rc);
+
+        if(rc != 2 || bitmap[0] != (1 << 3) || bitmap[70 / 8] != (1 << (70 % 8))) {
+            printf("ERROR: expected only elements 3 and 70 to change!\n");
+            rc = PLCTAG_ERR_BAD_DATA;
+        } else {
+            rc = PLCTAG_STATUS_OK;
+        }
+    }
+
+    /* a read with no changes. */
+    if(rc == PLCTAG_STATUS_OK) {
+        rc = plc_tag_read(array_tag, DATA_TIMEOUT);
+
+        if(rc == PLCTAG_STATUS_OK && (rc = plc_tag_get_changed_elements(array_tag, NULL, 0)) != 0) {
+            printf("ERROR: expected no changed elements, got %d!\n", rc);
+            rc = PLCTAG_ERR_BAD_DATA;
+        }
+    }
+
+    plc_tag_destroy(array_tag);
+
+    return rc;
+}
+
+
+static int check_adaptive_reads(void)
+{
+    int32_t adaptive_tag = plc_tag_create(ADAPTIVE_TAG_PATH, DATA_TIMEOUT);
+    int rc = PLCTAG_STATUS_OK;
+    int period = 0;
+    int64_t start_time = 0;
+
+    if(adaptive_tag < 0) {
+        printf("ERROR %s: Could not create adaptive tag!\n", plc_tag_decode_error(adaptive_tag));
+        return adaptive_tag;
+    }
+
+    /* nothing changes, so the reads should slow down. */
+    util_sleep_ms(1000);
+
+    period = plc_tag_get_int_attribute(adaptive_tag, "auto_sync_read_current_ms", 0);
+    printf("With no changes, reading every %dms.\n", period);
+
+    if(period <= 20) {
+        printf("ERROR: automatic reads did not slow down!\n");
+        rc = PLCTAG_ERR_BAD_DATA;
+    }
+
+    /* change the data from another tag. */
+    if(rc == PLCTAG_STATUS_OK) {
+        int32_t elem_tag = plc_tag_create("protocol=ab-eip&gateway=127.0.0.1&path=1,0&cpu=LGX&elem_size=4&elem_count=1&name=TestBigArray[20]", DATA_TIMEOUT);
+
+        if(elem_tag < 0) {
+            rc = elem_tag;
+        } else {
+            plc_tag_set_int32(elem_tag, 0, plc_tag_get_int32(elem_tag, 0) + 1);
+            rc = plc_tag_write(elem_tag, DATA_TIMEOUT);
+            plc_tag_destroy(elem_tag);
+        }
+    }
+
+    /* the next read sees the change and the reads speed up. */
+    start_time = util_time_ms();
+    while(rc == PLCTAG_STATUS_OK && plc_tag_get_int_attribute(adaptive_tag, "auto_sync_read_current_ms", 0) != 20) {
+        if(util_time_ms() - start_time > 2000) {
+            printf("ERROR: automatic reads did not speed up after a change!\n");
+            rc = PLCTAG_ERR_TIMEOUT;
+        }
+
+        util_sleep_ms(5);
+    }
+
+    plc_tag_destroy(adaptive_tag);
+
+    return rc;
+}
+
+
+int main()
+{
+    int32_t write_tag = 0;
+    int32_t watch_tag = 0;
+    int version_major = plc_tag_get_int_attribute(0, "version_major", 0);
+    int version_minor = plc_tag_get_int_attribute(0, "version_minor", 0);
+    int version_patch = plc_tag_get_int_attribute(0, "version_patch", 0);
+    int rc = PLCTAG_STATUS_OK;
+
+    /* check the library version. */
+    if(plc_tag_check_lib_version(REQUIRED_VERSION) != PLCTAG_STATUS_OK) {
+        printf("Required compatible library version %d.%d.%d not available, found %d.%d.%d!\n", REQUIRED_VERSION, version_major, version_minor, version_patch);
+        return 1;
+    }
+
+    printf("Starting with library version %d.%d.%d.\n", version_major, version_minor, version_patch);
+
+    write_tag = plc_tag_create(WRITE_TAG_PATH, DATA_TIMEOUT);
+    if(write_tag < 0) {
+        printf("ERROR %s: Could not create tag!\n", plc_tag_decode_error(write_tag));
+        return 1;
+    }
+
+    /* start from a known value. */
+    plc_tag_set_float32(write_tag, 4, 0.0f);
+    plc_tag_set_float32(write_tag, 8, 0.0f);
+    plc_tag_set_float32(write_tag, 12, 0.0f);
+    rc = write_value(write_tag, 0.0f);
+
+    if(rc == PLCTAG_STATUS_OK) {
+        watch_tag = plc_tag_create(WATCH_TAG_PATH, DATA_TIMEOUT);
+        if(watch_tag < 0) {
+            printf("ERROR %s: Could not create tag!\n", plc_tag_decode_error(watch_tag));
+            rc = watch_tag;
+        } else if(plc_tag_get_int_attribute(watch_tag, "change_detect", 0) != 1) {
+            printf("ERROR: a deadband should turn on change detection!\n");
+            rc = PLCTAG_ERR_BAD_CONFIG;
+        } else {
+            rc = plc_tag_register_callback(watch_tag, tag_callback);
+        }
+    }
+
+    /* the first automatic read is new data, the rest find the same data. */
+    if(rc == PLCTAG_STATUS_OK) {
+        util_sleep_ms(SETTLE_MS);
+        rc = check_counts("the first reads", 1, 0);
+    }
+
+    /* inside the deadband. */
+    if(rc == PLCTAG_STATUS_OK && (rc = write_value(write_tag, 0.5f)) == PLCTAG_STATUS_OK) {
+        rc = check_counts("a small change", 1, 0);
+    }
+
+    /* the deadband is from the value at the last change, so this adds up to more than the deadband. */
+    if(rc == PLCTAG_STATUS_OK && (rc = write_value(write_tag, 1.5f)) == PLCTAG_STATUS_OK) {
+        rc = check_counts("a change past the deadband", 2, 0);
+    }
+
+    /* reads that are not automatic still report completion. */
+    if(rc == PLCTAG_STATUS_OK) {
+        rc = plc_tag_read(watch_tag, DATA_TIMEOUT);
+
+        if(rc == PLCTAG_STATUS_OK) {
+            rc = check_counts("a direct read", 2, 1);
+        }
+    }
+
+    /* without change detection, every automatic read is reported. */
+    if(rc == PLCTAG_STATUS_OK) {
+        rc = plc_tag_set_int_attribute(watch_tag, "change_detect", 0);
+
+        if(rc == PLCTAG_STATUS_OK) {
+            util_sleep_ms(SETTLE_MS);
+
+            if(read_completed < 3) {
+                printf("ERROR: only %d read completions without change detection!\n", read_completed);
+                rc = PLCTAG_ERR_BAD_DATA;
+            }
+        }
+    }
+
+    if(watch_tag > 0) {
+        plc_tag_destroy(watch_tag);
+    }
+
+    if(rc == PLCTAG_STATUS_OK) {
+        rc = check_changed_elements();
+    }
+
+    if(rc == PLCTAG_STATUS_OK) {
+        rc = check_adaptive_reads();
+    }
+
+    plc_tag_destroy(write_tag);
+
+    if(rc != PLCTAG_STATUS_OK) {
+        return 1;
+    }
+
+    printf("SUCCESS!\n");
+
+    return 0;
+}
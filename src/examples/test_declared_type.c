@@ -0,0 +1,182 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by Kyle Hayes                                      *
+ *   Author Kyle Hayes  kyle.hayes@gmail.com                               *
+ *                                                                         *
+ * This software is available under either the Mozilla Public License      *
+ * version 2.0 or the GNU LGPL version 2 (or later) license, whichever     *
+ * you choose.                                                             *
+ *                                                                         *
+ * MPL 2.0:                                                                *
+ *                                                                         *
+ *   This Source Code Form is subject to the terms of the Mozilla Public   *
+ *   License, v. 2.0. If a copy of the MPL was not distributed with this   *
+ *   file, You can obtain one at http://mozilla.org/MPL/2.0/.              *
+ *                                                                         *
+ *                                                                         *
+ * LGPL 2:                                                                 *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU Library General Public License as       *
+ *   published by the Free Software Foundation; either version 2 of the    *
+ *   License, or (at your option) any later version.                       *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU Library General Public     *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include "../lib/libplctag.h"
+#include "utils.h"
+
+#define REQUIRED_VERSION 2,1,4
+
+#define TAG_ATTRIBS "protocol=ab-eip&gateway=127.0.0.1&path=1,0&cpu=LGX"
+#define ELEM_COUNT (200)
+#define DATA_TIMEOUT 5000
+
+/*
+ * Create tags that declare their CIP type, by name and by type code, and
+ * write them without reading them first.  A plain tag reads the values
+ * back.  A type the library does not know must fail creation.
+ */
+
+static int32_t checker = 0;
+static int32_t by_name = 0;
+static int32_t by_code = 0;
+
+
+static int create_tags(void)
+{
+    const char *bad_attribs[] = {
+        TAG_ATTRIBS "&name=TestBigArray[0]&elem_count=1&cip_type=udt",
+        TAG_ATTRIBS "&name=TestBigArray[0]&elem_count=32&cip_type=bool"
+    };
+
+    checker = plc_tag_create(TAG_ATTRIBS "&elem_size=4&name=TestBigArray[600]&elem_count=400", DATA_TIMEOUT);
+    if(checker < 0) {
+        printf("ERROR %s: Could not create the checking tag!\n", plc_tag_decode_error(checker));
+        return checker;
+    }
+
+    by_name = plc_tag_create(TAG_ATTRIBS "&name=TestBigArray[600]&elem_count=200&cip_type=dint", DATA_TIMEOUT);
+    by_code = plc_tag_create(TAG_ATTRIBS "&name=TestBigArray[800]&elem_count=200&cip_type=0xC4", DATA_TIMEOUT);
+    if(by_name < 0 || by_code < 0) {
+        printf("ERROR: Could not create the declared type tags!\n");
+        return PLCTAG_ERR_CREATE;
+    }
+
+    /* nothing was read, so the data is all zeros. */
+    if(plc_tag_get_size(by_name) != ELEM_COUNT * 4 || plc_tag_get_int32(by_name, 0) != 0) {
+        printf("ERROR: the declared type tag is not set up right!\n");
+        return PLCTAG_ERR_BAD_DATA;
+    }
+
+    /* unknown types and BOOL arrays cannot be declared. */
+    for(int i=0; i < (int)(sizeof(bad_attribs)/sizeof(bad_attribs[0])); i++) {
+        int32_t bad_tag = plc_tag_create(bad_attribs[i], DATA_TIMEOUT);
+
+        if(bad_tag != PLCTAG_ERR_UNSUPPORTED) {
+            printf("ERROR: tag %s got %s!\n", bad_attribs[i], plc_tag_decode_error(bad_tag));
+
+            if(bad_tag > 0) {
+                plc_tag_destroy(bad_tag);
+            }
+
+            return PLCTAG_ERR_BAD_STATUS;
+        }
+    }
+
+    return PLCTAG_STATUS_OK;
+}
+
+
+static int run_test(void)
+{
+    int rc = PLCTAG_STATUS_OK;
+    int32_t base = (int32_t)(util_time_ms() % 1000);
+
+    for(int i=0; i < ELEM_COUNT; i++) {
+        plc_tag_set_int32(by_name, i * 4, base + i);
+        plc_tag_set_int32(by_code, i * 4, base - i);
+    }
+
+    if((rc = plc_tag_write(by_name, DATA_TIMEOUT)) != PLCTAG_STATUS_OK || (rc = plc_tag_write(by_code, DATA_TIMEOUT)) != PLCTAG_STATUS_OK) {
+        printf("ERROR: %s: unable to write the declared type tags!\n", plc_tag_decode_error(rc));
+        return rc;
+    }
+
+    if((rc = plc_tag_read(checker, DATA_TIMEOUT)) != PLCTAG_STATUS_OK) {
+        printf("ERROR: %s: unable to read the checking tag!\n", plc_tag_decode_error(rc));
+        return rc;
+    }
+
+    for(int i=0; i < ELEM_COUNT; i++) {
+        int32_t named = plc_tag_get_int32(checker, i * 4);
+        int32_t coded = plc_tag_get_int32(checker, (ELEM_COUNT + i) * 4);
+
+        if(named != base + i || coded != base - i) {
+            printf("ERROR: element %d is %d and %d, expected %d and %d!\n", i, named, coded, base + i, base - i);
+            return PLCTAG_ERR_BAD_DATA;
+        }
+    }
+
+    /* reads still work and keep the declared type. */
+    if((rc = plc_tag_read(by_code, DATA_TIMEOUT)) != PLCTAG_STATUS_OK || plc_tag_get_int32(by_code, 4) != base - 1) {
+        printf("ERROR: %s: unable to read back the declared type tag!\n", plc_tag_decode_error(rc));
+        return (rc == PLCTAG_STATUS_OK ? PLCTAG_ERR_BAD_DATA : rc);
+    }
+
+    printf("Declared type tags wrote without reading first.\n");
+
+    return PLCTAG_STATUS_OK;
+}
+
+
+int main()
+{
+    int version_major = plc_tag_get_int_attribute(0, "version_major", 0);
+    int version_minor = plc_tag_get_int_attribute(0, "version_minor", 0);
+    int version_patch = plc_tag_get_int_attribute(0, "version_patch", 0);
+    int rc = PLCTAG_STATUS_OK;
+
+    /* check the library version. */
+    if(plc_tag_check_lib_version(REQUIRED_VERSION) != PLCTAG_STATUS_OK) {
+        printf("Required compatible library version %d.%d.%d not available, found %d.%d.%d!\n", REQUIRED_VERSION, version_major, version_minor, version_patch);
+        return 1;
+    }
+
+    printf("Starting with library version %d.%d.%d.\n", version_major, version_minor, version_patch);
+
+    rc = create_tags();
+
+    if(rc == PLCTAG_STATUS_OK) {
+        rc = run_test();
+    }
+
+    if(by_name > 0) {
+        plc_tag_destroy(by_name);
+    }
+
+    if(by_code > 0) {
+        plc_tag_destroy(by_code);
+    }
+
+    if(checker > 0) {
+        plc_tag_destroy(checker);
+    }
+
+    if(rc != PLCTAG_STATUS_OK) {
+        return 1;
+    }
+
+    printf("SUCCESS!\n");
+
+    return 0;
+}
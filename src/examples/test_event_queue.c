@@ -0,0 +1,192 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by Kyle Hayes                                      *
+ *   Author Kyle Hayes  kyle.hayes@gmail.com                               *
+ *                                                                         *
+ * This software is available under either the Mozilla Public License      *
+ * version 2.0 or the GNU LGPL version 2 (or later) license, whichever     *
+ * you choose.                                                             *
+ *                                                                         *
+ * MPL 2.0:                                                                *
+ *                                                                         *
+ *   This Source Code Form is subject to the terms of the Mozilla Public   *
+ *   License, v. 2.0. If a copy of the MPL was not distributed with this   *
+ *   file, You can obtain one at http://mozilla.org/MPL/2.0/.              *
+ *                                                                         *
+ *                                                                         *
+ * LGPL 2:                                                                 *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU Library General Public License as       *
+ *   published by the Free Software Foundation; either version 2 of the    *
+ *   License, or (at your option) any later version.                       *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU Library General Public     *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include "../lib/libplctag.h"
+#include "utils.h"
+
+#ifndef _WIN32
+    #include <poll.h>
+#endif
+
+#define REQUIRED_VERSION 2,1,4
+
+#define TAG_PATH "protocol=ab-eip&gateway=127.0.0.1&path=1,0&cpu=LGX&elem_size=4&elem_count=1&name=TestBigArray[%d]"
+#define DATA_TIMEOUT 5000
+
+#define NUM_TAGS (10)
+
+/*
+ * Wait until the queue handle is readable or the timeout passes.  The
+ * handle is an event HANDLE on Windows and a file descriptor elsewhere.
+ */
+
+static int wait_for_handle(intptr_t handle, int timeout_ms)
+{
+#ifdef _WIN32
+    if(WaitForSingleObject((HANDLE)handle, (DWORD)timeout_ms) == WAIT_FAILED) {
+        printf("ERROR: WaitForSingleObject() failed!\n");
+        return 1;
+    }
+#else
+    struct pollfd pfd;
+
+    pfd.fd = (int)handle;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+
+    if(poll(&pfd, 1, timeout_ms) < 0) {
+        printf("ERROR: poll() failed!\n");
+        return 1;
+    }
+#endif
+
+    return 0;
+}
+
+
+/*
+ * Check that tag completions show up on an event queue and that the queue
+ * handle can be waited on.
+ */
+
+static int wait_for_events(plc_tag_event_queue_t queue, int event, int num_events)
+{
+    plc_tag_event_t events[NUM_TAGS];
+    intptr_t handle = plc_tag_event_queue_get_fd(queue);
+    int64_t timeout_time = util_time_ms() + DATA_TIMEOUT;
+    int count = 0;
+
+    while(count < num_events && util_time_ms() < timeout_time) {
+        int num = 0;
+
+        if(wait_for_handle(handle, 100)) {
+            return 1;
+        }
+
+        num = plc_tag_event_queue_drain(queue, events, NUM_TAGS);
+        if(num < 0) {
+            printf("ERROR: %s: unable to drain event queue!\n", plc_tag_decode_error(num));
+            return 1;
+        }
+
+        for(int i=0; i < num; i++) {
+            if(events[i].event != event || events[i].status != PLCTAG_STATUS_OK) {
+                printf("ERROR: unexpected event %d with status %s for tag %d!\n", events[i].event, plc_tag_decode_error(events[i].status), events[i].tag_id);
+                return 1;
+            }
+        }
+
+        count += num;
+    }
+
+    if(count != num_events) {
+        printf("ERROR: got %d events, expected %d!\n", count, num_events);
+        return 1;
+    }
+
+    return 0;
+}
+
+
+int main()
+{
+    int32_t tags[NUM_TAGS] = {0};
+    plc_tag_event_queue_t queue = NULL;
+    char tag_path[256];
+    int version_major = plc_tag_get_int_attribute(0, "version_major", 0);
+    int version_minor = plc_tag_get_int_attribute(0, "version_minor", 0);
+    int version_patch = plc_tag_get_int_attribute(0, "version_patch", 0);
+    int rc = 0;
+
+    /* check the library version. */
+    if(plc_tag_check_lib_version(REQUIRED_VERSION) != PLCTAG_STATUS_OK) {
+        printf("Required compatible library version %d.%d.%d not available, found %d.%d.%d!\n", REQUIRED_VERSION, version_major, version_minor, version_patch);
+        return 1;
+    }
+
+    printf("Starting with library version %d.%d.%d.\n", version_major, version_minor, version_patch);
+
+    queue = plc_tag_event_queue_create(0);
+    if(!queue) {
+        printf("ERROR: unable to create event queue!\n");
+        return 1;
+    }
+
+    for(int i=0; i < NUM_TAGS && rc == 0; i++) {
+        snprintf(tag_path, sizeof(tag_path), TAG_PATH, i);
+
+        tags[i] = plc_tag_create(tag_path, DATA_TIMEOUT);
+        if(tags[i] < 0) {
+            printf("ERROR %s: Could not create tag %d!\n", plc_tag_decode_error(tags[i]), i);
+            rc = 1;
+        } else {
+            plc_tag_bind_event_queue(tags[i], queue);
+        }
+    }
+
+    /* start all the reads and wait for the completions on the queue. */
+    if(rc == 0) {
+        for(int i=0; i < NUM_TAGS; i++) {
+            plc_tag_read(tags[i], 0);
+        }
+
+        rc = wait_for_events(queue, PLCTAG_EVENT_READ_COMPLETED, NUM_TAGS);
+    }
+
+    /* destroying the tags queues one last event each. */
+    for(int i=0; i < NUM_TAGS; i++) {
+        if(tags[i] > 0) {
+            plc_tag_destroy(tags[i]);
+        }
+    }
+
+    if(rc == 0) {
+        rc = wait_for_events(queue, PLCTAG_EVENT_DESTROYED, NUM_TAGS);
+    }
+
+    if(rc == 0 && plc_tag_event_queue_get_dropped(queue) != 0) {
+        printf("ERROR: %d events were dropped!\n", plc_tag_event_queue_get_dropped(queue));
+        rc = 1;
+    }
+
+    plc_tag_event_queue_destroy(queue);
+
+    if(rc != 0) {
+        return 1;
+    }
+
+    printf("SUCCESS!\n");
+
+    return 0;
+}
@@ -0,0 +1,194 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by Kyle Hayes                                      *
+ *   Author Kyle Hayes  kyle.hayes@gmail.com                               *
+ *                                                                         *
+ * This software is available under either the Mozilla Public License      *
+ * version 2.0 or the GNU LGPL version 2 (or later) license, whichever     *
+ * you choose.                                                             *
+ *                                                                         *
+ * MPL 2.0:                                                                *
+ *                                                                         *
+ *   This Source Code Form is subject to the terms of the Mozilla Public   *
+ *   License, v. 2.0. If a copy of the MPL was not distributed with this   *
+ *   file, You can obtain one at http://mozilla.org/MPL/2.0/.              *
+ *                                                                         *
+ *                                                                         *
+ * LGPL 2:                                                                 *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU Library General Public License as       *
+ *   published by the Free Software Foundation; either version 2 of the    *
+ *   License, or (at your option) any later version.                       *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU Library General Public     *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "../lib/libplctag.h"
+#include "utils.h"
+
+#define REQUIRED_VERSION 2,1,4
+
+#define TAG_PATH "protocol=ab-eip&gateway=127.0.0.1&path=1,0&cpu=LGX&elem_size=4&elem_count=1&name=TestBigArray[%d]%s"
+#define DATA_TIMEOUT 5000
+
+#define NUM_TAGS (20)
+
+/*
+ * Check the batch read and write calls.  One set of tags writes values and
+ * a second set on the same elements reads them back.
+ */
+
+static int create_tags(int32_t *tags, const char *extra_attribs)
+{
+    char tag_path[256];
+
+    for(int i=0; i < NUM_TAGS; i++) {
+        snprintf(tag_path, sizeof(tag_path), TAG_PATH, i, extra_attribs);
+
+        tags[i] = plc_tag_create(tag_path, DATA_TIMEOUT);
+        if(tags[i] < 0) {
+            printf("ERROR %s: Could not create tag %d!\n", plc_tag_decode_error(tags[i]), i);
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+
+static void destroy_tags(int32_t *tags)
+{
+    for(int i=0; i < NUM_TAGS; i++) {
+        if(tags[i] > 0) {
+            plc_tag_destroy(tags[i]);
+        }
+    }
+}
+
+
+static int check_values(int32_t *readers, int32_t base)
+{
+    int statuses[NUM_TAGS];
+    int rc = PLCTAG_STATUS_OK;
+
+    rc = plc_tag_read_many(readers, statuses, NUM_TAGS, DATA_TIMEOUT);
+    if(rc != PLCTAG_STATUS_OK) {
+        printf("ERROR: %s: unable to read tags!\n", plc_tag_decode_error(rc));
+        return 1;
+    }
+
+    for(int i=0; i < NUM_TAGS; i++) {
+        if(statuses[i] != PLCTAG_STATUS_OK) {
+            printf("ERROR: %s: bad status for tag %d!\n", plc_tag_decode_error(statuses[i]), i);
+            return 1;
+        }
+
+        if(plc_tag_get_int32(readers[i], 0) != base + i) {
+            printf("ERROR: tag %d has value %d, expected %d!\n", i, plc_tag_get_int32(readers[i], 0), base + i);
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+
+int main()
+{
+    int32_t writers[NUM_TAGS] = {0};
+    int32_t readers[NUM_TAGS] = {0};
+    int32_t ids[2];
+    int statuses[NUM_TAGS];
+    int version_major = plc_tag_get_int_attribute(0, "version_major", 0);
+    int version_minor = plc_tag_get_int_attribute(0, "version_minor", 0);
+    int version_patch = plc_tag_get_int_attribute(0, "version_patch", 0);
+    int64_t start = 0;
+    int rc = PLCTAG_STATUS_OK;
+
+    /* check the library version. */
+    if(plc_tag_check_lib_version(REQUIRED_VERSION) != PLCTAG_STATUS_OK) {
+        printf("Required compatible library version %d.%d.%d not available, found %d.%d.%d!\n", REQUIRED_VERSION, version_major, version_minor, version_patch);
+        return 1;
+    }
+
+    printf("Starting with library version %d.%d.%d.\n", version_major, version_minor, version_patch);
+
+    if(create_tags(writers, "") || create_tags(readers, "")) {
+        destroy_tags(writers);
+        destroy_tags(readers);
+        return 1;
+    }
+
+    /* write all the tags in one batch. */
+    for(int i=0; i < NUM_TAGS; i++) {
+        plc_tag_set_int32(writers[i], 0, 1000 + i);
+    }
+
+    start = util_time_ms();
+
+    rc = plc_tag_write_many(writers, statuses, NUM_TAGS, DATA_TIMEOUT);
+    if(rc == PLCTAG_STATUS_OK) {
+        rc = check_values(readers, 1000);
+    } else {
+        printf("ERROR: %s: unable to write tags!\n", plc_tag_decode_error(rc));
+    }
+
+    printf("Batch write and read of %d tags took %dms.\n", NUM_TAGS, (int)(util_time_ms() - start));
+
+    destroy_tags(writers);
+
+    if(rc != PLCTAG_STATUS_OK) {
+        destroy_tags(readers);
+        return 1;
+    }
+
+    /* a missing tag gets its own status but does not stop the others. */
+    ids[0] = readers[0];
+    ids[1] = writers[0];
+
+    rc = plc_tag_read_many(ids, statuses, 2, DATA_TIMEOUT);
+    if(rc != PLCTAG_ERR_NOT_FOUND || statuses[0] != PLCTAG_STATUS_OK || statuses[1] != PLCTAG_ERR_NOT_FOUND) {
+        printf("ERROR: expected PLCTAG_ERR_NOT_FOUND for the destroyed tag but got %s!\n", plc_tag_decode_error(rc));
+        destroy_tags(readers);
+        return 1;
+    }
+
+    /* changes on automatic write tags are flushed without waiting for the timer. */
+    if(create_tags(writers, "&auto_sync_write_ms=60000")) {
+        destroy_tags(writers);
+        destroy_tags(readers);
+        return 1;
+    }
+
+    for(int i=0; i < NUM_TAGS; i++) {
+        plc_tag_set_int32(writers[i], 0, 2000 + i);
+    }
+
+    rc = plc_tag_write_many(NULL, NULL, 0, DATA_TIMEOUT);
+    if(rc == PLCTAG_STATUS_OK) {
+        rc = check_values(readers, 2000);
+    } else {
+        printf("ERROR: %s: unable to flush tags!\n", plc_tag_decode_error(rc));
+    }
+
+    destroy_tags(writers);
+    destroy_tags(readers);
+
+    if(rc != PLCTAG_STATUS_OK) {
+        return 1;
+    }
+
+    printf("SUCCESS!\n");
+
+    return 0;
+}
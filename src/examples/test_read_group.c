@@ -0,0 +1,206 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by Kyle Hayes                                      *
+ *   Author Kyle Hayes  kyle.hayes@gmail.com                               *
+ *                                                                         *
+ * This software is available under either the Mozilla Public License      *
+ * version 2.0 or the GNU LGPL version 2 (or later) license, whichever     *
+ * you choose.                                                             *
+ *                                                                         *
+ * MPL 2.0:                                                                *
+ *                                                                         *
+ *   This Source Code Form is subject to the terms of the Mozilla Public   *
+ *   License, v. 2.0. If a copy of the MPL was not distributed with this   *
+ *   file, You can obtain one at http://mozilla.org/MPL/2.0/.              *
+ *                                                                         *
+ *                                                                         *
+ * LGPL 2:                                                                 *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU Library General Public License as       *
+ *   published by the Free Software Foundation; either version 2 of the    *
+ *   License, or (at your option) any later version.                       *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU Library General Public     *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include "../lib/libplctag.h"
+#include "utils.h"
+
+#define REQUIRED_VERSION 2,1,4
+
+#define TAG_ATTRIBS "protocol=ab-eip&gateway=127.0.0.1&path=1,0&cpu=LGX&elem_size=4&elem_count=1"
+#define NUM_TAGS (6)
+#define FIRST_INDEX (300)
+#define NUM_ROUNDS (5)
+#define DATA_TIMEOUT 5000
+
+/*
+ * Put a few scattered elements of an array into one read group.  Change
+ * all of them with a separate tag, then read just one member.  Every
+ * member must get the new values from that one read and report the same
+ * read_group_seq.
+ */
+
+static int32_t writer = 0;
+static int32_t tags[NUM_TAGS] = {0};
+
+
+/* spread the members out so that the reads cannot be coalesced. */
+static int tag_index(int i)
+{
+    return i * 17;
+}
+
+
+static int create_tags(void)
+{
+    char attribs[256];
+
+    snprintf(attribs, sizeof(attribs), "protocol=ab-eip&gateway=127.0.0.1&path=1,0&cpu=LGX&elem_size=4&name=TestBigArray[%d]&elem_count=%d&coalesce=0", FIRST_INDEX, tag_index(NUM_TAGS - 1) + 1);
+
+    writer = plc_tag_create(attribs, DATA_TIMEOUT);
+    if(writer < 0) {
+        printf("ERROR %s: Could not create the writer tag!\n", plc_tag_decode_error(writer));
+        return writer;
+    }
+
+    for(int i=0; i < NUM_TAGS; i++) {
+        snprintf(attribs, sizeof(attribs), TAG_ATTRIBS "&name=TestBigArray[%d]&read_group=snapshot", FIRST_INDEX + tag_index(i));
+
+        tags[i] = plc_tag_create(attribs, DATA_TIMEOUT);
+        if(tags[i] < 0) {
+            printf("ERROR %s: Could not create tag %d!\n", plc_tag_decode_error(tags[i]), i);
+            return tags[i];
+        }
+    }
+
+    return PLCTAG_STATUS_OK;
+}
+
+
+static int wait_for_group(int32_t base, int seq)
+{
+    int64_t end_time = util_time_ms() + DATA_TIMEOUT;
+    int done = 0;
+
+    /* the other members pick the data up in the background. */
+    while(!done && util_time_ms() < end_time) {
+        done = 1;
+
+        for(int i=0; i < NUM_TAGS && done; i++) {
+            if(plc_tag_get_int_attribute(tags[i], "read_group_seq", -1) != seq) {
+                done = 0;
+            }
+        }
+
+        if(!done) {
+            util_sleep_ms(1);
+        }
+    }
+
+    if(!done) {
+        printf("ERROR: timed out waiting for the group to get read %d!\n", seq);
+        return PLCTAG_ERR_TIMEOUT;
+    }
+
+    for(int i=0; i < NUM_TAGS; i++) {
+        int32_t value = plc_tag_get_int32(tags[i], 0);
+
+        if(value != base + i) {
+            printf("ERROR: tag %d is %d, expected %d!\n", i, value, base + i);
+            return PLCTAG_ERR_BAD_DATA;
+        }
+    }
+
+    return PLCTAG_STATUS_OK;
+}
+
+
+static int run_test(void)
+{
+    int rc = PLCTAG_STATUS_OK;
+    int32_t base = (int32_t)(util_time_ms() % 1000);
+
+    for(int round=0; round < NUM_ROUNDS; round++) {
+        int seq = 0;
+
+        base += 100;
+
+        for(int i=0; i < NUM_TAGS; i++) {
+            plc_tag_set_int32(writer, tag_index(i) * 4, base + i);
+        }
+
+        rc = plc_tag_write(writer, DATA_TIMEOUT);
+        if(rc != PLCTAG_STATUS_OK) {
+            printf("ERROR: %s: unable to write the new values!\n", plc_tag_decode_error(rc));
+            return rc;
+        }
+
+        /* read a different member each time. */
+        rc = plc_tag_read(tags[round % NUM_TAGS], DATA_TIMEOUT);
+        if(rc != PLCTAG_STATUS_OK) {
+            printf("ERROR: %s: unable to read tag %d!\n", plc_tag_decode_error(rc), round % NUM_TAGS);
+            return rc;
+        }
+
+        seq = plc_tag_get_int_attribute(tags[round % NUM_TAGS], "read_group_seq", -1);
+
+        if((rc = wait_for_group(base, seq)) != PLCTAG_STATUS_OK) {
+            return rc;
+        }
+
+        printf("Round %d: all members got group read %d.\n", round, seq);
+    }
+
+    return PLCTAG_STATUS_OK;
+}
+
+
+int main()
+{
+    int version_major = plc_tag_get_int_attribute(0, "version_major", 0);
+    int version_minor = plc_tag_get_int_attribute(0, "version_minor", 0);
+    int version_patch = plc_tag_get_int_attribute(0, "version_patch", 0);
+    int rc = PLCTAG_STATUS_OK;
+
+    /* check the library version. */
+    if(plc_tag_check_lib_version(REQUIRED_VERSION) != PLCTAG_STATUS_OK) {
+        printf("Required compatible library version %d.%d.%d not available, found %d.%d.%d!\n", REQUIRED_VERSION, version_major, version_minor, version_patch);
+        return 1;
+    }
+
+    printf("Starting with library version %d.%d.%d.\n", version_major, version_minor, version_patch);
+
+    rc = create_tags();
+
+    if(rc == PLCTAG_STATUS_OK) {
+        rc = run_test();
+    }
+
+    for(int i=0; i < NUM_TAGS; i++) {
+        if(tags[i] > 0) {
+            plc_tag_destroy(tags[i]);
+        }
+    }
+
+    if(writer > 0) {
+        plc_tag_destroy(writer);
+    }
+
+    if(rc != PLCTAG_STATUS_OK) {
+        return 1;
+    }
+
+    printf("SUCCESS!\n");
+
+    return 0;
+}
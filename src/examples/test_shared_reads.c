@@ -0,0 +1,200 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by Kyle Hayes                                      *
+ *   Author Kyle Hayes  kyle.hayes@gmail.com                               *
+ *                                                                         *
+ * This software is available under either the Mozilla Public License      *
+ * version 2.0 or the GNU LGPL version 2 (or later) license, whichever     *
+ * you choose.                                                             *
+ *                                                                         *
+ * MPL 2.0:                                                                *
+ *                                                                         *
+ *   This Source Code Form is subject to the terms of the Mozilla Public   *
+ *   License, v. 2.0. If a copy of the MPL was not distributed with this   *
+ *   file, You can obtain one at http://mozilla.org/MPL/2.0/.              *
+ *                                                                         *
+ *                                                                         *
+ * LGPL 2:                                                                 *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU Library General Public License as       *
+ *   published by the Free Software Foundation; either version 2 of the    *
+ *   License, or (at your option) any later version.                       *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU Library General Public     *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include "../lib/libplctag.h"
+#include "utils.h"
+
+#define REQUIRED_VERSION 2,1,4
+
+#define READ_TAG_PATH "protocol=ab-eip&gateway=127.0.0.1&path=1,0&cpu=LGX&elem_size=4&elem_count=1&name=TestBigArray[40]&auto_sync_read_ms=10"
+#define WRITE_TAG_PATH "protocol=ab-eip&gateway=127.0.0.1&path=1,0&cpu=LGX&elem_size=4&elem_count=1&name=TestBigArray[40]&coalesce=0"
+#define DATA_TIMEOUT 5000
+#define NUM_THREADS (8)
+#define NUM_ROUNDS (10)
+
+/*
+ * Read one tag from many threads at once while it also has automatic
+ * reads.  None of the reads should get PLCTAG_ERR_BUSY and every read
+ * must see the value written before it was called.  Then check that a
+ * non-blocking read while another read is in flight is queued.
+ */
+
+static int32_t read_tag = 0;
+static volatile int32_t expected = 0;
+static volatile int errors = 0;
+
+
+static void *reader(void *arg)
+{
+    int rc = PLCTAG_STATUS_OK;
+    int32_t value = 0;
+
+    (void)arg;
+
+    rc = plc_tag_read(read_tag, DATA_TIMEOUT);
+    if(rc != PLCTAG_STATUS_OK) {
+        printf("ERROR: %s: concurrent read failed!\n", plc_tag_decode_error(rc));
+        errors++;
+        return NULL;
+    }
+
+    value = plc_tag_get_int32(read_tag, 0);
+    if(value != expected) {
+        printf("ERROR: read got %d, expected %d!\n", value, expected);
+        errors++;
+    }
+
+    return NULL;
+}
+
+
+static int run_rounds(int32_t write_tag)
+{
+    int rc = PLCTAG_STATUS_OK;
+    util_thread_t threads[NUM_THREADS];
+
+    for(int round=0; round < NUM_ROUNDS && !errors; round++) {
+        expected = (int32_t)((util_time_ms() + round) % 100000);
+
+        plc_tag_set_int32(write_tag, 0, expected);
+
+        rc = plc_tag_write(write_tag, DATA_TIMEOUT);
+        if(rc != PLCTAG_STATUS_OK) {
+            printf("ERROR: %s: unable to write the tag!\n", plc_tag_decode_error(rc));
+            return rc;
+        }
+
+        for(int i=0; i < NUM_THREADS; i++) {
+            util_thread_create(&threads[i], reader, NULL);
+        }
+
+        for(int i=0; i < NUM_THREADS; i++) {
+            util_thread_join(threads[i]);
+        }
+    }
+
+    if(errors) {
+        return PLCTAG_ERR_BAD_DATA;
+    }
+
+    printf("All concurrent reads got fresh data.\n");
+
+    return PLCTAG_STATUS_OK;
+}
+
+
+static int check_queued_read(void)
+{
+    int rc = PLCTAG_STATUS_OK;
+    int64_t end_time = util_time_ms() + DATA_TIMEOUT;
+
+    for(int i=0; i < 2; i++) {
+        rc = plc_tag_read(read_tag, 0);
+        if(rc != PLCTAG_STATUS_OK && rc != PLCTAG_STATUS_PENDING) {
+            printf("ERROR: %s: non-blocking read %d failed!\n", plc_tag_decode_error(rc), i);
+            return rc;
+        }
+    }
+
+    while((rc = plc_tag_status(read_tag)) == PLCTAG_STATUS_PENDING && util_time_ms() < end_time) {
+        util_sleep_ms(1);
+    }
+
+    if(rc != PLCTAG_STATUS_OK) {
+        printf("ERROR: %s: queued read did not finish!\n", plc_tag_decode_error(rc));
+        return (rc == PLCTAG_STATUS_PENDING ? PLCTAG_ERR_TIMEOUT : rc);
+    }
+
+    printf("Non-blocking reads were queued.\n");
+
+    return PLCTAG_STATUS_OK;
+}
+
+
+int main()
+{
+    int version_major = plc_tag_get_int_attribute(0, "version_major", 0);
+    int version_minor = plc_tag_get_int_attribute(0, "version_minor", 0);
+    int version_patch = plc_tag_get_int_attribute(0, "version_patch", 0);
+    int32_t write_tag = 0;
+    int rc = PLCTAG_STATUS_OK;
+
+    /* check the library version. */
+    if(plc_tag_check_lib_version(REQUIRED_VERSION) != PLCTAG_STATUS_OK) {
+        printf("Required compatible library version %d.%d.%d not available, found %d.%d.%d!\n", REQUIRED_VERSION, version_major, version_minor, version_patch);
+        return 1;
+    }
+
+    printf("Starting with library version %d.%d.%d.\n", version_major, version_minor, version_patch);
+
+    read_tag = plc_tag_create(READ_TAG_PATH, DATA_TIMEOUT);
+    if(read_tag < 0) {
+        printf("ERROR %s: Could not create the read tag!\n", plc_tag_decode_error(read_tag));
+        return 1;
+    }
+
+    write_tag = plc_tag_create(WRITE_TAG_PATH, DATA_TIMEOUT);
+    if(write_tag < 0) {
+        printf("ERROR %s: Could not create the write tag!\n", plc_tag_decode_error(write_tag));
+        plc_tag_destroy(read_tag);
+        return 1;
+    }
+
+    rc = run_rounds(write_tag);
+
+    /* the same again, with each read call doing its own read. */
+    if(rc == PLCTAG_STATUS_OK) {
+        rc = plc_tag_set_int_attribute(read_tag, "share_reads", 0);
+    }
+
+    if(rc == PLCTAG_STATUS_OK) {
+        rc = run_rounds(write_tag);
+    }
+
+    if(rc == PLCTAG_STATUS_OK) {
+        rc = check_queued_read();
+    }
+
+    plc_tag_destroy(write_tag);
+    plc_tag_destroy(read_tag);
+
+    if(rc != PLCTAG_STATUS_OK) {
+        return 1;
+    }
+
+    printf("SUCCESS!\n");
+
+    return 0;
+}
@@ -0,0 +1,255 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by Kyle Hayes                                      *
+ *   Author Kyle Hayes  kyle.hayes@gmail.com                               *
+ *                                                                         *
+ * This software is available under either the Mozilla Public License      *
+ * version 2.0 or the GNU LGPL version 2 (or later) license, whichever     *
+ * you choose.                                                             *
+ *                                                                         *
+ * MPL 2.0:                                                                *
+ *                                                                         *
+ *   This Source Code Form is subject to the terms of the Mozilla Public   *
+ *   License, v. 2.0. If a copy of the MPL was not distributed with this   *
+ *   file, You can obtain one at http://mozilla.org/MPL/2.0/.              *
+ *                                                                         *
+ *                                                                         *
+ * LGPL 2:                                                                 *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU Library General Public License as       *
+ *   published by the Free Software Foundation; either version 2 of the    *
+ *   License, or (at your option) any later version.                       *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU Library General Public     *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include "../lib/libplctag.h"
+#include "utils.h"
+
+#define REQUIRED_VERSION 2,1,4
+
+#define FIRST_TAG_PATH "protocol=ab-eip&gateway=127.0.0.1&path=1,0&cpu=LGX&elem_size=4&elem_count=1&name=TestBigArray[30]&share=1&auto_sync_read_ms=500"
+#define SECOND_TAG_PATH "share=1&name=TestBigArray[30]&elem_count=1&elem_size=4&cpu=LGX&path=1,0&gateway=127.0.0.1&protocol=ab-eip&auto_sync_read_ms=50"
+#define RESPELLED_TAG_PATH "protocol=ab-eip&gateway=127.0.0.1&path=1, 0&plc=ControlLogix&elem_size=4&elem_count=1&name=TestBigArray[30]&share=1"
+#define DATA_TIMEOUT 5000
+#define RUN_MS (500)
+#define MIN_READS ((RUN_MS / 50) / 2)
+
+/*
+ * Check that tags with the same attributes in a different order share one
+ * tag, that each handle gets its own events and that the tag uses the
+ * fastest automatic read period.  Check that other spellings of the same
+ * attributes share the tag too.  Then check that the second handle keeps
+ * working when the first one is destroyed.
+ */
+
+static int32_t first_tag = 0;
+static int32_t second_tag = 0;
+static volatile int first_reads = 0;
+static volatile int second_reads = 0;
+static volatile int first_destroyed = 0;
+static volatile int second_destroyed = 0;
+
+
+static void tag_callback(int32_t tag_id, int event, int status)
+{
+    if(event == PLCTAG_EVENT_READ_COMPLETED && status == PLCTAG_STATUS_OK) {
+        if(tag_id == first_tag) {
+            first_reads++;
+        } else if(tag_id == second_tag) {
+            second_reads++;
+        }
+    }
+
+    if(event == PLCTAG_EVENT_DESTROYED) {
+        if(tag_id == first_tag) {
+            first_destroyed++;
+        } else if(tag_id == second_tag) {
+            second_destroyed++;
+        }
+    }
+}
+
+
+static int check_shared(void)
+{
+    int rc = PLCTAG_STATUS_OK;
+    int32_t value = 0;
+
+    /* the data is shared. */
+    value = plc_tag_get_int32(first_tag, 0) + 1;
+    plc_tag_set_int32(first_tag, 0, value);
+
+    if(plc_tag_get_int32(second_tag, 0) != value) {
+        printf("ERROR: the tags do not share their data!\n");
+        return PLCTAG_ERR_BAD_DATA;
+    }
+
+    /* the tag uses the fastest period asked for. */
+    if(plc_tag_get_int_attribute(first_tag, "auto_sync_read_ms", 0) != 50) {
+        printf("ERROR: expected the shared tag to read every 50ms, got %dms!\n", plc_tag_get_int_attribute(first_tag, "auto_sync_read_ms", 0));
+        return PLCTAG_ERR_BAD_DATA;
+    }
+
+    rc = plc_tag_write(second_tag, DATA_TIMEOUT);
+    if(rc != PLCTAG_STATUS_OK) {
+        printf("ERROR: %s: unable to write through the second handle!\n", plc_tag_decode_error(rc));
+        return rc;
+    }
+
+    util_sleep_ms(RUN_MS);
+
+    /* both handles see the automatic reads. */
+    if(first_reads < MIN_READS || second_reads < MIN_READS) {
+        printf("ERROR: expected both handles to see the automatic reads, got %d and %d!\n", first_reads, second_reads);
+        return PLCTAG_ERR_BAD_DATA;
+    }
+
+    printf("Both handles saw the reads, %d and %d.\n", first_reads, second_reads);
+
+    return PLCTAG_STATUS_OK;
+}
+
+
+/* plc=ControlLogix is cpu=LGX and "1, 0" is the same path as "1,0". */
+static int check_respelled(void)
+{
+    int32_t respelled_tag = 0;
+    int32_t value = 0;
+    int rc = PLCTAG_STATUS_OK;
+
+    respelled_tag = plc_tag_create(RESPELLED_TAG_PATH, DATA_TIMEOUT);
+    if(respelled_tag < 0) {
+        printf("ERROR %s: Could not create the respelled tag!\n", plc_tag_decode_error(respelled_tag));
+        return respelled_tag;
+    }
+
+    value = plc_tag_get_int32(first_tag, 0) + 1;
+    plc_tag_set_int32(first_tag, 0, value);
+
+    if(plc_tag_get_int32(respelled_tag, 0) != value) {
+        printf("ERROR: the respelled tag does not share the data!\n");
+        rc = PLCTAG_ERR_BAD_DATA;
+    }
+
+    plc_tag_destroy(respelled_tag);
+
+    return rc;
+}
+
+
+static int check_first_destroyed(void)
+{
+    int rc = PLCTAG_STATUS_OK;
+    int reads = 0;
+
+    plc_tag_destroy(first_tag);
+
+    if(first_destroyed != 1 || second_destroyed != 0) {
+        printf("ERROR: only the first handle should have been destroyed!\n");
+        return PLCTAG_ERR_BAD_DATA;
+    }
+
+    if(plc_tag_status(first_tag) != PLCTAG_ERR_NOT_FOUND) {
+        printf("ERROR: the first handle should be gone!\n");
+        return PLCTAG_ERR_BAD_DATA;
+    }
+
+    /* the automatic reads keep going on the second handle. */
+    reads = second_reads;
+
+    util_sleep_ms(RUN_MS);
+
+    if(second_reads - reads < MIN_READS) {
+        printf("ERROR: expected automatic reads to continue, got %d!\n", second_reads - reads);
+        return PLCTAG_ERR_BAD_DATA;
+    }
+
+    rc = plc_tag_read(second_tag, DATA_TIMEOUT);
+    if(rc != PLCTAG_STATUS_OK) {
+        printf("ERROR: %s: unable to read through the second handle!\n", plc_tag_decode_error(rc));
+        return rc;
+    }
+
+    return PLCTAG_STATUS_OK;
+}
+
+
+int main()
+{
+    int version_major = plc_tag_get_int_attribute(0, "version_major", 0);
+    int version_minor = plc_tag_get_int_attribute(0, "version_minor", 0);
+    int version_patch = plc_tag_get_int_attribute(0, "version_patch", 0);
+    int rc = PLCTAG_STATUS_OK;
+
+    /* check the library version. */
+    if(plc_tag_check_lib_version(REQUIRED_VERSION) != PLCTAG_STATUS_OK) {
+        printf("Required compatible library version %d.%d.%d not available, found %d.%d.%d!\n", REQUIRED_VERSION, version_major, version_minor, version_patch);
+        return 1;
+    }
+
+    printf("Starting with library version %d.%d.%d.\n", version_major, version_minor, version_patch);
+
+    first_tag = plc_tag_create(FIRST_TAG_PATH, DATA_TIMEOUT);
+    if(first_tag < 0) {
+        printf("ERROR %s: Could not create the first tag!\n", plc_tag_decode_error(first_tag));
+        return 1;
+    }
+
+    second_tag = plc_tag_create(SECOND_TAG_PATH, DATA_TIMEOUT);
+    if(second_tag < 0) {
+        printf("ERROR %s: Could not create the second tag!\n", plc_tag_decode_error(second_tag));
+        plc_tag_destroy(first_tag);
+        return 1;
+    }
+
+    if(second_tag == first_tag) {
+        printf("ERROR: each handle should have its own tag ID!\n");
+        rc = PLCTAG_ERR_BAD_DATA;
+    }
+
+    if(rc == PLCTAG_STATUS_OK) {
+        rc = plc_tag_register_callback(first_tag, tag_callback);
+    }
+
+    if(rc == PLCTAG_STATUS_OK) {
+        rc = plc_tag_register_callback(second_tag, tag_callback);
+    }
+
+    if(rc == PLCTAG_STATUS_OK) {
+        rc = check_shared();
+    }
+
+    if(rc == PLCTAG_STATUS_OK) {
+        rc = check_respelled();
+    }
+
+    if(rc == PLCTAG_STATUS_OK) {
+        rc = check_first_destroyed();
+    }
+
+    plc_tag_destroy(first_tag);
+    plc_tag_destroy(second_tag);
+
+    if(rc == PLCTAG_STATUS_OK && second_destroyed != 1) {
+        printf("ERROR: the second handle should have been destroyed!\n");
+        rc = PLCTAG_ERR_BAD_DATA;
+    }
+
+    if(rc != PLCTAG_STATUS_OK) {
+        return 1;
+    }
+
+    printf("SUCCESS!\n");
+
+    return 0;
+}
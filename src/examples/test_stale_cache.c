@@ -0,0 +1,191 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by Kyle Hayes                                      *
+ *   Author Kyle Hayes  kyle.hayes@gmail.com                               *
+ *                                                                         *
+ * This software is available under either the Mozilla Public License      *
+ * version 2.0 or the GNU LGPL version 2 (or later) license, whichever     *
+ * you choose.                                                             *
+ *                                                                         *
+ * MPL 2.0:                                                                *
+ *                                                                         *
+ *   This Source Code Form is subject to the terms of the Mozilla Public   *
+ *   License, v. 2.0. If a copy of the MPL was not distributed with this   *
+ *   file, You can obtain one at http://mozilla.org/MPL/2.0/.              *
+ *                                                                         *
+ *                                                                         *
+ * LGPL 2:                                                                 *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU Library General Public License as       *
+ *   published by the Free Software Foundation; either version 2 of the    *
+ *   License, or (at your option) any later version.                       *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU Library General Public     *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include "../lib/libplctag.h"
+#include "utils.h"
+
+#define REQUIRED_VERSION 2,1,4
+
+#define READ_TAG_PATH "protocol=ab-eip&gateway=127.0.0.1&path=1,0&cpu=LGX&elem_size=4&elem_count=1&name=TestBigArray[60]&read_cache_ms=100&read_cache_stale_ms=500&coalesce=0"
+#define WRITE_TAG_PATH "protocol=ab-eip&gateway=127.0.0.1&path=1,0&cpu=LGX&elem_size=4&elem_count=1&name=TestBigArray[60]&coalesce=0"
+#define DATA_TIMEOUT 5000
+
+#define TRY(f) if((rc = (f)) != PLCTAG_STATUS_OK) { break; }
+
+/*
+ * Check that a read past read_cache_ms returns the cached data right away
+ * and refreshes it in the background, and that a read past
+ * read_cache_stale_ms as well waits for new data.
+ */
+
+
+static int write_value(int32_t write_tag, int32_t value)
+{
+    int rc = PLCTAG_STATUS_OK;
+
+    plc_tag_set_int32(write_tag, 0, value);
+
+    rc = plc_tag_write(write_tag, DATA_TIMEOUT);
+    if(rc != PLCTAG_STATUS_OK) {
+        printf("ERROR: %s: unable to write the tag!\n", plc_tag_decode_error(rc));
+    }
+
+    return rc;
+}
+
+
+static int read_value(int32_t read_tag, int32_t expected, const char *what)
+{
+    int rc = plc_tag_read(read_tag, DATA_TIMEOUT);
+    int32_t value = 0;
+
+    if(rc != PLCTAG_STATUS_OK) {
+        printf("ERROR: %s: %s read failed!\n", plc_tag_decode_error(rc), what);
+        return rc;
+    }
+
+    value = plc_tag_get_int32(read_tag, 0);
+    if(value != expected) {
+        printf("ERROR: %s read got %d, expected %d!\n", what, value, expected);
+        return PLCTAG_ERR_BAD_DATA;
+    }
+
+    return PLCTAG_STATUS_OK;
+}
+
+
+static int wait_for_refresh(int32_t read_tag)
+{
+    int rc = PLCTAG_STATUS_OK;
+    int64_t end_time = util_time_ms() + DATA_TIMEOUT;
+
+    while((rc = plc_tag_status(read_tag)) == PLCTAG_STATUS_PENDING && util_time_ms() < end_time) {
+        util_sleep_ms(1);
+    }
+
+    if(rc != PLCTAG_STATUS_OK) {
+        printf("ERROR: %s: background refresh did not finish!\n", plc_tag_decode_error(rc));
+        return (rc == PLCTAG_STATUS_PENDING ? PLCTAG_ERR_TIMEOUT : rc);
+    }
+
+    return PLCTAG_STATUS_OK;
+}
+
+
+static int run_test(int32_t read_tag, int32_t write_tag)
+{
+    int rc = PLCTAG_STATUS_OK;
+    int32_t base = (int32_t)(util_time_ms() % 100000);
+
+    do {
+        /* fill the cache. */
+        TRY(write_value(write_tag, base));
+        TRY(read_value(read_tag, base, "first"));
+
+        /* past the cache time, the old value comes back and is refreshed. */
+        TRY(write_value(write_tag, base + 1));
+
+        util_sleep_ms(150);
+
+        TRY(read_value(read_tag, base, "stale"));
+        TRY(wait_for_refresh(read_tag));
+        TRY(read_value(read_tag, base + 1, "refreshed"));
+
+        printf("Stale data was returned and refreshed.\n");
+
+        /* past the stale time too, the read waits for the PLC. */
+        TRY(write_value(write_tag, base + 2));
+
+        util_sleep_ms(700);
+
+        TRY(read_value(read_tag, base + 2, "expired"));
+
+        printf("Expired data was read again.\n");
+    } while(0);
+
+    return rc;
+}
+
+
+int main()
+{
+    int version_major = plc_tag_get_int_attribute(0, "version_major", 0);
+    int version_minor = plc_tag_get_int_attribute(0, "version_minor", 0);
+    int version_patch = plc_tag_get_int_attribute(0, "version_patch", 0);
+    int32_t read_tag = 0;
+    int32_t write_tag = 0;
+    int rc = PLCTAG_STATUS_OK;
+
+    /* check the library version. */
+    if(plc_tag_check_lib_version(REQUIRED_VERSION) != PLCTAG_STATUS_OK) {
+        printf("Required compatible library version %d.%d.%d not available, found %d.%d.%d!\n", REQUIRED_VERSION, version_major, version_minor, version_patch);
+        return 1;
+    }
+
+    printf("Starting with library version %d.%d.%d.\n", version_major, version_minor, version_patch);
+
+    read_tag = plc_tag_create(READ_TAG_PATH, DATA_TIMEOUT);
+    if(read_tag < 0) {
+        printf("ERROR %s: Could not create the read tag!\n", plc_tag_decode_error(read_tag));
+        return 1;
+    }
+
+    write_tag = plc_tag_create(WRITE_TAG_PATH, DATA_TIMEOUT);
+    if(write_tag < 0) {
+        printf("ERROR %s: Could not create the write tag!\n", plc_tag_decode_error(write_tag));
+        plc_tag_destroy(read_tag);
+        return 1;
+    }
+
+    if(plc_tag_get_int_attribute(read_tag, "read_cache_stale_ms", 0) != 500) {
+        printf("ERROR: read_cache_stale_ms was not set!\n");
+        rc = PLCTAG_ERR_BAD_CONFIG;
+    }
+
+    if(rc == PLCTAG_STATUS_OK) {
+        rc = run_test(read_tag, write_tag);
+    }
+
+    plc_tag_destroy(write_tag);
+    plc_tag_destroy(read_tag);
+
+    if(rc != PLCTAG_STATUS_OK) {
+        return 1;
+    }
+
+    printf("SUCCESS!\n");
+
+    return 0;
+}
@@ -0,0 +1,124 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by Kyle Hayes                                      *
+ *   Author Kyle Hayes  kyle.hayes@gmail.com                               *
+ *                                                                         *
+ * This software is available under either the Mozilla Public License      *
+ * version 2.0 or the GNU LGPL version 2 (or later) license, whichever     *
+ * you choose.                                                             *
+ *                                                                         *
+ * MPL 2.0:                                                                *
+ *                                                                         *
+ *   This Source Code Form is subject to the terms of the Mozilla Public   *
+ *   License, v. 2.0. If a copy of the MPL was not distributed with this   *
+ *   file, You can obtain one at http://mozilla.org/MPL/2.0/.              *
+ *                                                                         *
+ *                                                                         *
+ * LGPL 2:                                                                 *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU Library General Public License as       *
+ *   published by the Free Software Foundation; either version 2 of the    *
+ *   License, or (at your option) any later version.                       *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU Library General Public     *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include "../lib/libplctag.h"
+#include "utils.h"
+
+
+
+#define REQUIRED_VERSION 2,1,4
+
+#define TAG_PATH "make=system&family=library&name=version&share=0"
+#define DATA_TIMEOUT 1000
+
+#define MAX_TAGS (131071) /* the limit documented in libplctag.h. */
+
+/*
+ * Check that the library can hold as many tags as it says, that one more
+ * fails with PLCTAG_ERR_TOO_MANY_TAGS and that destroying a tag makes room
+ * for a new one.  System tags are used because they do not need a PLC.
+ */
+
+static int32_t tags[MAX_TAGS] = {0};
+
+
+int main()
+{
+    int rc = PLCTAG_STATUS_OK;
+    int32_t tag = 0;
+    int num_tags = 0;
+    int64_t start = 0;
+    int version_major = plc_tag_get_int_attribute(0, "version_major", 0);
+    int version_minor = plc_tag_get_int_attribute(0, "version_minor", 0);
+    int version_patch = plc_tag_get_int_attribute(0, "version_patch", 0);
+
+    /* check the library version. */
+    if(plc_tag_check_lib_version(REQUIRED_VERSION) != PLCTAG_STATUS_OK) {
+        printf("Required compatible library version %d.%d.%d not available, found %d.%d.%d!\n", REQUIRED_VERSION, version_major, version_minor, version_patch);
+        return 1;
+    }
+
+    printf("Starting with library version %d.%d.%d.\n", version_major, version_minor, version_patch);
+
+    start = util_time_ms();
+
+    for(num_tags = 0; num_tags < MAX_TAGS; num_tags++) {
+        tags[num_tags] = plc_tag_create(TAG_PATH, DATA_TIMEOUT);
+        if(tags[num_tags] < 0) {
+            printf("ERROR %s: Could not create tag %d!\n", plc_tag_decode_error(tags[num_tags]), num_tags);
+            rc = tags[num_tags];
+            break;
+        }
+    }
+
+    printf("Created %d tags in %dms.\n", num_tags, (int)(util_time_ms() - start));
+
+    if(rc == PLCTAG_STATUS_OK) {
+        tag = plc_tag_create(TAG_PATH, DATA_TIMEOUT);
+        if(tag != PLCTAG_ERR_TOO_MANY_TAGS) {
+            printf("ERROR: expected PLCTAG_ERR_TOO_MANY_TAGS past the limit, got %s!\n", plc_tag_decode_error(tag));
+            rc = PLCTAG_ERR_BAD_STATUS;
+        }
+    }
+
+    if(rc == PLCTAG_STATUS_OK) {
+        /* one less tag makes room for one more. */
+        plc_tag_destroy(tags[0]);
+
+        tags[0] = plc_tag_create(TAG_PATH, DATA_TIMEOUT);
+        if(tags[0] < 0) {
+            printf("ERROR %s: Could not create a tag after destroying one!\n", plc_tag_decode_error(tags[0]));
+            rc = tags[0];
+        }
+    }
+
+    for(int i=0; i < num_tags; i++) {
+        if(tags[i] > 0) {
+            plc_tag_destroy(tags[i]);
+        }
+    }
+
+    /* in case the tag past the limit was created anyway. */
+    if(tag > 0) {
+        plc_tag_destroy(tag);
+    }
+
+    if(rc != PLCTAG_STATUS_OK) {
+        return 1;
+    }
+
+    printf("SUCCESS!\n");
+
+    return 0;
+}
@@ -0,0 +1,194 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by Kyle Hayes                                      *
+ *   Author Kyle Hayes  kyle.hayes@gmail.com                               *
+ *                                                                         *
+ * This software is available under either the Mozilla Public License      *
+ * version 2.0 or the GNU LGPL version 2 (or later) license, whichever     *
+ * you choose.                                                             *
+ *                                                                         *
+ * MPL 2.0:                                                                *
+ *                                                                         *
+ *   This Source Code Form is subject to the terms of the Mozilla Public   *
+ *   License, v. 2.0. If a copy of the MPL was not distributed with this   *
+ *   file, You can obtain one at http://mozilla.org/MPL/2.0/.              *
+ *                                                                         *
+ *                                                                         *
+ * LGPL 2:                                                                 *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU Library General Public License as       *
+ *   published by the Free Software Foundation; either version 2 of the    *
+ *   License, or (at your option) any later version.                       *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU Library General Public     *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include "../lib/libplctag.h"
+#include "utils.h"
+
+#define REQUIRED_VERSION 2,1,4
+
+#define TEMPLATE_ATTRIBS "protocol=ab-eip&gateway=127.0.0.1&path=1,0&cpu=LGX&elem_size=4&elem_count=1"
+#define SWAPPED_ATTRIBS TEMPLATE_ATTRIBS "&int32_byte_order=3210"
+#define NUM_TAGS (20)
+#define FIRST_INDEX (500)
+#define DATA_TIMEOUT 5000
+
+/*
+ * Create tags from templates and check that they read and write the same
+ * data as tags created from full attribute strings.  One template
+ * overrides the byte order and every tag made from it must use it.
+ */
+
+static int32_t tmpl = 0;
+static int32_t swapped_tmpl = 0;
+static int32_t writer = 0;
+static int32_t tags[NUM_TAGS] = {0};
+static int32_t swapped_tags[NUM_TAGS] = {0};
+
+
+static int32_t swap32(int32_t val)
+{
+    uint32_t u = (uint32_t)val;
+
+    return (int32_t)(((u & 0xFF) << 24) | ((u & 0xFF00) << 8) | ((u >> 8) & 0xFF00) | (u >> 24));
+}
+
+
+static int create_tags(void)
+{
+    char name[64];
+
+    writer = plc_tag_create(TEMPLATE_ATTRIBS "&name=TestBigArray[500]&elem_count=20", DATA_TIMEOUT);
+    if(writer < 0) {
+        printf("ERROR %s: Could not create the writer tag!\n", plc_tag_decode_error(writer));
+        return writer;
+    }
+
+    tmpl = plc_tag_create_template(TEMPLATE_ATTRIBS);
+    swapped_tmpl = plc_tag_create_template(SWAPPED_ATTRIBS);
+    if(tmpl < 0 || swapped_tmpl < 0) {
+        printf("ERROR: Could not create the templates!\n");
+        return PLCTAG_ERR_CREATE;
+    }
+
+    for(int i=0; i < NUM_TAGS; i++) {
+        snprintf(name, sizeof(name), "TestBigArray[%d]", FIRST_INDEX + i);
+
+        tags[i] = plc_tag_create_from_template(tmpl, name, 0, DATA_TIMEOUT);
+        swapped_tags[i] = plc_tag_create_from_template(swapped_tmpl, name, 1, DATA_TIMEOUT);
+
+        if(tags[i] < 0 || swapped_tags[i] < 0) {
+            printf("ERROR: Could not create tag %d from the templates!\n", i);
+            return (tags[i] < 0 ? tags[i] : swapped_tags[i]);
+        }
+    }
+
+    /* the tags stay after their templates are gone. */
+    plc_tag_destroy_template(swapped_tmpl);
+
+    if(plc_tag_create_from_template(swapped_tmpl, "TestBigArray[0]", 1, DATA_TIMEOUT) != PLCTAG_ERR_NOT_FOUND) {
+        printf("ERROR: a destroyed template was still found!\n");
+        return PLCTAG_ERR_BAD_STATUS;
+    }
+
+    return PLCTAG_STATUS_OK;
+}
+
+
+static int run_test(void)
+{
+    int rc = PLCTAG_STATUS_OK;
+    int32_t base = (int32_t)(util_time_ms() % 1000);
+
+    for(int i=0; i < NUM_TAGS; i++) {
+        plc_tag_set_int32(writer, i * 4, base + i);
+    }
+
+    rc = plc_tag_write(writer, DATA_TIMEOUT);
+    if(rc != PLCTAG_STATUS_OK) {
+        printf("ERROR: %s: unable to write the test values!\n", plc_tag_decode_error(rc));
+        return rc;
+    }
+
+    for(int i=0; i < NUM_TAGS; i++) {
+        int32_t value = 0;
+
+        if((rc = plc_tag_read(tags[i], DATA_TIMEOUT)) != PLCTAG_STATUS_OK || (rc = plc_tag_read(swapped_tags[i], DATA_TIMEOUT)) != PLCTAG_STATUS_OK) {
+            printf("ERROR: %s: unable to read tag %d!\n", plc_tag_decode_error(rc), i);
+            return rc;
+        }
+
+        if((value = plc_tag_get_int32(tags[i], 0)) != base + i) {
+            printf("ERROR: tag %d is %d, expected %d!\n", i, value, base + i);
+            return PLCTAG_ERR_BAD_DATA;
+        }
+
+        if((value = plc_tag_get_int32(swapped_tags[i], 0)) != swap32(base + i)) {
+            printf("ERROR: byte swapped tag %d is %d, expected %d!\n", i, value, swap32(base + i));
+            return PLCTAG_ERR_BAD_DATA;
+        }
+    }
+
+    printf("Tags from the templates read the right data.\n");
+
+    return PLCTAG_STATUS_OK;
+}
+
+
+int main()
+{
+    int version_major = plc_tag_get_int_attribute(0, "version_major", 0);
+    int version_minor = plc_tag_get_int_attribute(0, "version_minor", 0);
+    int version_patch = plc_tag_get_int_attribute(0, "version_patch", 0);
+    int rc = PLCTAG_STATUS_OK;
+
+    /* check the library version. */
+    if(plc_tag_check_lib_version(REQUIRED_VERSION) != PLCTAG_STATUS_OK) {
+        printf("Required compatible library version %d.%d.%d not available, found %d.%d.%d!\n", REQUIRED_VERSION, version_major, version_minor, version_patch);
+        return 1;
+    }
+
+    printf("Starting with library version %d.%d.%d.\n", version_major, version_minor, version_patch);
+
+    rc = create_tags();
+
+    if(rc == PLCTAG_STATUS_OK) {
+        rc = run_test();
+    }
+
+    for(int i=0; i < NUM_TAGS; i++) {
+        if(tags[i] > 0) {
+            plc_tag_destroy(tags[i]);
+        }
+
+        if(swapped_tags[i] > 0) {
+            plc_tag_destroy(swapped_tags[i]);
+        }
+    }
+
+    if(writer > 0) {
+        plc_tag_destroy(writer);
+    }
+
+    if(tmpl > 0) {
+        plc_tag_destroy_template(tmpl);
+    }
+
+    if(rc != PLCTAG_STATUS_OK) {
+        return 1;
+    }
+
+    printf("SUCCESS!\n");
+
+    return 0;
+}
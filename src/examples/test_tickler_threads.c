@@ -0,0 +1,139 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by Kyle Hayes                                      *
+ *   Author Kyle Hayes  kyle.hayes@gmail.com                               *
+ *                                                                         *
+ * This software is available under either the Mozilla Public License      *
+ * version 2.0 or the GNU LGPL version 2 (or later) license, whichever     *
+ * you choose.                                                             *
+ *                                                                         *
+ * MPL 2.0:                                                                *
+ *                                                                         *
+ *   This Source Code Form is subject to the terms of the Mozilla Public   *
+ *   License, v. 2.0. If a copy of the MPL was not distributed with this   *
+ *   file, You can obtain one at http://mozilla.org/MPL/2.0/.              *
+ *                                                                         *
+ *                                                                         *
+ * LGPL 2:                                                                 *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU Library General Public License as       *
+ *   published by the Free Software Foundation; either version 2 of the    *
+ *   License, or (at your option) any later version.                       *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU Library General Public     *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include "../lib/libplctag.h"
+#include "utils.h"
+
+#define REQUIRED_VERSION 2,1,4
+
+#define TAG_PATH "protocol=ab-eip&gateway=127.0.0.1&path=1,0&cpu=LGX&elem_size=4&elem_count=1&name=TestBigArray[%d]&auto_sync_read_ms=%d"
+#define DATA_TIMEOUT 5000
+
+#define NUM_TAGS (20)
+#define NUM_THREADS (4)
+#define AUTO_SYNC_MS (50)
+#define RUN_MS (1000)
+
+/*
+ * Check that the tickler thread count can be changed and that automatic
+ * reads keep running on all the tags when there is more than one
+ * tickler thread.
+ */
+
+static int32_t tags[NUM_TAGS] = {0};
+static volatile int read_counts[NUM_TAGS] = {0};
+
+
+static void tag_callback(int32_t tag_id, int event, int status)
+{
+    if(event == PLCTAG_EVENT_READ_COMPLETED && status == PLCTAG_STATUS_OK) {
+        for(int i=0; i < NUM_TAGS; i++) {
+            if(tags[i] == tag_id) {
+                read_counts[i]++;
+            }
+        }
+    }
+}
+
+
+int main()
+{
+    char tag_path[256];
+    int version_major = plc_tag_get_int_attribute(0, "version_major", 0);
+    int version_minor = plc_tag_get_int_attribute(0, "version_minor", 0);
+    int version_patch = plc_tag_get_int_attribute(0, "version_patch", 0);
+    int rc = PLCTAG_STATUS_OK;
+
+    /* check the library version. */
+    if(plc_tag_check_lib_version(REQUIRED_VERSION) != PLCTAG_STATUS_OK) {
+        printf("Required compatible library version %d.%d.%d not available, found %d.%d.%d!\n", REQUIRED_VERSION, version_major, version_minor, version_patch);
+        return 1;
+    }
+
+    printf("Starting with library version %d.%d.%d.\n", version_major, version_minor, version_patch);
+
+    if(plc_tag_set_int_attribute(0, "tickler_threads", 0) != PLCTAG_ERR_OUT_OF_BOUNDS) {
+        printf("ERROR: zero tickler threads should not be allowed!\n");
+        return 1;
+    }
+
+    rc = plc_tag_set_int_attribute(0, "tickler_threads", NUM_THREADS);
+    if(rc != PLCTAG_STATUS_OK || plc_tag_get_int_attribute(0, "tickler_threads", 0) != NUM_THREADS) {
+        printf("ERROR: %s: unable to set the number of tickler threads!\n", plc_tag_decode_error(rc));
+        return 1;
+    }
+
+    /* create the tags without automatic reads so that the callbacks are set up first. */
+    for(int i=0; i < NUM_TAGS && rc == PLCTAG_STATUS_OK; i++) {
+        snprintf(tag_path, sizeof(tag_path), TAG_PATH, i, 0);
+
+        tags[i] = plc_tag_create(tag_path, DATA_TIMEOUT);
+        if(tags[i] < 0) {
+            printf("ERROR %s: Could not create tag %d!\n", plc_tag_decode_error(tags[i]), i);
+            rc = tags[i];
+        } else {
+            rc = plc_tag_register_callback(tags[i], tag_callback);
+        }
+    }
+
+    if(rc == PLCTAG_STATUS_OK) {
+        for(int i=0; i < NUM_TAGS; i++) {
+            plc_tag_set_int_attribute(tags[i], "auto_sync_read_ms", AUTO_SYNC_MS);
+        }
+
+        util_sleep_ms(RUN_MS);
+
+        /* allow for a lot of jitter. */
+        for(int i=0; i < NUM_TAGS && rc == PLCTAG_STATUS_OK; i++) {
+            if(read_counts[i] < (RUN_MS / AUTO_SYNC_MS) / 4) {
+                printf("ERROR: tag %d only had %d automatic reads!\n", i, read_counts[i]);
+                rc = PLCTAG_ERR_TIMEOUT;
+            }
+        }
+    }
+
+    for(int i=0; i < NUM_TAGS; i++) {
+        if(tags[i] > 0) {
+            plc_tag_destroy(tags[i]);
+        }
+    }
+
+    if(rc != PLCTAG_STATUS_OK) {
+        return 1;
+    }
+
+    printf("SUCCESS!\n");
+
+    return 0;
+}
@@ -0,0 +1,231 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by Kyle Hayes                                      *
+ *   Author Kyle Hayes  kyle.hayes@gmail.com                               *
+ *                                                                         *
+ * This software is available under either the Mozilla Public License      *
+ * version 2.0 or the GNU LGPL version 2 (or later) license, whichever     *
+ * you choose.                                                             *
+ *                                                                         *
+ * MPL 2.0:                                                                *
+ *                                                                         *
+ *   This Source Code Form is subject to the terms of the Mozilla Public   *
+ *   License, v. 2.0. If a copy of the MPL was not distributed with this   *
+ *   file, You can obtain one at http://mozilla.org/MPL/2.0/.              *
+ *                                                                         *
+ *                                                                         *
+ * LGPL 2:                                                                 *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU Library General Public License as       *
+ *   published by the Free Software Foundation; either version 2 of the    *
+ *   License, or (at your option) any later version.                       *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU Library General Public     *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include "../lib/libplctag.h"
+#include "utils.h"
+
+#define REQUIRED_VERSION 2,1,4
+
+#define WRITE_TAG_PATH "protocol=ab-eip&gateway=127.0.0.1&path=1,0&cpu=LGX&elem_size=4&elem_count=8&name=TestBigArray[50]&write_queue=1&coalesce=0"
+#define READ_TAG_PATH "protocol=ab-eip&gateway=127.0.0.1&path=1,0&cpu=LGX&elem_size=4&elem_count=8&name=TestBigArray[50]&coalesce=0"
+#define DATA_TIMEOUT 5000
+#define NUM_THREADS (8)
+#define NUM_ROUNDS (20)
+#define NUM_QUEUED (50)
+
+/*
+ * Write one tag from many threads at once, each thread to its own
+ * element.  None of the writes should get PLCTAG_ERR_BUSY and the PLC
+ * must end up with the last value each thread wrote.  Then check that
+ * non-blocking writes while a write is in flight are queued and that the
+ * latest value is the one sent.
+ */
+
+static int32_t write_tag = 0;
+static volatile int errors = 0;
+
+
+static int32_t thread_value(int thread, int round)
+{
+    return (int32_t)((thread * 1000) + round);
+}
+
+
+static void *writer(void *arg)
+{
+    int thread = (int)(intptr_t)arg;
+    int rc = PLCTAG_STATUS_OK;
+
+    for(int round=0; round < NUM_ROUNDS && !errors; round++) {
+        plc_tag_set_int32(write_tag, thread * 4, thread_value(thread, round));
+
+        rc = plc_tag_write(write_tag, DATA_TIMEOUT);
+        if(rc != PLCTAG_STATUS_OK) {
+            printf("ERROR: %s: concurrent write failed!\n", plc_tag_decode_error(rc));
+            errors++;
+        }
+    }
+
+    return NULL;
+}
+
+
+static int check_plc_values(int32_t read_tag, int32_t *expected)
+{
+    int rc = plc_tag_read(read_tag, DATA_TIMEOUT);
+
+    if(rc != PLCTAG_STATUS_OK) {
+        printf("ERROR: %s: unable to read back the tag!\n", plc_tag_decode_error(rc));
+        return rc;
+    }
+
+    for(int i=0; i < NUM_THREADS; i++) {
+        int32_t value = plc_tag_get_int32(read_tag, i * 4);
+
+        if(value != expected[i]) {
+            printf("ERROR: element %d is %d, expected %d!\n", i, value, expected[i]);
+            return PLCTAG_ERR_BAD_DATA;
+        }
+    }
+
+    return PLCTAG_STATUS_OK;
+}
+
+
+static int check_concurrent_writes(int32_t read_tag)
+{
+    util_thread_t threads[NUM_THREADS];
+    int32_t expected[NUM_THREADS];
+
+    for(int i=0; i < NUM_THREADS; i++) {
+        util_thread_create(&threads[i], writer, (void *)(intptr_t)i);
+    }
+
+    for(int i=0; i < NUM_THREADS; i++) {
+        util_thread_join(threads[i]);
+        expected[i] = thread_value(i, NUM_ROUNDS - 1);
+    }
+
+    if(errors) {
+        return PLCTAG_ERR_BAD_STATUS;
+    }
+
+    if(check_plc_values(read_tag, expected) != PLCTAG_STATUS_OK) {
+        return PLCTAG_ERR_BAD_DATA;
+    }
+
+    printf("All concurrent writes were sent.\n");
+
+    return PLCTAG_STATUS_OK;
+}
+
+
+static int check_queued_writes(int32_t read_tag)
+{
+    int rc = PLCTAG_STATUS_OK;
+    int32_t expected[NUM_THREADS];
+    int64_t end_time = 0;
+
+    for(int i=0; i < NUM_THREADS; i++) {
+        expected[i] = plc_tag_get_int32(write_tag, i * 4);
+    }
+
+    for(int i=0; i < NUM_QUEUED; i++) {
+        expected[0] = (int32_t)(util_time_ms() % 100000) + i;
+
+        plc_tag_set_int32(write_tag, 0, expected[0]);
+
+        rc = plc_tag_write(write_tag, 0);
+        if(rc != PLCTAG_STATUS_OK && rc != PLCTAG_STATUS_PENDING) {
+            printf("ERROR: %s: non-blocking write %d failed!\n", plc_tag_decode_error(rc), i);
+            return rc;
+        }
+    }
+
+    end_time = util_time_ms() + DATA_TIMEOUT;
+
+    while((rc = plc_tag_status(write_tag)) == PLCTAG_STATUS_PENDING && util_time_ms() < end_time) {
+        util_sleep_ms(1);
+    }
+
+    if(rc != PLCTAG_STATUS_OK) {
+        printf("ERROR: %s: queued write did not finish!\n", plc_tag_decode_error(rc));
+        return (rc == PLCTAG_STATUS_PENDING ? PLCTAG_ERR_TIMEOUT : rc);
+    }
+
+    rc = check_plc_values(read_tag, expected);
+    if(rc != PLCTAG_STATUS_OK) {
+        return rc;
+    }
+
+    printf("Non-blocking writes were queued and the latest value was sent.\n");
+
+    return PLCTAG_STATUS_OK;
+}
+
+
+int main()
+{
+    int version_major = plc_tag_get_int_attribute(0, "version_major", 0);
+    int version_minor = plc_tag_get_int_attribute(0, "version_minor", 0);
+    int version_patch = plc_tag_get_int_attribute(0, "version_patch", 0);
+    int32_t read_tag = 0;
+    int rc = PLCTAG_STATUS_OK;
+
+    /* check the library version. */
+    if(plc_tag_check_lib_version(REQUIRED_VERSION) != PLCTAG_STATUS_OK) {
+        printf("Required compatible library version %d.%d.%d not available, found %d.%d.%d!\n", REQUIRED_VERSION, version_major, version_minor, version_patch);
+        return 1;
+    }
+
+    printf("Starting with library version %d.%d.%d.\n", version_major, version_minor, version_patch);
+
+    write_tag = plc_tag_create(WRITE_TAG_PATH, DATA_TIMEOUT);
+    if(write_tag < 0) {
+        printf("ERROR %s: Could not create the write tag!\n", plc_tag_decode_error(write_tag));
+        return 1;
+    }
+
+    read_tag = plc_tag_create(READ_TAG_PATH, DATA_TIMEOUT);
+    if(read_tag < 0) {
+        printf("ERROR %s: Could not create the read tag!\n", plc_tag_decode_error(read_tag));
+        plc_tag_destroy(write_tag);
+        return 1;
+    }
+
+    if(plc_tag_get_int_attribute(write_tag, "write_queue", 0) != 1) {
+        printf("ERROR: the write tag does not queue writes!\n");
+        rc = PLCTAG_ERR_BAD_CONFIG;
+    }
+
+    if(rc == PLCTAG_STATUS_OK) {
+        rc = check_concurrent_writes(read_tag);
+    }
+
+    if(rc == PLCTAG_STATUS_OK) {
+        rc = check_queued_writes(read_tag);
+    }
+
+    plc_tag_destroy(read_tag);
+    plc_tag_destroy(write_tag);
+
+    if(rc != PLCTAG_STATUS_OK) {
+        return 1;
+    }
+
+    printf("SUCCESS!\n");
+
+    return 0;
+}
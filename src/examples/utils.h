@@ -41,11 +41,14 @@
     #define strdup _strdup
 	#define snprintf_platform sprintf_s
 	#define sscanf_platform sscanf_s
+    typedef HANDLE util_thread_t;
 #else
     #include <unistd.h>
     #include <strings.h>
+    #include <pthread.h>
 	#define snprintf_platform snprintf
 	#define sscanf_platform sscanf
+    typedef pthread_t util_thread_t;
 #endif
 
 
@@ -58,6 +61,8 @@ extern "C" {
 
 extern int util_sleep_ms(int ms);
 extern int64_t util_time_ms(void);
+extern int util_thread_create(util_thread_t *thread, void *(*func)(void *arg), void *arg);
+extern int util_thread_join(util_thread_t thread);
 
 
 #ifdef __cplusplus
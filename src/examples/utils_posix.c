@@ -73,4 +73,24 @@ int64_t util_time_ms(void)
 
 
 
+/*
+ * thread_create
+ *
+ * Start a thread running func(arg).  Returns zero on success.
+ */
+int util_thread_create(util_thread_t *thread, void *(*func)(void *arg), void *arg)
+{
+    return pthread_create(thread, NULL, func, arg);
+}
+
 
+
+/*
+ * thread_join
+ *
+ * Wait for a thread to finish.  Returns zero on success.
+ */
+int util_thread_join(util_thread_t thread)
+{
+    return pthread_join(thread, NULL);
+}
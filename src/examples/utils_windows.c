@@ -81,3 +81,64 @@ int64_t util_time_ms(void)
     return  res;
 }
 
+
+
+/*
+ * thread_create
+ *
+ * Start a thread running func(arg).  Returns zero on success.
+ */
+
+struct thread_args {
+    void *(*func)(void *arg);
+    void *arg;
+};
+
+static DWORD WINAPI thread_start(LPVOID param)
+{
+    struct thread_args args = *(struct thread_args *)param;
+
+    free(param);
+
+    args.func(args.arg);
+
+    return 0;
+}
+
+int util_thread_create(util_thread_t *thread, void *(*func)(void *arg), void *arg)
+{
+    struct thread_args *args = (struct thread_args *)malloc(sizeof(*args));
+
+    if(!args) {
+        return 1;
+    }
+
+    args->func = func;
+    args->arg = arg;
+
+    *thread = CreateThread(NULL, 0, thread_start, args, 0, NULL);
+    if(!*thread) {
+        free(args);
+        return 1;
+    }
+
+    return 0;
+}
+
+
+
+/*
+ * thread_join
+ *
+ * Wait for a thread to finish.  Returns zero on success.
+ */
+int util_thread_join(util_thread_t thread)
+{
+    if(WaitForSingleObject(thread, INFINITE) != WAIT_OBJECT_0) {
+        return 1;
+    }
+
+    CloseHandle(thread);
+
+    return 0;
+}
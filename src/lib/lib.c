@@ -43,29 +43,199 @@
 #include <lib/version.h>
 #include <platform.h>
 #include <util/attr.h>
+#include <util/byte_shuffle.h>
+#include <util/callback_executor.h>
 #include <util/debug.h>
 #include <util/hash.h>
 #include <util/hashtable.h>
+#include <util/poll_plan.h>
 #include <util/rc.h>
+#include <util/slot_table.h>
+#include <util/timer_heap.h>
 #include <util/vector.h>
 #include <ab/ab.h>
 #include <mb/modbus.h>
 
 
-#define INITIAL_TAG_TABLE_SIZE (201)
-
 #define TAG_ID_MASK (0xFFFFFFF)
 
-#define MAX_TAG_MAP_ATTEMPTS (50)
+/*
+ * Longest time to wait for a protocol to signal before looking at the
+ * tags again anyway.
+ */
+#define TAG_WAIT_MAX_MS (100)
+
+/*
+ * Events for batch callbacks are collected here and delivered together.
+ * The arrays run in parallel.  group is scratch space for one callback's
+ * events when the batch is delivered.
+ */
+struct event_batch_t {
+    int count;
+    int capacity;
+    plc_tag_batch_callback_t *callbacks;
+    plc_tag_callback_event_t *events;
+    plc_tag_callback_event_t *group;
+};
+
+#define EVENT_BATCH_MIN_CAPACITY (32)
+
+/* a growable list of tag IDs. */
+struct tag_id_list_t {
+    int count;
+    int capacity;
+    int32_t *ids;
+};
+
+#define TAG_ID_LIST_MIN_CAPACITY (64)
+
+/*
+ * Change detection state, see tag_change_create().  is_changed is set when
+ * a read finds a change and cleared when the event is raised.  auto_read
+ * is set while the read in flight is an automatic one.  changed_bits has
+ * a bit for each element that the last completed read changed.
+ *
+ * Changes are only reported as events if report is set.  Adaptive
+ * automatic reads track changes without reporting them.
+ */
+struct tag_change_t {
+    int report;
+    int32_t size;
+    int is_changed;
+    int auto_read;
+    int float_size;
+    double deadband;
+    double deadband_pct;
+    uint8_t *last;
+    int elem_size;
+    int elem_count;
+    int num_changed;
+    uint8_t *changed_bits;
+};
+
+/* elements are compared in blocks of this many first, so unchanged parts of big arrays are quick. */
+#define TAG_CHANGE_BLOCK_ELEMS (64)
+
+/*
+ * Shared tags, see create_tag_handle().  Each tag ID onto a shared tag has
+ * a handle with the settings it asked for and its own listeners.  The
+ * handle of the tag's own ID keeps its listeners in the tag itself.
+ */
+struct tag_handle_t {
+    struct tag_handle_t *next;
+    int32_t tag_id;
+    int read_cache_ms;
+    int auto_sync_read_ms;
+    int auto_sync_write_ms;
+    void (*callback)(int32_t tag_id, int event, int status);
+    plc_tag_batch_callback_t batch_callback;
+    void *callback_context;
+    event_queue_p event_queue;
+};
+
+struct tag_share_t {
+    char *key;
+    int64_t table_key;
+    plc_tag_p tag;
+    int num_handles;
+    struct tag_handle_t *handles;
+};
+
+/* these are per handle and are left out of the key. */
+static const char *tag_share_skip_attribs[] = { "auto_sync_read_ms", "auto_sync_write_ms", "debug", "read_cache_ms", "share", NULL };
 
 /* these are only internal to the file */
 
-static volatile int32_t next_tag_id = 10; /* MAGIC */
-static volatile hashtable_p tags = NULL;
-static mutex_p tag_lookup_mutex = NULL;
+static volatile slot_table_p tags = NULL;
 
 static volatile int library_terminating = 0;
-static thread_p tag_tickler_thread = NULL;
+
+/*
+ * The tags are split among tickler shards, each with its own thread.  Tags
+ * that talk to the same gateway and path stay on the same shard, but a
+ * shard can hold the tags of many gateways and paths.
+ *
+ * A shard only looks at tags that were woken up or whose next automatic
+ * read or write is due.  Both are protected by the shard mutex.  Take the
+ * shard mutex inside a tag API mutex, never the other way around.
+ */
+#define TICKLER_MAX_SHARDS (16)
+
+struct tickler_shard_t {
+    mutex_p mutex;
+    cond_p cond;
+    timer_heap_p timers;
+    struct tag_id_list_t ready;
+    thread_p thread;
+    int plan_dirty;
+};
+
+static struct tickler_shard_t tickler_shards[TICKLER_MAX_SHARDS];
+static mutex_p tickler_config_mutex = NULL;
+static volatile int num_tickler_shards = 0;
+static volatile int tickler_threads = 1;
+
+/* the shard of each tag, by slot index, so that waking a tag does not need to look it up. */
+static volatile uint8_t *tag_shard_map = NULL;
+
+/*
+ * Each shard plans when its tags' automatic reads happen so that they pack
+ * into few packets that are spread over time.  Only tags that talk to the
+ * same gateway and path share packets, so each of those is planned alone.  The plan is redone when a
+ * tag with automatic reads comes or goes.  A window of zero turns this off.
+ */
+#define AUTO_SYNC_DEFAULT_PACKET_SIZE (500)
+#define AUTO_SYNC_REQUEST_OVERHEAD (16)
+
+static volatile int auto_sync_window_ms = 0;
+static volatile int auto_sync_packet_size = AUTO_SYNC_DEFAULT_PACKET_SIZE;
+
+/* callbacks run here when the callback_threads library attribute is set. */
+#define CALLBACK_DEFAULT_LATE_MS (100)
+#define CALLBACK_MAX_THREADS (64)
+
+static mutex_p callback_executor_mutex = NULL;
+static callback_executor_p callback_executor = NULL;
+static int callback_threads = 0;
+static int callback_queue_size = 0;
+static int callback_late_ms = CALLBACK_DEFAULT_LATE_MS;
+
+/*
+ * Tags created with the share attribute, by a hash of their sorted
+ * attributes.  The table does not hold references.  Tags are taken out
+ * of it when their last handle is destroyed.  Take this mutex outside
+ * any tag API mutex.
+ */
+#define SHARED_TAGS_INITIAL_SIZE (64)
+
+static mutex_p shared_tags_mutex = NULL;
+static hashtable_p shared_tags = NULL;
+static volatile int share_tags = 0;
+
+/*
+ * Tag templates hold attributes parsed once for many tags that differ
+ * only in their names and element counts.  The byte order worked out for
+ * the first tag is reused by the rest as long as the protocol gives them
+ * the same default.  Templates are in their own table with their own IDs.
+ */
+struct tag_template_t {
+    mutex_p mutex;
+    attr attribs;
+    tag_create_function tag_constructor;
+
+    int has_byte_order;
+    tag_byte_order_t *default_byte_order;
+    tag_byte_order_t byte_order;
+    byte_shuffle_kernel_t int16_kernel;
+    byte_shuffle_kernel_t int32_kernel;
+    byte_shuffle_kernel_t int64_kernel;
+    byte_shuffle_kernel_t float32_kernel;
+    byte_shuffle_kernel_t float64_kernel;
+};
+
+typedef struct tag_template_t *tag_template_p;
+
+static volatile slot_table_p templates = NULL;
 
 //static mutex_p global_library_mutex = NULL;
 
@@ -74,12 +244,91 @@ static thread_p tag_tickler_thread = NULL;
 /* helper functions. */
 static plc_tag_p lookup_tag(int32_t id);
 static int add_tag_lookup(plc_tag_p tag);
-static int tag_id_inc(int id);
+static int32_t create_tag(attr attribs, tag_template_p tmpl, int timeout);
+static void tag_template_destroy(void *tmpl_arg);
+static int set_template_byte_order(tag_template_p tmpl, plc_tag_p tag, attr attribs);
+static char *make_share_key(attr attribs);
+static int32_t create_tag_handle(const char *key, attr attribs, int timeout);
+static int share_tag(plc_tag_p tag, char *key);
+static int release_tag_handle(plc_tag_p tag, int32_t tag_id);
+static struct tag_handle_t *find_tag_handle_unsafe(plc_tag_p tag, int32_t tag_id);
+static void combine_tag_handles_unsafe(plc_tag_p tag);
 static THREAD_FUNC(tag_tickler_func);
+static int start_tickler_shards(int num_shards);
+static void stop_tickler_shards(void);
+static int set_tickler_threads(int num_threads);
+static uint32_t get_tag_conn_hash(attr attribs);
+static uint8_t get_tag_shard(uint32_t conn_hash);
+static void request_auto_sync_plan(uint8_t shard_index);
+static void request_auto_sync_plan_all(void);
+static void plan_auto_sync(struct tickler_shard_t *shard);
+static int64_t tickle_tag(plc_tag_p tag, struct event_batch_t *batch);
+static void schedule_tag(plc_tag_p tag, int64_t due);
+static int tag_id_list_add(struct tag_id_list_t *list, int32_t tag_id);
+static void tag_id_list_clear(struct tag_id_list_t *list);
+static int start_read_unsafe(plc_tag_p tag);
+static int start_shared_read_unsafe(plc_tag_p tag, uint32_t want_gen);
+static void read_done_unsafe(plc_tag_p tag, int status);
+static int use_stale_cache_unsafe(plc_tag_p tag);
+static int start_write_unsafe(plc_tag_p tag);
+static int start_queued_write_unsafe(plc_tag_p tag, uint32_t want_gen);
+static void write_done_unsafe(plc_tag_p tag, int status);
+static int check_completion_unsafe(plc_tag_p tag, int is_read, int64_t timeout_time);
+static int wait_for_completion(plc_tag_p tag, int is_read, int timeout);
+static int lock_tag_io(plc_tag_p tag, int64_t timeout_time);
+static void unlock_tag_io(plc_tag_p tag);
+static int do_many(int32_t *ids, int *statuses, int num_tags, int is_read, int timeout);
+static int run_many(plc_tag_p *tag_list, int *statuses, int num_tags, int is_read, int timeout);
+static int flush_dirty_tags(int timeout);
+static void mark_tag_dirty(plc_tag_p tag);
 static int set_tag_byte_order(plc_tag_p tag, attr attribs);
 static int check_byte_order_str(const char *byte_order, int length);
 // static int get_string_count_size_unsafe(plc_tag_p tag, int offset);
 static int get_string_length_unsafe(plc_tag_p tag, int offset);
+static int get_array_impl(plc_tag_p tag, int offset, void *buffer, int count, int elem_size, const byte_shuffle_kernel_t *kernel);
+static int set_array_impl(plc_tag_p tag, int offset, const void *buffer, int count, int elem_size, const byte_shuffle_kernel_t *kernel);
+static int get_bit_impl(plc_tag_p tag, int offset_bit);
+static int set_bit_impl(plc_tag_p tag, int offset_bit, int val);
+static uint64_t get_uint64_impl(plc_tag_p tag, int offset);
+static int set_uint64_impl(plc_tag_p tag, int offset, uint64_t val);
+static int64_t get_int64_impl(plc_tag_p tag, int offset);
+static int set_int64_impl(plc_tag_p tag, int offset, int64_t ival);
+static uint32_t get_uint32_impl(plc_tag_p tag, int offset);
+static int set_uint32_impl(plc_tag_p tag, int offset, uint32_t val);
+static int32_t get_int32_impl(plc_tag_p tag, int offset);
+static int set_int32_impl(plc_tag_p tag, int offset, int32_t ival);
+static uint16_t get_uint16_impl(plc_tag_p tag, int offset);
+static int set_uint16_impl(plc_tag_p tag, int offset, uint16_t val);
+static int16_t get_int16_impl(plc_tag_p tag, int offset);
+static int set_int16_impl(plc_tag_p tag, int offset, int16_t ival);
+static uint8_t get_uint8_impl(plc_tag_p tag, int offset);
+static int set_uint8_impl(plc_tag_p tag, int offset, uint8_t val);
+static int8_t get_int8_impl(plc_tag_p tag, int offset);
+static int set_int8_impl(plc_tag_p tag, int offset, int8_t ival);
+static double get_float64_impl(plc_tag_p tag, int offset);
+static int set_float64_impl(plc_tag_p tag, int offset, double fval);
+static float get_float32_impl(plc_tag_p tag, int offset);
+static int set_float32_impl(plc_tag_p tag, int offset, float fval);
+static int copy_tag_data(plc_tag_p tag, int offset, uint8_t *buffer, int length);
+static int tag_snapshot_create(plc_tag_p tag);
+static void tag_snapshot_publish(plc_tag_p tag, int offset, int length);
+static int tag_snapshot_read(plc_tag_p tag, int offset, uint8_t *buffer, int length);
+static int tag_change_create(plc_tag_p tag, attr attribs);
+static int tag_change_check_unsafe(plc_tag_p tag);
+static int tag_change_take_unsafe(plc_tag_p tag);
+static int tag_change_enable_unsafe(plc_tag_p tag, int report);
+static void adapt_auto_sync_read_unsafe(plc_tag_p tag, int changed);
+static int tag_change_check_elements(plc_tag_p tag);
+static int tag_change_check_deadbands(plc_tag_p tag);
+static int tag_change_past_deadbands(tag_change_p change, double old_val, double new_val);
+static void tag_raise_event(plc_tag_p tag, int event, int status);
+static void tag_raise_batch_event(plc_tag_p tag, int event, int status, struct event_batch_t *batch);
+static void event_batch_add(struct event_batch_t *batch, plc_tag_batch_callback_t callback, plc_tag_callback_event_t *event);
+static void event_batch_flush(struct event_batch_t *batch);
+static void event_batch_destroy(struct event_batch_t *batch);
+static void deliver_event(int32_t tag_id, void (*callback)(int32_t tag_id, int event, int status), plc_tag_batch_callback_t batch_callback, void *callback_context, event_queue_p queue, int event, int status, struct event_batch_t *batch);
+static int submit_callback(void (*callback)(int32_t tag_id, int event, int status), int32_t tag_id, int event, int status);
+static int set_callback_threads(int num_threads);
 // static int get_string_capacity_unsafe(plc_tag_p tag, int offset);
 // static int get_string_padding_unsafe(plc_tag_p tag, int offset);
 // static int get_string_total_length_unsafe(plc_tag_p tag, int offset);
@@ -129,22 +378,53 @@ int lib_init(void)
 
     pdebug(DEBUG_INFO,"Setting up global library data.");
 
-    pdebug(DEBUG_INFO,"Creating tag hashtable.");
-    if((tags = hashtable_create(INITIAL_TAG_TABLE_SIZE)) == NULL) { /* MAGIC */
-        pdebug(DEBUG_ERROR, "Unable to create tag hashtable!");
+    pdebug(DEBUG_INFO,"Creating tag lookup table.");
+    if((tags = slot_table_create()) == NULL) {
+        pdebug(DEBUG_ERROR, "Unable to create tag lookup table!");
         return PLCTAG_ERR_NO_MEM;
     }
 
-    pdebug(DEBUG_INFO,"Creating tag hashtable mutex.");
-    rc = mutex_create((mutex_p *)&tag_lookup_mutex);
-    if (rc != PLCTAG_STATUS_OK) {
-        pdebug(DEBUG_ERROR, "Unable to create tag hashtable mutex!");
+    pdebug(DEBUG_INFO,"Creating tag template lookup table.");
+    if((templates = slot_table_create()) == NULL) {
+        pdebug(DEBUG_ERROR, "Unable to create tag template lookup table!");
+        return PLCTAG_ERR_NO_MEM;
+    }
+
+    pdebug(DEBUG_INFO,"Creating tag shard map.");
+    if((tag_shard_map = (uint8_t *)mem_alloc(slot_table_max_slots())) == NULL) {
+        pdebug(DEBUG_ERROR, "Unable to create tag shard map!");
+        return PLCTAG_ERR_NO_MEM;
+    }
+
+    rc = mutex_create(&tickler_config_mutex);
+    if(rc != PLCTAG_STATUS_OK) {
+        pdebug(DEBUG_ERROR, "Unable to create tickler configuration mutex!");
+        return rc;
+    }
+
+    pdebug(DEBUG_INFO,"Creating callback executor mutex.");
+    rc = mutex_create(&callback_executor_mutex);
+    if(rc != PLCTAG_STATUS_OK) {
+        pdebug(DEBUG_ERROR, "Unable to create callback executor mutex!");
+        return rc;
+    }
+
+    pdebug(DEBUG_INFO,"Creating shared tag table.");
+    rc = mutex_create(&shared_tags_mutex);
+    if(rc != PLCTAG_STATUS_OK) {
+        pdebug(DEBUG_ERROR, "Unable to create shared tag table mutex!");
+        return rc;
+    }
+
+    if((shared_tags = hashtable_create(SHARED_TAGS_INITIAL_SIZE)) == NULL) {
+        pdebug(DEBUG_ERROR, "Unable to create shared tag table!");
+        return PLCTAG_ERR_NO_MEM;
     }
 
-    pdebug(DEBUG_INFO,"Creating tag tickler thread.");
-    rc = thread_create(&tag_tickler_thread, tag_tickler_func, 32*1024, NULL);
+    pdebug(DEBUG_INFO,"Creating tag tickler threads.");
+    rc = start_tickler_shards(tickler_threads);
     if (rc != PLCTAG_STATUS_OK) {
-        pdebug(DEBUG_ERROR, "Unable to create tag tickler thread!");
+        pdebug(DEBUG_ERROR, "Unable to create tag tickler threads!");
     }
 
     pdebug(DEBUG_INFO,"Done.");
@@ -161,22 +441,46 @@ void lib_teardown(void)
 
     library_terminating = 1;
 
-    if(tag_tickler_thread) {
-        pdebug(DEBUG_INFO,"Tearing down tag tickler thread.");
-        thread_join(tag_tickler_thread);
-        thread_destroy(&tag_tickler_thread);
-        tag_tickler_thread = NULL;
+    pdebug(DEBUG_INFO,"Tearing down tag tickler threads.");
+    stop_tickler_shards();
+
+    if(tickler_config_mutex) {
+        mutex_destroy(&tickler_config_mutex);
+        tickler_config_mutex = NULL;
+    }
+
+    if(tag_shard_map) {
+        mem_free((void *)tag_shard_map);
+        tag_shard_map = NULL;
+    }
+
+    if(callback_executor_mutex) {
+        pdebug(DEBUG_INFO, "Tearing down callback executor.");
+        rc_dec(callback_executor);
+        callback_executor = NULL;
+        callback_threads = 0;
+        mutex_destroy(&callback_executor_mutex);
+        callback_executor_mutex = NULL;
+    }
+
+    if(shared_tags_mutex) {
+        pdebug(DEBUG_INFO, "Destroying shared tag table.");
+        hashtable_destroy(shared_tags);
+        shared_tags = NULL;
+        share_tags = 0;
+        mutex_destroy(&shared_tags_mutex);
+        shared_tags_mutex = NULL;
     }
 
-    if(tag_lookup_mutex) {
-        pdebug(DEBUG_INFO,"Tearing down tag lookup mutex.");
-        mutex_destroy(&tag_lookup_mutex);
-        tag_lookup_mutex = NULL;
+    if(templates) {
+        pdebug(DEBUG_INFO, "Destroying tag template lookup table.");
+        slot_table_destroy(templates);
+        templates = NULL;
     }
 
     if(tags) {
-        pdebug(DEBUG_INFO, "Destroying tag hashtable.");
-        hashtable_destroy(tags);
+        pdebug(DEBUG_INFO, "Destroying tag lookup table.");
+        slot_table_destroy(tags);
         tags = NULL;
     }
 
@@ -188,206 +492,372 @@ void lib_teardown(void)
 
 
 
-THREAD_FUNC(tag_tickler_func)
+/*
+ * Do the automatic reads and writes and check for completions on one tag.
+ *
+ * Returns the time at which the tag next needs to be looked at, or
+ * INT64_MAX if it does not need to be looked at until something wakes it.
+ */
+
+int64_t tickle_tag(plc_tag_p tag, struct event_batch_t *batch)
 {
-    (void)arg;
+    int events[PLCTAG_EVENT_DATA_CHANGED+1] =  {0};
+    int64_t next_due = INT64_MAX;
 
-    debug_set_tag_id(0);
+    /* try to hold the tag API mutex while all this goes on. */
+    if(mutex_try_lock(tag->api_mutex) == PLCTAG_STATUS_OK) {
+        /*
+         * if an API call is waiting on this tag, that call owns the
+         * operation in flight and will report its completion.
+         */
 
-    pdebug(DEBUG_INFO, "Starting.");
+        /* if this tag has automatic writes, then there are many things we should check */
+        if(tag->auto_sync_write_ms > 0 && !tag->api_waiting) {
+            /* has the tag been written to? */
+            if(tag->tag_is_dirty) {
+                /* abort any in flight read if the tag is dirty. */
+                if(tag->read_in_flight) {
+                    if(tag->vtable->abort) {
+                        tag->vtable->abort(tag);
+                    }
 
-    while(!library_terminating) {
-        int max_index = 0;
+                    pdebug(DEBUG_DETAIL, "Aborting in-flight automatic read!");
 
-        critical_block(tag_lookup_mutex) {
-            max_index = hashtable_capacity(tags);
-        }
+                    tag->read_complete = 0;
+                    tag->read_in_flight = 0;
 
-        for(int i=0; i < max_index; i++) {
-            plc_tag_p tag = NULL;
+                    /* FIXME - should we report an ABORT event here? */
+                    events[PLCTAG_EVENT_ABORTED] = 1;
+                }
 
-            critical_block(tag_lookup_mutex) {
-                /* look up the max index again. it may have changed. */
-                max_index = hashtable_capacity(tags);
+                /* have we already done something about it? */
+                if(!tag->auto_sync_next_write) {
+                    /* we need to queue up a new write. */
+                    tag->auto_sync_next_write = time_ms() + tag->auto_sync_write_ms;
 
-                if(i < max_index) {
-                    tag = hashtable_get_index(tags, i);
+                    pdebug(DEBUG_DETAIL, "Queueing up automatic write in %dms.", tag->auto_sync_write_ms);
+                } else if(!tag->write_in_flight && tag->auto_sync_next_write <= time_ms()) {
+                    pdebug(DEBUG_DETAIL, "Triggering automatic write start.");
 
-                    if(tag) {
-                        debug_set_tag_id(tag->tag_id);
-                        tag = rc_inc(tag);
+                    /* clear out any outstanding reads. */
+                    if(tag->read_in_flight && tag->vtable->abort) {
+                        tag->vtable->abort(tag);
+                        tag->read_in_flight = 0;
                     }
-                } else {
-                    debug_set_tag_id(0);
-                    tag = NULL;
+
+                    tag->tag_is_dirty = 0;
+                    tag->write_in_flight = 1;
+                    tag->write_gen++;
+                    tag->auto_sync_next_write = 0;
+
+                    if(tag->vtable->write) {
+                        tag->status = (int8_t)tag->vtable->write(tag);
+                    }
+
+                    events[PLCTAG_EVENT_WRITE_STARTED] = 1;
                 }
             }
+        }
 
-            if(tag) {
-                int events[PLCTAG_EVENT_DESTROYED+1] =  {0};
-
-                debug_set_tag_id(tag->tag_id);
-
-                /* try to hold the tag API mutex while all this goes on. */
-                if(mutex_try_lock(tag->api_mutex) == PLCTAG_STATUS_OK) {
-                    /* if this tag has automatic writes, then there are many things we should check */
-                    if(tag->auto_sync_write_ms > 0) {
-                        /* has the tag been written to? */
-                        if(tag->tag_is_dirty) {
-                            /* abort any in flight read if the tag is dirty. */
-                            if(tag->read_in_flight) {
-                                if(tag->vtable->abort) {
-                                    tag->vtable->abort(tag);
-                                }
-
-                                pdebug(DEBUG_DETAIL, "Aborting in-flight automatic read!");
-
-                                tag->read_complete = 0;
-                                tag->read_in_flight = 0;
-
-                                /* FIXME - should we report an ABORT event here? */
-                                events[PLCTAG_EVENT_ABORTED] = 1;
-                            }
-
-                            /* have we already done something about it? */
-                            if(!tag->auto_sync_next_write) {
-                                /* we need to queue up a new write. */
-                                tag->auto_sync_next_write = time_ms() + tag->auto_sync_write_ms;
-
-                                pdebug(DEBUG_DETAIL, "Queueing up automatic write in %dms.", tag->auto_sync_write_ms);
-                            } else if(!tag->write_in_flight && tag->auto_sync_next_write <= time_ms()) {
-                                pdebug(DEBUG_DETAIL, "Triggering automatic write start.");
-
-                                /* clear out any outstanding reads. */
-                                if(tag->read_in_flight && tag->vtable->abort) {
-                                    tag->vtable->abort(tag);
-                                    tag->read_in_flight = 0;
-                                }
-
-                                tag->tag_is_dirty = 0;
-                                tag->write_in_flight = 1;
-                                tag->auto_sync_next_write = 0;
-
-                                if(tag->vtable->write) {
-                                    tag->status = (int8_t)tag->vtable->write(tag);
-                                }
-
-                                events[PLCTAG_EVENT_WRITE_STARTED] = 1;
-                            }
-                        }
-                    }
+        /* start a write that a non-blocking API call asked for while the tag was busy. */
+        if(tag->write_queued && !tag->api_waiting && !tag->read_in_flight && !tag->write_in_flight) {
+            int rc = PLCTAG_STATUS_OK;
 
-                    /* if this tag has automatic reads, we need to check that state too. */
-                    if(tag->auto_sync_read_ms > 0) {
-                        int64_t current_time = time_ms();
+            pdebug(DEBUG_DETAIL, "Starting queued write.");
 
-                        /* do we need to read? */
-                        if(tag->auto_sync_next_read <= current_time) {
-                            /* make sure that we do not have an outstanding read or write. */
-                            if(!tag->read_in_flight && !tag->tag_is_dirty && !tag->write_in_flight) {
-                                int64_t periods = 0;
+            rc = start_write_unsafe(tag);
+            tag->status = (int8_t)rc;
 
-                                pdebug(DEBUG_DETAIL, "Triggering automatic read start.");
+            /* it may be done already. */
+            events[PLCTAG_EVENT_WRITE_COMPLETED] = (rc != PLCTAG_STATUS_PENDING);
+        }
 
-                                tag->read_in_flight = 1;
+        /* start a read that a non-blocking API call asked for while the tag was busy. */
+        if(tag->read_queued && !tag->api_waiting && !tag->read_in_flight && !tag->write_in_flight) {
+            int rc = PLCTAG_STATUS_OK;
 
-                                if(tag->vtable->read) {
-                                    tag->status = (int8_t)tag->vtable->read(tag);
-                                }
+            pdebug(DEBUG_DETAIL, "Starting queued read.");
 
-                                /*
-                                 * schedule the next read.
-                                 *
-                                 * Note that there will be some jitter.  In that case we want to skip
-                                 * to the next read time that is a whole multiple of the read period.
-                                 *
-                                 * This keeps the jitter from slowly moving the polling cycle.
-                                 */
-                                periods = (current_time - tag->auto_sync_next_read)/tag->auto_sync_read_ms;
+            tag->read_queued = 0;
 
-                                /* warn if we need to skip more than one period. */
-                                if(tag->auto_sync_next_read && periods > 0) {
-                                    pdebug(DEBUG_WARN, "Skipping multiple read periods due to long delay!");
-                                }
+            rc = start_read_unsafe(tag);
+            tag->status = (int8_t)rc;
 
-                                tag->auto_sync_next_read += (periods + 1) * tag->auto_sync_read_ms;
-                                pdebug(DEBUG_WARN, "Scheduling next read at time %"PRId64".", tag->auto_sync_next_read);
+            /* it may be done already. */
+            events[PLCTAG_EVENT_READ_COMPLETED] = (rc != PLCTAG_STATUS_PENDING);
+        }
 
-                                events[PLCTAG_EVENT_READ_STARTED] = 1;
-                            }
-                        }
-                    }
+        /* if this tag has automatic reads, we need to check that state too. */
+        if(tag->auto_sync_read_ms > 0 && !tag->api_waiting) {
+            int64_t current_time = time_ms();
 
-                    /* call the tickler function if we can. */
-                    if(tag->vtable->tickler) {
-                        /* call the tickler on the tag. */
-                        tag->vtable->tickler(tag);
+            /* the planner moved this tag's reads, so start over at the next read on the new phase. */
+            if(tag->auto_sync_replan) {
+                int64_t period = tag->auto_sync_read_ms;
 
-                        if(tag->read_complete) {
-                            tag->read_complete = 0;
-                            tag->read_in_flight = 0;
+                tag->auto_sync_replan = 0;
+                tag->auto_sync_next_read = (((current_time - tag->auto_sync_phase_ms) / period) + 1) * period + tag->auto_sync_phase_ms;
+            }
 
-                            events[PLCTAG_EVENT_READ_COMPLETED] = 1;
-                        }
+            /* do we need to read? */
+            if(tag->auto_sync_next_read <= current_time) {
+                /* make sure that we do not have an outstanding read or write. */
+                if(!tag->read_in_flight && !tag->tag_is_dirty && !tag->write_in_flight) {
+                    int64_t period = (tag->auto_sync_read_cur_ms > 0 ? tag->auto_sync_read_cur_ms : tag->auto_sync_read_ms);
+                    int64_t periods = 0;
 
-                        if(tag->write_complete) {
-                            tag->write_complete = 0;
-                            tag->write_in_flight = 0;
-                            tag->auto_sync_next_write = 0;
+                    pdebug(DEBUG_DETAIL, "Triggering automatic read start.");
 
-                            events[PLCTAG_EVENT_WRITE_COMPLETED] = 1;
-                        }
+                    tag->read_in_flight = 1;
+                    tag->read_gen++;
+
+                    if(tag->vtable->read) {
+                        tag->status = (int8_t)tag->vtable->read(tag);
                     }
 
-                    /* we are done with the tag API mutex now. */
-                    mutex_unlock(tag->api_mutex);
+                    /* with change detection, automatic reads only report changes and errors. */
+                    if(tag->change) {
+                        tag->change->auto_read = 1;
+                    }
 
-                    /* call the callback outside the API mutex. */
-                    if(tag->callback) {
-                        /* was there a read start? */
-                        if(events[PLCTAG_EVENT_READ_STARTED]) {
-                            pdebug(DEBUG_DETAIL, "Tag read started.");
-                            tag->callback(tag->tag_id, PLCTAG_EVENT_READ_STARTED, plc_tag_status(tag->tag_id));
-                        }
+                    /*
+                     * schedule the next read.
+                     *
+                     * Note that there will be some jitter.  In that case we want to skip
+                     * to the next read time that is a whole multiple of the read period.
+                     *
+                     * This keeps the jitter from slowly moving the polling cycle.
+                     */
+                    periods = (current_time - tag->auto_sync_next_read)/period;
+
+                    /* warn if we need to skip more than one period. */
+                    if(tag->auto_sync_next_read && periods > 0) {
+                        pdebug(DEBUG_WARN, "Skipping multiple read periods due to long delay!");
+                    }
 
-                        /* was there a write start? */
-                        if(events[PLCTAG_EVENT_WRITE_STARTED]) {
-                            pdebug(DEBUG_DETAIL, "Tag write started.");
-                            tag->callback(tag->tag_id, PLCTAG_EVENT_WRITE_STARTED, plc_tag_status(tag->tag_id));
-                        }
+                    tag->auto_sync_next_read += (periods + 1) * period;
+                    pdebug(DEBUG_WARN, "Scheduling next read at time %"PRId64".", tag->auto_sync_next_read);
 
-                        /* was there an abort? */
-                        if(events[PLCTAG_EVENT_ABORTED]) {
-                            pdebug(DEBUG_DETAIL, "Tag operation aborted.");
-                            tag->callback(tag->tag_id, PLCTAG_EVENT_ABORTED, plc_tag_status(tag->tag_id));
-                        }
+                    events[PLCTAG_EVENT_READ_STARTED] = ((tag->change && tag->change->report) ? 0 : 1);
+                }
+            }
+        }
 
-                        /* was there a read completion? */
-                        if(events[PLCTAG_EVENT_READ_COMPLETED]) {
-                            pdebug(DEBUG_DETAIL, "Tag read completed.");
-                            tag->callback(tag->tag_id, PLCTAG_EVENT_READ_COMPLETED, plc_tag_status(tag->tag_id));
-                        }
+        /* call the tickler function if we can. */
+        if(tag->vtable->tickler) {
+            /* call the tickler on the tag. */
+            tag->vtable->tickler(tag);
 
-                        /* was there a write completion? */
-                        if(events[PLCTAG_EVENT_WRITE_COMPLETED]) {
-                            pdebug(DEBUG_DETAIL, "Tag write completed.");
-                            tag->callback(tag->tag_id, PLCTAG_EVENT_WRITE_COMPLETED, plc_tag_status(tag->tag_id));
-                        }
+            if(tag->read_complete && !tag->api_waiting) {
+                int quiet = 0;
+
+                tag->read_complete = 0;
+                tag->read_in_flight = 0;
+
+                /* all the fragments are in, make them visible. */
+                tag_snapshot_publish(tag, 0, tag->size);
+
+                if(tag->change) {
+                    int is_auto_read = tag->change->auto_read;
+                    int changed = 0;
+
+                    tag->change->auto_read = 0;
+
+                    changed = tag_change_check_unsafe(tag);
+
+                    if(is_auto_read && tag->vtable->status(tag) == PLCTAG_STATUS_OK) {
+                        adapt_auto_sync_read_unsafe(tag, changed);
+                        quiet = tag->change->report;
                     }
+
+                    events[PLCTAG_EVENT_DATA_CHANGED] = tag_change_take_unsafe(tag);
                 }
+
+                events[PLCTAG_EVENT_READ_COMPLETED] = !quiet;
+
+                read_done_unsafe(tag, tag->vtable->status(tag));
+            }
+
+            if(tag->write_complete && !tag->api_waiting) {
+                tag->write_complete = 0;
+                tag->write_in_flight = 0;
+                tag->auto_sync_next_write = 0;
+
+                events[PLCTAG_EVENT_WRITE_COMPLETED] = 1;
+
+                write_done_unsafe(tag, tag->vtable->status(tag));
+            }
+        }
+
+        /*
+         * when does this tag next need to be looked at?  If an API call is
+         * waiting on the tag, it will wake us when it is done.
+         */
+        if(!tag->api_waiting) {
+            if(tag->auto_sync_read_ms > 0 && !tag->read_in_flight && !tag->tag_is_dirty && !tag->write_in_flight && tag->auto_sync_next_read < next_due) {
+                next_due = tag->auto_sync_next_read;
+            }
+
+            if(tag->auto_sync_write_ms > 0 && tag->auto_sync_next_write && !tag->write_in_flight && tag->auto_sync_next_write < next_due) {
+                next_due = tag->auto_sync_next_write;
+            }
+
+            /* a queued read or write can start now. */
+            if((tag->read_queued || tag->write_queued) && !tag->read_in_flight && !tag->write_in_flight) {
+                next_due = time_ms();
+            }
+
+            /* the protocol wakes the tag when a response comes in, but check now and then anyway. */
+            if((tag->read_in_flight || tag->write_in_flight || tag->status == PLCTAG_STATUS_PENDING) && time_ms() + TAG_WAIT_MAX_MS < next_due) {
+                next_due = time_ms() + TAG_WAIT_MAX_MS;
+            }
+        }
+
+        /* we are done with the tag API mutex now. */
+        mutex_unlock(tag->api_mutex);
+
+        /* call the callback outside the API mutex. */
+        if(tag->callback || tag->batch_callback || tag->event_queue || tag->share) {
+            /* was there a read start? */
+            if(events[PLCTAG_EVENT_READ_STARTED]) {
+                pdebug(DEBUG_DETAIL, "Tag read started.");
+                tag_raise_batch_event(tag, PLCTAG_EVENT_READ_STARTED, plc_tag_status(tag->tag_id), batch);
+            }
+
+            /* was there a write start? */
+            if(events[PLCTAG_EVENT_WRITE_STARTED]) {
+                pdebug(DEBUG_DETAIL, "Tag write started.");
+                tag_raise_batch_event(tag, PLCTAG_EVENT_WRITE_STARTED, plc_tag_status(tag->tag_id), batch);
+            }
+
+            /* was there an abort? */
+            if(events[PLCTAG_EVENT_ABORTED]) {
+                pdebug(DEBUG_DETAIL, "Tag operation aborted.");
+                tag_raise_batch_event(tag, PLCTAG_EVENT_ABORTED, plc_tag_status(tag->tag_id), batch);
+            }
+
+            /* was there a read completion? */
+            if(events[PLCTAG_EVENT_READ_COMPLETED]) {
+                pdebug(DEBUG_DETAIL, "Tag read completed.");
+                tag_raise_batch_event(tag, PLCTAG_EVENT_READ_COMPLETED, plc_tag_status(tag->tag_id), batch);
+            }
+
+            /* did the read find new data? */
+            if(events[PLCTAG_EVENT_DATA_CHANGED]) {
+                pdebug(DEBUG_DETAIL, "Tag data changed.");
+                tag_raise_batch_event(tag, PLCTAG_EVENT_DATA_CHANGED, PLCTAG_STATUS_OK, batch);
+            }
+
+            /* was there a write completion? */
+            if(events[PLCTAG_EVENT_WRITE_COMPLETED]) {
+                pdebug(DEBUG_DETAIL, "Tag write completed.");
+                tag_raise_batch_event(tag, PLCTAG_EVENT_WRITE_COMPLETED, plc_tag_status(tag->tag_id), batch);
+            }
+        }
+    } else {
+        /* try again on the next pass. */
+        next_due = time_ms() + 1;
+    }
+
+    return next_due;
+}
+
+
+
+
+THREAD_FUNC(tag_tickler_func)
+{
+    struct tickler_shard_t *shard = (struct tickler_shard_t *)arg;
+    struct event_batch_t batch = {0};
+    struct tag_id_list_t work = {0};
+
+    debug_set_tag_id(0);
+
+    pdebug(DEBUG_INFO, "Starting shard %d.", (int)(shard - tickler_shards));
+
+    while(!library_terminating) {
+        uint32_t io_seq = cond_seq(shard->cond);
+        int64_t now = time_ms();
+        int64_t next_wake = now + TAG_WAIT_MAX_MS;
+        int more_ready = 0;
+        int plan_dirty = 0;
+
+        critical_block(shard->mutex) {
+            plan_dirty = shard->plan_dirty;
+            shard->plan_dirty = 0;
+        }
+
+        /* the tags whose reads move are put on the ready list. */
+        if(plan_dirty) {
+            plan_auto_sync(shard);
+        }
+
+        /*
+         * only look at the tags that were woken up and the tags that are due.
+         * Tags with nothing to do cost nothing.
+         */
+        critical_block(shard->mutex) {
+            struct tag_id_list_t tmp = work;
+            int64_t due = 0;
+            int32_t tag_id = 0;
+
+            work = shard->ready;
+            shard->ready = tmp;
+            shard->ready.count = 0;
+
+            while(timer_heap_peek(shard->timers, &due, NULL) == PLCTAG_STATUS_OK && due <= now) {
+                timer_heap_pop(shard->timers, NULL, &tag_id);
+                tag_id_list_add(&work, tag_id);
             }
+        }
 
+        for(int i=0; i < work.count; i++) {
+            plc_tag_p tag = lookup_tag(work.ids[i]);
+
+            /* the tag may have been destroyed since it was queued. */
             if(tag) {
+                int64_t next_due = tickle_tag(tag, &batch);
+
+                if(next_due != INT64_MAX) {
+                    schedule_tag(tag, next_due);
+                }
+
                 debug_set_tag_id(0);
                 rc_dec(tag);
             }
         }
 
-        if(!library_terminating) {
-            sleep_ms(1);
+        work.count = 0;
+
+        /* send the batch callbacks everything from this pass. */
+        event_batch_flush(&batch);
+
+        critical_block(shard->mutex) {
+            int64_t due = 0;
+
+            if(timer_heap_peek(shard->timers, &due, NULL) == PLCTAG_STATUS_OK && due < next_wake) {
+                next_wake = due;
+            }
+
+            more_ready = (shard->ready.count > 0);
+        }
+
+        /*
+         * wait until something completes, a tag is woken up or the next
+         * automatic read or write is due.
+         */
+        if(!library_terminating && !more_ready) {
+            int64_t wait_ms = next_wake - time_ms();
+
+            if(wait_ms > 0) {
+                cond_wait(shard->cond, &io_seq, (int)wait_ms);
+            }
         }
     }
 
+    event_batch_destroy(&batch);
+    tag_id_list_clear(&work);
+
     debug_set_tag_id(0);
 
     pdebug(DEBUG_INFO,"Terminating.");
@@ -396,58 +866,361 @@ THREAD_FUNC(tag_tickler_func)
 }
 
 
-/**************************************************************************
- ***************************  API Functions  ******************************
- **************************************************************************/
-
 
 /*
- * plc_tag_decode_error()
- *
- * This takes an integer error value and turns it into a printable string.
- *
- * FIXME - this should produce better errors than this!
+ * Start tickler shards until there are at least num_shards of them.
+ * Shards are only stopped when the library shuts down.
  */
 
+int start_tickler_shards(int num_shards)
+{
+    int rc = PLCTAG_STATUS_OK;
+
+    while(num_tickler_shards < num_shards) {
+        struct tickler_shard_t *shard = &tickler_shards[num_tickler_shards];
+
+        if((rc = mutex_create(&shard->mutex)) != PLCTAG_STATUS_OK) {
+            pdebug(DEBUG_ERROR, "Unable to create tickler shard mutex!");
+            break;
+        }
 
+        if((rc = cond_create(&shard->cond)) != PLCTAG_STATUS_OK) {
+            pdebug(DEBUG_ERROR, "Unable to create tickler shard condition variable!");
+            break;
+        }
 
-LIB_EXPORT const char *plc_tag_decode_error(int rc)
+        if((shard->timers = timer_heap_create(TAG_ID_LIST_MIN_CAPACITY)) == NULL) {
+            pdebug(DEBUG_ERROR, "Unable to create tickler shard timer heap!");
+            rc = PLCTAG_ERR_NO_MEM;
+            break;
+        }
+
+        if((rc = thread_create(&shard->thread, tag_tickler_func, 32*1024, shard)) != PLCTAG_STATUS_OK) {
+            pdebug(DEBUG_ERROR, "Unable to create tickler shard thread!");
+            break;
+        }
+
+        num_tickler_shards++;
+    }
+
+    return rc;
+}
+
+
+
+/* library_terminating must be set before this is called. */
+void stop_tickler_shards(void)
 {
-    switch(rc) {
-    case PLCTAG_STATUS_PENDING:
-        return "PLCTAG_STATUS_PENDING";
-    case PLCTAG_STATUS_OK:
-        return "PLCTAG_STATUS_OK";
-    case PLCTAG_ERR_ABORT:
-        return "PLCTAG_ERR_ABORT";
-    case PLCTAG_ERR_BAD_CONFIG:
-        return "PLCTAG_ERR_BAD_CONFIG";
-    case PLCTAG_ERR_BAD_CONNECTION:
-        return "PLCTAG_ERR_BAD_CONNECTION";
-    case PLCTAG_ERR_BAD_DATA:
-        return "PLCTAG_ERR_BAD_DATA";
-    case PLCTAG_ERR_BAD_DEVICE:
-        return "PLCTAG_ERR_BAD_DEVICE";
-    case PLCTAG_ERR_BAD_GATEWAY:
-        return "PLCTAG_ERR_BAD_GATEWAY";
-    case PLCTAG_ERR_BAD_PARAM:
-        return "PLCTAG_ERR_BAD_PARAM";
-    case PLCTAG_ERR_BAD_REPLY:
-        return "PLCTAG_ERR_BAD_REPLY";
-    case PLCTAG_ERR_BAD_STATUS:
-        return "PLCTAG_ERR_BAD_STATUS";
-    case PLCTAG_ERR_CLOSE:
-        return "PLCTAG_ERR_CLOSE";
-    case PLCTAG_ERR_CREATE:
-        return "PLCTAG_ERR_CREATE";
-    case PLCTAG_ERR_DUPLICATE:
-        return "PLCTAG_ERR_DUPLICATE";
-    case PLCTAG_ERR_ENCODE:
-        return "PLCTAG_ERR_ENCODE";
-    case PLCTAG_ERR_MUTEX_DESTROY:
-        return "PLCTAG_ERR_MUTEX_DESTROY";
-    case PLCTAG_ERR_MUTEX_INIT:
-        return "PLCTAG_ERR_MUTEX_INIT";
+    /* a shard that failed part way through setting up is cleaned up too. */
+    for(int i=0; i < TICKLER_MAX_SHARDS; i++) {
+        struct tickler_shard_t *shard = &tickler_shards[i];
+
+        if(shard->thread) {
+            cond_signal(shard->cond);
+            thread_join(shard->thread);
+            thread_destroy(&shard->thread);
+            shard->thread = NULL;
+        }
+
+        if(shard->timers) {
+            timer_heap_destroy(shard->timers);
+            shard->timers = NULL;
+        }
+
+        tag_id_list_clear(&shard->ready);
+
+        if(shard->cond) {
+            cond_destroy(&shard->cond);
+            shard->cond = NULL;
+        }
+
+        if(shard->mutex) {
+            mutex_destroy(&shard->mutex);
+            shard->mutex = NULL;
+        }
+    }
+
+    num_tickler_shards = 0;
+}
+
+
+
+/*
+ * Set the number of tickler shards that new tags are spread over.  Tags
+ * that already exist stay on their shards.
+ */
+
+int set_tickler_threads(int num_threads)
+{
+    int rc = PLCTAG_STATUS_OK;
+
+    pdebug(DEBUG_INFO, "Starting.");
+
+    if(num_threads < 1 || num_threads > TICKLER_MAX_SHARDS) {
+        pdebug(DEBUG_WARN, "Number of tickler threads must be between 1 and %d!", TICKLER_MAX_SHARDS);
+        return PLCTAG_ERR_OUT_OF_BOUNDS;
+    }
+
+    if((rc = initialize_modules()) != PLCTAG_STATUS_OK) {
+        pdebug(DEBUG_ERROR, "Unable to initialize the library!");
+        return rc;
+    }
+
+    critical_block(tickler_config_mutex) {
+        rc = start_tickler_shards(num_threads);
+
+        if(rc == PLCTAG_STATUS_OK) {
+            tickler_threads = num_threads;
+        }
+    }
+
+    pdebug(DEBUG_INFO, "Done.");
+
+    return rc;
+}
+
+
+
+/*
+ * Hash the gateway and path of a new tag.  Tags with the same gateway and
+ * path share a session with the PLC.
+ */
+
+uint32_t get_tag_conn_hash(attr attribs)
+{
+    const char *gateway = attr_get_str(attribs, "gateway", "");
+    const char *path = attr_get_str(attribs, "path", "");
+    uint32_t key = 0;
+
+    key = hash((uint8_t *)gateway, (size_t)str_length(gateway), 0);
+    key = hash((uint8_t *)path, (size_t)str_length(path), key);
+
+    return key;
+}
+
+
+
+/*
+ * Pick the shard for a new tag.  Tags that share a session are kept
+ * together.  Different sessions can end up on the same shard.
+ */
+
+uint8_t get_tag_shard(uint32_t conn_hash)
+{
+    int num_shards = tickler_threads;
+
+    if(num_shards <= 1) {
+        return 0;
+    }
+
+    return (uint8_t)(conn_hash % (uint32_t)num_shards);
+}
+
+
+
+/*
+ * Get a shard to plan its automatic reads again on its next pass.
+ */
+
+void request_auto_sync_plan(uint8_t shard_index)
+{
+    struct tickler_shard_t *shard = &tickler_shards[shard_index];
+
+    if(!shard->mutex) {
+        return;
+    }
+
+    critical_block(shard->mutex) {
+        shard->plan_dirty = 1;
+    }
+
+    cond_signal(shard->cond);
+}
+
+
+
+void request_auto_sync_plan_all(void)
+{
+    for(int i=0; i < num_tickler_shards; i++) {
+        request_auto_sync_plan((uint8_t)i);
+    }
+}
+
+
+
+/*
+ * Work out when each tag on the shard with automatic reads should read.
+ *
+ * The tags of each gateway and path on the shard are planned separately
+ * since only they can share a packet.
+ *
+ * Tags whose phase changes are put on the ready list and move to the new
+ * phase the next time they are tickled.  This runs on the shard's thread
+ * and that is the only place that the phase and replan fields are used.
+ */
+
+void plan_auto_sync(struct tickler_shard_t *shard)
+{
+    uint8_t shard_index = (uint8_t)(shard - tickler_shards);
+    int window_ms = auto_sync_window_ms;
+    int max_index = 0;
+    int num_entries = 0;
+    poll_plan_entry_t *entries = NULL;
+    uint32_t *conn_hashes = NULL;
+
+    pdebug(DEBUG_DETAIL, "Starting.");
+
+    max_index = slot_table_capacity(tags);
+    if(max_index <= 0) {
+        pdebug(DEBUG_DETAIL, "Done.");
+        return;
+    }
+
+    entries = (poll_plan_entry_t *)mem_alloc(max_index * (int)sizeof(poll_plan_entry_t));
+    if(!entries) {
+        pdebug(DEBUG_ERROR, "Unable to allocate memory for %d poll plan entries!", max_index);
+        return;
+    }
+
+    conn_hashes = (uint32_t *)mem_alloc(max_index * (int)sizeof(uint32_t));
+    if(!conn_hashes) {
+        pdebug(DEBUG_ERROR, "Unable to allocate memory for %d connection hashes!", max_index);
+        mem_free(entries);
+        return;
+    }
+
+    for(int i=0; i < max_index; i++) {
+        plc_tag_p tag = slot_table_get_index(tags, i);
+
+        if(!tag) {
+            continue;
+        }
+
+        /* shared tags have more than one tag ID, only plan them under their own. */
+        if(tag->tickler_shard == shard_index && tag->auto_sync_read_ms > 0 && tag->tag_id > 0 && slot_table_id_index(tag->tag_id) == i) {
+            entries[num_entries].id = tag->tag_id;
+            entries[num_entries].period_ms = tag->auto_sync_read_ms;
+            entries[num_entries].cost = tag->size + AUTO_SYNC_REQUEST_OVERHEAD;
+            entries[num_entries].phase_ms = 0;
+            conn_hashes[num_entries] = tag->conn_hash;
+            num_entries++;
+        }
+
+        rc_dec(tag);
+    }
+
+    /* with the planner turned off, the reads go back to whole multiples of the period. */
+    if(window_ms > 0) {
+        int start = 0;
+
+        while(start < num_entries) {
+            int end = start + 1;
+            int rc = PLCTAG_STATUS_OK;
+
+            /* move the rest of this gateway and path's entries up next to the first one. */
+            for(int i=end; i < num_entries; i++) {
+                if(conn_hashes[i] == conn_hashes[start]) {
+                    poll_plan_entry_t tmp_entry = entries[i];
+                    uint32_t tmp_hash = conn_hashes[i];
+
+                    entries[i] = entries[end];
+                    conn_hashes[i] = conn_hashes[end];
+                    entries[end] = tmp_entry;
+                    conn_hashes[end] = tmp_hash;
+
+                    end++;
+                }
+            }
+
+            rc = poll_plan(entries + start, end - start, window_ms, auto_sync_packet_size);
+            if(rc != PLCTAG_STATUS_OK) {
+                pdebug(DEBUG_WARN, "Unable to plan automatic reads, error %s!", plc_tag_decode_error(rc));
+                num_entries = 0;
+                break;
+            }
+
+            start = end;
+        }
+    }
+
+    for(int i=0; i < num_entries; i++) {
+        plc_tag_p tag = lookup_tag(entries[i].id);
+
+        if(!tag) {
+            continue;
+        }
+
+        if(tag->auto_sync_phase_ms != entries[i].phase_ms) {
+            tag->auto_sync_phase_ms = entries[i].phase_ms;
+            tag->auto_sync_replan = 1;
+
+            critical_block(shard->mutex) {
+                tag_id_list_add(&shard->ready, tag->tag_id);
+            }
+        }
+
+        rc_dec(tag);
+    }
+
+    mem_free(conn_hashes);
+    mem_free(entries);
+
+    pdebug(DEBUG_DETAIL, "Planned automatic reads for %d tags.", num_entries);
+}
+
+
+/**************************************************************************
+ ***************************  API Functions  ******************************
+ **************************************************************************/
+
+
+/*
+ * plc_tag_decode_error()
+ *
+ * This takes an integer error value and turns it into a printable string.
+ *
+ * FIXME - this should produce better errors than this!
+ */
+
+
+
+LIB_EXPORT const char *plc_tag_decode_error(int rc)
+{
+    switch(rc) {
+    case PLCTAG_STATUS_PENDING:
+        return "PLCTAG_STATUS_PENDING";
+    case PLCTAG_STATUS_OK:
+        return "PLCTAG_STATUS_OK";
+    case PLCTAG_ERR_ABORT:
+        return "PLCTAG_ERR_ABORT";
+    case PLCTAG_ERR_BAD_CONFIG:
+        return "PLCTAG_ERR_BAD_CONFIG";
+    case PLCTAG_ERR_BAD_CONNECTION:
+        return "PLCTAG_ERR_BAD_CONNECTION";
+    case PLCTAG_ERR_BAD_DATA:
+        return "PLCTAG_ERR_BAD_DATA";
+    case PLCTAG_ERR_BAD_DEVICE:
+        return "PLCTAG_ERR_BAD_DEVICE";
+    case PLCTAG_ERR_BAD_GATEWAY:
+        return "PLCTAG_ERR_BAD_GATEWAY";
+    case PLCTAG_ERR_BAD_PARAM:
+        return "PLCTAG_ERR_BAD_PARAM";
+    case PLCTAG_ERR_BAD_REPLY:
+        return "PLCTAG_ERR_BAD_REPLY";
+    case PLCTAG_ERR_BAD_STATUS:
+        return "PLCTAG_ERR_BAD_STATUS";
+    case PLCTAG_ERR_CLOSE:
+        return "PLCTAG_ERR_CLOSE";
+    case PLCTAG_ERR_CREATE:
+        return "PLCTAG_ERR_CREATE";
+    case PLCTAG_ERR_DUPLICATE:
+        return "PLCTAG_ERR_DUPLICATE";
+    case PLCTAG_ERR_ENCODE:
+        return "PLCTAG_ERR_ENCODE";
+    case PLCTAG_ERR_MUTEX_DESTROY:
+        return "PLCTAG_ERR_MUTEX_DESTROY";
+    case PLCTAG_ERR_MUTEX_INIT:
+        return "PLCTAG_ERR_MUTEX_INIT";
     case PLCTAG_ERR_MUTEX_LOCK:
         return "PLCTAG_ERR_MUTEX_LOCK";
     case PLCTAG_ERR_MUTEX_UNLOCK:
@@ -496,6 +1269,8 @@ LIB_EXPORT const char *plc_tag_decode_error(int rc)
         return "PLCTAG_ERR_PARTIAL";
     case PLCTAG_ERR_BUSY:
         return "PLCTAG_ERR_BUSY";
+    case PLCTAG_ERR_TOO_MANY_TAGS:
+        return "PLCTAG_ERR_TOO_MANY_TAGS";
 
     default:
         return "Unknown error.";
@@ -560,19 +1335,15 @@ LIB_EXPORT int plc_tag_check_lib_version(int req_major, int req_minor, int req_p
 /*
  * plc_tag_create()
  *
- * Just pass through to the plc_tag_create_sync() function.
+ * Parse the attributes and pass them on to create_tag().
  *
  * This is where the dispatch occurs to the protocol specific implementation.
  */
 
 LIB_EXPORT int32_t plc_tag_create(const char *attrib_str, int timeout)
 {
-    plc_tag_p tag = PLC_TAG_P_NULL;
-    int id = PLCTAG_ERR_OUT_OF_BOUNDS;
     attr attribs = NULL;
     int rc = PLCTAG_STATUS_OK;
-    int read_cache_ms = 0;
-    tag_create_function tag_constructor;
 	int debug_level = -1;
 
     pdebug(DEBUG_INFO,"Starting");
@@ -604,16 +1375,63 @@ LIB_EXPORT int32_t plc_tag_create(const char *attrib_str, int timeout)
 		set_debug_level(debug_level);
 	}
 
+    return create_tag(attribs, NULL, timeout);
+}
+
+
+
+
+/*
+ * Create a tag from parsed attributes.  The attributes are freed here.
+ *
+ * Tags created from a template use the tag constructor the template
+ * found and reuse the byte order worked out for earlier tags.
+ */
+
+int32_t create_tag(attr attribs, tag_template_p tmpl, int timeout)
+{
+    plc_tag_p tag = PLC_TAG_P_NULL;
+    int id = PLCTAG_ERR_OUT_OF_BOUNDS;
+    int rc = PLCTAG_STATUS_OK;
+    int read_cache_ms = 0;
+    int read_cache_stale_ms = 0;
+    int double_buffer = 0;
+    tag_create_function tag_constructor;
+    int share = 0;
+    char *share_key = NULL;
+
+    pdebug(DEBUG_INFO, "Starting.");
+
+    /* is there already a shared tag with these attributes? */
+    share = attr_get_int(attribs, "share", share_tags);
+    if(share) {
+        share_key = make_share_key(attribs);
+        if(!share_key) {
+            pdebug(DEBUG_ERROR, "Unable to allocate memory for shared tag key!");
+            attr_destroy(attribs);
+            return PLCTAG_ERR_NO_MEM;
+        }
+
+        id = create_tag_handle(share_key, attribs, timeout);
+
+        if(id != PLCTAG_ERR_NOT_FOUND) {
+            mem_free(share_key);
+            attr_destroy(attribs);
+            return id;
+        }
+    }
+
     /*
      * create the tag, this is protocol specific.
      *
      * If this routine wants to keep the attributes around, it needs
      * to clone them.
      */
-    tag_constructor = find_tag_create_func(attribs);
+    tag_constructor = (tmpl ? tmpl->tag_constructor : find_tag_create_func(attribs));
 
     if(!tag_constructor) {
         pdebug(DEBUG_WARN,"Tag creation failed, no tag constructor found for tag type!");
+        mem_free(share_key);
         attr_destroy(attribs);
         return PLCTAG_ERR_BAD_PARAM;
     }
@@ -622,6 +1440,7 @@ LIB_EXPORT int32_t plc_tag_create(const char *attrib_str, int timeout)
 
     if(!tag) {
         pdebug(DEBUG_WARN, "Tag creation failed, skipping mutex creation and other generic setup.");
+        mem_free(share_key);
         attr_destroy(attribs);
         return PLCTAG_ERR_CREATE;
     }
@@ -633,6 +1452,7 @@ LIB_EXPORT int32_t plc_tag_create(const char *attrib_str, int timeout)
     rc = mutex_create(&(tag->ext_mutex));
     if(rc != PLCTAG_STATUS_OK) {
         pdebug(DEBUG_WARN,"Unable to create tag external mutex!");
+        mem_free(share_key);
         rc_dec(tag);
         return PLCTAG_ERR_CREATE;
     }
@@ -640,6 +1460,25 @@ LIB_EXPORT int32_t plc_tag_create(const char *attrib_str, int timeout)
     rc = mutex_create(&(tag->api_mutex));
     if(rc != PLCTAG_STATUS_OK) {
         pdebug(DEBUG_WARN,"Unable to create tag API mutex!");
+        mem_free(share_key);
+        rc_dec(tag);
+        return PLCTAG_ERR_CREATE;
+    }
+
+    /* plc_tag_read() and plc_tag_write() hold this while they wait. */
+    rc = mutex_create(&(tag->io_mutex));
+    if(rc != PLCTAG_STATUS_OK) {
+        pdebug(DEBUG_WARN,"Unable to create tag IO mutex!");
+        mem_free(share_key);
+        rc_dec(tag);
+        return PLCTAG_ERR_CREATE;
+    }
+
+    /* signaled when something happens that API calls waiting on this tag should see. */
+    rc = cond_create(&(tag->io_cond));
+    if(rc != PLCTAG_STATUS_OK) {
+        pdebug(DEBUG_WARN,"Unable to create tag IO condition variable!");
+        mem_free(share_key);
         rc_dec(tag);
         return PLCTAG_ERR_CREATE;
     }
@@ -654,10 +1493,26 @@ LIB_EXPORT int32_t plc_tag_create(const char *attrib_str, int timeout)
     tag->read_cache_expire = (int64_t)0;
     tag->read_cache_ms = (int64_t)read_cache_ms;
 
+    /* how long past read_cache_ms cached data can be returned while it is refreshed. */
+    read_cache_stale_ms = attr_get_int(attribs, "read_cache_stale_ms", 0);
+    if(read_cache_stale_ms < 0) {
+        pdebug(DEBUG_WARN, "read_cache_stale_ms value must be positive, using zero.");
+        read_cache_stale_ms = 0;
+    }
+
+    tag->read_cache_stale_ms = (int64_t)read_cache_stale_ms;
+
+    /* can concurrent reads share one read from the PLC? */
+    tag->share_reads = (attr_get_int(attribs, "share_reads", 1) ? 1 : 0);
+
+    /* do writes while the tag is busy wait and send only the latest data? */
+    tag->write_queue = (attr_get_int(attribs, "write_queue", 0) ? 1 : 0);
+
     /* set up any automatic read/write */
     tag->auto_sync_read_ms = attr_get_int(attribs, "auto_sync_read_ms", 0);
     if(tag->auto_sync_read_ms < 0) {
         pdebug(DEBUG_WARN, "auto_sync_read_ms value must be positive!");
+        mem_free(share_key);
         rc_dec(tag);
         return PLCTAG_ERR_BAD_PARAM;
     } else if(tag->auto_sync_read_ms > 0) {
@@ -666,9 +1521,19 @@ LIB_EXPORT int32_t plc_tag_create(const char *attrib_str, int timeout)
         tag->auto_sync_next_read = (periods + 1) * tag->auto_sync_read_ms;
     }
 
+    /* adaptive automatic reads slow down to this when the data does not change. */
+    tag->auto_sync_read_max_ms = attr_get_int(attribs, "auto_sync_read_max_ms", 0);
+    if(tag->auto_sync_read_max_ms < 0) {
+        pdebug(DEBUG_WARN, "auto_sync_read_max_ms value must be positive!");
+        mem_free(share_key);
+        rc_dec(tag);
+        return PLCTAG_ERR_BAD_PARAM;
+    }
+
     tag->auto_sync_write_ms = attr_get_int(attribs, "auto_sync_write_ms", 0);
     if(tag->auto_sync_write_ms < 0) {
         pdebug(DEBUG_WARN, "auto_sync_write_ms value must be positive!");
+        mem_free(share_key);
         rc_dec(tag);
         return PLCTAG_ERR_BAD_PARAM;
     } else {
@@ -676,13 +1541,36 @@ LIB_EXPORT int32_t plc_tag_create(const char *attrib_str, int timeout)
     }
 
     /* set up the tag byte order if there are any overrides. */
-    rc = set_tag_byte_order(tag, attribs);
+    rc = (tmpl ? set_template_byte_order(tmpl, tag, attribs) : set_tag_byte_order(tag, attribs));
     if(rc != PLCTAG_STATUS_OK) {
         pdebug(DEBUG_WARN, "Unable to correctly set tag data byte order: %s!", plc_tag_decode_error(rc));
+        mem_free(share_key);
+        rc_dec(tag);
+        return rc;
+    }
+
+    /* do reads report when the data changes? */
+    rc = tag_change_create(tag, attribs);
+
+    /* adaptive automatic reads need to see changes, but do not report them. */
+    if(rc == PLCTAG_STATUS_OK && tag->auto_sync_read_max_ms > 0) {
+        rc = tag_change_enable_unsafe(tag, 0);
+    }
+
+    if(rc != PLCTAG_STATUS_OK) {
+        pdebug(DEBUG_WARN, "Unable to set up change detection: %s!", plc_tag_decode_error(rc));
+        mem_free(share_key);
         rc_dec(tag);
         return rc;
     }
 
+    /* do getters read from a published copy of the data? */
+    double_buffer = attr_get_int(attribs, "double_buffer", 0);
+
+    /* which tickler thread looks after this tag? */
+    tag->conn_hash = get_tag_conn_hash(attribs);
+    tag->tickler_shard = get_tag_shard(tag->conn_hash);
+
     /*
      * Release memory for attributes
      */
@@ -700,6 +1588,10 @@ LIB_EXPORT int32_t plc_tag_create(const char *attrib_str, int timeout)
         rc = tag->vtable->status(tag);
 
         while(rc == PLCTAG_STATUS_PENDING && timeout_time > time_ms()) {
+            /* get this before checking so that we do not miss a signal. */
+            uint32_t io_seq = cond_seq(tag->io_cond);
+            int64_t wait_ms = 0;
+
             /* give some time to the tickler function. */
             if(tag->vtable->tickler) {
                 tag->vtable->tickler(tag);
@@ -715,7 +1607,15 @@ LIB_EXPORT int32_t plc_tag_create(const char *attrib_str, int timeout)
                 break;
             }
 
-            sleep_ms(1); /* MAGIC */
+            /* wait for the protocol layer to tell us something happened. */
+            wait_ms = timeout_time - time_ms();
+            if(wait_ms > TAG_WAIT_MAX_MS) {
+                wait_ms = TAG_WAIT_MAX_MS;
+            }
+
+            if(wait_ms > 0) {
+                cond_wait(tag->io_cond, &io_seq, (int)wait_ms);
+            }
         }
 
         /*
@@ -733,32 +1633,62 @@ LIB_EXPORT int32_t plc_tag_create(const char *attrib_str, int timeout)
         /* check to see if there was an error during tag creation. */
         if(rc != PLCTAG_STATUS_OK) {
             pdebug(DEBUG_WARN, "Error %s while trying to create tag!", plc_tag_decode_error(rc));
+            mem_free(share_key);
             rc_dec(tag);
             return rc;
         }
 
-        /* clear up any remaining flags.  This should be refactored. */
+        /*
+         * clear up any remaining flags.  This should be refactored.  The
+         * caller waited, so the first read is not reported as an event.
+         */
         tag->read_in_flight = 0;
         tag->write_in_flight = 0;
+        tag->read_complete = 0;
+        tag->write_complete = 0;
 
         pdebug(DEBUG_INFO,"tag set up elapsed time %" PRId64 "ms",(time_ms()-start_time));
     }
 
-    /* map the tag to a tag ID */
-    id = add_tag_lookup(tag);
-
+    if(double_buffer) {
+        rc = tag_snapshot_create(tag);
+        if(rc != PLCTAG_STATUS_OK) {
+            pdebug(DEBUG_WARN, "Unable to set up double buffered tag data!");
+            mem_free(share_key);
+            rc_dec(tag);
+            return rc;
+        }
+    }
+
+    /* map the tag to a tag ID */
+    id = add_tag_lookup(tag);
+
     /* if the mapping failed, then punt */
     if(id < 0) {
         pdebug(DEBUG_ERROR, "Unable to map tag %p to lookup table entry, rc=%s", tag, plc_tag_decode_error(id));
+        mem_free(share_key);
         rc_dec(tag);
         return id;
     }
 
     /* save this for later. */
+    tag_shard_map[slot_table_id_index(id)] = tag->tickler_shard;
     tag->tag_id = id;
 
     debug_set_tag_id(id);
 
+    /* if this fails, the tag is just not shared. */
+    if(share_key) {
+        share_tag(tag, share_key);
+    }
+
+    if(auto_sync_window_ms > 0 && tag->auto_sync_read_ms > 0) {
+        request_auto_sync_plan(tag->tickler_shard);
+    }
+
+    /* get the tickler to set up automatic reads and writes and to finish an unwaited create. */
+    plc_tag_wake_tag(id);
+
     pdebug(DEBUG_INFO, "Returning mapped tag ID %d", id);
 
     pdebug(DEBUG_INFO,"Done.");
@@ -769,6 +1699,304 @@ LIB_EXPORT int32_t plc_tag_create(const char *attrib_str, int timeout)
 
 
 
+/*
+ * plc_tag_create_many()
+ *
+ * Create all the tags without waiting, so that the sessions connect at
+ * the same time and the first reads of the tags on each session are
+ * packed together.  Then wait for all of them until one deadline.
+ *
+ * Each entry in tag_ids gets the tag handle or the error that
+ * plc_tag_create() would have returned.  Tags that fail or are not ready
+ * in time are destroyed.
+ */
+
+LIB_EXPORT int plc_tag_create_many(const char *attrib_strs[], int num_tags, int32_t tag_ids[], int timeout)
+{
+    int rc = PLCTAG_STATUS_OK;
+    int num_failed = 0;
+    int pending = 0;
+    int64_t timeout_time = 0;
+
+    pdebug(DEBUG_INFO, "Starting.");
+
+    if(!attrib_strs || !tag_ids || num_tags <= 0) {
+        pdebug(DEBUG_WARN, "Tag attribute strings or tag ID array are null or there are no tags!");
+        return PLCTAG_ERR_BAD_PARAM;
+    }
+
+    if(timeout < 0) {
+        pdebug(DEBUG_WARN, "Timeout must not be negative!");
+        return PLCTAG_ERR_BAD_PARAM;
+    }
+
+    timeout_time = timeout + time_ms();
+
+    for(int i=0; i < num_tags; i++) {
+        tag_ids[i] = plc_tag_create(attrib_strs[i], 0);
+    }
+
+    /*
+     * every tag waits against the same deadline.  All of them have to
+     * finish, so we only need to wait on one that has not.
+     */
+    do {
+        plc_tag_p wait_tag = NULL;
+        uint32_t io_seq = 0;
+
+        pending = 0;
+
+        for(int i=0; i < num_tags && timeout; i++) {
+            plc_tag_p tag = NULL;
+            uint32_t tag_seq = 0;
+
+            if(tag_ids[i] <= 0) {
+                continue;
+            }
+
+            /* get this before checking so that we do not miss a signal. */
+            tag = lookup_tag(tag_ids[i]);
+            if(tag) {
+                tag_seq = cond_seq(tag->io_cond);
+            }
+
+            if(plc_tag_status(tag_ids[i]) == PLCTAG_STATUS_PENDING) {
+                pending++;
+
+                if(tag && !wait_tag) {
+                    wait_tag = tag;
+                    io_seq = tag_seq;
+                    tag = NULL;
+                }
+            }
+
+            rc_dec(tag);
+        }
+
+        if(wait_tag && timeout_time > time_ms()) {
+            int64_t wait_ms = timeout_time - time_ms();
+
+            if(wait_ms > TAG_WAIT_MAX_MS) {
+                wait_ms = TAG_WAIT_MAX_MS;
+            }
+
+            cond_wait(wait_tag->io_cond, &io_seq, (int)wait_ms);
+        }
+
+        rc_dec(wait_tag);
+    } while(pending > 0 && timeout_time > time_ms());
+
+    for(int i=0; i < num_tags; i++) {
+        int status = tag_ids[i];
+
+        if(tag_ids[i] > 0 && timeout) {
+            status = plc_tag_status(tag_ids[i]);
+
+            if(status == PLCTAG_STATUS_PENDING) {
+                pdebug(DEBUG_WARN, "Timeout waiting for tag %d to be ready!", i);
+                status = PLCTAG_ERR_TIMEOUT;
+            }
+
+            if(status != PLCTAG_STATUS_OK) {
+                pdebug(DEBUG_WARN, "Error %s while trying to create tag %d!", plc_tag_decode_error(status), i);
+                plc_tag_destroy(tag_ids[i]);
+                tag_ids[i] = status;
+            }
+        }
+
+        if(tag_ids[i] < 0) {
+            num_failed++;
+        }
+    }
+
+    if(num_failed > 0) {
+        pdebug(DEBUG_WARN, "%d of %d tags were not created!", num_failed, num_tags);
+        rc = PLCTAG_ERR_PARTIAL;
+    }
+
+    pdebug(DEBUG_INFO, "Done.");
+
+    return rc;
+}
+
+
+
+
+/*
+ * plc_tag_create_template()
+ *
+ * Parse the attributes shared by many tags once.  The tags are created
+ * with plc_tag_create_from_template().
+ */
+
+LIB_EXPORT int32_t plc_tag_create_template(const char *attrib_str)
+{
+    tag_template_p tmpl = NULL;
+    int32_t id = PLCTAG_STATUS_OK;
+    int rc = PLCTAG_STATUS_OK;
+	int debug_level = -1;
+
+    pdebug(DEBUG_INFO, "Starting.");
+
+    if((rc = initialize_modules()) != PLCTAG_STATUS_OK) {
+        pdebug(DEBUG_ERROR,"Unable to initialize the internal library state!");
+        return rc;
+    }
+
+    if(!attrib_str || str_length(attrib_str) == 0) {
+        pdebug(DEBUG_WARN,"Template attribute string is null or zero length!");
+        return PLCTAG_ERR_TOO_SMALL;
+    }
+
+    tmpl = (tag_template_p)rc_alloc((int)sizeof(struct tag_template_t), tag_template_destroy);
+    if(!tmpl) {
+        pdebug(DEBUG_ERROR, "Unable to allocate tag template!");
+        return PLCTAG_ERR_NO_MEM;
+    }
+
+    if((rc = mutex_create(&(tmpl->mutex))) != PLCTAG_STATUS_OK) {
+        pdebug(DEBUG_ERROR, "Unable to create tag template mutex!");
+        rc_dec(tmpl);
+        return rc;
+    }
+
+    tmpl->attribs = attr_create_from_str(attrib_str);
+    if(!tmpl->attribs) {
+        pdebug(DEBUG_WARN,"Unable to parse attribute string!");
+        rc_dec(tmpl);
+        return PLCTAG_ERR_BAD_DATA;
+    }
+
+    /* set debug level */
+	debug_level = attr_get_int(tmpl->attribs, "debug", -1);
+	if (debug_level > DEBUG_NONE) {
+		set_debug_level(debug_level);
+	}
+
+    /* the name does not change the protocol. */
+    tmpl->tag_constructor = find_tag_create_func(tmpl->attribs);
+    if(!tmpl->tag_constructor) {
+        pdebug(DEBUG_WARN,"No tag constructor found for tag type!");
+        rc_dec(tmpl);
+        return PLCTAG_ERR_BAD_PARAM;
+    }
+
+    /* the table owns the reference. */
+    id = slot_table_put(templates, tmpl);
+    if(id < 0) {
+        pdebug(DEBUG_ERROR, "Unable to map tag template to lookup table entry, rc=%s", plc_tag_decode_error(id));
+        rc_dec(tmpl);
+        return id;
+    }
+
+    pdebug(DEBUG_INFO, "Done.");
+
+    return id;
+}
+
+
+
+/*
+ * plc_tag_create_from_template()
+ *
+ * Create a tag from the template attributes with the passed name and,
+ * if it is positive, element count.  The rest works like
+ * plc_tag_create().
+ */
+
+LIB_EXPORT int32_t plc_tag_create_from_template(int32_t template_id, const char *name, int elem_count, int timeout)
+{
+    tag_template_p tmpl = NULL;
+    attr attribs = NULL;
+    int32_t id = PLCTAG_STATUS_OK;
+
+    pdebug(DEBUG_INFO, "Starting.");
+
+    if(timeout < 0) {
+        pdebug(DEBUG_WARN, "Timeout must not be negative!");
+        return PLCTAG_ERR_BAD_PARAM;
+    }
+
+    if(!name || str_length(name) == 0) {
+        pdebug(DEBUG_WARN, "Tag name is null or zero length!");
+        return PLCTAG_ERR_TOO_SMALL;
+    }
+
+    tmpl = (templates ? slot_table_get(templates, template_id) : NULL);
+    if(!tmpl) {
+        pdebug(DEBUG_WARN, "Tag template %d not found!", template_id);
+        return PLCTAG_ERR_NOT_FOUND;
+    }
+
+    /* the template attributes are never changed, so no lock is needed to copy them. */
+    attribs = attr_copy(tmpl->attribs);
+    if(!attribs || attr_set_str(attribs, "name", name) || (elem_count > 0 && attr_set_int(attribs, "elem_count", elem_count))) {
+        pdebug(DEBUG_ERROR, "Unable to set up the tag attributes!");
+        attr_destroy(attribs);
+        rc_dec(tmpl);
+        return PLCTAG_ERR_NO_MEM;
+    }
+
+    id = create_tag(attribs, tmpl, timeout);
+
+    rc_dec(tmpl);
+
+    pdebug(DEBUG_INFO, "Done.");
+
+    return id;
+}
+
+
+
+/*
+ * plc_tag_destroy_template()
+ *
+ * Tags created from the template are not affected.
+ */
+
+LIB_EXPORT int plc_tag_destroy_template(int32_t template_id)
+{
+    tag_template_p tmpl = NULL;
+
+    pdebug(DEBUG_INFO, "Starting.");
+
+    tmpl = (templates ? slot_table_remove(templates, template_id) : NULL);
+    if(!tmpl) {
+        pdebug(DEBUG_WARN, "Called with non-existent tag template!");
+        return PLCTAG_ERR_NOT_FOUND;
+    }
+
+    rc_dec(tmpl);
+
+    pdebug(DEBUG_INFO, "Done.");
+
+    return PLCTAG_STATUS_OK;
+}
+
+
+
+void tag_template_destroy(void *tmpl_arg)
+{
+    tag_template_p tmpl = (tag_template_p)tmpl_arg;
+
+    pdebug(DEBUG_INFO, "Starting.");
+
+    if(tmpl->attribs) {
+        attr_destroy(tmpl->attribs);
+        tmpl->attribs = NULL;
+    }
+
+    if(tmpl->mutex) {
+        mutex_destroy(&(tmpl->mutex));
+        tmpl->mutex = NULL;
+    }
+
+    pdebug(DEBUG_INFO, "Done.");
+}
+
+
+
+
 /*
  * plc_tag_shutdown
  *
@@ -832,7 +2060,16 @@ LIB_EXPORT int plc_tag_register_callback(int32_t tag_id, void (*tag_callback_fun
     }
 
     critical_block(tag->api_mutex) {
-        if(tag->callback) {
+        struct tag_handle_t *handle = (tag_id != tag->tag_id ? find_tag_handle_unsafe(tag, tag_id) : NULL);
+
+        if(handle) {
+            if(handle->callback || handle->batch_callback) {
+                rc = PLCTAG_ERR_DUPLICATE;
+            } else {
+                rc = PLCTAG_STATUS_OK;
+                handle->callback = tag_callback_func;
+            }
+        } else if(tag->callback || tag->batch_callback) {
             rc = PLCTAG_ERR_DUPLICATE;
         } else {
             rc = PLCTAG_STATUS_OK;
@@ -874,9 +2111,22 @@ LIB_EXPORT int plc_tag_unregister_callback(int32_t tag_id)
     }
 
     critical_block(tag->api_mutex) {
-        if(tag->callback) {
+        struct tag_handle_t *handle = (tag_id != tag->tag_id ? find_tag_handle_unsafe(tag, tag_id) : NULL);
+
+        if(handle) {
+            if(handle->callback || handle->batch_callback) {
+                rc = PLCTAG_STATUS_OK;
+                handle->callback = NULL;
+                handle->batch_callback = NULL;
+                handle->callback_context = NULL;
+            } else {
+                rc = PLCTAG_ERR_NOT_FOUND;
+            }
+        } else if(tag->callback || tag->batch_callback) {
             rc = PLCTAG_STATUS_OK;
             tag->callback = NULL;
+            tag->batch_callback = NULL;
+            tag->callback_context = NULL;
         } else {
             rc = PLCTAG_ERR_NOT_FOUND;
         }
@@ -893,52 +2143,286 @@ LIB_EXPORT int plc_tag_unregister_callback(int32_t tag_id)
 
 
 /*
- * plc_tag_register_logger
- *
- * This function registers the passed callback function with the library.  Only one callback function
- * may be registered with the library at a time!
- *
- * Once registered, the function will be called with any logging message that is normally printed due
- * to the current log level setting.
- *
- * WARNING: the callback will usually be called when the internal tag API mutex is held.   You cannot
- * call any tag functions within the callback!
- *
- * Return values:
- *
- * If there is already a callback registered, the function will return PLCTAG_ERR_DUPLICATE.   Only one callback
- * function may be registered at a time on each tag.
+ * plc_tag_register_batch_callback
  *
- * If all is successful, the function will return PLCTAG_STATUS_OK.
+ * See libplctag.h.  The context is stored with the tag and copied into each
+ * event.
  */
 
-LIB_EXPORT int plc_tag_register_logger(void (*log_callback_func)(int32_t tag_id, int debug_level, const char *message))
+LIB_EXPORT int plc_tag_register_batch_callback(int32_t tag_id, plc_tag_batch_callback_t batch_callback_func, void *context)
 {
     int rc = PLCTAG_STATUS_OK;
+    plc_tag_p tag = lookup_tag(tag_id);
 
-    pdebug(DEBUG_DETAIL, "Starting.");
+    pdebug(DEBUG_INFO, "Starting.");
 
-    rc = debug_register_logger(log_callback_func);
+    if(!tag) {
+        pdebug(DEBUG_WARN,"Tag not found.");
+        return PLCTAG_ERR_NOT_FOUND;
+    }
 
-    pdebug(DEBUG_DETAIL, "Done.");
+    if(!batch_callback_func) {
+        pdebug(DEBUG_WARN, "Null batch callback pointer!");
+        rc_dec(tag);
+        return PLCTAG_ERR_NULL_PTR;
+    }
+
+    critical_block(tag->api_mutex) {
+        struct tag_handle_t *handle = (tag_id != tag->tag_id ? find_tag_handle_unsafe(tag, tag_id) : NULL);
+
+        if(handle) {
+            if(handle->callback || handle->batch_callback) {
+                rc = PLCTAG_ERR_DUPLICATE;
+            } else {
+                rc = PLCTAG_STATUS_OK;
+                handle->callback_context = context;
+                handle->batch_callback = batch_callback_func;
+            }
+        } else if(tag->callback || tag->batch_callback) {
+            rc = PLCTAG_ERR_DUPLICATE;
+        } else {
+            rc = PLCTAG_STATUS_OK;
+            tag->callback_context = context;
+            tag->batch_callback = batch_callback_func;
+        }
+    }
+
+    rc_dec(tag);
+
+    pdebug(DEBUG_INFO, "Done.");
 
     return rc;
 }
 
 
-
 /*
- * plc_tag_unregister_logger
+ * plc_tag_get_changed_elements
  *
- * This function removes the logger callback already registered for the library.
- *
- * Return values:
- *
- * The function returns PLCTAG_STATUS_OK if there was a registered callback and removing it went well.
- * An error of PLCTAG_ERR_NOT_FOUND is returned if there was no registered callback.
+ * See libplctag.h.  The bits are worked out when each read completes.
  */
 
-LIB_EXPORT int plc_tag_unregister_logger(void)
+LIB_EXPORT int plc_tag_get_changed_elements(int32_t tag_id, uint8_t *bitmap, int bitmap_size)
+{
+    int rc = PLCTAG_STATUS_OK;
+    plc_tag_p tag = lookup_tag(tag_id);
+
+    pdebug(DEBUG_DETAIL, "Starting.");
+
+    if(!tag) {
+        pdebug(DEBUG_WARN,"Tag not found.");
+        return PLCTAG_ERR_NOT_FOUND;
+    }
+
+    if(bitmap_size < 0 || (!bitmap && bitmap_size > 0)) {
+        pdebug(DEBUG_WARN, "Bitmap size must not be negative and the bitmap must not be null if the size is set!");
+        rc_dec(tag);
+        return PLCTAG_ERR_BAD_PARAM;
+    }
+
+    critical_block(tag->api_mutex) {
+        tag_change_p change = tag->change;
+        int num_bytes = 0;
+
+        if(!change) {
+            pdebug(DEBUG_WARN, "Tag does not have change detection turned on!");
+            rc = PLCTAG_ERR_UNSUPPORTED;
+            break;
+        }
+
+        if(!change->changed_bits) {
+            pdebug(DEBUG_DETAIL, "No read has completed yet.");
+            rc = PLCTAG_ERR_NO_DATA;
+            break;
+        }
+
+        num_bytes = (change->elem_count + 7) / 8;
+
+        if(bitmap) {
+            if(bitmap_size < num_bytes) {
+                pdebug(DEBUG_WARN, "Bitmap needs %d bytes but only has %d!", num_bytes, bitmap_size);
+                rc = PLCTAG_ERR_TOO_SMALL;
+                break;
+            }
+
+            mem_copy(bitmap, change->changed_bits, num_bytes);
+            mem_set(bitmap + num_bytes, 0, bitmap_size - num_bytes);
+        }
+
+        rc = change->num_changed;
+    }
+
+    rc_dec(tag);
+
+    pdebug(DEBUG_DETAIL, "Done.");
+
+    return rc;
+}
+
+
+
+
+/*
+ * Event queues
+ *
+ * See libplctag.h.  The queue itself is in util/event_queue.c.  A bound tag
+ * holds a reference to its queue so destroying the queue while tags are
+ * still bound only closes it.
+ */
+
+LIB_EXPORT plc_tag_event_queue_t plc_tag_event_queue_create(int capacity)
+{
+    event_queue_p queue = NULL;
+
+    pdebug(DEBUG_INFO, "Starting.");
+
+    if(capacity < 0) {
+        pdebug(DEBUG_WARN, "Capacity must not be negative!");
+        return NULL;
+    }
+
+    queue = event_queue_create(capacity);
+
+    pdebug(DEBUG_INFO, "Done.");
+
+    return queue;
+}
+
+
+LIB_EXPORT int plc_tag_event_queue_destroy(plc_tag_event_queue_t queue)
+{
+    pdebug(DEBUG_INFO, "Starting.");
+
+    if(!queue) {
+        pdebug(DEBUG_WARN, "Null event queue pointer!");
+        return PLCTAG_ERR_NULL_PTR;
+    }
+
+    event_queue_close(queue);
+    rc_dec(queue);
+
+    pdebug(DEBUG_INFO, "Done.");
+
+    return PLCTAG_STATUS_OK;
+}
+
+
+LIB_EXPORT intptr_t plc_tag_event_queue_get_fd(plc_tag_event_queue_t queue)
+{
+    if(!queue) {
+        pdebug(DEBUG_WARN, "Null event queue pointer!");
+        return PLCTAG_ERR_NULL_PTR;
+    }
+
+    return event_queue_get_handle(queue);
+}
+
+
+LIB_EXPORT int plc_tag_event_queue_drain(plc_tag_event_queue_t queue, plc_tag_event_t *events, int max_events)
+{
+    if(!queue || !events) {
+        pdebug(DEBUG_WARN, "Null event queue or event buffer pointer!");
+        return PLCTAG_ERR_NULL_PTR;
+    }
+
+    return event_queue_pop(queue, events, max_events);
+}
+
+
+LIB_EXPORT int plc_tag_event_queue_get_dropped(plc_tag_event_queue_t queue)
+{
+    if(!queue) {
+        pdebug(DEBUG_WARN, "Null event queue pointer!");
+        return PLCTAG_ERR_NULL_PTR;
+    }
+
+    return event_queue_get_dropped(queue);
+}
+
+
+LIB_EXPORT int plc_tag_bind_event_queue(int32_t tag_id, plc_tag_event_queue_t queue)
+{
+    plc_tag_p tag = lookup_tag(tag_id);
+    event_queue_p old_queue = NULL;
+
+    pdebug(DEBUG_INFO, "Starting.");
+
+    if(!tag) {
+        pdebug(DEBUG_WARN,"Tag not found.");
+        return PLCTAG_ERR_NOT_FOUND;
+    }
+
+    critical_block(tag->api_mutex) {
+        struct tag_handle_t *handle = (tag_id != tag->tag_id ? find_tag_handle_unsafe(tag, tag_id) : NULL);
+
+        if(handle) {
+            old_queue = handle->event_queue;
+            handle->event_queue = rc_inc(queue);
+        } else {
+            old_queue = tag->event_queue;
+            tag->event_queue = rc_inc(queue);
+        }
+    }
+
+    /* release the old queue outside the mutex. */
+    rc_dec(old_queue);
+
+    rc_dec(tag);
+
+    pdebug(DEBUG_INFO, "Done.");
+
+    return PLCTAG_STATUS_OK;
+}
+
+
+
+
+/*
+ * plc_tag_register_logger
+ *
+ * This function registers the passed callback function with the library.  Only one callback function
+ * may be registered with the library at a time!
+ *
+ * Once registered, the function will be called with any logging message that is normally printed due
+ * to the current log level setting.
+ *
+ * WARNING: the callback will usually be called when the internal tag API mutex is held.   You cannot
+ * call any tag functions within the callback!
+ *
+ * Return values:
+ *
+ * If there is already a callback registered, the function will return PLCTAG_ERR_DUPLICATE.   Only one callback
+ * function may be registered at a time on each tag.
+ *
+ * If all is successful, the function will return PLCTAG_STATUS_OK.
+ */
+
+LIB_EXPORT int plc_tag_register_logger(void (*log_callback_func)(int32_t tag_id, int debug_level, const char *message))
+{
+    int rc = PLCTAG_STATUS_OK;
+
+    pdebug(DEBUG_DETAIL, "Starting.");
+
+    rc = debug_register_logger(log_callback_func);
+
+    pdebug(DEBUG_DETAIL, "Done.");
+
+    return rc;
+}
+
+
+
+/*
+ * plc_tag_unregister_logger
+ *
+ * This function removes the logger callback already registered for the library.
+ *
+ * Return values:
+ *
+ * The function returns PLCTAG_STATUS_OK if there was a registered callback and removing it went well.
+ * An error of PLCTAG_ERR_NOT_FOUND is returned if there was no registered callback.
+ */
+
+LIB_EXPORT int plc_tag_unregister_logger(void)
 {
     int rc = PLCTAG_STATUS_OK;
 
@@ -1063,14 +2547,20 @@ LIB_EXPORT int plc_tag_abort(int32_t id)
         rc = tag->vtable->abort(tag);
 
         tag->read_in_flight = 0;
+        tag->read_queued = 0;
+        tag->read_refresh = 0;
         tag->read_complete = 0;
         tag->write_in_flight = 0;
+        tag->write_queued = 0;
         tag->write_complete = 0;
     }
 
-    if(tag->callback) {
+    /* let anyone waiting on this tag know. */
+    plc_tag_wake_waiters(tag);
+
+    if(tag->callback || tag->batch_callback || tag->event_queue || tag->share) {
         pdebug(DEBUG_DETAIL, "Calling callback with PLCTAG_EVENT_ABORTED.");
-        tag->callback(id, PLCTAG_EVENT_ABORTED, PLCTAG_STATUS_OK);
+        tag_raise_event(tag, PLCTAG_EVENT_ABORTED, PLCTAG_STATUS_OK);
     }
 
     rc_dec(tag);
@@ -1094,6 +2584,7 @@ LIB_EXPORT int plc_tag_abort(int32_t id)
 LIB_EXPORT int plc_tag_destroy(int32_t tag_id)
 {
     plc_tag_p tag = NULL;
+    event_queue_p queue = NULL;
 
     pdebug(DEBUG_INFO, "Starting.");
 
@@ -1102,15 +2593,29 @@ LIB_EXPORT int plc_tag_destroy(int32_t tag_id)
         return PLCTAG_ERR_NULL_PTR;
     }
 
-    critical_block(tag_lookup_mutex) {
-        tag = hashtable_remove(tags, tag_id);
-    }
+    tag = slot_table_remove(tags, tag_id);
 
     if(!tag) {
         pdebug(DEBUG_WARN, "Called with non-existent tag!");
         return PLCTAG_ERR_NOT_FOUND;
     }
 
+    /* other handles onto a shared tag keep it going. */
+    if(tag->share && release_tag_handle(tag, tag_id)) {
+        rc_dec(tag);
+
+        pdebug(DEBUG_INFO, "Done.");
+
+        debug_set_tag_id(0);
+
+        return PLCTAG_STATUS_OK;
+    }
+
+    /* the tag's reads no longer take up room in the plan. */
+    if(auto_sync_window_ms > 0 && tag->auto_sync_read_ms > 0) {
+        request_auto_sync_plan(tag->tickler_shard);
+    }
+
     /* abort anything in flight */
     pdebug(DEBUG_DETAIL, "Aborting any in-flight operations.");
 
@@ -1121,13 +2626,30 @@ LIB_EXPORT int plc_tag_destroy(int32_t tag_id)
 
         /* Force a clean up. */
         tag->vtable->abort(tag);
+
+        tag->read_in_flight = 0;
+        tag->read_queued = 0;
+        tag->read_refresh = 0;
+        tag->write_in_flight = 0;
+        tag->write_queued = 0;
     }
 
-    if(tag->callback) {
+    /* let anyone waiting on this tag know. */
+    plc_tag_wake_waiters(tag);
+
+    if(tag->callback || tag->batch_callback || tag->event_queue || tag->share) {
         pdebug(DEBUG_DETAIL, "Calling callback with PLCTAG_EVENT_DESTROYED.");
-        tag->callback(tag_id, PLCTAG_EVENT_DESTROYED, PLCTAG_STATUS_OK);
+        tag_raise_event(tag, PLCTAG_EVENT_DESTROYED, PLCTAG_STATUS_OK);
+    }
+
+    /* the tag will not send any more events. */
+    critical_block(tag->api_mutex) {
+        queue = tag->event_queue;
+        tag->event_queue = NULL;
     }
 
+    rc_dec(queue);
+
     /* release the reference outside the mutex. */
     rc_dec(tag);
 
@@ -1150,6 +2672,14 @@ LIB_EXPORT int plc_tag_destroy(int32_t tag_id)
  * If there is a timeout passed, then this routine waits for either
  * a timeout or an error.
  *
+ * If another read or a write is in flight, we wait for it instead of
+ * returning PLCTAG_ERR_BUSY.  A read that started after this call was made
+ * is used instead of starting another one, unless share_reads is off.
+ * Without a timeout, the read is queued and the tickler starts it.
+ *
+ * If the cached data is past read_cache_ms but not past read_cache_stale_ms
+ * more, it is returned right away and the tickler refreshes it.
+ *
  * The status of the operation is returned.
  */
 
@@ -1158,6 +2688,10 @@ LIB_EXPORT int plc_tag_read(int32_t id, int timeout)
     int rc = PLCTAG_STATUS_OK;
     plc_tag_p tag = lookup_tag(id);
     int is_done = 0;
+    int is_stale = 0;
+    int must_wait = 0;
+    uint32_t want_gen = 0;
+    int64_t timeout_time = 0;
 
     pdebug(DEBUG_INFO, "Starting.");
 
@@ -1172,121 +2706,136 @@ LIB_EXPORT int plc_tag_read(int32_t id, int timeout)
         return PLCTAG_ERR_NOT_FOUND;
     }
 
-    if(tag->callback) {
+    if(tag->callback || tag->share) {
         pdebug(DEBUG_DETAIL, "Calling callback with PLCTAG_EVENT_READ_STARTED.");
-        tag->callback(id, PLCTAG_EVENT_READ_STARTED, PLCTAG_STATUS_OK);
+        tag_raise_event(tag, PLCTAG_EVENT_READ_STARTED, PLCTAG_STATUS_OK);
     }
 
+    /* any read started from here on is fresh enough for this call. */
     critical_block(tag->api_mutex) {
-        /* check read cache, if not expired, return existing data. */
-        if(tag->read_cache_expire > time_ms()) {
-            pdebug(DEBUG_INFO, "Returning cached data.");
-            rc = PLCTAG_STATUS_OK;
-            is_done = 1;
-            break;
-        }
+        want_gen = tag->read_gen + 1;
 
-        if(tag->read_in_flight || tag->write_in_flight) {
-            pdebug(DEBUG_WARN, "An operation is already in flight!");
-            rc = PLCTAG_ERR_BUSY;
-            is_done = 1;
-            break;
-        }
+        /* stale cached data will do, it is refreshed in the background. */
+        is_stale = use_stale_cache_unsafe(tag);
+    }
+
+    if(is_stale) {
+        pdebug(DEBUG_DETAIL, "Returning stale cached data.");
+        rc = PLCTAG_STATUS_OK;
+        is_done = 1;
+    } else {
+        timeout_time = time_ms() + timeout;
 
-        if(tag->tag_is_dirty) {
-            pdebug(DEBUG_WARN, "Tag has locally updated data that will be overwritten!");
-            rc = PLCTAG_ERR_BUSY;
+        /*
+         * only one blocking read or write at a time.  Other blocking calls
+         * wait here, but not past their own timeout, instead of getting
+         * PLCTAG_ERR_BUSY.  The API mutex is free while we wait for the PLC.
+         * Non-blocking calls never wait.  They queue the read if the tag is
+         * busy.
+         */
+        if(timeout && (rc = lock_tag_io(tag, timeout_time)) != PLCTAG_STATUS_OK) {
+            pdebug(DEBUG_WARN, "Timed out waiting for another read or write of the tag.");
             is_done = 1;
-            break;
         }
 
-        tag->read_in_flight = 1;
-        tag->status = PLCTAG_STATUS_PENDING;
-
-        /* the protocol implementation does not do the timeout. */
-        rc = tag->vtable->read(tag);
-
-        /* if not pending then check for success or error. */
-        if(rc != PLCTAG_STATUS_PENDING) {
-            if(rc != PLCTAG_STATUS_OK) {
-                /* not pending and not OK, so error. Abort and clean up. */
+        if(!is_done) {
+            do {
+                /* get this before checking so that we do not miss a signal. */
+                uint32_t io_seq = cond_seq(tag->io_cond);
+                int64_t wait_ms = 0;
+
+                must_wait = 0;
+
+                critical_block(tag->api_mutex) {
+                    rc = start_shared_read_unsafe(tag, want_gen);
+
+                    /* an automatic or non-blocking operation is in flight. */
+                    if(rc == PLCTAG_ERR_BUSY && (tag->read_in_flight || tag->write_in_flight)) {
+                        if(timeout) {
+                            tag->io_waiters++;
+                            must_wait = 1;
+                        } else {
+                            pdebug(DEBUG_DETAIL, "Queueing read until the tag is free.");
+                            tag->read_queued = 1;
+                            rc = PLCTAG_STATUS_PENDING;
+                        }
 
-                pdebug(DEBUG_WARN,"Response from read command returned error %s!", plc_tag_decode_error(rc));
+                        break;
+                    }
 
-                if(tag->vtable->abort) {
-                    tag->vtable->abort(tag);
-                }
-            }
+                    if(rc != PLCTAG_STATUS_PENDING) {
+                        is_done = 1;
+                        break;
+                    }
 
-            tag->read_in_flight = 0;
-            is_done = 1;
-            break;
-        }
+                    /* we will wait for the read below, without holding the API mutex. */
+                    if(timeout) {
+                        tag->api_waiting = 1;
+                    } else {
+                        /* the tickler reports the completion. */
+                        plc_tag_wake_tag(tag->tag_id);
+                    }
+                } /* end of api mutex block */
 
-        /*
-         * if there is a timeout, then loop until we get
-         * an error or we timeout.
-         */
-        if(timeout) {
-            int64_t timeout_time = timeout + time_ms();
-            int64_t start_time = time_ms();
+                if(must_wait) {
+                    wait_ms = timeout_time - time_ms();
+                    if(wait_ms > TAG_WAIT_MAX_MS) {
+                        wait_ms = TAG_WAIT_MAX_MS;
+                    }
 
-            while(rc == PLCTAG_STATUS_PENDING && timeout_time > time_ms()) {
-                /* give some time to the tickler function. */
-                if(tag->vtable->tickler) {
-                    tag->vtable->tickler(tag);
-                }
+                    if(wait_ms > 0) {
+                        cond_wait(tag->io_cond, &io_seq, (int)wait_ms);
+                    }
 
-                rc = tag->vtable->status(tag);
+                    critical_block(tag->api_mutex) {
+                        tag->io_waiters--;
+                    }
 
-                /*
-                 * terminate early and do not wait again if the
-                 * IO is done.
-                 */
-                if(rc != PLCTAG_STATUS_PENDING) {
-                    break;
+                    if(timeout_time <= time_ms()) {
+                        pdebug(DEBUG_WARN, "Timed out waiting for the operation in flight.");
+                        rc = PLCTAG_ERR_TIMEOUT;
+                        is_done = 1;
+                    }
                 }
-
-                sleep_ms(1); /* MAGIC */
-            }
+            } while(must_wait && !is_done);
 
             /*
-             * if we dropped out of the while loop but the status is
-             * still pending, then we timed out.
-             *
-             * Abort the operation and set the status to show the timeout.
+             * if there is a timeout, then wait until we get
+             * an error or we timeout.
              */
-            if(rc != PLCTAG_STATUS_OK) {
-                /* abort the request. */
-                if(tag->vtable->abort) {
-                    tag->vtable->abort(tag);
-                }
+            if(!is_done && timeout) {
+                int64_t remaining_ms = timeout_time - time_ms();
 
-                /* translate error if we are still pending. */
-                if(rc == PLCTAG_STATUS_PENDING) {
-                    pdebug(DEBUG_WARN, "Read operation timed out.");
-                    rc = PLCTAG_ERR_TIMEOUT;
-                }
+                rc = wait_for_completion(tag, 1, (remaining_ms > 0 ? (int)remaining_ms : 0));
+                is_done = 1;
             }
 
-            /* we are done. */
-            tag->read_complete = 0;
-            tag->read_in_flight = 0;
-            is_done = 1;
-
-            pdebug(DEBUG_INFO,"elapsed time %" PRId64 "ms",(time_ms()-start_time));
+            if(timeout) {
+                unlock_tag_io(tag);
+            }
         }
-    } /* end of api mutex block */
+    }
 
-    if(rc == PLCTAG_STATUS_OK) {
+    if(rc == PLCTAG_STATUS_OK && !is_stale) {
         /* set up the cache time.  This works when read_cache_ms is zero as it is already expired. */
         tag->read_cache_expire = time_ms() + tag->read_cache_ms;
     }
 
-    if(tag->callback) {
+    if(tag->callback || tag->batch_callback || tag->event_queue || tag->share) {
         if(is_done) {
+            int changed = 0;
+
             pdebug(DEBUG_DETAIL, "Calling callback with PLCTAG_EVENT_READ_COMPLETED.");
-            tag->callback(id, PLCTAG_EVENT_READ_COMPLETED, rc);
+            tag_raise_event(tag, PLCTAG_EVENT_READ_COMPLETED, rc);
+
+            critical_block(tag->api_mutex) {
+                changed = tag_change_take_unsafe(tag);
+            }
+
+            if(changed) {
+                pdebug(DEBUG_DETAIL, "Calling callback with PLCTAG_EVENT_DATA_CHANGED.");
+                tag_raise_event(tag, PLCTAG_EVENT_DATA_CHANGED, PLCTAG_STATUS_OK);
+            }
         }
     }
 
@@ -1339,7 +2888,7 @@ LIB_EXPORT int plc_tag_status(int32_t id)
         rc = tag->vtable->status(tag);
 
         if(rc == PLCTAG_STATUS_OK) {
-            if(tag->read_in_flight || tag->write_in_flight) {
+            if(tag->read_in_flight || tag->read_queued || tag->write_in_flight || tag->write_queued) {
                 rc = PLCTAG_STATUS_PENDING;
             }
         }
@@ -1364,6 +2913,12 @@ LIB_EXPORT int plc_tag_status(int32_t id)
  * If there is a timeout passed, then this routine waits for either
  * a timeout or an error.
  *
+ * If the tag queues writes and another read or a write is in flight, we
+ * wait for it instead of returning PLCTAG_ERR_BUSY.  A write that started
+ * after this call was made sent our data, so it is used instead of
+ * starting another one.  Without a timeout, the write is queued and the
+ * tickler starts it.
+ *
  * The status of the operation is returned.
  */
 
@@ -1372,6 +2927,9 @@ LIB_EXPORT int plc_tag_write(int32_t id, int timeout)
     int rc = PLCTAG_STATUS_OK;
     plc_tag_p tag = lookup_tag(id);
     int is_done = 0;
+    int must_wait = 0;
+    uint32_t want_gen = 0;
+    int64_t timeout_time = 0;
 
     pdebug(DEBUG_SPEW, "Starting.");
 
@@ -1386,102 +2944,109 @@ LIB_EXPORT int plc_tag_write(int32_t id, int timeout)
         return PLCTAG_ERR_NOT_FOUND;
     }
 
-    if(tag->callback) {
+    if(tag->callback || tag->share) {
         pdebug(DEBUG_DETAIL, "Calling callback with PLCTAG_EVENT_WRITE_STARTED.");
-        tag->callback(id, PLCTAG_EVENT_WRITE_STARTED, PLCTAG_STATUS_OK);
+        tag_raise_event(tag, PLCTAG_EVENT_WRITE_STARTED, PLCTAG_STATUS_OK);
     }
 
+    /* any write started from here on sends the data set before this call. */
     critical_block(tag->api_mutex) {
-        if(tag->read_in_flight || tag->write_in_flight) {
-            pdebug(DEBUG_WARN, "Tag already has an operation in flight!");
-            is_done = 1;
-            rc = PLCTAG_ERR_BUSY;
-            break;
-        }
-
-        /* a write is now in flight. */
-        tag->write_in_flight = 1;
-        tag->status = PLCTAG_STATUS_OK;
+        want_gen = tag->write_gen + 1;
+    }
 
-        /* the protocol implementation does not do the timeout. */
-        rc = tag->vtable->write(tag);
+    timeout_time = time_ms() + timeout;
 
-        /* if not pending then check for success or error. */
-        if(rc != PLCTAG_STATUS_PENDING) {
-            if(rc != PLCTAG_STATUS_OK) {
-                /* not pending and not OK, so error. Abort and clean up. */
+    /*
+     * only one blocking read or write at a time, but do not wait for it past
+     * our own timeout.  Non-blocking calls never wait.  They queue the write
+     * if the tag queues writes and is busy.
+     */
+    if(timeout && (rc = lock_tag_io(tag, timeout_time)) != PLCTAG_STATUS_OK) {
+        pdebug(DEBUG_WARN, "Timed out waiting for another read or write of the tag.");
+        is_done = 1;
+    }
 
-                pdebug(DEBUG_WARN,"Response from write command returned error %s!", plc_tag_decode_error(rc));
+    if(!is_done) {
+        do {
+            /* get this before checking so that we do not miss a signal. */
+            uint32_t io_seq = cond_seq(tag->io_cond);
+            int64_t wait_ms = 0;
+
+            must_wait = 0;
+
+            critical_block(tag->api_mutex) {
+                rc = start_queued_write_unsafe(tag, want_gen);
+
+                /* an automatic or non-blocking operation is in flight. */
+                if(rc == PLCTAG_ERR_BUSY && tag->write_queue && (tag->read_in_flight || tag->write_in_flight)) {
+                    if(timeout) {
+                        tag->io_waiters++;
+                        must_wait = 1;
+                    } else {
+                        pdebug(DEBUG_DETAIL, "Queueing write until the tag is free.");
+                        tag->write_queued = 1;
+                        rc = PLCTAG_STATUS_PENDING;
+                    }
 
-                if(tag->vtable->abort) {
-                    tag->vtable->abort(tag);
+                    break;
                 }
-            }
 
-            tag->write_in_flight = 0;
-            is_done = 1;
-            break;
-        }
-
-        /*
-         * if there is a timeout, then loop until we get
-         * an error or we timeout.
-         */
-        if(timeout) {
-            int64_t start_time = time_ms();
-            int64_t timeout_time = timeout + start_time;
-
-            while(rc == PLCTAG_STATUS_PENDING && timeout_time > time_ms()) {
-                /* give some time to the tickler function. */
-                if(tag->vtable->tickler) {
-                    tag->vtable->tickler(tag);
+                if(rc != PLCTAG_STATUS_PENDING) {
+                    is_done = 1;
+                    break;
                 }
 
-                rc = tag->vtable->status(tag);
+                /* we will wait for the write below, without holding the API mutex. */
+                if(timeout) {
+                    tag->api_waiting = 1;
+                } else {
+                    /* the tickler reports the completion. */
+                    plc_tag_wake_tag(tag->tag_id);
+                }
+            } /* end of api mutex block */
 
-                /*
-                 * terminate early and do not wait again if the
-                 * IO is done.
-                 */
-                if(rc != PLCTAG_STATUS_PENDING) {
-                    break;
+            if(must_wait) {
+                wait_ms = timeout_time - time_ms();
+                if(wait_ms > TAG_WAIT_MAX_MS) {
+                    wait_ms = TAG_WAIT_MAX_MS;
                 }
 
-                sleep_ms(1); /* MAGIC */
-            }
+                if(wait_ms > 0) {
+                    cond_wait(tag->io_cond, &io_seq, (int)wait_ms);
+                }
 
-            /*
-             * if we dropped out of the while loop but the status is
-             * still pending, then we timed out.
-             *
-             * Abort the operation and set the status to show the timeout.
-             */
-            if(rc != PLCTAG_STATUS_OK) {
-                /* abort the request. */
-                if(tag->vtable->abort) {
-                    tag->vtable->abort(tag);
+                critical_block(tag->api_mutex) {
+                    tag->io_waiters--;
                 }
 
-                /* translate error if we are still pending. */
-                if(rc == PLCTAG_STATUS_PENDING) {
-                    pdebug(DEBUG_WARN, "Write operation timed out.");
+                if(timeout_time <= time_ms()) {
+                    pdebug(DEBUG_WARN, "Timed out waiting for the operation in flight.");
                     rc = PLCTAG_ERR_TIMEOUT;
+                    is_done = 1;
                 }
             }
+        } while(must_wait && !is_done);
 
-            /* the write is not in flight anymore. */
-            tag->write_in_flight = 0;
-            tag->write_complete = 0;
+        /*
+         * if there is a timeout, then wait until we get
+         * an error or we timeout.
+         */
+        if(!is_done && timeout) {
+            int64_t remaining_ms = timeout_time - time_ms();
+
+            rc = wait_for_completion(tag, 0, (remaining_ms > 0 ? (int)remaining_ms : 0));
             is_done = 1;
+        }
 
-            pdebug(DEBUG_INFO,"elapsed time %" PRId64 "ms",(time_ms()-start_time));
+        if(timeout) {
+            unlock_tag_io(tag);
         }
-    } /* end of api mutex block */
+    }
 
-    if(tag->callback) {
+    if(tag->callback || tag->batch_callback || tag->event_queue || tag->share) {
         if(is_done) {
             pdebug(DEBUG_DETAIL, "Calling callback with PLCTAG_EVENT_WRITE_COMPLETED.");
-            tag->callback(id, PLCTAG_EVENT_WRITE_COMPLETED, rc);
+            tag_raise_event(tag, PLCTAG_EVENT_WRITE_COMPLETED, rc);
         }
     }
 
@@ -1496,6 +3061,73 @@ LIB_EXPORT int plc_tag_write(int32_t id, int timeout)
 
 
 
+/*
+ * plc_tag_read_many()
+ *
+ * Start reads on all the passed tags and then wait once for all of them.
+ * Starting all the requests before waiting lets the protocol layer pack
+ * them into as few packets as it can.
+ */
+
+LIB_EXPORT int plc_tag_read_many(int32_t *ids, int *statuses, int num_tags, int timeout)
+{
+    int rc = PLCTAG_STATUS_OK;
+
+    pdebug(DEBUG_INFO, "Starting.");
+
+    if(!ids) {
+        pdebug(DEBUG_WARN, "Tag ID array pointer is null!");
+        return PLCTAG_ERR_NULL_PTR;
+    }
+
+    rc = do_many(ids, statuses, num_tags, 1, timeout);
+
+    pdebug(DEBUG_INFO, "Done with status %s.", plc_tag_decode_error(rc));
+
+    return rc;
+}
+
+
+
+
+/*
+ * plc_tag_write_many()
+ *
+ * Start writes on all the passed tags and then wait once for all of them.
+ * If no tags are passed, write all tags that have pending automatic writes.
+ */
+
+LIB_EXPORT int plc_tag_write_many(int32_t *ids, int *statuses, int num_tags, int timeout)
+{
+    int rc = PLCTAG_STATUS_OK;
+
+    pdebug(DEBUG_INFO, "Starting.");
+
+    if(!ids) {
+        if(statuses) {
+            pdebug(DEBUG_WARN, "Status array must be null when flushing all tags!");
+            return PLCTAG_ERR_BAD_PARAM;
+        }
+
+        if(timeout < 0) {
+            pdebug(DEBUG_WARN, "Timeout must not be negative!");
+            return PLCTAG_ERR_BAD_PARAM;
+        }
+
+        rc = flush_dirty_tags(timeout);
+    } else {
+        rc = do_many(ids, statuses, num_tags, 0, timeout);
+    }
+
+    pdebug(DEBUG_INFO, "Done with status %s.", plc_tag_decode_error(rc));
+
+    return rc;
+}
+
+
+
+
+
 /*
  * Tag data accessors.
  */
@@ -1529,6 +3161,32 @@ LIB_EXPORT int plc_tag_get_int_attribute(int32_t id, const char *attrib_name, in
         } else if(str_cmp_i(attrib_name, "debug_level") == 0) {
             pdebug(DEBUG_WARN, "Deprecated attribute \"debug_level\" used, use \"debug\" instead.");
             res = (int)get_debug_level();
+        } else if(str_cmp_i(attrib_name, "tickler_threads") == 0) {
+            res = tickler_threads;
+        } else if(str_cmp_i(attrib_name, "auto_sync_window_ms") == 0) {
+            res = auto_sync_window_ms;
+        } else if(str_cmp_i(attrib_name, "auto_sync_packet_size") == 0) {
+            res = auto_sync_packet_size;
+        } else if(str_cmp_i(attrib_name, "share_tags") == 0) {
+            res = share_tags;
+        } else if(str_cmp_i(attrib_name, "callback_threads") == 0) {
+            res = callback_threads;
+        } else if(str_cmp_i(attrib_name, "callback_queue_size") == 0) {
+            res = callback_queue_size;
+        } else if(str_cmp_i(attrib_name, "callback_late_ms") == 0) {
+            res = callback_late_ms;
+        } else if(str_cmp_i(attrib_name, "callback_dropped_events") == 0 || str_cmp_i(attrib_name, "callback_late_events") == 0) {
+            res = 0;
+
+            critical_block(callback_executor_mutex) {
+                if(callback_executor) {
+                    if(str_cmp_i(attrib_name, "callback_dropped_events") == 0) {
+                        res = callback_executor_get_dropped(callback_executor);
+                    } else {
+                        res = callback_executor_get_late(callback_executor);
+                    }
+                }
+            }
         } else {
             pdebug(DEBUG_WARN, "Attribute \"%s\" is not supported at the library level!");
             res = default_value;
@@ -1550,12 +3208,30 @@ LIB_EXPORT int plc_tag_get_int_attribute(int32_t id, const char *attrib_name, in
                 /* FIXME - what happens if this overflows? */
                 tag->status = PLCTAG_STATUS_OK;
                 res = (int)tag->read_cache_ms;
+            } else if(str_cmp_i(attrib_name, "read_cache_stale_ms") == 0) {
+                tag->status = PLCTAG_STATUS_OK;
+                res = (int)tag->read_cache_stale_ms;
             } else if(str_cmp_i(attrib_name, "auto_sync_read_ms") == 0) {
                 tag->status = PLCTAG_STATUS_OK;
                 res = (int)tag->auto_sync_read_ms;
             } else if(str_cmp_i(attrib_name, "auto_sync_write_ms") == 0) {
                 tag->status = PLCTAG_STATUS_OK;
                 res = (int)tag->auto_sync_write_ms;
+            } else if(str_cmp_i(attrib_name, "auto_sync_read_max_ms") == 0) {
+                tag->status = PLCTAG_STATUS_OK;
+                res = (int)tag->auto_sync_read_max_ms;
+            } else if(str_cmp_i(attrib_name, "auto_sync_read_current_ms") == 0) {
+                tag->status = PLCTAG_STATUS_OK;
+                res = (int)(tag->auto_sync_read_cur_ms > 0 ? tag->auto_sync_read_cur_ms : tag->auto_sync_read_ms);
+            } else if(str_cmp_i(attrib_name, "change_detect") == 0) {
+                tag->status = PLCTAG_STATUS_OK;
+                res = ((tag->change && tag->change->report) ? 1 : 0);
+            } else if(str_cmp_i(attrib_name, "share_reads") == 0) {
+                tag->status = PLCTAG_STATUS_OK;
+                res = (int)tag->share_reads;
+            } else if(str_cmp_i(attrib_name, "write_queue") == 0) {
+                tag->status = PLCTAG_STATUS_OK;
+                res = (int)tag->write_queue;
             } else if(str_cmp_i(attrib_name, "bit_num") == 0) {
                 tag->status = PLCTAG_STATUS_OK;
                 res = (int)(unsigned int)(tag->bit);
@@ -1605,6 +3281,47 @@ LIB_EXPORT int plc_tag_set_int_attribute(int32_t id, const char *attrib_name, in
             } else {
                 res = PLCTAG_ERR_OUT_OF_BOUNDS;
             }
+        } else if(str_cmp_i(attrib_name, "tickler_threads") == 0) {
+            res = set_tickler_threads(new_value);
+        } else if(str_cmp_i(attrib_name, "auto_sync_window_ms") == 0) {
+            if(new_value >= 0) {
+                auto_sync_window_ms = new_value;
+                request_auto_sync_plan_all();
+                res = PLCTAG_STATUS_OK;
+            } else {
+                res = PLCTAG_ERR_OUT_OF_BOUNDS;
+            }
+        } else if(str_cmp_i(attrib_name, "auto_sync_packet_size") == 0) {
+            if(new_value > 0) {
+                auto_sync_packet_size = new_value;
+                request_auto_sync_plan_all();
+                res = PLCTAG_STATUS_OK;
+            } else {
+                res = PLCTAG_ERR_OUT_OF_BOUNDS;
+            }
+        } else if(str_cmp_i(attrib_name, "share_tags") == 0) {
+            if(new_value == 0 || new_value == 1) {
+                share_tags = new_value;
+                res = PLCTAG_STATUS_OK;
+            } else {
+                res = PLCTAG_ERR_OUT_OF_BOUNDS;
+            }
+        } else if(str_cmp_i(attrib_name, "callback_threads") == 0) {
+            res = set_callback_threads(new_value);
+        } else if(str_cmp_i(attrib_name, "callback_queue_size") == 0) {
+            if(new_value >= 0) {
+                callback_queue_size = new_value;
+                res = PLCTAG_STATUS_OK;
+            } else {
+                res = PLCTAG_ERR_OUT_OF_BOUNDS;
+            }
+        } else if(str_cmp_i(attrib_name, "callback_late_ms") == 0) {
+            if(new_value >= 0) {
+                callback_late_ms = new_value;
+                res = PLCTAG_STATUS_OK;
+            } else {
+                res = PLCTAG_ERR_OUT_OF_BOUNDS;
+            }
         } else {
             pdebug(DEBUG_WARN, "Attribute \"%s\" is not support at the library level!", attrib_name);
             return PLCTAG_ERR_UNSUPPORTED;
@@ -1618,8 +3335,67 @@ LIB_EXPORT int plc_tag_set_int_attribute(int32_t id, const char *attrib_name, in
         }
 
         critical_block(tag->api_mutex) {
+            int is_handle_setting = (str_cmp_i(attrib_name, "read_cache_ms") == 0 || str_cmp_i(attrib_name, "auto_sync_read_ms") == 0 || str_cmp_i(attrib_name, "auto_sync_write_ms") == 0);
+            struct tag_handle_t *handle = (is_handle_setting ? find_tag_handle_unsafe(tag, id) : NULL);
+
             /* match the generic ones first. */
-            if(str_cmp_i(attrib_name, "read_cache_ms") == 0) {
+            if(handle) {
+                /* each handle onto a shared tag asks for its own, the tag uses the fastest. */
+                if(new_value >= 0) {
+                    if(str_cmp_i(attrib_name, "read_cache_ms") == 0) {
+                        handle->read_cache_ms = new_value;
+                    } else if(str_cmp_i(attrib_name, "auto_sync_read_ms") == 0) {
+                        handle->auto_sync_read_ms = new_value;
+                    } else {
+                        handle->auto_sync_write_ms = new_value;
+                    }
+
+                    combine_tag_handles_unsafe(tag);
+
+                    tag->status = PLCTAG_STATUS_OK;
+                    res = PLCTAG_STATUS_OK;
+                } else {
+                    pdebug(DEBUG_WARN, "%s must be greater than or equal to zero!", attrib_name);
+                    tag->status = PLCTAG_ERR_OUT_OF_BOUNDS;
+                    res = PLCTAG_ERR_OUT_OF_BOUNDS;
+                }
+            } else if(str_cmp_i(attrib_name, "change_detect") == 0) {
+                if(new_value == 0) {
+                    /* adaptive automatic reads still need to see the changes. */
+                    if(tag->auto_sync_read_max_ms > 0 && tag->change) {
+                        tag->change->report = 0;
+                    } else {
+                        tag_change_destroy(tag);
+                    }
+
+                    tag->status = PLCTAG_STATUS_OK;
+                    res = PLCTAG_STATUS_OK;
+                } else if(new_value == 1) {
+                    res = tag_change_enable_unsafe(tag, 1);
+                    tag->status = (int8_t)res;
+                } else {
+                    tag->status = PLCTAG_ERR_OUT_OF_BOUNDS;
+                    res = PLCTAG_ERR_OUT_OF_BOUNDS;
+                }
+            } else if(str_cmp_i(attrib_name, "share_reads") == 0) {
+                if(new_value == 0 || new_value == 1) {
+                    tag->share_reads = (new_value ? 1 : 0);
+                    tag->status = PLCTAG_STATUS_OK;
+                    res = PLCTAG_STATUS_OK;
+                } else {
+                    tag->status = PLCTAG_ERR_OUT_OF_BOUNDS;
+                    res = PLCTAG_ERR_OUT_OF_BOUNDS;
+                }
+            } else if(str_cmp_i(attrib_name, "write_queue") == 0) {
+                if(new_value == 0 || new_value == 1) {
+                    tag->write_queue = (new_value ? 1 : 0);
+                    tag->status = PLCTAG_STATUS_OK;
+                    res = PLCTAG_STATUS_OK;
+                } else {
+                    tag->status = PLCTAG_ERR_OUT_OF_BOUNDS;
+                    res = PLCTAG_ERR_OUT_OF_BOUNDS;
+                }
+            } else if(str_cmp_i(attrib_name, "read_cache_ms") == 0) {
                 if(new_value >= 0) {
                     /* expire the cache. */
                     tag->read_cache_expire = (int64_t)0;
@@ -1630,21 +3406,52 @@ LIB_EXPORT int plc_tag_set_int_attribute(int32_t id, const char *attrib_name, in
                     tag->status = PLCTAG_ERR_OUT_OF_BOUNDS;
                     res = PLCTAG_ERR_OUT_OF_BOUNDS;
                 }
+            } else if(str_cmp_i(attrib_name, "read_cache_stale_ms") == 0) {
+                if(new_value >= 0) {
+                    tag->read_cache_stale_ms = (int64_t)new_value;
+                    tag->status = PLCTAG_STATUS_OK;
+                    res = PLCTAG_STATUS_OK;
+                } else {
+                    tag->status = PLCTAG_ERR_OUT_OF_BOUNDS;
+                    res = PLCTAG_ERR_OUT_OF_BOUNDS;
+                }
             } else if(str_cmp_i(attrib_name, "auto_sync_read_ms") == 0) {
                 if(new_value >= 0) {
                     tag->auto_sync_read_ms = new_value;
+                    tag->auto_sync_read_cur_ms = 0;
                     tag->status = PLCTAG_STATUS_OK;
                     res = PLCTAG_STATUS_OK;
+                    plc_tag_wake_tag(tag->tag_id);
+
+                    if(auto_sync_window_ms > 0) {
+                        request_auto_sync_plan(tag->tickler_shard);
+                    }
                 } else {
                     pdebug(DEBUG_WARN, "auto_sync_read_ms must be greater than or equal to zero!");
                     tag->status = PLCTAG_ERR_OUT_OF_BOUNDS;
                     res = PLCTAG_ERR_OUT_OF_BOUNDS;
                 }
+            } else if(str_cmp_i(attrib_name, "auto_sync_read_max_ms") == 0) {
+                if(new_value >= 0) {
+                    res = (new_value > 0 ? tag_change_enable_unsafe(tag, 0) : PLCTAG_STATUS_OK);
+
+                    if(res == PLCTAG_STATUS_OK) {
+                        tag->auto_sync_read_max_ms = new_value;
+                        tag->auto_sync_read_cur_ms = 0;
+                    }
+
+                    tag->status = (int8_t)res;
+                } else {
+                    pdebug(DEBUG_WARN, "auto_sync_read_max_ms must be greater than or equal to zero!");
+                    tag->status = PLCTAG_ERR_OUT_OF_BOUNDS;
+                    res = PLCTAG_ERR_OUT_OF_BOUNDS;
+                }
             } else if(str_cmp_i(attrib_name, "auto_sync_write_ms") == 0) {
                 if(new_value >= 0) {
                     tag->auto_sync_write_ms = new_value;
                     tag->status = PLCTAG_STATUS_OK;
                     res = PLCTAG_STATUS_OK;
+                    plc_tag_wake_tag(tag->tag_id);
                 } else {
                     pdebug(DEBUG_WARN, "auto_sync_write_ms must be greater than or equal to zero!");
                     tag->status = PLCTAG_ERR_OUT_OF_BOUNDS;
@@ -1695,22 +3502,13 @@ LIB_EXPORT int plc_tag_get_size(int32_t id)
 
 
 
-LIB_EXPORT int plc_tag_get_bit(int32_t id, int offset_bit)
+int get_bit_impl(plc_tag_p tag, int offset_bit)
 {
     int res = PLCTAG_ERR_OUT_OF_BOUNDS;
     int real_offset = offset_bit;
-    plc_tag_p tag = lookup_tag(id);
-
-    pdebug(DEBUG_SPEW, "Starting.");
-
-    if(!tag) {
-        pdebug(DEBUG_WARN, "Tag not found.");
-        return PLCTAG_ERR_NOT_FOUND;
-    }
 
     /* is there data? */
     if(!tag->data) {
-        rc_dec(tag);
         pdebug(DEBUG_WARN, "Tag has no data!");
         tag->status = PLCTAG_ERR_NO_DATA;
         return PLCTAG_ERR_NO_DATA;
@@ -1725,27 +3523,26 @@ LIB_EXPORT int plc_tag_get_bit(int32_t id, int offset_bit)
 
     pdebug(DEBUG_SPEW, "selecting bit %d with offset %d in byte %d (%x).", real_offset, (real_offset % 8), (real_offset / 8), tag->data[real_offset / 8]);
 
-    critical_block(tag->api_mutex) {
-        if((real_offset >= 0) && ((real_offset / 8) < tag->size)) {
-            res = !!(((1 << (real_offset % 8)) & 0xFF) & (tag->data[real_offset / 8]));
-            tag->status = PLCTAG_STATUS_OK;
-        } else {
-            pdebug(DEBUG_WARN, "Data offset out of bounds!");
-            res = PLCTAG_ERR_OUT_OF_BOUNDS;
-            tag->status = PLCTAG_ERR_OUT_OF_BOUNDS;
+    if(real_offset >= 0) {
+        uint8_t raw = 0;
+
+        res = copy_tag_data(tag, real_offset / 8, &raw, 1);
+        if(res == PLCTAG_STATUS_OK) {
+            res = !!(((1 << (real_offset % 8)) & 0xFF) & raw);
         }
+    } else {
+        pdebug(DEBUG_WARN, "Data offset out of bounds!");
+        res = PLCTAG_ERR_OUT_OF_BOUNDS;
+        tag->status = PLCTAG_ERR_OUT_OF_BOUNDS;
     }
 
-    rc_dec(tag);
-
     return res;
 }
 
 
-LIB_EXPORT int plc_tag_set_bit(int32_t id, int offset_bit, int val)
+LIB_EXPORT int plc_tag_get_bit(int32_t id, int offset_bit)
 {
-    int res = PLCTAG_STATUS_OK;
-    int real_offset = offset_bit;
+    int res = PLCTAG_ERR_OUT_OF_BOUNDS;
     plc_tag_p tag = lookup_tag(id);
 
     pdebug(DEBUG_SPEW, "Starting.");
@@ -1755,9 +3552,23 @@ LIB_EXPORT int plc_tag_set_bit(int32_t id, int offset_bit, int val)
         return PLCTAG_ERR_NOT_FOUND;
     }
 
+    res = get_bit_impl(tag, offset_bit);
+
+    rc_dec(tag);
+
+    pdebug(DEBUG_SPEW, "Done.");
+
+    return res;
+}
+
+
+int set_bit_impl(plc_tag_p tag, int offset_bit, int val)
+{
+    int res = PLCTAG_STATUS_OK;
+    int real_offset = offset_bit;
+
     /* is there data? */
     if(!tag->data) {
-        rc_dec(tag);
         pdebug(DEBUG_WARN, "Tag has no data!");
         tag->status = PLCTAG_ERR_NO_DATA;
         return PLCTAG_ERR_NO_DATA;
@@ -1775,7 +3586,7 @@ LIB_EXPORT int plc_tag_set_bit(int32_t id, int offset_bit, int val)
     critical_block(tag->api_mutex) {
         if((real_offset >= 0) && ((real_offset / 8) < tag->size)) {
             if(tag->auto_sync_write_ms > 0) {
-                tag->tag_is_dirty = 1;
+                mark_tag_dirty(tag);
             }
 
             if(val) {
@@ -1784,6 +3595,8 @@ LIB_EXPORT int plc_tag_set_bit(int32_t id, int offset_bit, int val)
                 tag->data[real_offset / 8] &= (uint8_t)(~(1 << (real_offset % 8)));
             }
 
+            tag_snapshot_publish(tag, real_offset / 8, 1);
+
             tag->status = PLCTAG_STATUS_OK;
         } else {
             pdebug(DEBUG_WARN, "Data offset out of bounds!");
@@ -1792,53 +3605,51 @@ LIB_EXPORT int plc_tag_set_bit(int32_t id, int offset_bit, int val)
         }
     }
 
-    rc_dec(tag);
-
     return res;
 }
 
 
-
-LIB_EXPORT uint64_t plc_tag_get_uint64(int32_t id, int offset)
+LIB_EXPORT int plc_tag_set_bit(int32_t id, int offset_bit, int val)
 {
-    uint64_t res = UINT64_MAX;
+    int res = PLCTAG_STATUS_OK;
     plc_tag_p tag = lookup_tag(id);
 
     pdebug(DEBUG_SPEW, "Starting.");
 
     if(!tag) {
-        pdebug(DEBUG_WARN,"Tag not found.");
-        return res;
+        pdebug(DEBUG_WARN, "Tag not found.");
+        return PLCTAG_ERR_NOT_FOUND;
     }
 
+    res = set_bit_impl(tag, offset_bit, val);
+
+    rc_dec(tag);
+
+    pdebug(DEBUG_SPEW, "Done.");
+
+    return res;
+}
+
+
+
+uint64_t get_uint64_impl(plc_tag_p tag, int offset)
+{
+    uint64_t res = UINT64_MAX;
+    uint8_t raw[sizeof(uint64_t)];
+
     /* is there data? */
     if(!tag->data) {
-        rc_dec(tag);
         pdebug(DEBUG_WARN,"Tag has no data!");
         tag->status = PLCTAG_ERR_NO_DATA;
         return res;
     }
 
     if(!tag->is_bit) {
-        critical_block(tag->api_mutex) {
-            if((offset >= 0) && (offset + ((int)sizeof(uint64_t)) <= tag->size)) {
-                res =   ((uint64_t)(tag->data[offset + tag->byte_order->int64_order[0]]) << 0 ) +
-                        ((uint64_t)(tag->data[offset + tag->byte_order->int64_order[1]]) << 8 ) +
-                        ((uint64_t)(tag->data[offset + tag->byte_order->int64_order[2]]) << 16) +
-                        ((uint64_t)(tag->data[offset + tag->byte_order->int64_order[3]]) << 24) +
-                        ((uint64_t)(tag->data[offset + tag->byte_order->int64_order[4]]) << 32) +
-                        ((uint64_t)(tag->data[offset + tag->byte_order->int64_order[5]]) << 40) +
-                        ((uint64_t)(tag->data[offset + tag->byte_order->int64_order[6]]) << 48) +
-                        ((uint64_t)(tag->data[offset + tag->byte_order->int64_order[7]]) << 56);
-
-                tag->status = PLCTAG_STATUS_OK;
-            } else {
-                pdebug(DEBUG_WARN, "Data offset out of bounds!");
-                tag->status = PLCTAG_ERR_OUT_OF_BOUNDS;
-            }
+        if(copy_tag_data(tag, offset, raw, (int)sizeof(raw)) == PLCTAG_STATUS_OK) {
+            res = tag->int64_kernel.get(raw, tag->int64_kernel.order);
         }
     } else {
-        int rc = plc_tag_get_bit(id, tag->bit);
+        int rc = get_bit_impl(tag, tag->bit);
 
         /* make sure the response is good. */
         if(rc >= 0) {
@@ -1846,28 +3657,39 @@ LIB_EXPORT uint64_t plc_tag_get_uint64(int32_t id, int offset)
         }
     }
 
-    rc_dec(tag);
-
     return res;
 }
 
 
-
-LIB_EXPORT int plc_tag_set_uint64(int32_t id, int offset, uint64_t val)
+LIB_EXPORT uint64_t plc_tag_get_uint64(int32_t id, int offset)
 {
-    int rc = PLCTAG_STATUS_OK;
+    uint64_t res = UINT64_MAX;
     plc_tag_p tag = lookup_tag(id);
 
     pdebug(DEBUG_SPEW, "Starting.");
 
     if(!tag) {
         pdebug(DEBUG_WARN,"Tag not found.");
-        return PLCTAG_ERR_NOT_FOUND;
+        return res;
     }
 
+    res = get_uint64_impl(tag, offset);
+
+    rc_dec(tag);
+
+    pdebug(DEBUG_SPEW, "Done.");
+
+    return res;
+}
+
+
+
+int set_uint64_impl(plc_tag_p tag, int offset, uint64_t val)
+{
+    int rc = PLCTAG_STATUS_OK;
+
     /* is there data? */
     if(!tag->data) {
-        rc_dec(tag);
         pdebug(DEBUG_WARN,"Tag has no data!");
         tag->status = PLCTAG_ERR_NO_DATA;
         return PLCTAG_ERR_NO_DATA;
@@ -1877,17 +3699,11 @@ LIB_EXPORT int plc_tag_set_uint64(int32_t id, int offset, uint64_t val)
         critical_block(tag->api_mutex) {
             if((offset >= 0) && (offset + ((int)sizeof(uint64_t)) <= tag->size)) {
                 if(tag->auto_sync_write_ms > 0) {
-                    tag->tag_is_dirty = 1;
+                    mark_tag_dirty(tag);
                 }
 
-                tag->data[offset + tag->byte_order->int64_order[0]] = (uint8_t)((val >> 0 ) & 0xFF);
-                tag->data[offset + tag->byte_order->int64_order[1]] = (uint8_t)((val >> 8 ) & 0xFF);
-                tag->data[offset + tag->byte_order->int64_order[2]] = (uint8_t)((val >> 16) & 0xFF);
-                tag->data[offset + tag->byte_order->int64_order[3]] = (uint8_t)((val >> 24) & 0xFF);
-                tag->data[offset + tag->byte_order->int64_order[4]] = (uint8_t)((val >> 32) & 0xFF);
-                tag->data[offset + tag->byte_order->int64_order[5]] = (uint8_t)((val >> 40) & 0xFF);
-                tag->data[offset + tag->byte_order->int64_order[6]] = (uint8_t)((val >> 48) & 0xFF);
-                tag->data[offset + tag->byte_order->int64_order[7]] = (uint8_t)((val >> 56) & 0xFF);
+                tag->int64_kernel.set(tag->data + offset, tag->int64_kernel.order, (uint64_t)val);
+                tag_snapshot_publish(tag, offset, (int)sizeof(uint64_t));
 
                 tag->status = PLCTAG_STATUS_OK;
             } else {
@@ -1898,60 +3714,58 @@ LIB_EXPORT int plc_tag_set_uint64(int32_t id, int offset, uint64_t val)
         }
     } else {
         if(!val) {
-            rc = plc_tag_set_bit(id, 0, 0);
+            rc = set_bit_impl(tag, 0, 0);
         } else {
-            rc = plc_tag_set_bit(id, 0, 1);
+            rc = set_bit_impl(tag, 0, 1);
         }
     }
 
-    rc_dec(tag);
-
     return rc;
 }
 
 
-
-
-LIB_EXPORT int64_t plc_tag_get_int64(int32_t id, int offset)
+LIB_EXPORT int plc_tag_set_uint64(int32_t id, int offset, uint64_t val)
 {
-    int64_t res = INT64_MIN;
+    int rc = PLCTAG_STATUS_OK;
     plc_tag_p tag = lookup_tag(id);
 
     pdebug(DEBUG_SPEW, "Starting.");
 
     if(!tag) {
         pdebug(DEBUG_WARN,"Tag not found.");
-        return res;
+        return PLCTAG_ERR_NOT_FOUND;
     }
 
+    rc = set_uint64_impl(tag, offset, val);
+
+    rc_dec(tag);
+
+    pdebug(DEBUG_SPEW, "Done.");
+
+    return rc;
+}
+
+
+
+
+int64_t get_int64_impl(plc_tag_p tag, int offset)
+{
+    int64_t res = INT64_MIN;
+    uint8_t raw[sizeof(int64_t)];
+
     /* is there data? */
     if(!tag->data) {
-        rc_dec(tag);
         pdebug(DEBUG_WARN,"Tag has no data!");
         tag->status = PLCTAG_ERR_NO_DATA;
         return res;
     }
 
     if(!tag->is_bit) {
-        critical_block(tag->api_mutex) {
-            if((offset >= 0) && (offset + ((int)sizeof(int64_t)) <= tag->size)) {
-                res = (int64_t)(((uint64_t)(tag->data[offset + tag->byte_order->int64_order[0]]) << 0 ) +
-                                ((uint64_t)(tag->data[offset + tag->byte_order->int64_order[1]]) << 8 ) +
-                                ((uint64_t)(tag->data[offset + tag->byte_order->int64_order[2]]) << 16) +
-                                ((uint64_t)(tag->data[offset + tag->byte_order->int64_order[3]]) << 24) +
-                                ((uint64_t)(tag->data[offset + tag->byte_order->int64_order[4]]) << 32) +
-                                ((uint64_t)(tag->data[offset + tag->byte_order->int64_order[5]]) << 40) +
-                                ((uint64_t)(tag->data[offset + tag->byte_order->int64_order[6]]) << 48) +
-                                ((uint64_t)(tag->data[offset + tag->byte_order->int64_order[7]]) << 56));
-
-                tag->status = PLCTAG_STATUS_OK;
-            } else {
-                pdebug(DEBUG_WARN, "Data offset out of bounds!");
-                tag->status = PLCTAG_ERR_OUT_OF_BOUNDS;
-            }
+        if(copy_tag_data(tag, offset, raw, (int)sizeof(raw)) == PLCTAG_STATUS_OK) {
+            res = (int64_t)tag->int64_kernel.get(raw, tag->int64_kernel.order);
         }
     } else {
-        int rc = plc_tag_get_bit(id, tag->bit);
+        int rc = get_bit_impl(tag, tag->bit);
 
         /* make sure the response is good. */
         if(rc >= 0) {
@@ -1959,29 +3773,40 @@ LIB_EXPORT int64_t plc_tag_get_int64(int32_t id, int offset)
         }
     }
 
-    rc_dec(tag);
-
     return res;
 }
 
 
-
-LIB_EXPORT int plc_tag_set_int64(int32_t id, int offset, int64_t ival)
+LIB_EXPORT int64_t plc_tag_get_int64(int32_t id, int offset)
 {
-    int rc = PLCTAG_STATUS_OK;
+    int64_t res = INT64_MIN;
     plc_tag_p tag = lookup_tag(id);
-    uint64_t val = (uint64_t)(ival);
 
     pdebug(DEBUG_SPEW, "Starting.");
 
     if(!tag) {
         pdebug(DEBUG_WARN,"Tag not found.");
-        return PLCTAG_ERR_NOT_FOUND;
+        return res;
     }
 
+    res = get_int64_impl(tag, offset);
+
+    rc_dec(tag);
+
+    pdebug(DEBUG_SPEW, "Done.");
+
+    return res;
+}
+
+
+
+int set_int64_impl(plc_tag_p tag, int offset, int64_t ival)
+{
+    int rc = PLCTAG_STATUS_OK;
+    uint64_t val = (uint64_t)(ival);
+
     /* is there data? */
     if(!tag->data) {
-        rc_dec(tag);
         pdebug(DEBUG_WARN,"Tag has no data!");
         tag->status = PLCTAG_ERR_NO_DATA;
         return PLCTAG_ERR_NO_DATA;
@@ -1991,17 +3816,11 @@ LIB_EXPORT int plc_tag_set_int64(int32_t id, int offset, int64_t ival)
         critical_block(tag->api_mutex) {
             if((offset >= 0) && (offset + ((int)sizeof(int64_t)) <= tag->size)) {
                 if(tag->auto_sync_write_ms > 0) {
-                    tag->tag_is_dirty = 1;
+                    mark_tag_dirty(tag);
                 }
 
-                tag->data[offset + tag->byte_order->int64_order[0]] = (uint8_t)((val >> 0 ) & 0xFF);
-                tag->data[offset + tag->byte_order->int64_order[1]] = (uint8_t)((val >> 8 ) & 0xFF);
-                tag->data[offset + tag->byte_order->int64_order[2]] = (uint8_t)((val >> 16) & 0xFF);
-                tag->data[offset + tag->byte_order->int64_order[3]] = (uint8_t)((val >> 24) & 0xFF);
-                tag->data[offset + tag->byte_order->int64_order[4]] = (uint8_t)((val >> 32) & 0xFF);
-                tag->data[offset + tag->byte_order->int64_order[5]] = (uint8_t)((val >> 40) & 0xFF);
-                tag->data[offset + tag->byte_order->int64_order[6]] = (uint8_t)((val >> 48) & 0xFF);
-                tag->data[offset + tag->byte_order->int64_order[7]] = (uint8_t)((val >> 56) & 0xFF);
+                tag->int64_kernel.set(tag->data + offset, tag->int64_kernel.order, (uint64_t)val);
+                tag_snapshot_publish(tag, offset, (int)sizeof(int64_t));
 
                 tag->status = PLCTAG_STATUS_OK;
             } else {
@@ -2012,53 +3831,55 @@ LIB_EXPORT int plc_tag_set_int64(int32_t id, int offset, int64_t ival)
         }
     } else {
         if(!val) {
-            rc = plc_tag_set_bit(id, 0, 0);
+            rc = set_bit_impl(tag, 0, 0);
         } else {
-            rc = plc_tag_set_bit(id, 0, 1);
+            rc = set_bit_impl(tag, 0, 1);
         }
     }
 
-    rc_dec(tag);
-
     return rc;
 }
 
-LIB_EXPORT uint32_t plc_tag_get_uint32(int32_t id, int offset)
+
+LIB_EXPORT int plc_tag_set_int64(int32_t id, int offset, int64_t ival)
 {
-    uint32_t res = UINT32_MAX;
+    int rc = PLCTAG_STATUS_OK;
     plc_tag_p tag = lookup_tag(id);
 
     pdebug(DEBUG_SPEW, "Starting.");
 
     if(!tag) {
         pdebug(DEBUG_WARN,"Tag not found.");
-        return res;
+        return PLCTAG_ERR_NOT_FOUND;
     }
 
+    rc = set_int64_impl(tag, offset, ival);
+
+    rc_dec(tag);
+
+    pdebug(DEBUG_SPEW, "Done.");
+
+    return rc;
+}
+
+uint32_t get_uint32_impl(plc_tag_p tag, int offset)
+{
+    uint32_t res = UINT32_MAX;
+    uint8_t raw[sizeof(uint32_t)];
+
     /* is there data? */
     if(!tag->data) {
-        rc_dec(tag);
         pdebug(DEBUG_WARN,"Tag has no data!");
         tag->status = PLCTAG_ERR_NO_DATA;
         return res;
     }
 
     if(!tag->is_bit) {
-        critical_block(tag->api_mutex) {
-            if((offset >= 0) && (offset + ((int)sizeof(uint32_t)) <= tag->size)) {
-                res =   ((uint32_t)(tag->data[offset + tag->byte_order->int32_order[0]]) << 0 ) +
-                        ((uint32_t)(tag->data[offset + tag->byte_order->int32_order[1]]) << 8 ) +
-                        ((uint32_t)(tag->data[offset + tag->byte_order->int32_order[2]]) << 16) +
-                        ((uint32_t)(tag->data[offset + tag->byte_order->int32_order[3]]) << 24);
-
-                tag->status = PLCTAG_STATUS_OK;
-            } else {
-                pdebug(DEBUG_WARN, "Data offset out of bounds!");
-                tag->status = PLCTAG_ERR_OUT_OF_BOUNDS;
-            }
+        if(copy_tag_data(tag, offset, raw, (int)sizeof(raw)) == PLCTAG_STATUS_OK) {
+            res = (uint32_t)tag->int32_kernel.get(raw, tag->int32_kernel.order);
         }
     } else {
-        int rc = plc_tag_get_bit(id, tag->bit);
+        int rc = get_bit_impl(tag, tag->bit);
 
         /* make sure the response is good. */
         if(rc >= 0) {
@@ -2066,28 +3887,39 @@ LIB_EXPORT uint32_t plc_tag_get_uint32(int32_t id, int offset)
         }
     }
 
-    rc_dec(tag);
-
     return res;
 }
 
 
-
-LIB_EXPORT int plc_tag_set_uint32(int32_t id, int offset, uint32_t val)
+LIB_EXPORT uint32_t plc_tag_get_uint32(int32_t id, int offset)
 {
-    int rc = PLCTAG_STATUS_OK;
+    uint32_t res = UINT32_MAX;
     plc_tag_p tag = lookup_tag(id);
 
     pdebug(DEBUG_SPEW, "Starting.");
 
     if(!tag) {
         pdebug(DEBUG_WARN,"Tag not found.");
-        return PLCTAG_ERR_NOT_FOUND;
+        return res;
     }
 
+    res = get_uint32_impl(tag, offset);
+
+    rc_dec(tag);
+
+    pdebug(DEBUG_SPEW, "Done.");
+
+    return res;
+}
+
+
+
+int set_uint32_impl(plc_tag_p tag, int offset, uint32_t val)
+{
+    int rc = PLCTAG_STATUS_OK;
+
     /* is there data? */
     if(!tag->data) {
-        rc_dec(tag);
         pdebug(DEBUG_WARN,"Tag has no data!");
         tag->status = PLCTAG_ERR_NO_DATA;
         return PLCTAG_ERR_NO_DATA;
@@ -2097,13 +3929,11 @@ LIB_EXPORT int plc_tag_set_uint32(int32_t id, int offset, uint32_t val)
         critical_block(tag->api_mutex) {
             if((offset >= 0) && (offset + ((int)sizeof(uint32_t)) <= tag->size)) {
                 if(tag->auto_sync_write_ms > 0) {
-                    tag->tag_is_dirty = 1;
+                    mark_tag_dirty(tag);
                 }
 
-                tag->data[offset + tag->byte_order->int32_order[0]] = (uint8_t)((val >> 0 ) & 0xFF);
-                tag->data[offset + tag->byte_order->int32_order[1]] = (uint8_t)((val >> 8 ) & 0xFF);
-                tag->data[offset + tag->byte_order->int32_order[2]] = (uint8_t)((val >> 16) & 0xFF);
-                tag->data[offset + tag->byte_order->int32_order[3]] = (uint8_t)((val >> 24) & 0xFF);
+                tag->int32_kernel.set(tag->data + offset, tag->int32_kernel.order, (uint64_t)val);
+                tag_snapshot_publish(tag, offset, (int)sizeof(uint32_t));
 
                 tag->status = PLCTAG_STATUS_OK;
             } else {
@@ -2114,56 +3944,58 @@ LIB_EXPORT int plc_tag_set_uint32(int32_t id, int offset, uint32_t val)
         }
     } else {
         if(!val) {
-            rc = plc_tag_set_bit(id, 0, 0);
+            rc = set_bit_impl(tag, 0, 0);
         } else {
-            rc = plc_tag_set_bit(id, 0, 1);
+            rc = set_bit_impl(tag, 0, 1);
         }
     }
 
-    rc_dec(tag);
-
     return rc;
 }
 
 
-
-
-LIB_EXPORT int32_t  plc_tag_get_int32(int32_t id, int offset)
+LIB_EXPORT int plc_tag_set_uint32(int32_t id, int offset, uint32_t val)
 {
-    int32_t res = INT32_MIN;
+    int rc = PLCTAG_STATUS_OK;
     plc_tag_p tag = lookup_tag(id);
 
     pdebug(DEBUG_SPEW, "Starting.");
 
     if(!tag) {
         pdebug(DEBUG_WARN,"Tag not found.");
-        return res;
+        return PLCTAG_ERR_NOT_FOUND;
     }
 
+    rc = set_uint32_impl(tag, offset, val);
+
+    rc_dec(tag);
+
+    pdebug(DEBUG_SPEW, "Done.");
+
+    return rc;
+}
+
+
+
+
+int32_t get_int32_impl(plc_tag_p tag, int offset)
+{
+    int32_t res = INT32_MIN;
+    uint8_t raw[sizeof(int32_t)];
+
     /* is there data? */
     if(!tag->data) {
-        rc_dec(tag);
         pdebug(DEBUG_WARN,"Tag has no data!");
         tag->status = PLCTAG_ERR_NO_DATA;
         return res;
     }
 
     if(!tag->is_bit) {
-        critical_block(tag->api_mutex) {
-            if((offset >= 0) && (offset + ((int)sizeof(int32_t)) <= tag->size)) {
-                res = (int32_t)(((uint32_t)(tag->data[offset + tag->byte_order->int32_order[0]]) << 0 ) +
-                                ((uint32_t)(tag->data[offset + tag->byte_order->int32_order[1]]) << 8 ) +
-                                ((uint32_t)(tag->data[offset + tag->byte_order->int32_order[2]]) << 16) +
-                                ((uint32_t)(tag->data[offset + tag->byte_order->int32_order[3]]) << 24));
-
-                tag->status = PLCTAG_STATUS_OK;
-            }  else {
-                pdebug(DEBUG_WARN, "Data offset out of bounds!");
-                tag->status = PLCTAG_ERR_OUT_OF_BOUNDS;
-            }
+        if(copy_tag_data(tag, offset, raw, (int)sizeof(raw)) == PLCTAG_STATUS_OK) {
+            res = (int32_t)(uint32_t)tag->int32_kernel.get(raw, tag->int32_kernel.order);
         }
     } else {
-        int rc = plc_tag_get_bit(id, tag->bit);
+        int rc = get_bit_impl(tag, tag->bit);
 
         /* make sure the response is good. */
         if(rc >= 0) {
@@ -2171,29 +4003,40 @@ LIB_EXPORT int32_t  plc_tag_get_int32(int32_t id, int offset)
         }
     }
 
-    rc_dec(tag);
-
     return res;
 }
 
 
-
-LIB_EXPORT int plc_tag_set_int32(int32_t id, int offset, int32_t ival)
+LIB_EXPORT int32_t plc_tag_get_int32(int32_t id, int offset)
 {
-    int rc = PLCTAG_STATUS_OK;
+    int32_t res = INT32_MIN;
     plc_tag_p tag = lookup_tag(id);
-    uint32_t val = (uint32_t)ival;
 
     pdebug(DEBUG_SPEW, "Starting.");
 
     if(!tag) {
         pdebug(DEBUG_WARN,"Tag not found.");
-        return PLCTAG_ERR_NOT_FOUND;
+        return res;
     }
 
+    res = get_int32_impl(tag, offset);
+
+    rc_dec(tag);
+
+    pdebug(DEBUG_SPEW, "Done.");
+
+    return res;
+}
+
+
+
+int set_int32_impl(plc_tag_p tag, int offset, int32_t ival)
+{
+    int rc = PLCTAG_STATUS_OK;
+    uint32_t val = (uint32_t)ival;
+
     /* is there data? */
     if(!tag->data) {
-        rc_dec(tag);
         pdebug(DEBUG_WARN,"Tag has no data!");
         tag->status = PLCTAG_ERR_NO_DATA;
         return PLCTAG_ERR_NO_DATA;
@@ -2203,13 +4046,11 @@ LIB_EXPORT int plc_tag_set_int32(int32_t id, int offset, int32_t ival)
         critical_block(tag->api_mutex) {
             if((offset >= 0) && (offset + ((int)sizeof(int32_t)) <= tag->size)) {
                 if(tag->auto_sync_write_ms > 0) {
-                    tag->tag_is_dirty = 1;
+                    mark_tag_dirty(tag);
                 }
 
-                tag->data[offset + tag->byte_order->int32_order[0]] = (uint8_t)((val >> 0 ) & 0xFF);
-                tag->data[offset + tag->byte_order->int32_order[1]] = (uint8_t)((val >> 8 ) & 0xFF);
-                tag->data[offset + tag->byte_order->int32_order[2]] = (uint8_t)((val >> 16) & 0xFF);
-                tag->data[offset + tag->byte_order->int32_order[3]] = (uint8_t)((val >> 24) & 0xFF);
+                tag->int32_kernel.set(tag->data + offset, tag->int32_kernel.order, (uint64_t)val);
+                tag_snapshot_publish(tag, offset, (int)sizeof(int32_t));
 
                 tag->status = PLCTAG_STATUS_OK;
             } else {
@@ -2220,14 +4061,34 @@ LIB_EXPORT int plc_tag_set_int32(int32_t id, int offset, int32_t ival)
         }
     } else {
         if(!val) {
-            rc = plc_tag_set_bit(id, 0, 0);
+            rc = set_bit_impl(tag, 0, 0);
         } else {
-            rc = plc_tag_set_bit(id, 0, 1);
+            rc = set_bit_impl(tag, 0, 1);
         }
     }
 
+    return rc;
+}
+
+
+LIB_EXPORT int plc_tag_set_int32(int32_t id, int offset, int32_t ival)
+{
+    int rc = PLCTAG_STATUS_OK;
+    plc_tag_p tag = lookup_tag(id);
+
+    pdebug(DEBUG_SPEW, "Starting.");
+
+    if(!tag) {
+        pdebug(DEBUG_WARN,"Tag not found.");
+        return PLCTAG_ERR_NOT_FOUND;
+    }
+
+    rc = set_int32_impl(tag, offset, ival);
+
     rc_dec(tag);
 
+    pdebug(DEBUG_SPEW, "Done.");
+
     return rc;
 }
 
@@ -2237,40 +4098,24 @@ LIB_EXPORT int plc_tag_set_int32(int32_t id, int offset, int32_t ival)
 
 
 
-LIB_EXPORT uint16_t plc_tag_get_uint16(int32_t id, int offset)
+uint16_t get_uint16_impl(plc_tag_p tag, int offset)
 {
     uint16_t res = UINT16_MAX;
-    plc_tag_p tag = lookup_tag(id);
-
-    pdebug(DEBUG_SPEW, "Starting.");
-
-    if(!tag) {
-        pdebug(DEBUG_WARN,"Tag not found.");
-        return res;
-    }
+    uint8_t raw[sizeof(uint16_t)];
 
     /* is there data? */
     if(!tag->data) {
-        rc_dec(tag);
         pdebug(DEBUG_WARN,"Tag has no data!");
         tag->status = PLCTAG_ERR_NO_DATA;
         return res;
     }
 
     if(!tag->is_bit) {
-        critical_block(tag->api_mutex) {
-            if((offset >= 0) && (offset + ((int)sizeof(uint16_t)) <= tag->size)) {
-                res =   (uint16_t)(((uint16_t)(tag->data[offset + tag->byte_order->int16_order[0]]) << 0 ) +
-                                   ((uint16_t)(tag->data[offset + tag->byte_order->int16_order[1]]) << 8 ));
-
-                tag->status = PLCTAG_STATUS_OK;
-            } else {
-                pdebug(DEBUG_WARN, "Data offset out of bounds!");
-                tag->status = PLCTAG_ERR_OUT_OF_BOUNDS;
-            }
+        if(copy_tag_data(tag, offset, raw, (int)sizeof(raw)) == PLCTAG_STATUS_OK) {
+            res = (uint16_t)tag->int16_kernel.get(raw, tag->int16_kernel.order);
         }
     } else {
-        int rc = plc_tag_get_bit(id, tag->bit);
+        int rc = get_bit_impl(tag, tag->bit);
 
         /* make sure the response is good. */
         if(rc >= 0) {
@@ -2278,29 +4123,40 @@ LIB_EXPORT uint16_t plc_tag_get_uint16(int32_t id, int offset)
         }
     }
 
-    rc_dec(tag);
-
     return res;
 }
 
 
-
-
-LIB_EXPORT int plc_tag_set_uint16(int32_t id, int offset, uint16_t val)
+LIB_EXPORT uint16_t plc_tag_get_uint16(int32_t id, int offset)
 {
-    int rc = PLCTAG_STATUS_OK;
+    uint16_t res = UINT16_MAX;
     plc_tag_p tag = lookup_tag(id);
 
     pdebug(DEBUG_SPEW, "Starting.");
 
     if(!tag) {
         pdebug(DEBUG_WARN,"Tag not found.");
-        return PLCTAG_ERR_NOT_FOUND;
+        return res;
     }
 
+    res = get_uint16_impl(tag, offset);
+
+    rc_dec(tag);
+
+    pdebug(DEBUG_SPEW, "Done.");
+
+    return res;
+}
+
+
+
+
+int set_uint16_impl(plc_tag_p tag, int offset, uint16_t val)
+{
+    int rc = PLCTAG_STATUS_OK;
+
     /* is there data? */
     if(!tag->data) {
-        rc_dec(tag);
         pdebug(DEBUG_WARN,"Tag has no data!");
         tag->status = PLCTAG_ERR_NO_DATA;
         return PLCTAG_ERR_NO_DATA;
@@ -2310,11 +4166,11 @@ LIB_EXPORT int plc_tag_set_uint16(int32_t id, int offset, uint16_t val)
         critical_block(tag->api_mutex) {
             if((offset >= 0) && (offset + ((int)sizeof(uint16_t)) <= tag->size)) {
                 if(tag->auto_sync_write_ms > 0) {
-                    tag->tag_is_dirty = 1;
+                    mark_tag_dirty(tag);
                 }
 
-                tag->data[offset + tag->byte_order->int16_order[0]] = (uint8_t)((val >> 0 ) & 0xFF);
-                tag->data[offset + tag->byte_order->int16_order[1]] = (uint8_t)((val >> 8 ) & 0xFF);
+                tag->int16_kernel.set(tag->data + offset, tag->int16_kernel.order, (uint64_t)val);
+                tag_snapshot_publish(tag, offset, (int)sizeof(uint16_t));
 
                 tag->status = PLCTAG_STATUS_OK;
             } else {
@@ -2325,14 +4181,34 @@ LIB_EXPORT int plc_tag_set_uint16(int32_t id, int offset, uint16_t val)
         }
     } else {
         if(!val) {
-            rc = plc_tag_set_bit(id, 0, 0);
+            rc = set_bit_impl(tag, 0, 0);
         } else {
-            rc = plc_tag_set_bit(id, 0, 1);
+            rc = set_bit_impl(tag, 0, 1);
         }
     }
 
+    return rc;
+}
+
+
+LIB_EXPORT int plc_tag_set_uint16(int32_t id, int offset, uint16_t val)
+{
+    int rc = PLCTAG_STATUS_OK;
+    plc_tag_p tag = lookup_tag(id);
+
+    pdebug(DEBUG_SPEW, "Starting.");
+
+    if(!tag) {
+        pdebug(DEBUG_WARN,"Tag not found.");
+        return PLCTAG_ERR_NOT_FOUND;
+    }
+
+    rc = set_uint16_impl(tag, offset, val);
+
     rc_dec(tag);
 
+    pdebug(DEBUG_SPEW, "Done.");
+
     return rc;
 }
 
@@ -2344,39 +4220,24 @@ LIB_EXPORT int plc_tag_set_uint16(int32_t id, int offset, uint16_t val)
 
 
 
-LIB_EXPORT int16_t  plc_tag_get_int16(int32_t id, int offset)
+int16_t get_int16_impl(plc_tag_p tag, int offset)
 {
     int16_t res = INT16_MIN;
-    plc_tag_p tag = lookup_tag(id);
-
-    pdebug(DEBUG_SPEW, "Starting.");
-
-    if(!tag) {
-        pdebug(DEBUG_WARN,"Tag not found.");
-        return res;
-    }
+    uint8_t raw[sizeof(int16_t)];
 
     /* is there data? */
     if(!tag->data) {
-        rc_dec(tag);
         pdebug(DEBUG_WARN,"Tag has no data!");
         tag->status = PLCTAG_ERR_NO_DATA;
         return res;
     }
 
     if(!tag->is_bit) {
-        critical_block(tag->api_mutex) {
-            if((offset >= 0) && (offset + ((int)sizeof(int16_t)) <= tag->size)) {
-                res =   (int16_t)(uint16_t)(((uint16_t)(tag->data[offset + tag->byte_order->int16_order[0]]) << 0 ) +
-                                            ((uint16_t)(tag->data[offset + tag->byte_order->int16_order[1]]) << 8 ));
-                tag->status = PLCTAG_STATUS_OK;
-            } else {
-                pdebug(DEBUG_WARN, "Data offset out of bounds!");
-                tag->status = PLCTAG_ERR_OUT_OF_BOUNDS;
-            }
+        if(copy_tag_data(tag, offset, raw, (int)sizeof(raw)) == PLCTAG_STATUS_OK) {
+            res = (int16_t)(uint16_t)tag->int16_kernel.get(raw, tag->int16_kernel.order);
         }
     } else {
-        int rc = plc_tag_get_bit(id, tag->bit);
+        int rc = get_bit_impl(tag, tag->bit);
 
         /* make sure the response is good. */
         if(rc >= 0) {
@@ -2384,30 +4245,41 @@ LIB_EXPORT int16_t  plc_tag_get_int16(int32_t id, int offset)
         }
     }
 
-    rc_dec(tag);
-
     return res;
 }
 
 
-
-
-LIB_EXPORT int plc_tag_set_int16(int32_t id, int offset, int16_t ival)
+LIB_EXPORT int16_t plc_tag_get_int16(int32_t id, int offset)
 {
-    int rc = PLCTAG_STATUS_OK;
+    int16_t res = INT16_MIN;
     plc_tag_p tag = lookup_tag(id);
-    uint16_t val = (uint16_t)ival;
 
     pdebug(DEBUG_SPEW, "Starting.");
 
     if(!tag) {
         pdebug(DEBUG_WARN,"Tag not found.");
-        return PLCTAG_ERR_NOT_FOUND;
+        return res;
     }
 
+    res = get_int16_impl(tag, offset);
+
+    rc_dec(tag);
+
+    pdebug(DEBUG_SPEW, "Done.");
+
+    return res;
+}
+
+
+
+
+int set_int16_impl(plc_tag_p tag, int offset, int16_t ival)
+{
+    int rc = PLCTAG_STATUS_OK;
+    uint16_t val = (uint16_t)ival;
+
     /* is there data? */
     if(!tag->data) {
-        rc_dec(tag);
         pdebug(DEBUG_WARN,"Tag has no data!");
         tag->status = PLCTAG_ERR_NO_DATA;
         return PLCTAG_ERR_NO_DATA;
@@ -2417,11 +4289,11 @@ LIB_EXPORT int plc_tag_set_int16(int32_t id, int offset, int16_t ival)
         critical_block(tag->api_mutex) {
             if((offset >= 0) && (offset + ((int)sizeof(int16_t)) <= tag->size)) {
                 if(tag->auto_sync_write_ms > 0) {
-                    tag->tag_is_dirty = 1;
+                    mark_tag_dirty(tag);
                 }
 
-                tag->data[offset + tag->byte_order->int16_order[0]] = (uint8_t)((val >> 0 ) & 0xFF);
-                tag->data[offset + tag->byte_order->int16_order[1]] = (uint8_t)((val >> 8 ) & 0xFF);
+                tag->int16_kernel.set(tag->data + offset, tag->int16_kernel.order, (uint64_t)val);
+                tag_snapshot_publish(tag, offset, (int)sizeof(int16_t));
 
                 tag->status = PLCTAG_STATUS_OK;
             } else {
@@ -2432,14 +4304,34 @@ LIB_EXPORT int plc_tag_set_int16(int32_t id, int offset, int16_t ival)
         }
     } else {
         if(!val) {
-            rc = plc_tag_set_bit(id, 0, 0);
+            rc = set_bit_impl(tag, 0, 0);
         } else {
-            rc = plc_tag_set_bit(id, 0, 1);
+            rc = set_bit_impl(tag, 0, 1);
         }
     }
 
+    return rc;
+}
+
+
+LIB_EXPORT int plc_tag_set_int16(int32_t id, int offset, int16_t ival)
+{
+    int rc = PLCTAG_STATUS_OK;
+    plc_tag_p tag = lookup_tag(id);
+
+    pdebug(DEBUG_SPEW, "Starting.");
+
+    if(!tag) {
+        pdebug(DEBUG_WARN,"Tag not found.");
+        return PLCTAG_ERR_NOT_FOUND;
+    }
+
+    rc = set_int16_impl(tag, offset, ival);
+
     rc_dec(tag);
 
+    pdebug(DEBUG_SPEW, "Done.");
+
     return rc;
 }
 
@@ -2450,38 +4342,24 @@ LIB_EXPORT int plc_tag_set_int16(int32_t id, int offset, int16_t ival)
 
 
 
-LIB_EXPORT uint8_t plc_tag_get_uint8(int32_t id, int offset)
+uint8_t get_uint8_impl(plc_tag_p tag, int offset)
 {
     uint8_t res = UINT8_MAX;
-    plc_tag_p tag = lookup_tag(id);
-
-    pdebug(DEBUG_SPEW, "Starting.");
-
-    if(!tag) {
-        pdebug(DEBUG_WARN,"Tag not found.");
-        return res;
-    }
+    uint8_t raw[sizeof(uint8_t)];
 
     /* is there data? */
     if(!tag->data) {
-        rc_dec(tag);
         pdebug(DEBUG_WARN,"Tag has no data!");
         tag->status = PLCTAG_ERR_NO_DATA;
         return res;
     }
 
     if(!tag->is_bit) {
-        critical_block(tag->api_mutex) {
-            if((offset >= 0) && (offset + ((int)sizeof(uint8_t)) <= tag->size)) {
-                res = tag->data[offset];
-                tag->status = PLCTAG_STATUS_OK;
-            } else {
-                pdebug(DEBUG_WARN, "Data offset out of bounds!");
-                tag->status = PLCTAG_ERR_OUT_OF_BOUNDS;
-            }
+        if(copy_tag_data(tag, offset, raw, (int)sizeof(raw)) == PLCTAG_STATUS_OK) {
+            res = raw[0];
         }
     } else {
-        int rc = plc_tag_get_bit(id, tag->bit);
+        int rc = get_bit_impl(tag, tag->bit);
 
         /* make sure the response is good. */
         if(rc >= 0) {
@@ -2489,29 +4367,40 @@ LIB_EXPORT uint8_t plc_tag_get_uint8(int32_t id, int offset)
         }
     }
 
-    rc_dec(tag);
-
     return res;
 }
 
 
-
-
-LIB_EXPORT int plc_tag_set_uint8(int32_t id, int offset, uint8_t val)
+LIB_EXPORT uint8_t plc_tag_get_uint8(int32_t id, int offset)
 {
-    int rc = PLCTAG_STATUS_OK;
+    uint8_t res = UINT8_MAX;
     plc_tag_p tag = lookup_tag(id);
 
     pdebug(DEBUG_SPEW, "Starting.");
 
     if(!tag) {
         pdebug(DEBUG_WARN,"Tag not found.");
-        return PLCTAG_ERR_NOT_FOUND;
+        return res;
     }
 
+    res = get_uint8_impl(tag, offset);
+
+    rc_dec(tag);
+
+    pdebug(DEBUG_SPEW, "Done.");
+
+    return res;
+}
+
+
+
+
+int set_uint8_impl(plc_tag_p tag, int offset, uint8_t val)
+{
+    int rc = PLCTAG_STATUS_OK;
+
     /* is there data? */
     if(!tag->data) {
-        rc_dec(tag);
         pdebug(DEBUG_WARN,"Tag has no data!");
         tag->status = PLCTAG_ERR_NO_DATA;
         return PLCTAG_ERR_NO_DATA;
@@ -2521,10 +4410,11 @@ LIB_EXPORT int plc_tag_set_uint8(int32_t id, int offset, uint8_t val)
         critical_block(tag->api_mutex) {
             if((offset >= 0) && (offset + ((int)sizeof(uint8_t)) <= tag->size)) {
                 if(tag->auto_sync_write_ms > 0) {
-                    tag->tag_is_dirty = 1;
+                    mark_tag_dirty(tag);
                 }
 
                 tag->data[offset] = val;
+                tag_snapshot_publish(tag, offset, (int)sizeof(uint8_t));
 
                 tag->status = PLCTAG_STATUS_OK;
             } else {
@@ -2535,53 +4425,59 @@ LIB_EXPORT int plc_tag_set_uint8(int32_t id, int offset, uint8_t val)
         }
     } else {
         if(!val) {
-            rc = plc_tag_set_bit(id, 0, 0);
+            rc = set_bit_impl(tag, 0, 0);
         } else {
-            rc = plc_tag_set_bit(id, 0, 1);
+            rc = set_bit_impl(tag, 0, 1);
         }
     }
 
-    rc_dec(tag);
-
     return rc;
 }
 
 
-
-
-
-LIB_EXPORT int8_t plc_tag_get_int8(int32_t id, int offset)
+LIB_EXPORT int plc_tag_set_uint8(int32_t id, int offset, uint8_t val)
 {
-    int8_t res = INT8_MIN;
+    int rc = PLCTAG_STATUS_OK;
     plc_tag_p tag = lookup_tag(id);
 
     pdebug(DEBUG_SPEW, "Starting.");
 
     if(!tag) {
         pdebug(DEBUG_WARN,"Tag not found.");
-        return res;
+        return PLCTAG_ERR_NOT_FOUND;
     }
 
+    rc = set_uint8_impl(tag, offset, val);
+
+    rc_dec(tag);
+
+    pdebug(DEBUG_SPEW, "Done.");
+
+    return rc;
+}
+
+
+
+
+
+int8_t get_int8_impl(plc_tag_p tag, int offset)
+{
+    int8_t res = INT8_MIN;
+    uint8_t raw[sizeof(int8_t)];
+
     /* is there data? */
     if(!tag->data) {
-        rc_dec(tag);
         pdebug(DEBUG_WARN,"Tag has no data!");
         tag->status = PLCTAG_ERR_NO_DATA;
         return res;
     }
 
     if(!tag->is_bit) {
-        critical_block(tag->api_mutex) {
-            if((offset >= 0) && (offset + ((int)sizeof(uint8_t)) <= tag->size)) {
-                res =   (int8_t)tag->data[offset];
-                tag->status = PLCTAG_STATUS_OK;
-            } else {
-                pdebug(DEBUG_WARN, "Data offset out of bounds!");
-                tag->status = PLCTAG_ERR_OUT_OF_BOUNDS;
-            }
+        if(copy_tag_data(tag, offset, raw, (int)sizeof(raw)) == PLCTAG_STATUS_OK) {
+            res =   (int8_t)raw[0];
         }
     } else {
-        int rc = plc_tag_get_bit(id, tag->bit);
+        int rc = get_bit_impl(tag, tag->bit);
 
         /* make sure the response is good. */
         if(rc >= 0) {
@@ -2589,30 +4485,41 @@ LIB_EXPORT int8_t plc_tag_get_int8(int32_t id, int offset)
         }
     }
 
-    rc_dec(tag);
-
     return res;
 }
 
 
-
-
-LIB_EXPORT int plc_tag_set_int8(int32_t id, int offset, int8_t ival)
+LIB_EXPORT int8_t plc_tag_get_int8(int32_t id, int offset)
 {
-    int rc = PLCTAG_STATUS_OK;
+    int8_t res = INT8_MIN;
     plc_tag_p tag = lookup_tag(id);
-    uint8_t val = (uint8_t)ival;
 
     pdebug(DEBUG_SPEW, "Starting.");
 
     if(!tag) {
         pdebug(DEBUG_WARN,"Tag not found.");
-        return PLCTAG_ERR_NOT_FOUND;
+        return res;
     }
 
+    res = get_int8_impl(tag, offset);
+
+    rc_dec(tag);
+
+    pdebug(DEBUG_SPEW, "Done.");
+
+    return res;
+}
+
+
+
+
+int set_int8_impl(plc_tag_p tag, int offset, int8_t ival)
+{
+    int rc = PLCTAG_STATUS_OK;
+    uint8_t val = (uint8_t)ival;
+
     /* is there data? */
     if(!tag->data) {
-        rc_dec(tag);
         pdebug(DEBUG_WARN,"Tag has no data!");
         tag->status = PLCTAG_ERR_NO_DATA;
         return PLCTAG_ERR_NO_DATA;
@@ -2622,10 +4529,11 @@ LIB_EXPORT int plc_tag_set_int8(int32_t id, int offset, int8_t ival)
         critical_block(tag->api_mutex) {
             if((offset >= 0) && (offset + ((int)sizeof(int8_t)) <= tag->size)) {
                 if(tag->auto_sync_write_ms > 0) {
-                    tag->tag_is_dirty = 1;
+                    mark_tag_dirty(tag);
                 }
 
                 tag->data[offset] = val;
+                tag_snapshot_publish(tag, offset, (int)sizeof(int8_t));
 
                 tag->status = PLCTAG_STATUS_OK;
             } else {
@@ -2636,14 +4544,34 @@ LIB_EXPORT int plc_tag_set_int8(int32_t id, int offset, int8_t ival)
         }
     } else {
         if(!val) {
-            rc = plc_tag_set_bit(id, 0, 0);
+            rc = set_bit_impl(tag, 0, 0);
         } else {
-            rc = plc_tag_set_bit(id, 0, 1);
+            rc = set_bit_impl(tag, 0, 1);
         }
     }
 
+    return rc;
+}
+
+
+LIB_EXPORT int plc_tag_set_int8(int32_t id, int offset, int8_t ival)
+{
+    int rc = PLCTAG_STATUS_OK;
+    plc_tag_p tag = lookup_tag(id);
+
+    pdebug(DEBUG_SPEW, "Starting.");
+
+    if(!tag) {
+        pdebug(DEBUG_WARN,"Tag not found.");
+        return PLCTAG_ERR_NOT_FOUND;
+    }
+
+    rc = set_int8_impl(tag, offset, ival);
+
     rc_dec(tag);
 
+    pdebug(DEBUG_SPEW, "Done.");
+
     return rc;
 }
 
@@ -2652,23 +4580,15 @@ LIB_EXPORT int plc_tag_set_int8(int32_t id, int offset, int8_t ival)
 
 
 
-LIB_EXPORT double plc_tag_get_float64(int32_t id, int offset)
+double get_float64_impl(plc_tag_p tag, int offset)
 {
     double res = DBL_MIN;
+    uint8_t raw[sizeof(double)];
     int rc = PLCTAG_STATUS_OK;
     uint64_t ures = 0;
-    plc_tag_p tag = lookup_tag(id);
-
-    pdebug(DEBUG_SPEW, "Starting.");
-
-    if(!tag) {
-        pdebug(DEBUG_WARN,"Tag not found.");
-        return res;
-    }
 
     /* is there data? */
     if(!tag->data) {
-        rc_dec(tag);
         pdebug(DEBUG_WARN,"Tag has no data!");
         tag->status = PLCTAG_ERR_NO_DATA;
         return res;
@@ -2680,24 +4600,9 @@ LIB_EXPORT double plc_tag_get_float64(int32_t id, int offset)
         return res;
     }
 
-    critical_block(tag->api_mutex) {
-        if((offset >= 0) && (offset + ((int)sizeof(double)) <= tag->size)) {
-            ures =  ((uint64_t)(tag->data[offset + tag->byte_order->float64_order[0]]) << 0 ) +
-                    ((uint64_t)(tag->data[offset + tag->byte_order->float64_order[1]]) << 8 ) +
-                    ((uint64_t)(tag->data[offset + tag->byte_order->float64_order[2]]) << 16) +
-                    ((uint64_t)(tag->data[offset + tag->byte_order->float64_order[3]]) << 24) +
-                    ((uint64_t)(tag->data[offset + tag->byte_order->float64_order[4]]) << 32) +
-                    ((uint64_t)(tag->data[offset + tag->byte_order->float64_order[5]]) << 40) +
-                    ((uint64_t)(tag->data[offset + tag->byte_order->float64_order[6]]) << 48) +
-                    ((uint64_t)(tag->data[offset + tag->byte_order->float64_order[7]]) << 56);
-
-            tag->status = PLCTAG_STATUS_OK;
-            rc = PLCTAG_STATUS_OK;
-        } else {
-            pdebug(DEBUG_WARN, "Data offset out of bounds!");
-            tag->status = PLCTAG_ERR_OUT_OF_BOUNDS;
-            rc = PLCTAG_ERR_OUT_OF_BOUNDS;
-        }
+    rc = copy_tag_data(tag, offset, raw, (int)sizeof(raw));
+    if(rc == PLCTAG_STATUS_OK) {
+        ures = tag->float64_kernel.get(raw, tag->float64_kernel.order);
     }
 
     if(rc == PLCTAG_STATUS_OK) {
@@ -2707,30 +4612,41 @@ LIB_EXPORT double plc_tag_get_float64(int32_t id, int offset)
         res = DBL_MIN;
     }
 
-    rc_dec(tag);
-
     return res;
 }
 
 
-
-
-LIB_EXPORT int plc_tag_set_float64(int32_t id, int offset, double fval)
+LIB_EXPORT double plc_tag_get_float64(int32_t id, int offset)
 {
-    int rc = PLCTAG_STATUS_OK;
+    double res = DBL_MIN;
     plc_tag_p tag = lookup_tag(id);
-    uint64_t val = 0;
 
     pdebug(DEBUG_SPEW, "Starting.");
 
     if(!tag) {
         pdebug(DEBUG_WARN,"Tag not found.");
-        return PLCTAG_ERR_NOT_FOUND;
+        return res;
     }
 
+    res = get_float64_impl(tag, offset);
+
+    rc_dec(tag);
+
+    pdebug(DEBUG_SPEW, "Done.");
+
+    return res;
+}
+
+
+
+
+int set_float64_impl(plc_tag_p tag, int offset, double fval)
+{
+    int rc = PLCTAG_STATUS_OK;
+    uint64_t val = 0;
+
     /* is there data? */
     if(!tag->data) {
-        rc_dec(tag);
         pdebug(DEBUG_WARN,"Tag has no data!");
         tag->status = PLCTAG_ERR_NO_DATA;
         return PLCTAG_ERR_NO_DATA;
@@ -2748,17 +4664,11 @@ LIB_EXPORT int plc_tag_set_float64(int32_t id, int offset, double fval)
     critical_block(tag->api_mutex) {
         if((offset >= 0) && (offset + ((int)sizeof(uint64_t)) <= tag->size)) {
             if(tag->auto_sync_write_ms > 0) {
-                tag->tag_is_dirty = 1;
+                mark_tag_dirty(tag);
             }
 
-            tag->data[offset + tag->byte_order->float64_order[0]] = (uint8_t)((val >> 0 ) & 0xFF);
-            tag->data[offset + tag->byte_order->float64_order[1]] = (uint8_t)((val >> 8 ) & 0xFF);
-            tag->data[offset + tag->byte_order->float64_order[2]] = (uint8_t)((val >> 16) & 0xFF);
-            tag->data[offset + tag->byte_order->float64_order[3]] = (uint8_t)((val >> 24) & 0xFF);
-            tag->data[offset + tag->byte_order->float64_order[4]] = (uint8_t)((val >> 32) & 0xFF);
-            tag->data[offset + tag->byte_order->float64_order[5]] = (uint8_t)((val >> 40) & 0xFF);
-            tag->data[offset + tag->byte_order->float64_order[6]] = (uint8_t)((val >> 48) & 0xFF);
-            tag->data[offset + tag->byte_order->float64_order[7]] = (uint8_t)((val >> 56) & 0xFF);
+            tag->float64_kernel.set(tag->data + offset, tag->float64_kernel.order, (uint64_t)val);
+            tag_snapshot_publish(tag, offset, (int)sizeof(double));
 
             tag->status = PLCTAG_STATUS_OK;
         } else {
@@ -2768,30 +4678,42 @@ LIB_EXPORT int plc_tag_set_float64(int32_t id, int offset, double fval)
         }
     }
 
-    rc_dec(tag);
-
     return rc;
 }
 
 
-
-LIB_EXPORT float plc_tag_get_float32(int32_t id, int offset)
+LIB_EXPORT int plc_tag_set_float64(int32_t id, int offset, double fval)
 {
-    float res = FLT_MIN;
     int rc = PLCTAG_STATUS_OK;
-    uint32_t ures = 0;
     plc_tag_p tag = lookup_tag(id);
 
     pdebug(DEBUG_SPEW, "Starting.");
 
     if(!tag) {
         pdebug(DEBUG_WARN,"Tag not found.");
-        return res;
+        return PLCTAG_ERR_NOT_FOUND;
     }
 
+    rc = set_float64_impl(tag, offset, fval);
+
+    rc_dec(tag);
+
+    pdebug(DEBUG_SPEW, "Done.");
+
+    return rc;
+}
+
+
+
+float get_float32_impl(plc_tag_p tag, int offset)
+{
+    float res = FLT_MIN;
+    uint8_t raw[sizeof(float)];
+    int rc = PLCTAG_STATUS_OK;
+    uint32_t ures = 0;
+
     /* is there data? */
     if(!tag->data) {
-        rc_dec(tag);
         pdebug(DEBUG_WARN,"Tag has no data!");
         tag->status = PLCTAG_ERR_NO_DATA;
         return res;
@@ -2803,20 +4725,9 @@ LIB_EXPORT float plc_tag_get_float32(int32_t id, int offset)
         return res;
     }
 
-    critical_block(tag->api_mutex) {
-        if((offset >= 0) && (offset + ((int)sizeof(float)) <= tag->size)) {
-            ures =  (uint32_t)(((uint32_t)(tag->data[offset + tag->byte_order->float32_order[0]]) << 0 ) +
-                               ((uint32_t)(tag->data[offset + tag->byte_order->float32_order[1]]) << 8 ) +
-                               ((uint32_t)(tag->data[offset + tag->byte_order->float32_order[2]]) << 16) +
-                               ((uint32_t)(tag->data[offset + tag->byte_order->float32_order[3]]) << 24));
-
-            tag->status = PLCTAG_STATUS_OK;
-            rc = PLCTAG_STATUS_OK;
-        } else {
-            pdebug(DEBUG_WARN, "Data offset out of bounds!");
-            tag->status = PLCTAG_ERR_OUT_OF_BOUNDS;
-            rc = PLCTAG_ERR_OUT_OF_BOUNDS;
-        }
+    rc = copy_tag_data(tag, offset, raw, (int)sizeof(raw));
+    if(rc == PLCTAG_STATUS_OK) {
+        ures = (uint32_t)tag->float32_kernel.get(raw, tag->float32_kernel.order);
     }
 
     if(rc == PLCTAG_STATUS_OK) {
@@ -2826,30 +4737,41 @@ LIB_EXPORT float plc_tag_get_float32(int32_t id, int offset)
         res = FLT_MIN;
     }
 
-    rc_dec(tag);
-
     return res;
 }
 
 
-
-
-LIB_EXPORT int plc_tag_set_float32(int32_t id, int offset, float fval)
+LIB_EXPORT float plc_tag_get_float32(int32_t id, int offset)
 {
-    int rc = PLCTAG_STATUS_OK;
+    float res = FLT_MIN;
     plc_tag_p tag = lookup_tag(id);
-    uint32_t val = 0;
 
     pdebug(DEBUG_SPEW, "Starting.");
 
     if(!tag) {
         pdebug(DEBUG_WARN,"Tag not found.");
-        return PLCTAG_ERR_NOT_FOUND;
+        return res;
     }
 
+    res = get_float32_impl(tag, offset);
+
+    rc_dec(tag);
+
+    pdebug(DEBUG_SPEW, "Done.");
+
+    return res;
+}
+
+
+
+
+int set_float32_impl(plc_tag_p tag, int offset, float fval)
+{
+    int rc = PLCTAG_STATUS_OK;
+    uint32_t val = 0;
+
     /* is there data? */
     if(!tag->data) {
-        rc_dec(tag);
         pdebug(DEBUG_WARN,"Tag has no data!");
         tag->status = PLCTAG_ERR_NO_DATA;
         return PLCTAG_ERR_NO_DATA;
@@ -2867,13 +4789,11 @@ LIB_EXPORT int plc_tag_set_float32(int32_t id, int offset, float fval)
     critical_block(tag->api_mutex) {
         if((offset >= 0) && (offset + ((int)sizeof(float)) <= tag->size)) {
             if(tag->auto_sync_write_ms > 0) {
-                tag->tag_is_dirty = 1;
+                mark_tag_dirty(tag);
             }
 
-            tag->data[offset + tag->byte_order->float32_order[0]] = (uint8_t)((val >> 0 ) & 0xFF);
-            tag->data[offset + tag->byte_order->float32_order[1]] = (uint8_t)((val >> 8 ) & 0xFF);
-            tag->data[offset + tag->byte_order->float32_order[2]] = (uint8_t)((val >> 16) & 0xFF);
-            tag->data[offset + tag->byte_order->float32_order[3]] = (uint8_t)((val >> 24) & 0xFF);
+            tag->float32_kernel.set(tag->data + offset, tag->float32_kernel.order, (uint64_t)val);
+            tag_snapshot_publish(tag, offset, (int)sizeof(float));
 
             tag->status = PLCTAG_STATUS_OK;
         } else {
@@ -2883,12 +4803,346 @@ LIB_EXPORT int plc_tag_set_float32(int32_t id, int offset, float fval)
         }
     }
 
+    return rc;
+}
+
+
+LIB_EXPORT int plc_tag_set_float32(int32_t id, int offset, float fval)
+{
+    int rc = PLCTAG_STATUS_OK;
+    plc_tag_p tag = lookup_tag(id);
+
+    pdebug(DEBUG_SPEW, "Starting.");
+
+    if(!tag) {
+        pdebug(DEBUG_WARN,"Tag not found.");
+        return PLCTAG_ERR_NOT_FOUND;
+    }
+
+    rc = set_float32_impl(tag, offset, fval);
+
     rc_dec(tag);
 
+    pdebug(DEBUG_SPEW, "Done.");
+
     return rc;
 }
 
 
+/*
+ * plc_tag_pin()
+ *
+ * Look up the tag once and return a handle that holds a reference to it.
+ * The handle based accessors below skip the tag ID lookup and the
+ * reference count changes that the ID based accessors do on every call.
+ */
+
+LIB_EXPORT plc_tag_handle_t plc_tag_pin(int32_t tag_id)
+{
+    plc_tag_p tag = lookup_tag(tag_id);
+
+    pdebug(DEBUG_DETAIL, "Starting.");
+
+    if(!tag) {
+        pdebug(DEBUG_WARN, "Tag not found.");
+        return NULL;
+    }
+
+    /* we keep the reference from lookup_tag() until the tag is unpinned. */
+
+    pdebug(DEBUG_DETAIL, "Done.");
+
+    return tag;
+}
+
+
+
+/*
+ * plc_tag_unpin()
+ *
+ * Release the reference held by a handle from plc_tag_pin().  The handle
+ * must not be used after this.
+ */
+
+LIB_EXPORT int plc_tag_unpin(plc_tag_handle_t handle)
+{
+    pdebug(DEBUG_DETAIL, "Starting.");
+
+    if(!handle) {
+        pdebug(DEBUG_WARN, "Null tag handle!");
+        return PLCTAG_ERR_NULL_PTR;
+    }
+
+    rc_dec(handle);
+
+    pdebug(DEBUG_DETAIL, "Done.");
+
+    return PLCTAG_STATUS_OK;
+}
+
+
+
+LIB_EXPORT int plc_tag_pinned_get_size(plc_tag_handle_t handle)
+{
+    int result = 0;
+
+    if(!handle) {
+        pdebug(DEBUG_WARN, "Null tag handle!");
+        return PLCTAG_ERR_NULL_PTR;
+    }
+
+    critical_block(handle->api_mutex) {
+        result = handle->size;
+        handle->status = PLCTAG_STATUS_OK;
+    }
+
+    return result;
+}
+
+
+
+LIB_EXPORT int plc_tag_pinned_get_bit(plc_tag_handle_t handle, int offset_bit)
+{
+    if(!handle) {
+        pdebug(DEBUG_WARN, "Null tag handle!");
+        return PLCTAG_ERR_NULL_PTR;
+    }
+
+    return get_bit_impl(handle, offset_bit);
+}
+
+
+LIB_EXPORT int plc_tag_pinned_set_bit(plc_tag_handle_t handle, int offset_bit, int val)
+{
+    if(!handle) {
+        pdebug(DEBUG_WARN, "Null tag handle!");
+        return PLCTAG_ERR_NULL_PTR;
+    }
+
+    return set_bit_impl(handle, offset_bit, val);
+}
+
+
+LIB_EXPORT uint64_t plc_tag_pinned_get_uint64(plc_tag_handle_t handle, int offset)
+{
+    if(!handle) {
+        pdebug(DEBUG_WARN, "Null tag handle!");
+        return UINT64_MAX;
+    }
+
+    return get_uint64_impl(handle, offset);
+}
+
+
+LIB_EXPORT int plc_tag_pinned_set_uint64(plc_tag_handle_t handle, int offset, uint64_t val)
+{
+    if(!handle) {
+        pdebug(DEBUG_WARN, "Null tag handle!");
+        return PLCTAG_ERR_NULL_PTR;
+    }
+
+    return set_uint64_impl(handle, offset, val);
+}
+
+
+LIB_EXPORT int64_t plc_tag_pinned_get_int64(plc_tag_handle_t handle, int offset)
+{
+    if(!handle) {
+        pdebug(DEBUG_WARN, "Null tag handle!");
+        return INT64_MIN;
+    }
+
+    return get_int64_impl(handle, offset);
+}
+
+
+LIB_EXPORT int plc_tag_pinned_set_int64(plc_tag_handle_t handle, int offset, int64_t ival)
+{
+    if(!handle) {
+        pdebug(DEBUG_WARN, "Null tag handle!");
+        return PLCTAG_ERR_NULL_PTR;
+    }
+
+    return set_int64_impl(handle, offset, ival);
+}
+
+
+LIB_EXPORT uint32_t plc_tag_pinned_get_uint32(plc_tag_handle_t handle, int offset)
+{
+    if(!handle) {
+        pdebug(DEBUG_WARN, "Null tag handle!");
+        return UINT32_MAX;
+    }
+
+    return get_uint32_impl(handle, offset);
+}
+
+
+LIB_EXPORT int plc_tag_pinned_set_uint32(plc_tag_handle_t handle, int offset, uint32_t val)
+{
+    if(!handle) {
+        pdebug(DEBUG_WARN, "Null tag handle!");
+        return PLCTAG_ERR_NULL_PTR;
+    }
+
+    return set_uint32_impl(handle, offset, val);
+}
+
+
+LIB_EXPORT int32_t plc_tag_pinned_get_int32(plc_tag_handle_t handle, int offset)
+{
+    if(!handle) {
+        pdebug(DEBUG_WARN, "Null tag handle!");
+        return INT32_MIN;
+    }
+
+    return get_int32_impl(handle, offset);
+}
+
+
+LIB_EXPORT int plc_tag_pinned_set_int32(plc_tag_handle_t handle, int offset, int32_t ival)
+{
+    if(!handle) {
+        pdebug(DEBUG_WARN, "Null tag handle!");
+        return PLCTAG_ERR_NULL_PTR;
+    }
+
+    return set_int32_impl(handle, offset, ival);
+}
+
+
+LIB_EXPORT uint16_t plc_tag_pinned_get_uint16(plc_tag_handle_t handle, int offset)
+{
+    if(!handle) {
+        pdebug(DEBUG_WARN, "Null tag handle!");
+        return UINT16_MAX;
+    }
+
+    return get_uint16_impl(handle, offset);
+}
+
+
+LIB_EXPORT int plc_tag_pinned_set_uint16(plc_tag_handle_t handle, int offset, uint16_t val)
+{
+    if(!handle) {
+        pdebug(DEBUG_WARN, "Null tag handle!");
+        return PLCTAG_ERR_NULL_PTR;
+    }
+
+    return set_uint16_impl(handle, offset, val);
+}
+
+
+LIB_EXPORT int16_t plc_tag_pinned_get_int16(plc_tag_handle_t handle, int offset)
+{
+    if(!handle) {
+        pdebug(DEBUG_WARN, "Null tag handle!");
+        return INT16_MIN;
+    }
+
+    return get_int16_impl(handle, offset);
+}
+
+
+LIB_EXPORT int plc_tag_pinned_set_int16(plc_tag_handle_t handle, int offset, int16_t ival)
+{
+    if(!handle) {
+        pdebug(DEBUG_WARN, "Null tag handle!");
+        return PLCTAG_ERR_NULL_PTR;
+    }
+
+    return set_int16_impl(handle, offset, ival);
+}
+
+
+LIB_EXPORT uint8_t plc_tag_pinned_get_uint8(plc_tag_handle_t handle, int offset)
+{
+    if(!handle) {
+        pdebug(DEBUG_WARN, "Null tag handle!");
+        return UINT8_MAX;
+    }
+
+    return get_uint8_impl(handle, offset);
+}
+
+
+LIB_EXPORT int plc_tag_pinned_set_uint8(plc_tag_handle_t handle, int offset, uint8_t val)
+{
+    if(!handle) {
+        pdebug(DEBUG_WARN, "Null tag handle!");
+        return PLCTAG_ERR_NULL_PTR;
+    }
+
+    return set_uint8_impl(handle, offset, val);
+}
+
+
+LIB_EXPORT int8_t plc_tag_pinned_get_int8(plc_tag_handle_t handle, int offset)
+{
+    if(!handle) {
+        pdebug(DEBUG_WARN, "Null tag handle!");
+        return INT8_MIN;
+    }
+
+    return get_int8_impl(handle, offset);
+}
+
+
+LIB_EXPORT int plc_tag_pinned_set_int8(plc_tag_handle_t handle, int offset, int8_t ival)
+{
+    if(!handle) {
+        pdebug(DEBUG_WARN, "Null tag handle!");
+        return PLCTAG_ERR_NULL_PTR;
+    }
+
+    return set_int8_impl(handle, offset, ival);
+}
+
+
+LIB_EXPORT double plc_tag_pinned_get_float64(plc_tag_handle_t handle, int offset)
+{
+    if(!handle) {
+        pdebug(DEBUG_WARN, "Null tag handle!");
+        return DBL_MIN;
+    }
+
+    return get_float64_impl(handle, offset);
+}
+
+
+LIB_EXPORT int plc_tag_pinned_set_float64(plc_tag_handle_t handle, int offset, double fval)
+{
+    if(!handle) {
+        pdebug(DEBUG_WARN, "Null tag handle!");
+        return PLCTAG_ERR_NULL_PTR;
+    }
+
+    return set_float64_impl(handle, offset, fval);
+}
+
+
+LIB_EXPORT float plc_tag_pinned_get_float32(plc_tag_handle_t handle, int offset)
+{
+    if(!handle) {
+        pdebug(DEBUG_WARN, "Null tag handle!");
+        return FLT_MIN;
+    }
+
+    return get_float32_impl(handle, offset);
+}
+
+
+LIB_EXPORT int plc_tag_pinned_set_float32(plc_tag_handle_t handle, int offset, float fval)
+{
+    if(!handle) {
+        pdebug(DEBUG_WARN, "Null tag handle!");
+        return PLCTAG_ERR_NULL_PTR;
+    }
+
+    return set_float32_impl(handle, offset, fval);
+}
+
+
 LIB_EXPORT int plc_tag_get_string(int32_t tag_id, int string_start_offset, char *buffer, int buffer_length)
 {
     int rc = PLCTAG_STATUS_OK;
@@ -3066,8 +5320,10 @@ LIB_EXPORT int plc_tag_set_string(int32_t tag_id, int string_start_offset, const
                 }
 
                 if(rc == PLCTAG_STATUS_OK && tag->auto_sync_write_ms > 0) {
-                    tag->tag_is_dirty = 1;
+                    mark_tag_dirty(tag);
                 }
+
+                tag_snapshot_publish(tag, string_start_offset, tag->size - string_start_offset);
             } else {
                 pdebug(DEBUG_WARN, "Writing the full string would go out of bounds in the tag buffer!");
                 rc = PLCTAG_ERR_OUT_OF_BOUNDS;
@@ -3272,7 +5528,7 @@ LIB_EXPORT int plc_tag_set_raw_bytes(int32_t id, int offset, uint8_t *buffer, in
         critical_block(tag->api_mutex) {
             if((offset >= 0) && ((offset + buffer_size) <= tag->size)) {
                 if(tag->auto_sync_write_ms > 0) {
-                    tag->tag_is_dirty = 1;
+                    mark_tag_dirty(tag);
                 }
 
                 int i;
@@ -3280,6 +5536,8 @@ LIB_EXPORT int plc_tag_set_raw_bytes(int32_t id, int offset, uint8_t *buffer, in
                     tag->data[offset + i] = buffer[i];
                 }
 
+                tag_snapshot_publish(tag, offset, buffer_size);
+
                 tag->status = PLCTAG_STATUS_OK;
             } else {
                 pdebug(DEBUG_WARN, "Data offset out of bounds!");
@@ -3330,20 +5588,7 @@ LIB_EXPORT int plc_tag_get_raw_bytes(int32_t id, int offset, uint8_t *buffer, in
     }
 
     if(!tag->is_bit) {
-        critical_block(tag->api_mutex) {
-            if((offset >= 0) && ((offset + buffer_size) <= tag->size)) {
-                int i;
-                for (i=0;i<buffer_size;i++) {
-                    buffer[i] = tag->data[offset + i];
-                }
-
-                tag->status = PLCTAG_STATUS_OK;
-            } else {
-                pdebug(DEBUG_WARN, "Data offset out of bounds!");
-                tag->status = PLCTAG_ERR_OUT_OF_BOUNDS;
-                rc = PLCTAG_ERR_OUT_OF_BOUNDS;
-            }
-        }
+        rc = copy_tag_data(tag, offset, buffer, buffer_size);
     } else {
         pdebug(DEBUG_WARN,"Trying to read a list of values from a Tag bit.");
         tag->status = PLCTAG_ERR_UNSUPPORTED;
@@ -3358,576 +5603,3249 @@ LIB_EXPORT int plc_tag_get_raw_bytes(int32_t id, int offset, uint8_t *buffer, in
 
 
 
-/*****************************************************************************************************
- *****************************  Support routines for extra indirection *******************************
- ****************************************************************************************************/
-
-int set_tag_byte_order(plc_tag_p tag, attr attribs)
+/*
+ * Typed array accessors.
+ *
+ * These convert a run of elements with one tag lookup and one pass through
+ * the API mutex instead of one of each per element.
+ */
 
+int get_array_impl(plc_tag_p tag, int offset, void *buffer, int count, int elem_size, const byte_shuffle_kernel_t *kernel)
 {
-    int use_default = 1;
-
-    pdebug(DEBUG_INFO, "Starting.");
-
-    /* the default values are already set in the tag. */
+    int rc = PLCTAG_STATUS_OK;
 
-    /* check for overrides. */
-    if(attr_get_str(attribs,  "int16_byte_order", NULL) != NULL) {
-        use_default = 0;
+    /* is there data? */
+    if(!tag->data) {
+        pdebug(DEBUG_WARN,"Tag has no data!");
+        tag->status = PLCTAG_ERR_NO_DATA;
+        return PLCTAG_ERR_NO_DATA;
     }
 
-    if(attr_get_str(attribs,  "int32_byte_order", NULL) != NULL) {
-        use_default = 0;
+    if(!buffer) {
+        pdebug(DEBUG_WARN,"Buffer is null!");
+        return PLCTAG_ERR_NULL_PTR;
     }
 
-    if(attr_get_str(attribs,  "int64_byte_order", NULL) != NULL) {
-        use_default = 0;
+    if(count <= 0) {
+        pdebug(DEBUG_WARN,"The element count must be greater than zero.");
+        return PLCTAG_ERR_BAD_PARAM;
     }
 
-    if(attr_get_str(attribs,  "float32_byte_order", NULL) != NULL) {
-        use_default = 0;
+    if(tag->is_bit) {
+        pdebug(DEBUG_WARN,"Trying to read an array of values from a Tag bit.");
+        tag->status = PLCTAG_ERR_UNSUPPORTED;
+        return PLCTAG_ERR_UNSUPPORTED;
     }
 
-    if(attr_get_str(attribs,  "float64_byte_order", NULL) != NULL) {
-        use_default = 0;
+    if(count > INT_MAX / elem_size) {
+        pdebug(DEBUG_WARN, "Data offset out of bounds!");
+        tag->status = PLCTAG_ERR_OUT_OF_BOUNDS;
+        return PLCTAG_ERR_OUT_OF_BOUNDS;
     }
 
-    if(attr_get_str(attribs, "str_is_counted", NULL) != NULL) {
-        use_default = 0;
+    /* copy out the raw bytes then convert them in place. */
+    rc = copy_tag_data(tag, offset, (uint8_t *)buffer, count * elem_size);
+    if(rc == PLCTAG_STATUS_OK) {
+        byte_shuffle_decode(kernel, (const uint8_t *)buffer, (uint8_t *)buffer, count);
     }
 
-    if(attr_get_str(attribs, "str_is_fixed_length", NULL) != NULL) {
-        use_default = 0;
-    }
+    return rc;
+}
 
-    if(attr_get_str(attribs, "str_is_zero_terminated", NULL) != NULL) {
-        use_default = 0;
-    }
 
-    if(attr_get_str(attribs, "str_is_byte_swapped", NULL) != NULL) {
-        use_default = 0;
-    }
+int set_array_impl(plc_tag_p tag, int offset, const void *buffer, int count, int elem_size, const byte_shuffle_kernel_t *kernel)
+{
+    int rc = PLCTAG_STATUS_OK;
 
-    if(attr_get_str(attribs, "str_count_word_bytes", NULL) != NULL) {
-        use_default = 0;
+    /* is there data? */
+    if(!tag->data) {
+        pdebug(DEBUG_WARN,"Tag has no data!");
+        tag->status = PLCTAG_ERR_NO_DATA;
+        return PLCTAG_ERR_NO_DATA;
     }
 
-    if(attr_get_str(attribs, "str_max_capacity", NULL) != NULL) {
-        use_default = 0;
+    if(!buffer) {
+        pdebug(DEBUG_WARN,"Buffer is null!");
+        return PLCTAG_ERR_NULL_PTR;
     }
 
-    if(attr_get_str(attribs, "str_total_length", NULL) != NULL) {
-        use_default = 0;
+    if(count <= 0) {
+        pdebug(DEBUG_WARN,"The element count must be greater than zero.");
+        return PLCTAG_ERR_BAD_PARAM;
     }
 
-    if(attr_get_str(attribs, "str_pad_bytes", NULL) != NULL) {
-        use_default = 0;
+    if(tag->is_bit) {
+        pdebug(DEBUG_WARN,"Trying to write an array of values on a Tag bit.");
+        tag->status = PLCTAG_ERR_UNSUPPORTED;
+        return PLCTAG_ERR_UNSUPPORTED;
     }
 
-    /* if we need to override something, build a new byte order structure. */
-    if(!use_default) {
-        const char *byte_order_str = NULL;
-        int str_param = 0;
-        int rc = PLCTAG_STATUS_OK;
-        tag_byte_order_t *new_byte_order = mem_alloc((int)(unsigned int)sizeof(*(tag->byte_order)));
+    critical_block(tag->api_mutex) {
+        if((offset >= 0) && (offset <= tag->size) && (count <= (tag->size - offset) / elem_size)) {
+            if(tag->auto_sync_write_ms > 0) {
+                mark_tag_dirty(tag);
+            }
 
-        if(!new_byte_order) {
-            pdebug(DEBUG_WARN, "Unable to allocate byte order struct for tag!");
-            return PLCTAG_ERR_NO_MEM;
+            byte_shuffle_encode(kernel, (const uint8_t *)buffer, tag->data + offset, count);
+            tag_snapshot_publish(tag, offset, count * elem_size);
+
+            tag->status = PLCTAG_STATUS_OK;
+        } else {
+            pdebug(DEBUG_WARN, "Data offset out of bounds!");
+            tag->status = PLCTAG_ERR_OUT_OF_BOUNDS;
+            rc = PLCTAG_ERR_OUT_OF_BOUNDS;
         }
+    }
 
-        /* copy the defaults. */
-        *new_byte_order = *(tag->byte_order);
+    return rc;
+}
 
-        /* replace the old byte order. */
-        tag->byte_order = new_byte_order;
 
-        /* mark it as allocated so that we free it later. */
-        tag->byte_order->is_allocated = 1;
 
-        /* 16-bit ints. */
-        byte_order_str = attr_get_str(attribs, "int16_byte_order", NULL);
-        if(byte_order_str) {
-            pdebug(DEBUG_DETAIL, "Override byte order int16_byte_order=%s", byte_order_str);
+LIB_EXPORT int plc_tag_get_uint64_array(int32_t id, int offset, uint64_t *buffer, int count)
+{
+    int rc = PLCTAG_STATUS_OK;
+    plc_tag_p tag = lookup_tag(id);
 
-            rc = check_byte_order_str(byte_order_str, 2);
-            if(rc != PLCTAG_STATUS_OK) {
-                pdebug(DEBUG_WARN, "Byte order string int16_byte_order, \"%s\", is illegal or malformed.", byte_order_str);
-                return rc;
-            }
+    pdebug(DEBUG_SPEW, "Starting.");
 
-            /* strange gyrations to make the compiler happy.   MSVC will probably complain. */
-            tag->byte_order->int16_order[0] = (int)(unsigned int)(((unsigned int)byte_order_str[0] - (unsigned int)('0')) & 0x01);
-            tag->byte_order->int16_order[1] = (int)(unsigned int)(((unsigned int)byte_order_str[1] - (unsigned int)('0')) & 0x01);
-        }
+    if(!tag) {
+        pdebug(DEBUG_WARN,"Tag not found.");
+        return PLCTAG_ERR_NOT_FOUND;
+    }
 
-        /* 32-bit ints. */
-        byte_order_str = attr_get_str(attribs, "int32_byte_order", NULL);
-        if(byte_order_str) {
-            pdebug(DEBUG_DETAIL, "Override byte order int32_byte_order=%s", byte_order_str);
+    rc = get_array_impl(tag, offset, buffer, count, (int)sizeof(uint64_t), &tag->int64_kernel);
 
-            rc = check_byte_order_str(byte_order_str, 4);
-            if(rc != PLCTAG_STATUS_OK) {
-                pdebug(DEBUG_WARN, "Byte order string int32_byte_order, \"%s\", is illegal or malformed.", byte_order_str);
-                return rc;
-            }
+    rc_dec(tag);
 
-            tag->byte_order->int32_order[0] = (int)(unsigned int)(((unsigned int)byte_order_str[0] - (unsigned int)('0')) & 0x03);
-            tag->byte_order->int32_order[1] = (int)(unsigned int)(((unsigned int)byte_order_str[1] - (unsigned int)('0')) & 0x03);
-            tag->byte_order->int32_order[2] = (int)(unsigned int)(((unsigned int)byte_order_str[2] - (unsigned int)('0')) & 0x03);
-            tag->byte_order->int32_order[3] = (int)(unsigned int)(((unsigned int)byte_order_str[3] - (unsigned int)('0')) & 0x03);
-        }
+    pdebug(DEBUG_SPEW, "Done.");
 
-        /* 64-bit ints. */
-        byte_order_str = attr_get_str(attribs, "int64_byte_order", NULL);
-        if(byte_order_str) {
-            pdebug(DEBUG_DETAIL, "Override byte order int64_byte_order=%s", byte_order_str);
+    return rc;
+}
 
-            rc = check_byte_order_str(byte_order_str, 8);
-            if(rc != PLCTAG_STATUS_OK) {
-                pdebug(DEBUG_WARN, "Byte order string int64_byte_order, \"%s\", is illegal or malformed.", byte_order_str);
-                return rc;
-            }
 
-            tag->byte_order->int64_order[0] = (int)(unsigned int)(((unsigned int)byte_order_str[0] - (unsigned int)('0')) & 0x07);
-            tag->byte_order->int64_order[1] = (int)(unsigned int)(((unsigned int)byte_order_str[1] - (unsigned int)('0')) & 0x07);
-            tag->byte_order->int64_order[2] = (int)(unsigned int)(((unsigned int)byte_order_str[2] - (unsigned int)('0')) & 0x07);
-            tag->byte_order->int64_order[3] = (int)(unsigned int)(((unsigned int)byte_order_str[3] - (unsigned int)('0')) & 0x07);
-            tag->byte_order->int64_order[4] = (int)(unsigned int)(((unsigned int)byte_order_str[4] - (unsigned int)('0')) & 0x07);
-            tag->byte_order->int64_order[5] = (int)(unsigned int)(((unsigned int)byte_order_str[5] - (unsigned int)('0')) & 0x07);
-            tag->byte_order->int64_order[6] = (int)(unsigned int)(((unsigned int)byte_order_str[6] - (unsigned int)('0')) & 0x07);
-            tag->byte_order->int64_order[7] = (int)(unsigned int)(((unsigned int)byte_order_str[7] - (unsigned int)('0')) & 0x07);
-        }
+LIB_EXPORT int plc_tag_set_uint64_array(int32_t id, int offset, const uint64_t *buffer, int count)
+{
+    int rc = PLCTAG_STATUS_OK;
+    plc_tag_p tag = lookup_tag(id);
 
-        /* 32-bit floats. */
-        byte_order_str = attr_get_str(attribs, "float32_byte_order", NULL);
-        if(byte_order_str) {
-            pdebug(DEBUG_DETAIL, "Override byte order float32_byte_order=%s", byte_order_str);
+    pdebug(DEBUG_SPEW, "Starting.");
 
-            rc = check_byte_order_str(byte_order_str, 4);
-            if(rc != PLCTAG_STATUS_OK) {
-                pdebug(DEBUG_WARN, "Byte order string float32_byte_order, \"%s\", is illegal or malformed.", byte_order_str);
-                return rc;
-            }
+    if(!tag) {
+        pdebug(DEBUG_WARN,"Tag not found.");
+        return PLCTAG_ERR_NOT_FOUND;
+    }
 
-            tag->byte_order->float32_order[0] = (int)(unsigned int)(((unsigned int)byte_order_str[0] - (unsigned int)('0')) & 0x03);
-            tag->byte_order->float32_order[1] = (int)(unsigned int)(((unsigned int)byte_order_str[1] - (unsigned int)('0')) & 0x03);
-            tag->byte_order->float32_order[2] = (int)(unsigned int)(((unsigned int)byte_order_str[2] - (unsigned int)('0')) & 0x03);
-            tag->byte_order->float32_order[3] = (int)(unsigned int)(((unsigned int)byte_order_str[3] - (unsigned int)('0')) & 0x03);
-        }
+    rc = set_array_impl(tag, offset, buffer, count, (int)sizeof(uint64_t), &tag->int64_kernel);
 
-        /* 64-bit floats */
-        byte_order_str = attr_get_str(attribs, "float64_byte_order", NULL);
-        if(byte_order_str) {
-            pdebug(DEBUG_DETAIL, "Override byte order float64_byte_order=%s", byte_order_str);
+    rc_dec(tag);
 
-            rc = check_byte_order_str(byte_order_str, 8);
-            if(rc != PLCTAG_STATUS_OK) {
-                pdebug(DEBUG_WARN, "Byte order string float64_byte_order, \"%s\", is illegal or malformed.", byte_order_str);
-                return rc;
-            }
+    pdebug(DEBUG_SPEW, "Done.");
 
-            tag->byte_order->float64_order[0] = (int)(unsigned int)(((unsigned int)byte_order_str[0] - (unsigned int)('0')) & 0x07);
-            tag->byte_order->float64_order[1] = (int)(unsigned int)(((unsigned int)byte_order_str[1] - (unsigned int)('0')) & 0x07);
-            tag->byte_order->float64_order[2] = (int)(unsigned int)(((unsigned int)byte_order_str[2] - (unsigned int)('0')) & 0x07);
-            tag->byte_order->float64_order[3] = (int)(unsigned int)(((unsigned int)byte_order_str[3] - (unsigned int)('0')) & 0x07);
-            tag->byte_order->float64_order[4] = (int)(unsigned int)(((unsigned int)byte_order_str[4] - (unsigned int)('0')) & 0x07);
-            tag->byte_order->float64_order[5] = (int)(unsigned int)(((unsigned int)byte_order_str[5] - (unsigned int)('0')) & 0x07);
-            tag->byte_order->float64_order[6] = (int)(unsigned int)(((unsigned int)byte_order_str[6] - (unsigned int)('0')) & 0x07);
-            tag->byte_order->float64_order[7] = (int)(unsigned int)(((unsigned int)byte_order_str[7] - (unsigned int)('0')) & 0x07);
-        }
+    return rc;
+}
 
-        /* string information. */
 
-        /* is the string counted? */
-        if(attr_get_str(attribs, "str_is_counted", NULL)) {
-            str_param = attr_get_int(attribs, "str_is_counted", 0);
-            if(str_param == 1 || str_param == 0) {
-                tag->byte_order->str_is_counted = (str_param ? 1 : 0);
-            } else {
-                pdebug(DEBUG_WARN, "Tag string attribute str_is_counted must be missing, zero (0) or one (1)!");
-                return PLCTAG_ERR_BAD_PARAM;
-            }
-        }
+LIB_EXPORT int plc_tag_get_int64_array(int32_t id, int offset, int64_t *buffer, int count)
+{
+    int rc = PLCTAG_STATUS_OK;
+    plc_tag_p tag = lookup_tag(id);
 
-        /* is the string a fixed length? */
-        if(attr_get_str(attribs, "str_is_fixed_length", NULL)) {
-            str_param = attr_get_int(attribs, "str_is_fixed_length", 0);
-            if(str_param == 1 || str_param == 0) {
-                tag->byte_order->str_is_fixed_length = (str_param ? 1: 0);
-            } else {
-                pdebug(DEBUG_WARN, "Tag string attribute str_is_fixed_length must be missing, zero (0) or one (1)!");
-                return PLCTAG_ERR_BAD_PARAM;
-            }
-        }
+    pdebug(DEBUG_SPEW, "Starting.");
 
-        /* is the string zero terminated? */
-        if(attr_get_str(attribs, "str_is_zero_terminated", NULL)) {
-            str_param = attr_get_int(attribs, "str_is_zero_terminated", 0);
-            if(str_param == 1 || str_param == 0) {
-                tag->byte_order->str_is_zero_terminated = (str_param ? 1 : 0);
-            } else {
-                pdebug(DEBUG_WARN, "Tag string attribute str_is_zero_terminated must be missing, zero (0) or one (1)!");
-                return PLCTAG_ERR_BAD_PARAM;
-            }
-        }
+    if(!tag) {
+        pdebug(DEBUG_WARN,"Tag not found.");
+        return PLCTAG_ERR_NOT_FOUND;
+    }
 
-        /* is the string byteswapped like PLC/5? */
-        if(attr_get_str(attribs, "str_is_byte_swapped", NULL)) {
-            str_param = attr_get_int(attribs, "str_is_byte_swapped", 0);
-            if(str_param == 1 || str_param == 0) {
-                tag->byte_order->str_is_byte_swapped = (str_param ? 1 : 0);
-            } else {
-                pdebug(DEBUG_WARN, "Tag string attribute str_is_byte_swapped must be missing, zero (0) or one (1)!");
-                return PLCTAG_ERR_BAD_PARAM;
-            }
-        }
+    rc = get_array_impl(tag, offset, buffer, count, (int)sizeof(int64_t), &tag->int64_kernel);
 
-        /* main string parameters. */
+    rc_dec(tag);
 
-        /* how many bytes is the string count word? */
-        if(attr_get_str(attribs, "str_count_word_bytes", NULL)) {
-            str_param = attr_get_int(attribs, "str_count_word_bytes", 0);
-            if(str_param == 0 || str_param == 1 || str_param == 2 || str_param == 4 || str_param == 8) {
-                tag->byte_order->str_count_word_bytes = (unsigned int)str_param;
+    pdebug(DEBUG_SPEW, "Done.");
+
+    return rc;
+}
+
+
+LIB_EXPORT int plc_tag_set_int64_array(int32_t id, int offset, const int64_t *buffer, int count)
+{
+    int rc = PLCTAG_STATUS_OK;
+    plc_tag_p tag = lookup_tag(id);
+
+    pdebug(DEBUG_SPEW, "Starting.");
+
+    if(!tag) {
+        pdebug(DEBUG_WARN,"Tag not found.");
+        return PLCTAG_ERR_NOT_FOUND;
+    }
+
+    rc = set_array_impl(tag, offset, buffer, count, (int)sizeof(int64_t), &tag->int64_kernel);
+
+    rc_dec(tag);
+
+    pdebug(DEBUG_SPEW, "Done.");
+
+    return rc;
+}
+
+
+LIB_EXPORT int plc_tag_get_uint32_array(int32_t id, int offset, uint32_t *buffer, int count)
+{
+    int rc = PLCTAG_STATUS_OK;
+    plc_tag_p tag = lookup_tag(id);
+
+    pdebug(DEBUG_SPEW, "Starting.");
+
+    if(!tag) {
+        pdebug(DEBUG_WARN,"Tag not found.");
+        return PLCTAG_ERR_NOT_FOUND;
+    }
+
+    rc = get_array_impl(tag, offset, buffer, count, (int)sizeof(uint32_t), &tag->int32_kernel);
+
+    rc_dec(tag);
+
+    pdebug(DEBUG_SPEW, "Done.");
+
+    return rc;
+}
+
+
+LIB_EXPORT int plc_tag_set_uint32_array(int32_t id, int offset, const uint32_t *buffer, int count)
+{
+    int rc = PLCTAG_STATUS_OK;
+    plc_tag_p tag = lookup_tag(id);
+
+    pdebug(DEBUG_SPEW, "Starting.");
+
+    if(!tag) {
+        pdebug(DEBUG_WARN,"Tag not found.");
+        return PLCTAG_ERR_NOT_FOUND;
+    }
+
+    rc = set_array_impl(tag, offset, buffer, count, (int)sizeof(uint32_t), &tag->int32_kernel);
+
+    rc_dec(tag);
+
+    pdebug(DEBUG_SPEW, "Done.");
+
+    return rc;
+}
+
+
+LIB_EXPORT int plc_tag_get_int32_array(int32_t id, int offset, int32_t *buffer, int count)
+{
+    int rc = PLCTAG_STATUS_OK;
+    plc_tag_p tag = lookup_tag(id);
+
+    pdebug(DEBUG_SPEW, "Starting.");
+
+    if(!tag) {
+        pdebug(DEBUG_WARN,"Tag not found.");
+        return PLCTAG_ERR_NOT_FOUND;
+    }
+
+    rc = get_array_impl(tag, offset, buffer, count, (int)sizeof(int32_t), &tag->int32_kernel);
+
+    rc_dec(tag);
+
+    pdebug(DEBUG_SPEW, "Done.");
+
+    return rc;
+}
+
+
+LIB_EXPORT int plc_tag_set_int32_array(int32_t id, int offset, const int32_t *buffer, int count)
+{
+    int rc = PLCTAG_STATUS_OK;
+    plc_tag_p tag = lookup_tag(id);
+
+    pdebug(DEBUG_SPEW, "Starting.");
+
+    if(!tag) {
+        pdebug(DEBUG_WARN,"Tag not found.");
+        return PLCTAG_ERR_NOT_FOUND;
+    }
+
+    rc = set_array_impl(tag, offset, buffer, count, (int)sizeof(int32_t), &tag->int32_kernel);
+
+    rc_dec(tag);
+
+    pdebug(DEBUG_SPEW, "Done.");
+
+    return rc;
+}
+
+
+LIB_EXPORT int plc_tag_get_uint16_array(int32_t id, int offset, uint16_t *buffer, int count)
+{
+    int rc = PLCTAG_STATUS_OK;
+    plc_tag_p tag = lookup_tag(id);
+
+    pdebug(DEBUG_SPEW, "Starting.");
+
+    if(!tag) {
+        pdebug(DEBUG_WARN,"Tag not found.");
+        return PLCTAG_ERR_NOT_FOUND;
+    }
+
+    rc = get_array_impl(tag, offset, buffer, count, (int)sizeof(uint16_t), &tag->int16_kernel);
+
+    rc_dec(tag);
+
+    pdebug(DEBUG_SPEW, "Done.");
+
+    return rc;
+}
+
+
+LIB_EXPORT int plc_tag_set_uint16_array(int32_t id, int offset, const uint16_t *buffer, int count)
+{
+    int rc = PLCTAG_STATUS_OK;
+    plc_tag_p tag = lookup_tag(id);
+
+    pdebug(DEBUG_SPEW, "Starting.");
+
+    if(!tag) {
+        pdebug(DEBUG_WARN,"Tag not found.");
+        return PLCTAG_ERR_NOT_FOUND;
+    }
+
+    rc = set_array_impl(tag, offset, buffer, count, (int)sizeof(uint16_t), &tag->int16_kernel);
+
+    rc_dec(tag);
+
+    pdebug(DEBUG_SPEW, "Done.");
+
+    return rc;
+}
+
+
+LIB_EXPORT int plc_tag_get_int16_array(int32_t id, int offset, int16_t *buffer, int count)
+{
+    int rc = PLCTAG_STATUS_OK;
+    plc_tag_p tag = lookup_tag(id);
+
+    pdebug(DEBUG_SPEW, "Starting.");
+
+    if(!tag) {
+        pdebug(DEBUG_WARN,"Tag not found.");
+        return PLCTAG_ERR_NOT_FOUND;
+    }
+
+    rc = get_array_impl(tag, offset, buffer, count, (int)sizeof(int16_t), &tag->int16_kernel);
+
+    rc_dec(tag);
+
+    pdebug(DEBUG_SPEW, "Done.");
+
+    return rc;
+}
+
+
+LIB_EXPORT int plc_tag_set_int16_array(int32_t id, int offset, const int16_t *buffer, int count)
+{
+    int rc = PLCTAG_STATUS_OK;
+    plc_tag_p tag = lookup_tag(id);
+
+    pdebug(DEBUG_SPEW, "Starting.");
+
+    if(!tag) {
+        pdebug(DEBUG_WARN,"Tag not found.");
+        return PLCTAG_ERR_NOT_FOUND;
+    }
+
+    rc = set_array_impl(tag, offset, buffer, count, (int)sizeof(int16_t), &tag->int16_kernel);
+
+    rc_dec(tag);
+
+    pdebug(DEBUG_SPEW, "Done.");
+
+    return rc;
+}
+
+
+LIB_EXPORT int plc_tag_get_uint8_array(int32_t id, int offset, uint8_t *buffer, int count)
+{
+    int rc = PLCTAG_STATUS_OK;
+    plc_tag_p tag = lookup_tag(id);
+
+    pdebug(DEBUG_SPEW, "Starting.");
+
+    if(!tag) {
+        pdebug(DEBUG_WARN,"Tag not found.");
+        return PLCTAG_ERR_NOT_FOUND;
+    }
+
+    rc = get_array_impl(tag, offset, buffer, count, (int)sizeof(uint8_t), NULL);
+
+    rc_dec(tag);
+
+    pdebug(DEBUG_SPEW, "Done.");
+
+    return rc;
+}
+
+
+LIB_EXPORT int plc_tag_set_uint8_array(int32_t id, int offset, const uint8_t *buffer, int count)
+{
+    int rc = PLCTAG_STATUS_OK;
+    plc_tag_p tag = lookup_tag(id);
+
+    pdebug(DEBUG_SPEW, "Starting.");
+
+    if(!tag) {
+        pdebug(DEBUG_WARN,"Tag not found.");
+        return PLCTAG_ERR_NOT_FOUND;
+    }
+
+    rc = set_array_impl(tag, offset, buffer, count, (int)sizeof(uint8_t), NULL);
+
+    rc_dec(tag);
+
+    pdebug(DEBUG_SPEW, "Done.");
+
+    return rc;
+}
+
+
+LIB_EXPORT int plc_tag_get_int8_array(int32_t id, int offset, int8_t *buffer, int count)
+{
+    int rc = PLCTAG_STATUS_OK;
+    plc_tag_p tag = lookup_tag(id);
+
+    pdebug(DEBUG_SPEW, "Starting.");
+
+    if(!tag) {
+        pdebug(DEBUG_WARN,"Tag not found.");
+        return PLCTAG_ERR_NOT_FOUND;
+    }
+
+    rc = get_array_impl(tag, offset, buffer, count, (int)sizeof(int8_t), NULL);
+
+    rc_dec(tag);
+
+    pdebug(DEBUG_SPEW, "Done.");
+
+    return rc;
+}
+
+
+LIB_EXPORT int plc_tag_set_int8_array(int32_t id, int offset, const int8_t *buffer, int count)
+{
+    int rc = PLCTAG_STATUS_OK;
+    plc_tag_p tag = lookup_tag(id);
+
+    pdebug(DEBUG_SPEW, "Starting.");
+
+    if(!tag) {
+        pdebug(DEBUG_WARN,"Tag not found.");
+        return PLCTAG_ERR_NOT_FOUND;
+    }
+
+    rc = set_array_impl(tag, offset, buffer, count, (int)sizeof(int8_t), NULL);
+
+    rc_dec(tag);
+
+    pdebug(DEBUG_SPEW, "Done.");
+
+    return rc;
+}
+
+
+LIB_EXPORT int plc_tag_get_float64_array(int32_t id, int offset, double *buffer, int count)
+{
+    int rc = PLCTAG_STATUS_OK;
+    plc_tag_p tag = lookup_tag(id);
+
+    pdebug(DEBUG_SPEW, "Starting.");
+
+    if(!tag) {
+        pdebug(DEBUG_WARN,"Tag not found.");
+        return PLCTAG_ERR_NOT_FOUND;
+    }
+
+    rc = get_array_impl(tag, offset, buffer, count, (int)sizeof(double), &tag->float64_kernel);
+
+    rc_dec(tag);
+
+    pdebug(DEBUG_SPEW, "Done.");
+
+    return rc;
+}
+
+
+LIB_EXPORT int plc_tag_set_float64_array(int32_t id, int offset, const double *buffer, int count)
+{
+    int rc = PLCTAG_STATUS_OK;
+    plc_tag_p tag = lookup_tag(id);
+
+    pdebug(DEBUG_SPEW, "Starting.");
+
+    if(!tag) {
+        pdebug(DEBUG_WARN,"Tag not found.");
+        return PLCTAG_ERR_NOT_FOUND;
+    }
+
+    rc = set_array_impl(tag, offset, buffer, count, (int)sizeof(double), &tag->float64_kernel);
+
+    rc_dec(tag);
+
+    pdebug(DEBUG_SPEW, "Done.");
+
+    return rc;
+}
+
+
+LIB_EXPORT int plc_tag_get_float32_array(int32_t id, int offset, float *buffer, int count)
+{
+    int rc = PLCTAG_STATUS_OK;
+    plc_tag_p tag = lookup_tag(id);
+
+    pdebug(DEBUG_SPEW, "Starting.");
+
+    if(!tag) {
+        pdebug(DEBUG_WARN,"Tag not found.");
+        return PLCTAG_ERR_NOT_FOUND;
+    }
+
+    rc = get_array_impl(tag, offset, buffer, count, (int)sizeof(float), &tag->float32_kernel);
+
+    rc_dec(tag);
+
+    pdebug(DEBUG_SPEW, "Done.");
+
+    return rc;
+}
+
+
+LIB_EXPORT int plc_tag_set_float32_array(int32_t id, int offset, const float *buffer, int count)
+{
+    int rc = PLCTAG_STATUS_OK;
+    plc_tag_p tag = lookup_tag(id);
+
+    pdebug(DEBUG_SPEW, "Starting.");
+
+    if(!tag) {
+        pdebug(DEBUG_WARN,"Tag not found.");
+        return PLCTAG_ERR_NOT_FOUND;
+    }
+
+    rc = set_array_impl(tag, offset, buffer, count, (int)sizeof(float), &tag->float32_kernel);
+
+    rc_dec(tag);
+
+    pdebug(DEBUG_SPEW, "Done.");
+
+    return rc;
+}
+
+
+
+
+/*****************************************************************************************************
+ *****************************  Support routines for extra indirection *******************************
+ ****************************************************************************************************/
+
+int set_tag_byte_order(plc_tag_p tag, attr attribs)
+
+{
+    int use_default = 1;
+
+    pdebug(DEBUG_INFO, "Starting.");
+
+    /* the default values are already set in the tag. */
+
+    /* check for overrides. */
+    if(attr_get_str(attribs,  "int16_byte_order", NULL) != NULL) {
+        use_default = 0;
+    }
+
+    if(attr_get_str(attribs,  "int32_byte_order", NULL) != NULL) {
+        use_default = 0;
+    }
+
+    if(attr_get_str(attribs,  "int64_byte_order", NULL) != NULL) {
+        use_default = 0;
+    }
+
+    if(attr_get_str(attribs,  "float32_byte_order", NULL) != NULL) {
+        use_default = 0;
+    }
+
+    if(attr_get_str(attribs,  "float64_byte_order", NULL) != NULL) {
+        use_default = 0;
+    }
+
+    if(attr_get_str(attribs, "str_is_counted", NULL) != NULL) {
+        use_default = 0;
+    }
+
+    if(attr_get_str(attribs, "str_is_fixed_length", NULL) != NULL) {
+        use_default = 0;
+    }
+
+    if(attr_get_str(attribs, "str_is_zero_terminated", NULL) != NULL) {
+        use_default = 0;
+    }
+
+    if(attr_get_str(attribs, "str_is_byte_swapped", NULL) != NULL) {
+        use_default = 0;
+    }
+
+    if(attr_get_str(attribs, "str_count_word_bytes", NULL) != NULL) {
+        use_default = 0;
+    }
+
+    if(attr_get_str(attribs, "str_max_capacity", NULL) != NULL) {
+        use_default = 0;
+    }
+
+    if(attr_get_str(attribs, "str_total_length", NULL) != NULL) {
+        use_default = 0;
+    }
+
+    if(attr_get_str(attribs, "str_pad_bytes", NULL) != NULL) {
+        use_default = 0;
+    }
+
+    /* if we need to override something, build a new byte order structure. */
+    if(!use_default) {
+        const char *byte_order_str = NULL;
+        int str_param = 0;
+        int rc = PLCTAG_STATUS_OK;
+        tag_byte_order_t *new_byte_order = mem_alloc((int)(unsigned int)sizeof(*(tag->byte_order)));
+
+        if(!new_byte_order) {
+            pdebug(DEBUG_WARN, "Unable to allocate byte order struct for tag!");
+            return PLCTAG_ERR_NO_MEM;
+        }
+
+        /* copy the defaults. */
+        *new_byte_order = *(tag->byte_order);
+
+        /* replace the old byte order. */
+        tag->byte_order = new_byte_order;
+
+        /* mark it as allocated so that we free it later. */
+        tag->byte_order->is_allocated = 1;
+
+        /* 16-bit ints. */
+        byte_order_str = attr_get_str(attribs, "int16_byte_order", NULL);
+        if(byte_order_str) {
+            pdebug(DEBUG_DETAIL, "Override byte order int16_byte_order=%s", byte_order_str);
+
+            rc = check_byte_order_str(byte_order_str, 2);
+            if(rc != PLCTAG_STATUS_OK) {
+                pdebug(DEBUG_WARN, "Byte order string int16_byte_order, \"%s\", is illegal or malformed.", byte_order_str);
+                return rc;
+            }
+
+            /* strange gyrations to make the compiler happy.   MSVC will probably complain. */
+            tag->byte_order->int16_order[0] = (int)(unsigned int)(((unsigned int)byte_order_str[0] - (unsigned int)('0')) & 0x01);
+            tag->byte_order->int16_order[1] = (int)(unsigned int)(((unsigned int)byte_order_str[1] - (unsigned int)('0')) & 0x01);
+        }
+
+        /* 32-bit ints. */
+        byte_order_str = attr_get_str(attribs, "int32_byte_order", NULL);
+        if(byte_order_str) {
+            pdebug(DEBUG_DETAIL, "Override byte order int32_byte_order=%s", byte_order_str);
+
+            rc = check_byte_order_str(byte_order_str, 4);
+            if(rc != PLCTAG_STATUS_OK) {
+                pdebug(DEBUG_WARN, "Byte order string int32_byte_order, \"%s\", is illegal or malformed.", byte_order_str);
+                return rc;
+            }
+
+            tag->byte_order->int32_order[0] = (int)(unsigned int)(((unsigned int)byte_order_str[0] - (unsigned int)('0')) & 0x03);
+            tag->byte_order->int32_order[1] = (int)(unsigned int)(((unsigned int)byte_order_str[1] - (unsigned int)('0')) & 0x03);
+            tag->byte_order->int32_order[2] = (int)(unsigned int)(((unsigned int)byte_order_str[2] - (unsigned int)('0')) & 0x03);
+            tag->byte_order->int32_order[3] = (int)(unsigned int)(((unsigned int)byte_order_str[3] - (unsigned int)('0')) & 0x03);
+        }
+
+        /* 64-bit ints. */
+        byte_order_str = attr_get_str(attribs, "int64_byte_order", NULL);
+        if(byte_order_str) {
+            pdebug(DEBUG_DETAIL, "Override byte order int64_byte_order=%s", byte_order_str);
+
+            rc = check_byte_order_str(byte_order_str, 8);
+            if(rc != PLCTAG_STATUS_OK) {
+                pdebug(DEBUG_WARN, "Byte order string int64_byte_order, \"%s\", is illegal or malformed.", byte_order_str);
+                return rc;
+            }
+
+            tag->byte_order->int64_order[0] = (int)(unsigned int)(((unsigned int)byte_order_str[0] - (unsigned int)('0')) & 0x07);
+            tag->byte_order->int64_order[1] = (int)(unsigned int)(((unsigned int)byte_order_str[1] - (unsigned int)('0')) & 0x07);
+            tag->byte_order->int64_order[2] = (int)(unsigned int)(((unsigned int)byte_order_str[2] - (unsigned int)('0')) & 0x07);
+            tag->byte_order->int64_order[3] = (int)(unsigned int)(((unsigned int)byte_order_str[3] - (unsigned int)('0')) & 0x07);
+            tag->byte_order->int64_order[4] = (int)(unsigned int)(((unsigned int)byte_order_str[4] - (unsigned int)('0')) & 0x07);
+            tag->byte_order->int64_order[5] = (int)(unsigned int)(((unsigned int)byte_order_str[5] - (unsigned int)('0')) & 0x07);
+            tag->byte_order->int64_order[6] = (int)(unsigned int)(((unsigned int)byte_order_str[6] - (unsigned int)('0')) & 0x07);
+            tag->byte_order->int64_order[7] = (int)(unsigned int)(((unsigned int)byte_order_str[7] - (unsigned int)('0')) & 0x07);
+        }
+
+        /* 32-bit floats. */
+        byte_order_str = attr_get_str(attribs, "float32_byte_order", NULL);
+        if(byte_order_str) {
+            pdebug(DEBUG_DETAIL, "Override byte order float32_byte_order=%s", byte_order_str);
+
+            rc = check_byte_order_str(byte_order_str, 4);
+            if(rc != PLCTAG_STATUS_OK) {
+                pdebug(DEBUG_WARN, "Byte order string float32_byte_order, \"%s\", is illegal or malformed.", byte_order_str);
+                return rc;
+            }
+
+            tag->byte_order->float32_order[0] = (int)(unsigned int)(((unsigned int)byte_order_str[0] - (unsigned int)('0')) & 0x03);
+            tag->byte_order->float32_order[1] = (int)(unsigned int)(((unsigned int)byte_order_str[1] - (unsigned int)('0')) & 0x03);
+            tag->byte_order->float32_order[2] = (int)(unsigned int)(((unsigned int)byte_order_str[2] - (unsigned int)('0')) & 0x03);
+            tag->byte_order->float32_order[3] = (int)(unsigned int)(((unsigned int)byte_order_str[3] - (unsigned int)('0')) & 0x03);
+        }
+
+        /* 64-bit floats */
+        byte_order_str = attr_get_str(attribs, "float64_byte_order", NULL);
+        if(byte_order_str) {
+            pdebug(DEBUG_DETAIL, "Override byte order float64_byte_order=%s", byte_order_str);
+
+            rc = check_byte_order_str(byte_order_str, 8);
+            if(rc != PLCTAG_STATUS_OK) {
+                pdebug(DEBUG_WARN, "Byte order string float64_byte_order, \"%s\", is illegal or malformed.", byte_order_str);
+                return rc;
+            }
+
+            tag->byte_order->float64_order[0] = (int)(unsigned int)(((unsigned int)byte_order_str[0] - (unsigned int)('0')) & 0x07);
+            tag->byte_order->float64_order[1] = (int)(unsigned int)(((unsigned int)byte_order_str[1] - (unsigned int)('0')) & 0x07);
+            tag->byte_order->float64_order[2] = (int)(unsigned int)(((unsigned int)byte_order_str[2] - (unsigned int)('0')) & 0x07);
+            tag->byte_order->float64_order[3] = (int)(unsigned int)(((unsigned int)byte_order_str[3] - (unsigned int)('0')) & 0x07);
+            tag->byte_order->float64_order[4] = (int)(unsigned int)(((unsigned int)byte_order_str[4] - (unsigned int)('0')) & 0x07);
+            tag->byte_order->float64_order[5] = (int)(unsigned int)(((unsigned int)byte_order_str[5] - (unsigned int)('0')) & 0x07);
+            tag->byte_order->float64_order[6] = (int)(unsigned int)(((unsigned int)byte_order_str[6] - (unsigned int)('0')) & 0x07);
+            tag->byte_order->float64_order[7] = (int)(unsigned int)(((unsigned int)byte_order_str[7] - (unsigned int)('0')) & 0x07);
+        }
+
+        /* string information. */
+
+        /* is the string counted? */
+        if(attr_get_str(attribs, "str_is_counted", NULL)) {
+            str_param = attr_get_int(attribs, "str_is_counted", 0);
+            if(str_param == 1 || str_param == 0) {
+                tag->byte_order->str_is_counted = (str_param ? 1 : 0);
+            } else {
+                pdebug(DEBUG_WARN, "Tag string attribute str_is_counted must be missing, zero (0) or one (1)!");
+                return PLCTAG_ERR_BAD_PARAM;
+            }
+        }
+
+        /* is the string a fixed length? */
+        if(attr_get_str(attribs, "str_is_fixed_length", NULL)) {
+            str_param = attr_get_int(attribs, "str_is_fixed_length", 0);
+            if(str_param == 1 || str_param == 0) {
+                tag->byte_order->str_is_fixed_length = (str_param ? 1: 0);
+            } else {
+                pdebug(DEBUG_WARN, "Tag string attribute str_is_fixed_length must be missing, zero (0) or one (1)!");
+                return PLCTAG_ERR_BAD_PARAM;
+            }
+        }
+
+        /* is the string zero terminated? */
+        if(attr_get_str(attribs, "str_is_zero_terminated", NULL)) {
+            str_param = attr_get_int(attribs, "str_is_zero_terminated", 0);
+            if(str_param == 1 || str_param == 0) {
+                tag->byte_order->str_is_zero_terminated = (str_param ? 1 : 0);
+            } else {
+                pdebug(DEBUG_WARN, "Tag string attribute str_is_zero_terminated must be missing, zero (0) or one (1)!");
+                return PLCTAG_ERR_BAD_PARAM;
+            }
+        }
+
+        /* is the string byteswapped like PLC/5? */
+        if(attr_get_str(attribs, "str_is_byte_swapped", NULL)) {
+            str_param = attr_get_int(attribs, "str_is_byte_swapped", 0);
+            if(str_param == 1 || str_param == 0) {
+                tag->byte_order->str_is_byte_swapped = (str_param ? 1 : 0);
+            } else {
+                pdebug(DEBUG_WARN, "Tag string attribute str_is_byte_swapped must be missing, zero (0) or one (1)!");
+                return PLCTAG_ERR_BAD_PARAM;
+            }
+        }
+
+        /* main string parameters. */
+
+        /* how many bytes is the string count word? */
+        if(attr_get_str(attribs, "str_count_word_bytes", NULL)) {
+            str_param = attr_get_int(attribs, "str_count_word_bytes", 0);
+            if(str_param == 0 || str_param == 1 || str_param == 2 || str_param == 4 || str_param == 8) {
+                tag->byte_order->str_count_word_bytes = (unsigned int)str_param;
+            } else {
+                pdebug(DEBUG_WARN, "Tag string attribute str_count_word_bytes must be missing, 0, 1, 2, 4, or 8!");
+                return PLCTAG_ERR_BAD_PARAM;
+            }
+        }
+
+        /* What is the string maximum capacity */
+        if(attr_get_str(attribs, "str_max_capacity", NULL)) {
+            str_param = attr_get_int(attribs, "str_max_capacity", 0);
+            if(str_param >= 0) {
+                tag->byte_order->str_max_capacity = (unsigned int)str_param;
+            } else {
+                pdebug(DEBUG_WARN, "Tag string attribute str_max_capacity must be missing, 0, or positive!");
+                return PLCTAG_ERR_BAD_PARAM;
+            }
+        }
+
+        /* What is the string total length */
+        if(attr_get_str(attribs, "str_total_length", NULL)) {
+            str_param = attr_get_int(attribs, "str_total_length", 0);
+            if(str_param >= 0) {
+                tag->byte_order->str_total_length = (unsigned int)str_param;
+            } else {
+                pdebug(DEBUG_WARN, "Tag string attribute str_total_length must be missing, 0, or positive!");
+                return PLCTAG_ERR_BAD_PARAM;
+            }
+        }
+
+        /* What is the string padding length */
+        if(attr_get_str(attribs, "str_pad_bytes", NULL)) {
+            str_param = attr_get_int(attribs, "str_pad_bytes", 0);
+            if(str_param >= 0) {
+                tag->byte_order->str_pad_bytes = (unsigned int)str_param;
+            } else {
+                pdebug(DEBUG_WARN, "Tag string attribute str_pad_bytes must be missing, 0, or positive!");
+                return PLCTAG_ERR_BAD_PARAM;
+            }
+        }
+
+        /* now make sure that the combination of settings works. */
+
+        /* if we have a counted string, we need the count! */
+        if(tag->byte_order->str_is_counted) {
+            if(tag->byte_order->str_count_word_bytes == 0) {
+                pdebug(DEBUG_WARN, "If a string definition is counted, you must use both \"str_is_counted\" and \"str_count_word_bytes\" parameters!");
+                return PLCTAG_ERR_BAD_PARAM;
+            }
+        }
+
+        /* if we have a fixed length string, we need to know what the length is! */
+        if(tag->byte_order->str_is_fixed_length) {
+            if(tag->byte_order->str_total_length == 0) {
+                pdebug(DEBUG_WARN, "If a string definition is fixed length, you must use both \"str_is_fixed_length\" and \"str_total_length\" parameters!");
+                return PLCTAG_ERR_BAD_PARAM;
+            }
+        }
+
+        /* check the total length. */
+        if(tag->byte_order->str_total_length > 0
+          && (tag->byte_order->str_is_zero_terminated
+            + tag->byte_order->str_max_capacity
+            + tag->byte_order->str_count_word_bytes
+            + tag->byte_order->str_pad_bytes)
+          > tag->byte_order->str_total_length)
+        {
+            pdebug(DEBUG_WARN, "Tag string total length must be at least the sum of the other string components!");
+            return PLCTAG_ERR_BAD_PARAM;
+        }
+
+        /* Do we have enough of a definition for a string? */
+        /* FIXME - This is probably not enough checking! */
+        if(tag->byte_order->str_is_counted || tag->byte_order->str_is_zero_terminated) {
+            tag->byte_order->str_is_defined = 1;
+        } else {
+            pdebug(DEBUG_WARN, "Insufficient definitions found to support strings!");
+        }
+    }
+
+    /* pick the accessor kernels for the final byte order. */
+    if(byte_shuffle_kernel_init(&(tag->int16_kernel), tag->byte_order->int16_order, 2) != PLCTAG_STATUS_OK
+       || byte_shuffle_kernel_init(&(tag->int32_kernel), tag->byte_order->int32_order, 4) != PLCTAG_STATUS_OK
+       || byte_shuffle_kernel_init(&(tag->int64_kernel), tag->byte_order->int64_order, 8) != PLCTAG_STATUS_OK
+       || byte_shuffle_kernel_init(&(tag->float32_kernel), tag->byte_order->float32_order, 4) != PLCTAG_STATUS_OK
+       || byte_shuffle_kernel_init(&(tag->float64_kernel), tag->byte_order->float64_order, 8) != PLCTAG_STATUS_OK) {
+        pdebug(DEBUG_WARN, "Unable to set up byte order kernels!");
+        return PLCTAG_ERR_BAD_CONFIG;
+    }
+
+    pdebug(DEBUG_INFO, "Done.");
+
+    return PLCTAG_STATUS_OK;
+}
+
+
+
+/*
+ * Set the byte order of a tag created from a template.  The first tag
+ * works it out from the attributes.  Later tags copy it and its accessor
+ * kernels, unless the protocol gave them a different default.
+ */
+
+int set_template_byte_order(tag_template_p tmpl, plc_tag_p tag, attr attribs)
+{
+    tag_byte_order_t *default_byte_order = tag->byte_order;
+    int rc = PLCTAG_STATUS_OK;
+    int reused = 0;
+
+    critical_block(tmpl->mutex) {
+        if(!tmpl->has_byte_order || tmpl->default_byte_order != default_byte_order) {
+            break;
+        }
+
+        reused = 1;
+
+        tag->int16_kernel = tmpl->int16_kernel;
+        tag->int32_kernel = tmpl->int32_kernel;
+        tag->int64_kernel = tmpl->int64_kernel;
+        tag->float32_kernel = tmpl->float32_kernel;
+        tag->float64_kernel = tmpl->float64_kernel;
+
+        /* the default needs nothing more. */
+        if(!tmpl->byte_order.is_allocated) {
+            break;
+        }
+
+        tag->byte_order = mem_alloc((int)(unsigned int)sizeof(*(tag->byte_order)));
+        if(!tag->byte_order) {
+            pdebug(DEBUG_WARN, "Unable to allocate byte order struct for tag!");
+            tag->byte_order = default_byte_order;
+            rc = PLCTAG_ERR_NO_MEM;
+            break;
+        }
+
+        *(tag->byte_order) = tmpl->byte_order;
+    }
+
+    if(reused) {
+        /* the kernels walk the order tables of the tag's own byte order. */
+        tag->int16_kernel.order = tag->byte_order->int16_order;
+        tag->int32_kernel.order = tag->byte_order->int32_order;
+        tag->int64_kernel.order = tag->byte_order->int64_order;
+        tag->float32_kernel.order = tag->byte_order->float32_order;
+        tag->float64_kernel.order = tag->byte_order->float64_order;
+
+        return rc;
+    }
+
+    rc = set_tag_byte_order(tag, attribs);
+    if(rc != PLCTAG_STATUS_OK) {
+        return rc;
+    }
+
+    critical_block(tmpl->mutex) {
+        tmpl->byte_order = *(tag->byte_order);
+        tmpl->default_byte_order = default_byte_order;
+        tmpl->int16_kernel = tag->int16_kernel;
+        tmpl->int32_kernel = tag->int32_kernel;
+        tmpl->int64_kernel = tag->int64_kernel;
+        tmpl->float32_kernel = tag->float32_kernel;
+        tmpl->float64_kernel = tag->float64_kernel;
+        tmpl->has_byte_order = 1;
+    }
+
+    return rc;
+}
+
+
+
+int check_byte_order_str(const char *byte_order, int length)
+{
+    int taken[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+    int byte_order_len = str_length(byte_order);
+
+    pdebug(DEBUG_DETAIL, "Starting.");
+
+    /* check the size. */
+    if(byte_order_len != length) {
+        pdebug(DEBUG_WARN, "Byte order string, \"%s\", must be %d characters long!", byte_order, length);
+        return (byte_order_len < length ? PLCTAG_ERR_TOO_SMALL : PLCTAG_ERR_TOO_LARGE);
+    }
+
+    /* check each character. */
+    for(int i=0; i < byte_order_len; i++) {
+        int val = 0;
+
+        if(!isdigit(byte_order[i]) || byte_order[i] < '0' || byte_order[i] > '7') {
+            pdebug(DEBUG_WARN, "Byte order string, \"%s\", must be only characters from '0' to '7'!", byte_order);
+            return PLCTAG_ERR_BAD_DATA;
+        }
+
+        /* get the numeric value. */
+        val = byte_order[i] - '0';
+
+        if(val < 0 || val > (length-1)) {
+            pdebug(DEBUG_WARN, "Byte order string, \"%s\", must only values from 0 to %d!", byte_order, (length - 1));
+            return PLCTAG_ERR_BAD_DATA;
+        }
+
+        if(taken[val]) {
+            pdebug(DEBUG_WARN, "Byte order string, \"%s\", must use each digit exactly once!", byte_order);
+            return PLCTAG_ERR_BAD_DATA;
+        }
+
+        taken[val] = 1;
+    }
+
+    pdebug(DEBUG_DETAIL, "Done.");
+
+    return PLCTAG_STATUS_OK;
+}
+
+
+
+
+plc_tag_p lookup_tag(int32_t tag_id)
+{
+    plc_tag_p tag = NULL;
+
+    /* the slot table checks the ID generation and takes the reference for us. */
+    tag = slot_table_get(tags, tag_id);
+
+    if(tag) {
+        debug_set_tag_id(tag_id);
+        pdebug(DEBUG_SPEW, "Found tag %p with id %d.", tag, tag_id);
+    } else {
+        debug_set_tag_id(0);
+        /* FIXME - remove this. */
+        pdebug(DEBUG_WARN, "Tag with ID %d not found.", tag_id);
+    }
+
+    return tag;
+}
+
+
+
+int add_tag_lookup(plc_tag_p tag)
+{
+    int32_t new_id = 0;
+
+    pdebug(DEBUG_DETAIL, "Starting.");
+
+    /* returns the new ID or an error. */
+    new_id = slot_table_put(tags, tag);
+
+    /* a full table is the documented limit on live tags. */
+    if(new_id == PLCTAG_ERR_NO_RESOURCES) {
+        pdebug(DEBUG_WARN, "Too many tags, the limit is %d!", slot_table_max_slots() - 1);
+        new_id = PLCTAG_ERR_TOO_MANY_TAGS;
+    }
+
+    pdebug(DEBUG_DETAIL, "Done.");
+
+    return new_id;
+}
+
+
+
+
+/*
+ * The key of a shared tag is its sorted attributes, without the ones that
+ * each handle sets for itself.  This must be called before the tag
+ * constructor because tag constructors may change the attributes they are
+ * passed.
+ *
+ * Attributes that mean the same thing must give the same key.  The PLC
+ * type can be given as "plc" or "cpu" and has several names for each type,
+ * so it is replaced by its canonical name.  Whitespace in the values is
+ * left out of the key.
+ */
+
+char *make_share_key(attr attribs)
+{
+    attr key_attribs = NULL;
+    char *key = NULL;
+
+    key_attribs = attr_copy(attribs);
+    if(!key_attribs) {
+        return NULL;
+    }
+
+    if(attr_get_str(key_attribs, "plc", NULL) || attr_get_str(key_attribs, "cpu", NULL)) {
+        const char *plc_name = ab_plc_type_name(key_attribs);
+
+        if(plc_name) {
+            attr_remove(key_attribs, "cpu");
+
+            if(attr_set_str(key_attribs, "plc", plc_name)) {
+                attr_destroy(key_attribs);
+                return NULL;
+            }
+        }
+    }
+
+    key = attr_to_sorted_str(key_attribs, tag_share_skip_attribs);
+
+    attr_destroy(key_attribs);
+
+    return key;
+}
+
+
+
+/*
+ * Make a new tag ID onto the shared tag with the passed key, if there is
+ * one.  The handle asks for its own read cache and automatic read and
+ * write periods.  The tag uses the fastest of those asked for by all its
+ * handles.
+ *
+ * Returns PLCTAG_ERR_NOT_FOUND if there is no such tag, so that the caller
+ * creates it.  The tag is already set up or being set up, so this does not
+ * tickle or abort it while waiting.
+ */
+
+int32_t create_tag_handle(const char *key, attr attribs, int timeout)
+{
+    int64_t table_key = (int64_t)hash((uint8_t *)key, (size_t)str_length(key), 0) + 1;
+    struct tag_handle_t *handle = NULL;
+    plc_tag_p tag = NULL;
+    int32_t id = PLCTAG_ERR_NOT_FOUND;
+    int rc = PLCTAG_STATUS_OK;
+
+    pdebug(DEBUG_INFO, "Starting.");
+
+    handle = (struct tag_handle_t *)mem_alloc((int)sizeof(*handle));
+    if(!handle) {
+        pdebug(DEBUG_ERROR, "Unable to allocate memory for tag handle!");
+        return PLCTAG_ERR_NO_MEM;
+    }
+
+    handle->read_cache_ms = attr_get_int(attribs, "read_cache_ms", 0);
+    handle->auto_sync_read_ms = attr_get_int(attribs, "auto_sync_read_ms", 0);
+    handle->auto_sync_write_ms = attr_get_int(attribs, "auto_sync_write_ms", 0);
+
+    if(handle->read_cache_ms < 0) {
+        pdebug(DEBUG_WARN, "read_cache_ms value must be positive, using zero.");
+        handle->read_cache_ms = 0;
+    }
+
+    if(handle->auto_sync_read_ms < 0 || handle->auto_sync_write_ms < 0) {
+        pdebug(DEBUG_WARN, "auto_sync_read_ms and auto_sync_write_ms values must be positive!");
+        mem_free(handle);
+        return PLCTAG_ERR_BAD_PARAM;
+    }
+
+    critical_block(shared_tags_mutex) {
+        tag_share_p share = (tag_share_p)hashtable_get(shared_tags, table_key);
+
+        if(!share || str_cmp(share->key, key) != 0) {
+            pdebug(DEBUG_DETAIL, "No shared tag found.");
+            break;
+        }
+
+        tag = rc_inc(share->tag);
+
+        /* the tag table owns this reference. */
+        id = add_tag_lookup(rc_inc(tag));
+        if(id < 0) {
+            pdebug(DEBUG_WARN, "Unable to map shared tag to a new tag ID, error %s!", plc_tag_decode_error(id));
+            rc_dec(tag);
+            tag = rc_dec(tag);
+            break;
+        }
+
+        tag_shard_map[slot_table_id_index(id)] = tag->tickler_shard;
+
+        critical_block(tag->api_mutex) {
+            handle->tag_id = id;
+            handle->next = share->handles;
+            share->handles = handle;
+            share->num_handles++;
+
+            combine_tag_handles_unsafe(tag);
+        }
+
+        handle = NULL;
+    }
+
+    if(handle) {
+        mem_free(handle);
+    }
+
+    if(!tag) {
+        return id;
+    }
+
+    pdebug(DEBUG_DETAIL, "Tag ID %d is another handle onto the tag with ID %d.", id, tag->tag_id);
+
+    /* wait for the tag to be set up. */
+    if(timeout) {
+        int64_t timeout_time = timeout + time_ms();
+
+        do {
+            uint32_t io_seq = cond_seq(tag->io_cond);
+            int64_t wait_ms = 0;
+
+            critical_block(tag->api_mutex) {
+                rc = tag->vtable->status(tag);
+            }
+
+            if(rc != PLCTAG_STATUS_PENDING) {
+                break;
+            }
+
+            wait_ms = timeout_time - time_ms();
+            if(wait_ms > TAG_WAIT_MAX_MS) {
+                wait_ms = TAG_WAIT_MAX_MS;
+            }
+
+            if(wait_ms > 0) {
+                cond_wait(tag->io_cond, &io_seq, (int)wait_ms);
+            }
+        } while(timeout_time > time_ms());
+
+        if(rc == PLCTAG_STATUS_PENDING) {
+            rc = PLCTAG_ERR_TIMEOUT;
+        }
+    }
+
+    rc_dec(tag);
+
+    if(rc != PLCTAG_STATUS_OK) {
+        pdebug(DEBUG_WARN, "Error %s while waiting for shared tag!", plc_tag_decode_error(rc));
+        plc_tag_destroy(id);
+        return rc;
+    }
+
+    pdebug(DEBUG_INFO, "Done.");
+
+    return id;
+}
+
+
+
+/*
+ * Put a newly created tag in the shared tag table under the passed key.
+ * This takes the key.  If another tag already has the same hash, the new
+ * tag is just not shared.
+ */
+
+int share_tag(plc_tag_p tag, char *key)
+{
+    int64_t table_key = (int64_t)hash((uint8_t *)key, (size_t)str_length(key), 0) + 1;
+    tag_share_p share = NULL;
+    int rc = PLCTAG_STATUS_OK;
+
+    pdebug(DEBUG_DETAIL, "Starting.");
+
+    share = (tag_share_p)mem_alloc((int)sizeof(*share));
+    if(share) {
+        share->handles = (struct tag_handle_t *)mem_alloc((int)sizeof(struct tag_handle_t));
+    }
+
+    if(!share || !share->handles) {
+        pdebug(DEBUG_ERROR, "Unable to allocate memory for shared tag!");
+        mem_free(share);
+        mem_free(key);
+        return PLCTAG_ERR_NO_MEM;
+    }
+
+    share->key = key;
+    share->table_key = table_key;
+    share->tag = tag;
+    share->num_handles = 1;
+    share->handles->tag_id = tag->tag_id;
+    share->handles->read_cache_ms = (int)tag->read_cache_ms;
+    share->handles->auto_sync_read_ms = tag->auto_sync_read_ms;
+    share->handles->auto_sync_write_ms = tag->auto_sync_write_ms;
+
+    critical_block(shared_tags_mutex) {
+        if(hashtable_get(shared_tags, table_key)) {
+            pdebug(DEBUG_DETAIL, "Another tag already uses this hash, not sharing the tag.");
+            rc = PLCTAG_ERR_DUPLICATE;
+            break;
+        }
+
+        rc = hashtable_put(shared_tags, table_key, share);
+        if(rc == PLCTAG_STATUS_OK) {
+            critical_block(tag->api_mutex) {
+                tag->share = share;
+            }
+        }
+    }
+
+    if(rc != PLCTAG_STATUS_OK) {
+        mem_free(share->handles);
+        mem_free(share->key);
+        mem_free(share);
+    }
+
+    pdebug(DEBUG_DETAIL, "Done.");
+
+    return rc;
+}
+
+
+
+/*
+ * Drop the handle for the passed tag ID.  Returns 1 if the tag still has
+ * other handles, otherwise the tag is taken out of the shared tag table
+ * and 0 is returned so that the caller destroys it.
+ *
+ * If the handle of the tag's own ID goes away, another handle takes over
+ * the tag ID and its listeners move into the tag.
+ */
+
+int release_tag_handle(plc_tag_p tag, int32_t tag_id)
+{
+    struct tag_handle_t *handle = NULL;
+    tag_share_p share = NULL;
+    int others_remain = 0;
+
+    pdebug(DEBUG_DETAIL, "Starting.");
+
+    critical_block(shared_tags_mutex) {
+        critical_block(tag->api_mutex) {
+            struct tag_handle_t **link = NULL;
+
+            share = tag->share;
+            if(!share) {
+                break;
+            }
+
+            for(link = &(share->handles); *link; link = &((*link)->next)) {
+                if((*link)->tag_id == tag_id) {
+                    handle = *link;
+                    *link = handle->next;
+                    share->num_handles--;
+                    break;
+                }
+            }
+
+            if(share->num_handles > 0) {
+                others_remain = 1;
+
+                if(tag_id == tag->tag_id) {
+                    struct tag_handle_t *next = share->handles;
+
+                    /* the handle keeps the old listeners so that they hear about the destruction. */
+                    handle->callback = tag->callback;
+                    handle->batch_callback = tag->batch_callback;
+                    handle->callback_context = tag->callback_context;
+                    handle->event_queue = tag->event_queue;
+
+                    tag->tag_id = next->tag_id;
+                    tag->callback = next->callback;
+                    tag->batch_callback = next->batch_callback;
+                    tag->callback_context = next->callback_context;
+                    tag->event_queue = next->event_queue;
+
+                    next->callback = NULL;
+                    next->batch_callback = NULL;
+                    next->callback_context = NULL;
+                    next->event_queue = NULL;
+
+                    /* timers are kept by tag ID, so start over under the new one. */
+                    tag->tickler_due = 0;
+                }
+
+                combine_tag_handles_unsafe(tag);
             } else {
-                pdebug(DEBUG_WARN, "Tag string attribute str_count_word_bytes must be missing, 0, 1, 2, 4, or 8!");
-                return PLCTAG_ERR_BAD_PARAM;
+                tag->share = NULL;
+            }
+        }
+
+        if(share && !others_remain) {
+            hashtable_remove(shared_tags, share->table_key);
+        }
+    }
+
+    if(others_remain) {
+        plc_tag_wake_tag(tag->tag_id);
+
+        if(handle) {
+            deliver_event(handle->tag_id, handle->callback, handle->batch_callback, handle->callback_context, handle->event_queue, PLCTAG_EVENT_DESTROYED, PLCTAG_STATUS_OK, NULL);
+            rc_dec(handle->event_queue);
+        }
+    } else if(share) {
+        mem_free(share->key);
+        mem_free(share);
+    }
+
+    if(handle) {
+        mem_free(handle);
+    }
+
+    pdebug(DEBUG_DETAIL, "Done.");
+
+    return others_remain;
+}
+
+
+
+/*
+ * Find the handle of a tag ID onto a shared tag.  Returns NULL if the tag
+ * is not shared.
+ */
+
+struct tag_handle_t *find_tag_handle_unsafe(plc_tag_p tag, int32_t tag_id)
+{
+    if(!tag->share) {
+        return NULL;
+    }
+
+    for(struct tag_handle_t *handle = tag->share->handles; handle; handle = handle->next) {
+        if(handle->tag_id == tag_id) {
+            return handle;
+        }
+    }
+
+    return NULL;
+}
+
+
+
+/*
+ * Set up a shared tag with the fastest settings any of its handles asked
+ * for.  A handle that asks for no read cache gets fresh reads.  Automatic
+ * reads and writes use the shortest period that is asked for.
+ */
+
+void combine_tag_handles_unsafe(plc_tag_p tag)
+{
+    int read_cache_ms = INT_MAX;
+    int auto_sync_read_ms = 0;
+    int auto_sync_write_ms = 0;
+
+    for(struct tag_handle_t *handle = tag->share->handles; handle; handle = handle->next) {
+        if(handle->read_cache_ms < read_cache_ms) {
+            read_cache_ms = handle->read_cache_ms;
+        }
+
+        if(handle->auto_sync_read_ms > 0 && (auto_sync_read_ms == 0 || handle->auto_sync_read_ms < auto_sync_read_ms)) {
+            auto_sync_read_ms = handle->auto_sync_read_ms;
+        }
+
+        if(handle->auto_sync_write_ms > 0 && (auto_sync_write_ms == 0 || handle->auto_sync_write_ms < auto_sync_write_ms)) {
+            auto_sync_write_ms = handle->auto_sync_write_ms;
+        }
+    }
+
+    if(tag->read_cache_ms != (int64_t)read_cache_ms) {
+        tag->read_cache_ms = (int64_t)read_cache_ms;
+        tag->read_cache_expire = (int64_t)0;
+    }
+
+    /* a faster period should not wait out the rest of the old one. */
+    if(tag->auto_sync_read_ms != auto_sync_read_ms) {
+        tag->auto_sync_read_ms = auto_sync_read_ms;
+        tag->auto_sync_read_cur_ms = 0;
+        tag->auto_sync_replan = 1;
+
+        if(auto_sync_window_ms > 0) {
+            request_auto_sync_plan(tag->tickler_shard);
+        }
+    }
+
+    tag->auto_sync_write_ms = auto_sync_write_ms;
+
+    plc_tag_wake_tag(tag->tag_id);
+}
+
+
+
+/*
+ * get the string count length depending on the PLC string type.
+ *
+ * This is called in other functions so is separated out.
+ *
+ * This must be called with the tag API mutex held!
+ */
+
+// int get_string_count_size_unsafe(plc_tag_p tag, int offset)
+// {
+//     int string_count_length = 0;
+//     string_type_t string_type = tag->byte_order.string_type;
+
+//     /* FIXME - do something with the offset! */
+//     (void)offset;
+
+//     switch(string_type) {
+//         case STRING_AB_MICRO800:
+//             string_count_length = 1; /* FIXME - is this correct? */
+//             break;
+
+//         case STRING_AB_PLC5:
+//             string_count_length = 2;
+//             break;
+
+//         case STRING_AB_LGX:
+//             string_count_length = 4;
+//             break;
+
+//         case STRING_AB_TAG_NAME:
+//             string_count_length = 2;
+//             break;
+
+//         case STRING_ZERO_TERM:
+//             string_count_length = 0;
+//             break;
+
+//         default:
+//             pdebug(DEBUG_WARN, "Unsupported string type!");
+//             string_count_length = PLCTAG_ERR_UNSUPPORTED;
+//             break;
+//     }
+
+//     return string_count_length;
+// }
+
+
+
+/*
+ * get the string length depending on the PLC string type.
+ *
+ * This is called in other functions so is separated out.
+ *
+ * This must be called with the tag API mutex held!
+ */
+
+int get_string_length_unsafe(plc_tag_p tag, int offset)
+{
+    int string_length = 0;
+
+    if(tag->byte_order->str_is_counted) {
+        switch(tag->byte_order->str_count_word_bytes) {
+            case 1:
+                string_length = (int)(unsigned int)(tag->data[offset]);
+                break;
+
+            case 2:
+                string_length = (int16_t)(uint16_t)(((uint16_t)(tag->data[offset + tag->byte_order->int16_order[0]]) << 0 ) +
+                                                    ((uint16_t)(tag->data[offset + tag->byte_order->int16_order[1]]) << 8 ));
+                break;
+
+            case 4:
+                string_length = (int32_t)(((uint32_t)(tag->data[offset + tag->byte_order->int32_order[0]]) << 0 ) +
+                                          ((uint32_t)(tag->data[offset + tag->byte_order->int32_order[1]]) << 8 ) +
+                                          ((uint32_t)(tag->data[offset + tag->byte_order->int32_order[2]]) << 16) +
+                                          ((uint32_t)(tag->data[offset + tag->byte_order->int32_order[3]]) << 24));
+                break;
+
+            default:
+                pdebug(DEBUG_WARN, "Unsupported string count word size, %d bytes!", tag->byte_order->str_count_word_bytes);
+                return 0; /* FIXME - this should be an error code. */
+                break;
+        }
+
+    } else {
+        if(tag->byte_order->str_is_zero_terminated) {
+            /* slow, but hopefully correct. */
+            for(int i = offset + (int)(tag->byte_order->str_count_word_bytes); i < tag->size; i++) {
+                size_t char_index = (((size_t)(unsigned int)string_length) ^ (tag->byte_order->str_is_byte_swapped)) /* byte swap if necessary */
+                                + (size_t)(unsigned int)offset
+                                + (size_t)(unsigned int)(tag->byte_order->str_count_word_bytes);
+
+                if(tag->data[char_index] == (uint8_t)0) {
+                    /* found the end. */
+                    break;
+                }
+
+                string_length++;
+            }
+        } else {
+            /* it is not counted or zero terminated, so it is not supported. */
+            pdebug(DEBUG_WARN, "Unsupported string length type.   Must be counted or zero-terminated!");
+            return 0; /* FIXME this should be an error code. */
+        }
+    }
+
+    return string_length;
+}
+
+
+/*
+ * Start a read on the tag.
+ *
+ * This must be called with the tag API mutex held.  PLCTAG_STATUS_PENDING
+ * means the read was started.  Anything else means it is already done.
+ */
+
+int start_read_unsafe(plc_tag_p tag)
+{
+    int rc = PLCTAG_STATUS_OK;
+
+    /* check read cache, if not expired, return existing data. */
+    if(tag->read_cache_expire > time_ms()) {
+        pdebug(DEBUG_INFO, "Returning cached data.");
+        return PLCTAG_STATUS_OK;
+    }
+
+    if(tag->read_in_flight || tag->write_in_flight) {
+        pdebug(DEBUG_WARN, "An operation is already in flight!");
+        return PLCTAG_ERR_BUSY;
+    }
+
+    if(tag->tag_is_dirty) {
+        pdebug(DEBUG_WARN, "Tag has locally updated data that will be overwritten!");
+        return PLCTAG_ERR_BUSY;
+    }
+
+    tag->read_in_flight = 1;
+    tag->read_gen++;
+    tag->status = PLCTAG_STATUS_PENDING;
+
+    if(tag->change) {
+        tag->change->auto_read = 0;
+    }
+
+    /* the protocol implementation does not do the timeout. */
+    rc = tag->vtable->read(tag);
+
+    /* if not pending then check for success or error. */
+    if(rc != PLCTAG_STATUS_PENDING) {
+        if(rc != PLCTAG_STATUS_OK) {
+            /* not pending and not OK, so error. Abort and clean up. */
+
+            pdebug(DEBUG_WARN,"Response from read command returned error %s!", plc_tag_decode_error(rc));
+
+            if(tag->vtable->abort) {
+                tag->vtable->abort(tag);
+            }
+        } else {
+            tag_snapshot_publish(tag, 0, tag->size);
+            tag_change_check_unsafe(tag);
+        }
+
+        tag->read_in_flight = 0;
+
+        read_done_unsafe(tag, rc);
+    }
+
+    return rc;
+}
+
+
+
+/*
+ * Start a read for an API call, or find a finished one it can use.
+ *
+ * This must be called with the tag API mutex held.  want_gen is the
+ * read generation after the one that was current when the call was made.
+ * Any read from then on started after the call and is fresh enough.
+ * Otherwise this is the same as start_read_unsafe().  The caller can
+ * wait and try again if it gets PLCTAG_ERR_BUSY while an operation is
+ * in flight.
+ */
+
+int start_shared_read_unsafe(plc_tag_p tag, uint32_t want_gen)
+{
+    /* local changes would be lost, start_read_unsafe() refuses those. */
+    if(tag->share_reads && !tag->tag_is_dirty && (int32_t)(tag->read_gen_done - want_gen) >= 0) {
+        pdebug(DEBUG_DETAIL, "Using a read that started after the call.");
+        return tag->read_gen_status;
+    }
+
+    return start_read_unsafe(tag);
+}
+
+
+
+/*
+ * Note that the latest read finished.  API calls waiting to share it, or
+ * waiting for the tag to be free, look again.
+ */
+
+void read_done_unsafe(plc_tag_p tag, int status)
+{
+    tag->read_gen_done = tag->read_gen;
+    tag->read_gen_status = status;
+
+    /* a background refresh of stale cached data starts the cache over. */
+    if(tag->read_refresh && !tag->read_queued) {
+        tag->read_refresh = 0;
+
+        if(status == PLCTAG_STATUS_OK) {
+            tag->read_cache_expire = time_ms() + tag->read_cache_ms;
+        }
+    }
+
+    if(tag->io_waiters > 0) {
+        plc_tag_wake_waiters(tag);
+    }
+}
+
+
+
+/*
+ * Check whether a read can return stale cached data.
+ *
+ * This must be called with the tag API mutex held.  The data must be past
+ * read_cache_ms, but by less than read_cache_stale_ms.  If nothing is
+ * already refreshing the tag, one read is queued for the tickler.  Later
+ * calls in the window share it.
+ */
+
+int use_stale_cache_unsafe(plc_tag_p tag)
+{
+    int64_t current_time = time_ms();
+
+    if(tag->read_cache_stale_ms <= 0 || tag->read_cache_expire <= 0) {
+        return 0;
+    }
+
+    if(tag->read_cache_expire > current_time || tag->read_cache_expire + tag->read_cache_stale_ms <= current_time) {
+        return 0;
+    }
+
+    /* the refresh would overwrite local changes. */
+    if(tag->tag_is_dirty) {
+        return 0;
+    }
+
+    if(!tag->read_refresh) {
+        pdebug(DEBUG_DETAIL, "Queueing a refresh of the cached data.");
+
+        tag->read_refresh = 1;
+        tag->read_queued = 1;
+
+        plc_tag_wake_tag(tag->tag_id);
+    }
+
+    return 1;
+}
+
+
+
+/*
+ * Start a write on the tag.
+ *
+ * This must be called with the tag API mutex held.  PLCTAG_STATUS_PENDING
+ * means the write was started.  Anything else means it is already done.
+ */
+
+int start_write_unsafe(plc_tag_p tag)
+{
+    int rc = PLCTAG_STATUS_OK;
+
+    if(tag->read_in_flight || tag->write_in_flight) {
+        pdebug(DEBUG_WARN, "Tag already has an operation in flight!");
+        return PLCTAG_ERR_BUSY;
+    }
+
+    /* a write is now in flight.  It sends the data of any queued write too. */
+    tag->write_in_flight = 1;
+    tag->write_queued = 0;
+    tag->write_gen++;
+    tag->status = PLCTAG_STATUS_OK;
+
+    /* the protocol implementation does not do the timeout. */
+    rc = tag->vtable->write(tag);
+
+    /* if not pending then check for success or error. */
+    if(rc != PLCTAG_STATUS_PENDING) {
+        if(rc != PLCTAG_STATUS_OK) {
+            /* not pending and not OK, so error. Abort and clean up. */
+
+            pdebug(DEBUG_WARN,"Response from write command returned error %s!", plc_tag_decode_error(rc));
+
+            if(tag->vtable->abort) {
+                tag->vtable->abort(tag);
+            }
+        }
+
+        tag->write_in_flight = 0;
+
+        write_done_unsafe(tag, rc);
+    }
+
+    return rc;
+}
+
+
+
+/*
+ * Start a write for an API call on a tag that queues writes, or find a
+ * finished one that sent the data of the call.
+ *
+ * This must be called with the tag API mutex held.  want_gen is the
+ * write generation after the one that was current when the call was made.
+ * The tag data was set before the call, so any write from then on sent
+ * it.  Otherwise this is the same as start_write_unsafe().
+ */
+
+int start_queued_write_unsafe(plc_tag_p tag, uint32_t want_gen)
+{
+    if(tag->write_queue && (int32_t)(tag->write_gen_done - want_gen) >= 0) {
+        pdebug(DEBUG_DETAIL, "Using a write that started after the call.");
+        return tag->write_gen_status;
+    }
+
+    return start_write_unsafe(tag);
+}
+
+
+
+/*
+ * Note that the latest write finished.  API calls waiting on it, or
+ * waiting for the tag to be free, look again.
+ */
+
+void write_done_unsafe(plc_tag_p tag, int status)
+{
+    tag->write_gen_done = tag->write_gen;
+    tag->write_gen_status = status;
+
+    if(tag->io_waiters > 0) {
+        plc_tag_wake_waiters(tag);
+    }
+}
+
+
+
+/*
+ * Check once on a read or write that an API call is waiting for.
+ *
+ * This must be called with the tag API mutex held.  If the operation is
+ * done, or has run past timeout_time, the in flight and complete flags
+ * and api_waiting are cleared.  PLCTAG_STATUS_PENDING means keep waiting.
+ */
+
+int check_completion_unsafe(plc_tag_p tag, int is_read, int64_t timeout_time)
+{
+    int rc = PLCTAG_STATUS_PENDING;
+
+    if(!(is_read ? tag->read_in_flight : tag->write_in_flight)) {
+        /* plc_tag_abort() or plc_tag_destroy() got there first. */
+        pdebug(DEBUG_WARN, "Operation was aborted while waiting for it.");
+        rc = PLCTAG_ERR_ABORT;
+    } else {
+        /* give some time to the tickler function. */
+        if(tag->vtable->tickler) {
+            tag->vtable->tickler(tag);
+        }
+
+        rc = tag->vtable->status(tag);
+
+        if(rc == PLCTAG_STATUS_PENDING && timeout_time <= time_ms()) {
+            pdebug(DEBUG_WARN, "%s operation timed out.", (is_read ? "Read" : "Write"));
+            rc = PLCTAG_ERR_TIMEOUT;
+        }
+    }
+
+    if(rc != PLCTAG_STATUS_PENDING) {
+        if(rc != PLCTAG_STATUS_OK) {
+            /* abort the request. */
+            if(tag->vtable->abort) {
+                tag->vtable->abort(tag);
+            }
+        } else if(is_read) {
+            tag_snapshot_publish(tag, 0, tag->size);
+            tag_change_check_unsafe(tag);
+        }
+
+        /* we are done. */
+        if(is_read) {
+            tag->read_complete = 0;
+            tag->read_in_flight = 0;
+
+            /* a timeout or abort is only this call's, others can still try. */
+            if(rc != PLCTAG_ERR_TIMEOUT && rc != PLCTAG_ERR_ABORT) {
+                read_done_unsafe(tag, rc);
+            }
+        } else {
+            tag->write_complete = 0;
+            tag->write_in_flight = 0;
+
+            if(rc != PLCTAG_ERR_TIMEOUT && rc != PLCTAG_ERR_ABORT) {
+                write_done_unsafe(tag, rc);
+            }
+        }
+
+        tag->api_waiting = 0;
+
+        if(tag->io_waiters > 0) {
+            plc_tag_wake_waiters(tag);
+        }
+
+        /* the tickler skips tags that an API call is waiting on, so get it to look again. */
+        if(tag->auto_sync_read_ms > 0 || tag->auto_sync_write_ms > 0 || tag->read_queued || tag->write_queued) {
+            plc_tag_wake_tag(tag->tag_id);
+        }
+    }
+
+    return rc;
+}
+
+
+
+/*
+ * Wait for the read or write that the caller started to finish.
+ *
+ * The API mutex is only held while the tag is checked, not while waiting.
+ * Other API calls on the tag are not blocked for the whole round trip.
+ * The protocol layers call plc_tag_wake_tag() when a response comes in,
+ * which signals the tag's own condition variable, so we look at the tag
+ * again as soon as there is something to see.
+ *
+ * The caller sets api_waiting before calling this.  It is cleared along
+ * with the in flight and complete flags when the operation is done.
+ */
+
+int wait_for_completion(plc_tag_p tag, int is_read, int timeout)
+{
+    int rc = PLCTAG_STATUS_PENDING;
+    int64_t start_time = time_ms();
+    int64_t timeout_time = start_time + timeout;
+
+    while(rc == PLCTAG_STATUS_PENDING) {
+        /* get this before checking so that we do not miss a signal. */
+        uint32_t io_seq = cond_seq(tag->io_cond);
+        int64_t wait_ms = 0;
+
+        critical_block(tag->api_mutex) {
+            rc = check_completion_unsafe(tag, is_read, timeout_time);
+        }
+
+        if(rc == PLCTAG_STATUS_PENDING) {
+            wait_ms = timeout_time - time_ms();
+            if(wait_ms > TAG_WAIT_MAX_MS) {
+                wait_ms = TAG_WAIT_MAX_MS;
+            }
+
+            if(wait_ms > 0) {
+                cond_wait(tag->io_cond, &io_seq, (int)wait_ms);
+            }
+        }
+    }
+
+    pdebug(DEBUG_INFO,"elapsed time %" PRId64 "ms",(time_ms()-start_time));
+
+    return rc;
+}
+
+
+
+/*
+ * Take the tag IO mutex that plc_tag_read() and plc_tag_write() hold while
+ * they wait, but give up at timeout_time.  unlock_tag_io() signals the
+ * tag's waiters when the mutex is let go so that we try again at once.
+ */
+
+int lock_tag_io(plc_tag_p tag, int64_t timeout_time)
+{
+    while(1) {
+        /* get this before trying so that we do not miss a signal. */
+        uint32_t io_seq = cond_seq(tag->io_cond);
+        int64_t wait_ms = 0;
+
+        if(mutex_try_lock(tag->io_mutex) == PLCTAG_STATUS_OK) {
+            return PLCTAG_STATUS_OK;
+        }
+
+        wait_ms = timeout_time - time_ms();
+        if(wait_ms <= 0) {
+            return PLCTAG_ERR_TIMEOUT;
+        }
+
+        if(wait_ms > TAG_WAIT_MAX_MS) {
+            wait_ms = TAG_WAIT_MAX_MS;
+        }
+
+        cond_wait(tag->io_cond, &io_seq, (int)wait_ms);
+    }
+}
+
+
+
+void unlock_tag_io(plc_tag_p tag)
+{
+    mutex_unlock(tag->io_mutex);
+
+    plc_tag_wake_waiters(tag);
+}
+
+
+
+/*
+ * Look up all the tags for a batch read or write and run it.
+ */
+
+int do_many(int32_t *ids, int *statuses, int num_tags, int is_read, int timeout)
+{
+    int rc = PLCTAG_STATUS_OK;
+    plc_tag_p *tag_list = NULL;
+    int *status_list = NULL;
+
+    if(num_tags < 0) {
+        pdebug(DEBUG_WARN, "Number of tags must not be negative!");
+        return PLCTAG_ERR_BAD_PARAM;
+    }
+
+    if(timeout < 0) {
+        pdebug(DEBUG_WARN, "Timeout must not be negative!");
+        return PLCTAG_ERR_BAD_PARAM;
+    }
+
+    if(num_tags == 0) {
+        return PLCTAG_STATUS_OK;
+    }
+
+    tag_list = (plc_tag_p *)mem_alloc(num_tags * (int)sizeof(plc_tag_p));
+    status_list = (int *)mem_alloc(num_tags * (int)sizeof(int));
+
+    if(!tag_list || !status_list) {
+        pdebug(DEBUG_ERROR, "Unable to allocate memory for %d tags!", num_tags);
+        mem_free(tag_list);
+        mem_free(status_list);
+        return PLCTAG_ERR_NO_MEM;
+    }
+
+    for(int i=0; i < num_tags; i++) {
+        tag_list[i] = lookup_tag(ids[i]);
+        status_list[i] = (tag_list[i] ? PLCTAG_STATUS_PENDING : PLCTAG_ERR_NOT_FOUND);
+    }
+
+    rc = run_many(tag_list, status_list, num_tags, is_read, timeout);
+
+    for(int i=0; i < num_tags; i++) {
+        if(statuses) {
+            statuses[i] = status_list[i];
+        }
+
+        rc_dec(tag_list[i]);
+    }
+
+    debug_set_tag_id(0);
+
+    mem_free(tag_list);
+    mem_free(status_list);
+
+    return rc;
+}
+
+
+
+/*
+ * Run a batch read or write.
+ *
+ * Every operation is started before we wait on any of them.  The requests
+ * end up queued together in the protocol layer which packs them into as
+ * few packets as it can.  Then we wait once, on the completion condition,
+ * until every operation is done or the timeout passes.
+ *
+ * Entries in tag_list may be NULL.  Their status is left as it is.  The
+ * return value is the first status that is not OK.
+ */
+
+int run_many(plc_tag_p *tag_list, int *statuses, int num_tags, int is_read, int timeout)
+{
+    struct event_batch_t batch = {0};
+    int rc = PLCTAG_STATUS_OK;
+    int64_t start_time = time_ms();
+    int64_t timeout_time = start_time + timeout;
+    int num_pending = 0;
+
+    for(int i=0; i < num_tags; i++) {
+        plc_tag_p tag = tag_list[i];
+
+        if(!tag) {
+            continue;
+        }
+
+        debug_set_tag_id(tag->tag_id);
+
+        if(tag->callback || tag->share) {
+            pdebug(DEBUG_DETAIL, "Calling callback with PLCTAG_EVENT_%s_STARTED.", (is_read ? "READ" : "WRITE"));
+            tag_raise_event(tag, (is_read ? PLCTAG_EVENT_READ_STARTED : PLCTAG_EVENT_WRITE_STARTED), PLCTAG_STATUS_OK);
+        }
+
+        critical_block(tag->api_mutex) {
+            statuses[i] = (is_read ? start_read_unsafe(tag) : start_write_unsafe(tag));
+
+            if(!is_read && tag->tag_is_dirty && statuses[i] != PLCTAG_ERR_BUSY) {
+                /* this write sends the local changes, so the automatic write is not needed. */
+                tag->tag_is_dirty = 0;
+                tag->auto_sync_next_write = 0;
+            }
+
+            if(statuses[i] == PLCTAG_STATUS_PENDING) {
+                /* we will wait for this below. */
+                if(timeout) {
+                    tag->api_waiting = 1;
+                } else {
+                    /* the tickler reports the completion. */
+                    plc_tag_wake_tag(tag->tag_id);
+                }
+
+                num_pending++;
+            }
+        }
+    }
+
+    while(timeout && num_pending > 0) {
+        /* all the tags have to finish, so we only need to wait on one that has not. */
+        plc_tag_p wait_tag = NULL;
+        uint32_t io_seq = 0;
+        int64_t wait_ms = 0;
+
+        num_pending = 0;
+
+        for(int i=0; i < num_tags; i++) {
+            plc_tag_p tag = tag_list[i];
+            uint32_t tag_seq = 0;
+
+            if(!tag || statuses[i] != PLCTAG_STATUS_PENDING) {
+                continue;
+            }
+
+            /* get this before checking so that we do not miss a signal. */
+            tag_seq = cond_seq(tag->io_cond);
+
+            critical_block(tag->api_mutex) {
+                statuses[i] = check_completion_unsafe(tag, is_read, timeout_time);
+            }
+
+            if(statuses[i] == PLCTAG_STATUS_PENDING) {
+                num_pending++;
+
+                if(!wait_tag) {
+                    wait_tag = tag;
+                    io_seq = tag_seq;
+                }
+            }
+        }
+
+        if(wait_tag) {
+            wait_ms = timeout_time - time_ms();
+            if(wait_ms > TAG_WAIT_MAX_MS) {
+                wait_ms = TAG_WAIT_MAX_MS;
+            }
+
+            if(wait_ms > 0) {
+                cond_wait(wait_tag->io_cond, &io_seq, (int)wait_ms);
+            }
+        }
+    }
+    for(int i=0; i < num_tags; i++) {
+        plc_tag_p tag = tag_list[i];
+
+        if(tag) {
+            debug_set_tag_id(tag->tag_id);
+
+            if(is_read && statuses[i] == PLCTAG_STATUS_OK) {
+                /* set up the cache time.  This works when read_cache_ms is zero as it is already expired. */
+                tag->read_cache_expire = time_ms() + tag->read_cache_ms;
+            }
+
+            if((tag->callback || tag->batch_callback || tag->event_queue || tag->share) && statuses[i] != PLCTAG_STATUS_PENDING) {
+                pdebug(DEBUG_DETAIL, "Calling callback with PLCTAG_EVENT_%s_COMPLETED.", (is_read ? "READ" : "WRITE"));
+                tag_raise_batch_event(tag, (is_read ? PLCTAG_EVENT_READ_COMPLETED : PLCTAG_EVENT_WRITE_COMPLETED), statuses[i], &batch);
+
+                if(is_read) {
+                    int changed = 0;
+
+                    critical_block(tag->api_mutex) {
+                        changed = tag_change_take_unsafe(tag);
+                    }
+
+                    if(changed) {
+                        tag_raise_batch_event(tag, PLCTAG_EVENT_DATA_CHANGED, PLCTAG_STATUS_OK, &batch);
+                    }
+                }
+            }
+        }
+
+        if(rc == PLCTAG_STATUS_OK && statuses[i] != PLCTAG_STATUS_OK) {
+            rc = statuses[i];
+        }
+    }
+
+    debug_set_tag_id(0);
+
+    event_batch_flush(&batch);
+    event_batch_destroy(&batch);
+
+    pdebug(DEBUG_INFO,"elapsed time %" PRId64 "ms for %d tags.", (time_ms()-start_time), num_tags);
+
+    return rc;
+}
+
+
+
+/*
+ * Write every tag that has automatic writes pending, as one batch.
+ */
+
+int flush_dirty_tags(int timeout)
+{
+    int rc = PLCTAG_STATUS_OK;
+    int max_index = 0;
+    int num_tags = 0;
+    plc_tag_p *tag_list = NULL;
+    int *status_list = NULL;
+
+    if(!tags) {
+        return PLCTAG_STATUS_OK;
+    }
+
+    max_index = slot_table_capacity(tags);
+    if(max_index <= 0) {
+        return PLCTAG_STATUS_OK;
+    }
+
+    tag_list = (plc_tag_p *)mem_alloc(max_index * (int)sizeof(plc_tag_p));
+    status_list = (int *)mem_alloc(max_index * (int)sizeof(int));
+
+    if(!tag_list || !status_list) {
+        pdebug(DEBUG_ERROR, "Unable to allocate memory for %d tags!", max_index);
+        mem_free(tag_list);
+        mem_free(status_list);
+        return PLCTAG_ERR_NO_MEM;
+    }
+
+    for(int i=0; i < max_index; i++) {
+        plc_tag_p tag = slot_table_get_index(tags, i);
+        int is_dirty = 0;
+
+        if(!tag) {
+            continue;
+        }
+
+        critical_block(tag->api_mutex) {
+            /* shared tags have more than one tag ID, only flush them once. */
+            is_dirty = (tag->auto_sync_write_ms > 0 && tag->tag_is_dirty && slot_table_id_index(tag->tag_id) == i);
+        }
+
+        if(is_dirty) {
+            tag_list[num_tags] = tag;
+            status_list[num_tags] = PLCTAG_STATUS_PENDING;
+            num_tags++;
+        } else {
+            rc_dec(tag);
+        }
+    }
+
+    pdebug(DEBUG_DETAIL, "Flushing %d tags.", num_tags);
+
+    rc = run_many(tag_list, status_list, num_tags, 0, timeout);
+
+    for(int i=0; i < num_tags; i++) {
+        rc_dec(tag_list[i]);
+    }
+
+    mem_free(tag_list);
+    mem_free(status_list);
+
+    return rc;
+}
+
+
+
+/*
+ * Wake up any API calls waiting on a tag.  Only this tag's waiters are
+ * woken.
+ */
+
+void plc_tag_wake_waiters(plc_tag_p tag)
+{
+    if(tag && tag->io_cond) {
+        cond_signal(tag->io_cond);
+    }
+}
+
+
+
+/*
+ * Get the tickler thread to look at one tag.  This also wakes up any API
+ * calls waiting on the tag.
+ *
+ * The protocol layers call this when a response for the tag comes in.  This
+ * may be called with the tag API mutex held.
+ */
+
+void plc_tag_wake_tag(int32_t tag_id)
+{
+    if(tag_id > 0 && tag_shard_map) {
+        struct tickler_shard_t *shard = &tickler_shards[tag_shard_map[slot_table_id_index(tag_id)]];
+
+        critical_block(shard->mutex) {
+            tag_id_list_add(&shard->ready, tag_id);
+        }
+
+        cond_signal(shard->cond);
+    }
+
+    if(tag_id > 0 && tags) {
+        /* the tag may be gone already, so look it up quietly. */
+        plc_tag_p tag = slot_table_get(tags, tag_id);
+
+        plc_tag_wake_waiters(tag);
+
+        rc_dec(tag);
+    }
+}
+
+
+
+/*
+ * Have the tickler look at the tag at the given time.  The tag keeps the
+ * time of its earliest pending timer so that most calls do not add one.
+ * Timers that turn out not to be needed just cause an extra look.
+ */
+
+void schedule_tag(plc_tag_p tag, int64_t due)
+{
+    struct tickler_shard_t *shard = &tickler_shards[tag->tickler_shard];
+    int64_t now = time_ms();
+
+    critical_block(shard->mutex) {
+        if(tag->tickler_due <= now || due < tag->tickler_due) {
+            if(timer_heap_push(shard->timers, due, tag->tag_id) == PLCTAG_STATUS_OK) {
+                tag->tickler_due = due;
             }
         }
+    }
+}
+
+
+
+int tag_id_list_add(struct tag_id_list_t *list, int32_t tag_id)
+{
+    if(list->count >= list->capacity) {
+        int new_capacity = (list->capacity ? list->capacity * 2 : TAG_ID_LIST_MIN_CAPACITY);
+        int32_t *new_ids = (int32_t *)mem_realloc(list->ids, new_capacity * (int)sizeof(int32_t));
+
+        if(!new_ids) {
+            pdebug(DEBUG_ERROR, "Unable to grow tag ID list!");
+            return PLCTAG_ERR_NO_MEM;
+        }
+
+        list->ids = new_ids;
+        list->capacity = new_capacity;
+    }
+
+    list->ids[list->count++] = tag_id;
+
+    return PLCTAG_STATUS_OK;
+}
+
+
+
+void tag_id_list_clear(struct tag_id_list_t *list)
+{
+    if(list->ids) {
+        mem_free(list->ids);
+    }
+
+    list->ids = NULL;
+    list->count = 0;
+    list->capacity = 0;
+}
+
+
+
+/*
+ * Mark the tag as changed locally so that the automatic write picks it up.
+ *
+ * This must be called with the tag API mutex held.
+ */
+
+void mark_tag_dirty(plc_tag_p tag)
+{
+    if(!tag->tag_is_dirty) {
+        tag->tag_is_dirty = 1;
+
+        /* get the tickler thread to schedule the write. */
+        if(tag->auto_sync_write_ms > 0) {
+            plc_tag_wake_tag(tag->tag_id);
+        }
+    }
+}
 
-        /* What is the string maximum capacity */
-        if(attr_get_str(attribs, "str_max_capacity", NULL)) {
-            str_param = attr_get_int(attribs, "str_max_capacity", 0);
-            if(str_param >= 0) {
-                tag->byte_order->str_max_capacity = (unsigned int)str_param;
+
+
+/*
+ * Copy raw bytes out of the tag data.
+ *
+ * Double buffered tags are read from the published snapshot without taking
+ * the API mutex.  All other tags are read from the data buffer under the
+ * API mutex.
+ */
+
+int copy_tag_data(plc_tag_p tag, int offset, uint8_t *buffer, int length)
+{
+    int rc = PLCTAG_STATUS_OK;
+
+    if(tag->snapshot) {
+        rc = tag_snapshot_read(tag, offset, buffer, length);
+    } else {
+        critical_block(tag->api_mutex) {
+            if((offset >= 0) && (offset <= tag->size) && (length <= (tag->size - offset))) {
+                mem_copy(buffer, tag->data + offset, length);
             } else {
-                pdebug(DEBUG_WARN, "Tag string attribute str_max_capacity must be missing, 0, or positive!");
-                return PLCTAG_ERR_BAD_PARAM;
+                rc = PLCTAG_ERR_OUT_OF_BOUNDS;
             }
         }
+    }
 
-        /* What is the string total length */
-        if(attr_get_str(attribs, "str_total_length", NULL)) {
-            str_param = attr_get_int(attribs, "str_total_length", 0);
-            if(str_param >= 0) {
-                tag->byte_order->str_total_length = (unsigned int)str_param;
-            } else {
-                pdebug(DEBUG_WARN, "Tag string attribute str_total_length must be missing, 0, or positive!");
-                return PLCTAG_ERR_BAD_PARAM;
-            }
+    if(rc == PLCTAG_STATUS_OK) {
+        tag->status = PLCTAG_STATUS_OK;
+    } else {
+        pdebug(DEBUG_WARN, "Data offset out of bounds!");
+        tag->status = (int8_t)rc;
+    }
+
+    return rc;
+}
+
+
+
+/*
+ * Double buffered tag data.
+ *
+ * The protocol layers fill tag->data a fragment at a time.  A double
+ * buffered tag also has a snapshot with two copies of the data.  The
+ * copy selected by the low bit of the sequence number is the front buffer
+ * that readers use.
+ *
+ * The snapshot is only changed with the tag API mutex held.  A publish
+ * copies the new bytes into the back buffer, bumps the sequence number to
+ * swap the buffers and then copies the same bytes into the new back buffer
+ * so that the two stay the same between publishes.  Completed reads publish
+ * the whole buffer.  Local writes through the setters publish the bytes
+ * they changed.
+ *
+ * Readers do not lock.  They copy out of the front buffer and then check
+ * that the sequence number did not change.  If it did, the buffer could
+ * have been overwritten under them and they try again.  A reader retries
+ * on any sequence change: even a single publish swaps the buffers and then
+ * copies into the buffer the reader was copying from.
+ *
+ * If the tag data changes size, a new snapshot is allocated and the old
+ * one is retired.  Nothing writes to a retired snapshot so readers still
+ * holding it get consistent, if slightly old, data.  Retired snapshots are
+ * freed when the tag is destroyed.
+ */
+
+struct tag_snapshot_t {
+    volatile uint32_t seq;
+    int32_t size;
+    tag_snapshot_p retired;
+    uint8_t *buffers[2];
+};
+
+
+int tag_snapshot_create(plc_tag_p tag)
+{
+    tag_snapshot_p snapshot = NULL;
+    int32_t size = (tag->data ? tag->size : 0);
+
+    pdebug(DEBUG_DETAIL, "Starting.");
+
+    if(size < 0) {
+        size = 0;
+    }
+
+    snapshot = mem_alloc((int)sizeof(*snapshot) + (2 * size));
+    if(!snapshot) {
+        pdebug(DEBUG_ERROR, "Unable to allocate tag data snapshot!");
+        return PLCTAG_ERR_NO_MEM;
+    }
+
+    snapshot->seq = 0;
+    snapshot->size = size;
+    snapshot->buffers[0] = (uint8_t *)(snapshot + 1);
+    snapshot->buffers[1] = snapshot->buffers[0] + size;
+
+    if(size > 0) {
+        mem_copy(snapshot->buffers[0], tag->data, size);
+        mem_copy(snapshot->buffers[1], tag->data, size);
+    }
+
+    snapshot->retired = tag->snapshot;
+
+    /* make sure the contents are visible before the pointer. */
+    atomic_fence();
+
+    tag->snapshot = snapshot;
+
+    pdebug(DEBUG_DETAIL, "Done.");
+
+    return PLCTAG_STATUS_OK;
+}
+
+
+void tag_snapshot_publish(plc_tag_p tag, int offset, int length)
+{
+    tag_snapshot_p snapshot = tag->snapshot;
+    uint32_t seq = 0;
+
+    if(!snapshot) {
+        return;
+    }
+
+    /* the size changed, so we need a new snapshot. */
+    if(snapshot->size != (tag->data ? tag->size : 0)) {
+        pdebug(DEBUG_DETAIL, "Tag data size changed from %d to %d bytes.", snapshot->size, tag->size);
+
+        if(tag_snapshot_create(tag) != PLCTAG_STATUS_OK) {
+            pdebug(DEBUG_WARN, "Unable to publish tag data!");
         }
 
-        /* What is the string padding length */
-        if(attr_get_str(attribs, "str_pad_bytes", NULL)) {
-            str_param = attr_get_int(attribs, "str_pad_bytes", 0);
-            if(str_param >= 0) {
-                tag->byte_order->str_pad_bytes = (unsigned int)str_param;
+        return;
+    }
+
+    if(offset < 0 || length <= 0 || offset >= snapshot->size) {
+        return;
+    }
+
+    if(length > snapshot->size - offset) {
+        length = snapshot->size - offset;
+    }
+
+    seq = snapshot->seq;
+
+    /* fill the back buffer. */
+    mem_copy(snapshot->buffers[(seq + 1) & 1] + offset, tag->data + offset, length);
+
+    /* swap. */
+    atomic_fence();
+    snapshot->seq = seq + 1;
+    atomic_fence();
+
+    /* bring the old front buffer up to date. */
+    mem_copy(snapshot->buffers[seq & 1] + offset, tag->data + offset, length);
+}
+
+
+int tag_snapshot_read(plc_tag_p tag, int offset, uint8_t *buffer, int length)
+{
+    while(1) {
+        tag_snapshot_p snapshot = tag->snapshot;
+        uint32_t seq = 0;
+
+        atomic_fence();
+
+        seq = snapshot->seq;
+
+        atomic_fence();
+
+        if((offset < 0) || (offset > snapshot->size) || (length > (snapshot->size - offset))) {
+            return PLCTAG_ERR_OUT_OF_BOUNDS;
+        }
+
+        mem_copy(buffer, snapshot->buffers[seq & 1] + offset, length);
+
+        atomic_fence();
+
+        if(snapshot->seq == seq) {
+            return PLCTAG_STATUS_OK;
+        }
+
+        pdebug(DEBUG_SPEW, "Snapshot changed during copy, retrying.");
+    }
+}
+
+
+
+/*
+ * Change detection.
+ *
+ * The tag keeps a copy of its data as of the last change.  When a read
+ * completes, the new data is compared with the copy.  Almost every read
+ * finds the same data, so the whole buffer is compared first.
+ *
+ * With deadbands, the data is treated as REAL or LREAL elements.  An
+ * element only counts as changed when it moves past all the deadbands
+ * that are set, measured from its value at its last change.  Only the
+ * elements that changed are copied so that slow drift still shows up
+ * once it adds up.
+ */
+
+int tag_change_create(plc_tag_p tag, attr attribs)
+{
+    tag_change_p change = NULL;
+    int enabled = attr_get_int(attribs, "change_detect", 0);
+    double deadband = (double)attr_get_float(attribs, "change_deadband", 0.0f);
+    double deadband_pct = (double)attr_get_float(attribs, "change_deadband_pct", 0.0f);
+    const char *deadband_type = attr_get_str(attribs, "change_deadband_type", "real");
+    int float_size = 0;
+
+    pdebug(DEBUG_DETAIL, "Starting.");
+
+    if(deadband < 0.0 || deadband_pct < 0.0) {
+        pdebug(DEBUG_WARN, "Change deadbands must not be negative!");
+        return PLCTAG_ERR_BAD_PARAM;
+    }
+
+    if(str_cmp_i(deadband_type, "real") == 0) {
+        float_size = (int)sizeof(float);
+    } else if(str_cmp_i(deadband_type, "lreal") == 0) {
+        float_size = (int)sizeof(double);
+    } else {
+        pdebug(DEBUG_WARN, "Change deadband type must be \"real\" or \"lreal\"!");
+        return PLCTAG_ERR_BAD_PARAM;
+    }
+
+    /* a deadband turns change detection on. */
+    if(deadband > 0.0 || deadband_pct > 0.0) {
+        enabled = 1;
+    } else {
+        float_size = 0;
+    }
+
+    if(!enabled) {
+        pdebug(DEBUG_DETAIL, "Done.");
+        return PLCTAG_STATUS_OK;
+    }
+
+    change = (tag_change_p)mem_alloc((int)sizeof(*change));
+    if(!change) {
+        pdebug(DEBUG_ERROR, "Unable to allocate change detection data!");
+        return PLCTAG_ERR_NO_MEM;
+    }
+
+    change->report = 1;
+    change->float_size = float_size;
+    change->deadband = deadband;
+    change->deadband_pct = deadband_pct;
+
+    tag->change = change;
+
+    pdebug(DEBUG_DETAIL, "Done.");
+
+    return PLCTAG_STATUS_OK;
+}
+
+
+
+/*
+ * Compare the data from a read that just finished with the data as of the
+ * last change.  Returns non-zero if it changed.  The change is kept until
+ * it is taken with tag_change_take_unsafe().
+ *
+ * This must be called with the tag API mutex held.
+ */
+
+int tag_change_check_unsafe(plc_tag_p tag)
+{
+    tag_change_p change = tag->change;
+    int elem_size = 0;
+    int changed = 0;
+
+    if(!change || !tag->data || tag->size <= 0) {
+        return 0;
+    }
+
+    /* some protocols only know the element size after the first read. */
+    if(change->float_size) {
+        elem_size = change->float_size;
+    } else if(tag->vtable->get_int_attrib) {
+        elem_size = tag->vtable->get_int_attrib(tag, "elem_size", 1);
+    }
+
+    if(elem_size <= 0) {
+        elem_size = 1;
+    }
+
+    if(change->size != tag->size || change->elem_size != elem_size) {
+        /* the first read, or the tag changed shape.  Either way it is all new data. */
+        int elem_count = (tag->size + elem_size - 1) / elem_size;
+        uint8_t *new_last = (uint8_t *)mem_realloc(change->last, tag->size);
+        uint8_t *new_bits = NULL;
+
+        if(!new_last) {
+            pdebug(DEBUG_ERROR, "Unable to allocate change detection buffer!");
+            return 0;
+        }
+
+        change->last = new_last;
+
+        new_bits = (uint8_t *)mem_realloc(change->changed_bits, (elem_count + 7) / 8);
+        if(!new_bits) {
+            pdebug(DEBUG_ERROR, "Unable to allocate changed element bits!");
+            return 0;
+        }
+
+        change->changed_bits = new_bits;
+        change->size = tag->size;
+        change->elem_size = elem_size;
+        change->elem_count = elem_count;
+        mem_copy(change->last, tag->data, tag->size);
+
+        mem_set(change->changed_bits, 0, (elem_count + 7) / 8);
+        for(int i=0; i < elem_count; i++) {
+            change->changed_bits[i / 8] |= (uint8_t)(1 << (i % 8));
+        }
+
+        change->num_changed = elem_count;
+    } else {
+        mem_set(change->changed_bits, 0, (change->elem_count + 7) / 8);
+        change->num_changed = 0;
+
+        /* almost every read finds the same data. */
+        if(mem_cmp(change->last, change->size, tag->data, tag->size) != 0) {
+            if(change->float_size) {
+                change->num_changed = tag_change_check_deadbands(tag);
             } else {
-                pdebug(DEBUG_WARN, "Tag string attribute str_pad_bytes must be missing, 0, or positive!");
-                return PLCTAG_ERR_BAD_PARAM;
+                change->num_changed = tag_change_check_elements(tag);
             }
         }
+    }
 
-        /* now make sure that the combination of settings works. */
+    changed = (change->num_changed > 0);
 
-        /* if we have a counted string, we need the count! */
-        if(tag->byte_order->str_is_counted) {
-            if(tag->byte_order->str_count_word_bytes == 0) {
-                pdebug(DEBUG_WARN, "If a string definition is counted, you must use both \"str_is_counted\" and \"str_count_word_bytes\" parameters!");
-                return PLCTAG_ERR_BAD_PARAM;
-            }
+    if(changed) {
+        change->is_changed = 1;
+    }
+
+    return changed;
+}
+
+
+
+/* This must be called with the tag API mutex held. */
+int tag_change_take_unsafe(plc_tag_p tag)
+{
+    int changed = 0;
+
+    if(tag->change) {
+        changed = (tag->change->is_changed && tag->change->report);
+        tag->change->is_changed = 0;
+    }
+
+    return changed;
+}
+
+
+
+/*
+ * Turn on change detection if it is not on already.  If report is set,
+ * changes are reported as events.  Any deadbands are kept.
+ *
+ * This must be called with the tag API mutex held.
+ */
+
+int tag_change_enable_unsafe(plc_tag_p tag, int report)
+{
+    if(!tag->change) {
+        tag->change = (tag_change_p)mem_alloc((int)sizeof(*(tag->change)));
+
+        if(!tag->change) {
+            pdebug(DEBUG_ERROR, "Unable to allocate change detection data!");
+            return PLCTAG_ERR_NO_MEM;
         }
+    }
 
-        /* if we have a fixed length string, we need to know what the length is! */
-        if(tag->byte_order->str_is_fixed_length) {
-            if(tag->byte_order->str_total_length == 0) {
-                pdebug(DEBUG_WARN, "If a string definition is fixed length, you must use both \"str_is_fixed_length\" and \"str_total_length\" parameters!");
-                return PLCTAG_ERR_BAD_PARAM;
+    if(report) {
+        tag->change->report = 1;
+    }
+
+    return PLCTAG_STATUS_OK;
+}
+
+
+
+/*
+ * Adjust the period of adaptive automatic reads after an automatic read.
+ *
+ * Each read that finds no change doubles the period as long as it stays
+ * within auto_sync_read_max_ms.  A change drops the period back to
+ * auto_sync_read_ms and pulls the next read in.  The periods stay whole
+ * multiples of auto_sync_read_ms so that the reads keep their planned
+ * phase.
+ *
+ * This must be called with the tag API mutex held.
+ */
+
+void adapt_auto_sync_read_unsafe(plc_tag_p tag, int changed)
+{
+    int32_t min_ms = tag->auto_sync_read_ms;
+    int32_t max_ms = tag->auto_sync_read_max_ms;
+    int32_t cur_ms = tag->auto_sync_read_cur_ms;
+
+    if(max_ms <= min_ms) {
+        tag->auto_sync_read_cur_ms = 0;
+        return;
+    }
+
+    if(cur_ms < min_ms) {
+        cur_ms = min_ms;
+    }
+
+    if(changed) {
+        if(cur_ms > min_ms) {
+            int64_t current_time = time_ms();
+            int64_t next_read = (((current_time - tag->auto_sync_phase_ms) / min_ms) + 1) * min_ms + tag->auto_sync_phase_ms;
+
+            if(next_read < tag->auto_sync_next_read) {
+                tag->auto_sync_next_read = next_read;
             }
-        }
 
-        /* check the total length. */
-        if(tag->byte_order->str_total_length > 0
-          && (tag->byte_order->str_is_zero_terminated
-            + tag->byte_order->str_max_capacity
-            + tag->byte_order->str_count_word_bytes
-            + tag->byte_order->str_pad_bytes)
-          > tag->byte_order->str_total_length)
-        {
-            pdebug(DEBUG_WARN, "Tag string total length must be at least the sum of the other string components!");
-            return PLCTAG_ERR_BAD_PARAM;
+            pdebug(DEBUG_DETAIL, "Data changed, reading every %dms again.", min_ms);
         }
 
-        /* Do we have enough of a definition for a string? */
-        /* FIXME - This is probably not enough checking! */
-        if(tag->byte_order->str_is_counted || tag->byte_order->str_is_zero_terminated) {
-            tag->byte_order->str_is_defined = 1;
-        } else {
-            pdebug(DEBUG_WARN, "Insufficient definitions found to support strings!");
+        cur_ms = min_ms;
+    } else if(cur_ms <= max_ms / 2) {
+        cur_ms *= 2;
+
+        pdebug(DEBUG_DETAIL, "Data did not change, slowing down to reading every %dms.", cur_ms);
+    }
+
+    tag->auto_sync_read_cur_ms = cur_ms;
+}
+
+
+
+/*
+ * Find the elements that are different and copy them.  Whole blocks are
+ * compared first and most of them are usually the same.
+ *
+ * Returns the number of elements that changed.
+ */
+
+int tag_change_check_elements(plc_tag_p tag)
+{
+    tag_change_p change = tag->change;
+    int elem_size = change->elem_size;
+    int block_size = elem_size * TAG_CHANGE_BLOCK_ELEMS;
+    int num_changed = 0;
+
+    for(int block_offset = 0; block_offset < change->size; block_offset += block_size) {
+        int block_len = (block_offset + block_size <= change->size ? block_size : change->size - block_offset);
+
+        if(mem_cmp(change->last + block_offset, block_len, tag->data + block_offset, block_len) == 0) {
+            continue;
         }
-    }
 
-    pdebug(DEBUG_INFO, "Done.");
+        for(int offset = block_offset; offset < block_offset + block_len; offset += elem_size) {
+            int len = (offset + elem_size <= change->size ? elem_size : change->size - offset);
+            int index = offset / elem_size;
 
-    return PLCTAG_STATUS_OK;
+            if(mem_cmp(change->last + offset, len, tag->data + offset, len) != 0) {
+                change->changed_bits[index / 8] |= (uint8_t)(1 << (index % 8));
+                num_changed++;
+            }
+        }
+
+        mem_copy(change->last + block_offset, tag->data + block_offset, block_len);
+    }
+
+    return num_changed;
 }
 
-int check_byte_order_str(const char *byte_order, int length)
+
+
+/* Returns the number of elements that moved past the deadbands. */
+int tag_change_check_deadbands(plc_tag_p tag)
 {
-    int taken[8] = {0, 0, 0, 0, 0, 0, 0, 0};
-    int byte_order_len = str_length(byte_order);
+    tag_change_p change = tag->change;
+    int float_size = change->float_size;
+    int num_changed = 0;
+    int offset = 0;
+
+    for(offset = 0; offset + float_size <= change->size; offset += float_size) {
+        uint8_t *old_raw = change->last + offset;
+        uint8_t *new_raw = tag->data + offset;
+        double old_val = 0.0;
+        double new_val = 0.0;
+
+        if(float_size == (int)sizeof(float)) {
+            uint32_t old_bits = (uint32_t)tag->float32_kernel.get(old_raw, tag->float32_kernel.order);
+            uint32_t new_bits = (uint32_t)tag->float32_kernel.get(new_raw, tag->float32_kernel.order);
+            float old_float = 0.0f;
+            float new_float = 0.0f;
+
+            if(old_bits == new_bits) {
+                continue;
+            }
 
-    pdebug(DEBUG_DETAIL, "Starting.");
+            mem_copy(&old_float, &old_bits, (int)sizeof(old_float));
+            mem_copy(&new_float, &new_bits, (int)sizeof(new_float));
 
-    /* check the size. */
-    if(byte_order_len != length) {
-        pdebug(DEBUG_WARN, "Byte order string, \"%s\", must be %d characters long!", byte_order, length);
-        return (byte_order_len < length ? PLCTAG_ERR_TOO_SMALL : PLCTAG_ERR_TOO_LARGE);
-    }
+            old_val = (double)old_float;
+            new_val = (double)new_float;
+        } else {
+            uint64_t old_bits = tag->float64_kernel.get(old_raw, tag->float64_kernel.order);
+            uint64_t new_bits = tag->float64_kernel.get(new_raw, tag->float64_kernel.order);
 
-    /* check each character. */
-    for(int i=0; i < byte_order_len; i++) {
-        int val = 0;
+            if(old_bits == new_bits) {
+                continue;
+            }
 
-        if(!isdigit(byte_order[i]) || byte_order[i] < '0' || byte_order[i] > '7') {
-            pdebug(DEBUG_WARN, "Byte order string, \"%s\", must be only characters from '0' to '7'!", byte_order);
-            return PLCTAG_ERR_BAD_DATA;
+            mem_copy(&old_val, &old_bits, (int)sizeof(old_val));
+            mem_copy(&new_val, &new_bits, (int)sizeof(new_val));
         }
 
-        /* get the numeric value. */
-        val = byte_order[i] - '0';
+        if(tag_change_past_deadbands(change, old_val, new_val)) {
+            int index = offset / float_size;
 
-        if(val < 0 || val > (length-1)) {
-            pdebug(DEBUG_WARN, "Byte order string, \"%s\", must only values from 0 to %d!", byte_order, (length - 1));
-            return PLCTAG_ERR_BAD_DATA;
+            mem_copy(old_raw, new_raw, float_size);
+            change->changed_bits[index / 8] |= (uint8_t)(1 << (index % 8));
+            num_changed++;
         }
+    }
 
-        if(taken[val]) {
-            pdebug(DEBUG_WARN, "Byte order string, \"%s\", must use each digit exactly once!", byte_order);
-            return PLCTAG_ERR_BAD_DATA;
-        }
+    /* bytes past the last whole element are compared exactly. */
+    if(offset < change->size && mem_cmp(change->last + offset, change->size - offset, tag->data + offset, change->size - offset) != 0) {
+        int index = offset / float_size;
 
-        taken[val] = 1;
+        mem_copy(change->last + offset, tag->data + offset, change->size - offset);
+        change->changed_bits[index / 8] |= (uint8_t)(1 << (index % 8));
+        num_changed++;
     }
 
-    pdebug(DEBUG_DETAIL, "Done.");
+    return num_changed;
+}
 
-    return PLCTAG_STATUS_OK;
+
+
+int tag_change_past_deadbands(tag_change_p change, double old_val, double new_val)
+{
+    double diff = new_val - old_val;
+
+    /* NaN does not compare, and the bits already differ. */
+    if(old_val != old_val || new_val != new_val) {
+        return 1;
+    }
+
+    if(diff < 0.0) {
+        diff = -diff;
+    }
+
+    if(change->deadband > 0.0 && diff <= change->deadband) {
+        return 0;
+    }
+
+    if(change->deadband_pct > 0.0 && diff <= ((old_val < 0.0 ? -old_val : old_val) * change->deadband_pct) / 100.0) {
+        return 0;
+    }
+
+    return 1;
 }
 
 
+/*
+ * Send an event to the tag's callback and event queue.
+ *
+ * Start events only go to the callback.  This must be called without the
+ * API mutex held.
+ */
+
+void tag_raise_event(plc_tag_p tag, int event, int status)
+{
+    tag_raise_batch_event(tag, event, status, NULL);
+}
+
 
 
-plc_tag_p lookup_tag(int32_t tag_id)
+/*
+ * As above, but events for batch callbacks are added to the batch if
+ * there is one.  Otherwise they are delivered right away.
+ *
+ * The other handles onto a shared tag get the event too, under their own
+ * tag IDs.
+ */
+
+void tag_raise_batch_event(plc_tag_p tag, int event, int status, struct event_batch_t *batch)
 {
-    plc_tag_p tag = NULL;
+    event_queue_p queue = NULL;
+    struct tag_handle_t *others = NULL;
+    int num_others = 0;
 
-    critical_block(tag_lookup_mutex) {
-        tag = hashtable_get(tags, (int64_t)tag_id);
+    /* hold references so that the queues cannot be unbound and freed under us. */
+    if(tag->event_queue || tag->share) {
+        critical_block(tag->api_mutex) {
+            queue = rc_inc(tag->event_queue);
 
-        if(tag) {
-            debug_set_tag_id(tag->tag_id);
-        } else {
-            /* FIXME - remove this. */
-            pdebug(DEBUG_WARN, "Tag with ID %d not found.", tag_id);
-        }
+            if(tag->share) {
+                others = (struct tag_handle_t *)mem_alloc(tag->share->num_handles * (int)sizeof(struct tag_handle_t));
 
-        if(tag && tag->tag_id == tag_id) {
-            pdebug(DEBUG_SPEW, "Found tag %p with id %d.", tag, tag->tag_id);
-            tag = rc_inc(tag);
-        } else {
-            debug_set_tag_id(0);
-            tag = NULL;
+                if(!others) {
+                    pdebug(DEBUG_ERROR, "Unable to allocate memory for shared tag handles!");
+                    break;
+                }
+
+                for(struct tag_handle_t *handle = tag->share->handles; handle; handle = handle->next) {
+                    if(handle->tag_id != tag->tag_id) {
+                        others[num_others] = *handle;
+                        others[num_others].event_queue = rc_inc(handle->event_queue);
+                        num_others++;
+                    }
+                }
+            }
         }
     }
 
-    return tag;
+    deliver_event(tag->tag_id, tag->callback, tag->batch_callback, tag->callback_context, queue, event, status, batch);
+    rc_dec(queue);
+
+    for(int i=0; i < num_others; i++) {
+        deliver_event(others[i].tag_id, others[i].callback, others[i].batch_callback, others[i].callback_context, others[i].event_queue, event, status, batch);
+        rc_dec(others[i].event_queue);
+    }
+
+    if(others) {
+        mem_free(others);
+    }
 }
 
 
 
-int tag_id_inc(int id)
+/*
+ * Send an event to one set of listeners.
+ */
+
+void deliver_event(int32_t tag_id, void (*callback)(int32_t tag_id, int event, int status), plc_tag_batch_callback_t batch_callback, void *callback_context, event_queue_p queue, int event, int status, struct event_batch_t *batch)
 {
-    if(id <= 0) {
-        pdebug(DEBUG_ERROR, "Incoming ID is not valid! Got %d",id);
-        /* try to correct. */
-        id = (TAG_ID_MASK/2);
+    /* start events run directly because the callback may set up the data for the operation. */
+    if(callback) {
+        if(event == PLCTAG_EVENT_READ_STARTED || event == PLCTAG_EVENT_WRITE_STARTED || submit_callback(callback, tag_id, event, status) == PLCTAG_ERR_NOT_FOUND) {
+            callback(tag_id, event, status);
+        }
     }
 
-    id = (id + 1) & TAG_ID_MASK;
+    if(event == PLCTAG_EVENT_READ_STARTED || event == PLCTAG_EVENT_WRITE_STARTED) {
+        return;
+    }
 
-    if(id == 0) {
-        id = 1; /* skip zero intentionally! Can't return an ID of zero because it looks like a NULL pointer */
+    if(batch_callback) {
+        plc_tag_callback_event_t batch_event;
+
+        batch_event.tag_id = tag_id;
+        batch_event.event = event;
+        batch_event.status = status;
+        batch_event.timestamp_ms = time_ms();
+        batch_event.context = callback_context;
+
+        if(batch) {
+            event_batch_add(batch, batch_callback, &batch_event);
+        } else {
+            batch_callback(&batch_event, 1);
+        }
     }
 
-    return id;
+    if(queue) {
+        event_queue_push(queue, tag_id, event, status);
+    }
 }
 
 
 
-int add_tag_lookup(plc_tag_p tag)
-{
-    int rc = PLCTAG_ERR_NOT_FOUND;
-    int new_id = 0;
+/*
+ * Add an event to a batch.  If the batch cannot grow, the events in it are
+ * delivered now to make room.
+ */
 
-    pdebug(DEBUG_DETAIL, "Starting.");
+void event_batch_add(struct event_batch_t *batch, plc_tag_batch_callback_t callback, plc_tag_callback_event_t *event)
+{
+    if(batch->count >= batch->capacity) {
+        int new_capacity = (batch->capacity ? batch->capacity * 2 : EVENT_BATCH_MIN_CAPACITY);
+        plc_tag_batch_callback_t *new_callbacks = (plc_tag_batch_callback_t *)mem_realloc(batch->callbacks, new_capacity * (int)sizeof(*new_callbacks));
+        plc_tag_callback_event_t *new_events = NULL;
+        plc_tag_callback_event_t *new_group = NULL;
+
+        if(new_callbacks) {
+            batch->callbacks = new_callbacks;
+            new_events = (plc_tag_callback_event_t *)mem_realloc(batch->events, new_capacity * (int)sizeof(*new_events));
+        }
 
-    critical_block(tag_lookup_mutex) {
-        int attempts = 0;
+        if(new_events) {
+            batch->events = new_events;
+            new_group = (plc_tag_callback_event_t *)mem_realloc(batch->group, new_capacity * (int)sizeof(*new_group));
+        }
 
-        /* only get this when we hold the mutex. */
-        new_id = next_tag_id;
+        if(new_group) {
+            batch->group = new_group;
+            batch->capacity = new_capacity;
+        } else {
+            pdebug(DEBUG_WARN, "Unable to grow event batch, delivering events early.");
 
-        do {
-            new_id = tag_id_inc(new_id);
+            event_batch_flush(batch);
 
-            if(new_id <=0) {
-                pdebug(DEBUG_WARN,"ID %d is illegal!", new_id);
-                attempts = MAX_TAG_MAP_ATTEMPTS;
-                break;
+            if(batch->count >= batch->capacity) {
+                /* nothing allocated at all. */
+                callback(event, 1);
+                return;
             }
+        }
+    }
 
-            pdebug(DEBUG_SPEW,"Trying new ID %d.", new_id);
+    batch->callbacks[batch->count] = callback;
+    batch->events[batch->count] = *event;
+    batch->count++;
+}
 
-            if(!hashtable_get(tags,(int64_t)new_id)) {
-                pdebug(DEBUG_DETAIL,"Found unused ID %d", new_id);
-                break;
-            }
 
-            attempts++;
-        } while(attempts < MAX_TAG_MAP_ATTEMPTS);
 
-        if(attempts < MAX_TAG_MAP_ATTEMPTS) {
-            rc = hashtable_put(tags, (int64_t)new_id, tag);
-        } else {
-            rc = PLCTAG_ERR_NO_RESOURCES;
+/*
+ * Call each batch callback function once with all of its events.  Events
+ * keep their order.
+ */
+
+void event_batch_flush(struct event_batch_t *batch)
+{
+    while(batch->count > 0) {
+        plc_tag_batch_callback_t callback = batch->callbacks[0];
+        int num_group = 0;
+        int num_left = 0;
+
+        for(int i=0; i < batch->count; i++) {
+            if(batch->callbacks[i] == callback) {
+                batch->group[num_group++] = batch->events[i];
+            } else {
+                batch->callbacks[num_left] = batch->callbacks[i];
+                batch->events[num_left] = batch->events[i];
+                num_left++;
+            }
         }
 
-        next_tag_id = new_id;
+        batch->count = num_left;
+
+        callback(batch->group, num_group);
     }
+}
 
-    if(rc != PLCTAG_STATUS_OK) {
-        new_id = rc;
+
+
+void event_batch_destroy(struct event_batch_t *batch)
+{
+    if(batch->callbacks) {
+        mem_free(batch->callbacks);
     }
 
-    pdebug(DEBUG_DETAIL, "Done.");
+    if(batch->events) {
+        mem_free(batch->events);
+    }
 
-    return new_id;
+    if(batch->group) {
+        mem_free(batch->group);
+    }
+
+    batch->callbacks = NULL;
+    batch->events = NULL;
+    batch->group = NULL;
+    batch->count = 0;
+    batch->capacity = 0;
 }
 
 
 
 /*
- * get the string count length depending on the PLC string type.
+ * Hand a callback to the callback executor.  Returns PLCTAG_ERR_NOT_FOUND if
+ * there is no executor and the callback should be called directly.
  *
- * This is called in other functions so is separated out.
- *
- * This must be called with the tag API mutex held!
+ * The executor mutex is held while submitting so that the executor cannot
+ * be shut down in the middle.  Submitting never waits on a callback.
  */
 
-// int get_string_count_size_unsafe(plc_tag_p tag, int offset)
-// {
-//     int string_count_length = 0;
-//     string_type_t string_type = tag->byte_order.string_type;
+int submit_callback(void (*callback)(int32_t tag_id, int event, int status), int32_t tag_id, int event, int status)
+{
+    int rc = PLCTAG_ERR_NOT_FOUND;
 
-//     /* FIXME - do something with the offset! */
-//     (void)offset;
+    critical_block(callback_executor_mutex) {
+        if(callback_executor) {
+            rc = callback_executor_submit(callback_executor, callback, tag_id, event, status);
+        }
+    }
 
-//     switch(string_type) {
-//         case STRING_AB_MICRO800:
-//             string_count_length = 1; /* FIXME - is this correct? */
-//             break;
+    return rc;
+}
 
-//         case STRING_AB_PLC5:
-//             string_count_length = 2;
-//             break;
 
-//         case STRING_AB_LGX:
-//             string_count_length = 4;
-//             break;
 
-//         case STRING_AB_TAG_NAME:
-//             string_count_length = 2;
-//             break;
+/*
+ * Replace the callback executor.  The old executor, if any, runs the
+ * callbacks it already has before it is released.  Zero threads means
+ * that callbacks are called directly.
+ */
 
-//         case STRING_ZERO_TERM:
-//             string_count_length = 0;
-//             break;
+int set_callback_threads(int num_threads)
+{
+    callback_executor_p new_executor = NULL;
+    callback_executor_p old_executor = NULL;
+    int rc = PLCTAG_STATUS_OK;
 
-//         default:
-//             pdebug(DEBUG_WARN, "Unsupported string type!");
-//             string_count_length = PLCTAG_ERR_UNSUPPORTED;
-//             break;
-//     }
+    pdebug(DEBUG_INFO, "Starting.");
 
-//     return string_count_length;
-// }
+    if(num_threads < 0 || num_threads > CALLBACK_MAX_THREADS) {
+        pdebug(DEBUG_WARN, "Number of callback threads must be between 0 and %d!", CALLBACK_MAX_THREADS);
+        return PLCTAG_ERR_OUT_OF_BOUNDS;
+    }
+
+    /* this can be set before any tags are created. */
+    if((rc = initialize_modules()) != PLCTAG_STATUS_OK) {
+        pdebug(DEBUG_ERROR, "Unable to initialize the library!");
+        return rc;
+    }
+
+    if(num_threads > 0) {
+        new_executor = callback_executor_create(num_threads, callback_queue_size, callback_late_ms);
+        if(!new_executor) {
+            pdebug(DEBUG_WARN, "Unable to create callback executor!");
+            return PLCTAG_ERR_NO_RESOURCES;
+        }
+    }
+
+    critical_block(callback_executor_mutex) {
+        old_executor = callback_executor;
+        callback_executor = new_executor;
+        callback_threads = num_threads;
+    }
+
+    /* this waits for the old executor's threads to finish. */
+    rc_dec(old_executor);
+
+    pdebug(DEBUG_INFO, "Done.");
+
+    return PLCTAG_STATUS_OK;
+}
 
 
 
 /*
- * get the string length depending on the PLC string type.
- *
- * This is called in other functions so is separated out.
- *
- * This must be called with the tag API mutex held!
+ * Called from the protocol tag destructors to release the event queue of
+ * a tag that was not destroyed with plc_tag_destroy().
  */
 
-int get_string_length_unsafe(plc_tag_p tag, int offset)
+void tag_event_queue_release(plc_tag_p tag)
 {
-    int string_length = 0;
-
-    if(tag->byte_order->str_is_counted) {
-        switch(tag->byte_order->str_count_word_bytes) {
-            case 1:
-                string_length = (int)(unsigned int)(tag->data[offset]);
-                break;
+    if(tag->event_queue) {
+        rc_dec(tag->event_queue);
+        tag->event_queue = NULL;
+    }
+}
 
-            case 2:
-                string_length = (int16_t)(uint16_t)(((uint16_t)(tag->data[offset + tag->byte_order->int16_order[0]]) << 0 ) +
-                                                    ((uint16_t)(tag->data[offset + tag->byte_order->int16_order[1]]) << 8 ));
-                break;
 
-            case 4:
-                string_length = (int32_t)(((uint32_t)(tag->data[offset + tag->byte_order->int32_order[0]]) << 0 ) +
-                                          ((uint32_t)(tag->data[offset + tag->byte_order->int32_order[1]]) << 8 ) +
-                                          ((uint32_t)(tag->data[offset + tag->byte_order->int32_order[2]]) << 16) +
-                                          ((uint32_t)(tag->data[offset + tag->byte_order->int32_order[3]]) << 24));
-                break;
 
-            default:
-                pdebug(DEBUG_WARN, "Unsupported string count word size, %d bytes!", tag->byte_order->str_count_word_bytes);
-                return 0; /* FIXME - this should be an error code. */
-                break;
-        }
+/*
+ * Called from the protocol tag destructors and when change detection is
+ * turned off.  The tag API mutex must be held if the tag is still in use.
+ */
 
-    } else {
-        if(tag->byte_order->str_is_zero_terminated) {
-            /* slow, but hopefully correct. */
-            for(int i = offset + (int)(tag->byte_order->str_count_word_bytes); i < tag->size; i++) {
-                size_t char_index = (((size_t)(unsigned int)string_length) ^ (tag->byte_order->str_is_byte_swapped)) /* byte swap if necessary */
-                                + (size_t)(unsigned int)offset
-                                + (size_t)(unsigned int)(tag->byte_order->str_count_word_bytes);
+void tag_change_destroy(plc_tag_p tag)
+{
+    tag_change_p change = tag->change;
 
-                if(tag->data[char_index] == (uint8_t)0) {
-                    /* found the end. */
-                    break;
-                }
+    tag->change = NULL;
 
-                string_length++;
-            }
-        } else {
-            /* it is not counted or zero terminated, so it is not supported. */
-            pdebug(DEBUG_WARN, "Unsupported string length type.   Must be counted or zero-terminated!");
-            return 0; /* FIXME this should be an error code. */
-        }
+    if(change) {
+        mem_free(change->last);
+        mem_free(change->changed_bits);
+        mem_free(change);
     }
+}
 
-    return string_length;
+
+
+/*
+ * Called from the protocol tag destructors.  By then there are no
+ * other references to the tag.
+ */
+
+void tag_snapshot_destroy(plc_tag_p tag)
+{
+    tag_snapshot_p snapshot = tag->snapshot;
+
+    tag->snapshot = NULL;
+
+    while(snapshot) {
+        tag_snapshot_p retired = snapshot->retired;
+
+        mem_free(snapshot);
+
+        snapshot = retired;
+    }
 }
 
 
+
 /*
  * get the string capacity depending on the PLC string type.
  *
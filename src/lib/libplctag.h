@@ -101,6 +101,7 @@ extern "C" {
 #define PLCTAG_ERR_WRITE            (-37)
 #define PLCTAG_ERR_PARTIAL          (-38)
 #define PLCTAG_ERR_BUSY             (-39)
+#define PLCTAG_ERR_TOO_MANY_TAGS    (-40)
 
 
 
@@ -187,12 +188,104 @@ LIB_EXPORT int plc_tag_check_lib_version(int req_major, int req_minor, int req_p
  * the operation was a success.  If the value is less than zero then the
  * tag was not created and the failure error is one of the PLCTAG_ERR_xyz
  * errors.
+ *
+ * At most 131071 tag handles can exist at once.  Each handle onto a shared
+ * tag counts as one.  Past that, creating a tag fails with
+ * PLCTAG_ERR_TOO_MANY_TAGS until some tags are destroyed.
+ *
+ * Tags created with "share=1", or with the library attribute "share_tags" set
+ * to 1, are shared.  Creating a shared tag with the same attributes as one
+ * that already exists, in any order, returns a new handle onto the existing
+ * tag instead of connecting a second one.  read_cache_ms, auto_sync_read_ms,
+ * auto_sync_write_ms and debug are not compared.  Each handle asks for its
+ * own and the tag uses the fastest of them: the shortest automatic periods
+ * and the shortest read cache time.  Handles have their own callbacks and
+ * event queues, but share the tag data, status and operations, so a read,
+ * write or abort through one handle is seen by all.  The tag is destroyed
+ * with its last handle.  "share=0" turns sharing off for one tag.
+ *
+ * Logix tags on the same connection that read overlapping or adjacent
+ * elements of the same array, for example "MyArray[10]" and "MyArray[12]"
+ * with elem_count=5, are read together.  One request covers all of them and
+ * each tag gets its own part of the data.  A read still only returns data
+ * read from the PLC after it was started.  "coalesce=0" makes a tag always
+ * read on its own.
+ *
+ * Logix-class tags created with the same "read_group=<name>" on the same
+ * connection form a read group.  Reading any member reads every member,
+ * with all the requests queued together so that they are packed into as
+ * few packets as possible.  Every member takes its data from that read,
+ * so the members always hold one consistent snapshot.  Members that were
+ * not read themselves pick up the new data the next time the library
+ * looks at them and raise PLCTAG_EVENT_READ_COMPLETED.  The integer
+ * attribute "read_group_seq" is the same for all members that took their
+ * data from the same group read.  Other tag types fail to be created with
+ * PLCTAG_ERR_UNSUPPORTED.
+ *
+ * Logix-class tags can declare their atomic CIP type with "cip_type", either
+ * by name (bool, sint, int, dint, lint, usint, uint, udint, ulint, real,
+ * lreal, byte, word, dword or lword) or by type code, for example
+ * "cip_type=0xCA".  The element size comes from the type.  Such tags are not
+ * read when they are created and their data starts out as zeros, so the
+ * first write goes out at once.  Errors such as a missing tag or a wrong
+ * type show up when the tag is first read or written.  Bit tags, tag
+ * listings and BOOL arrays cannot declare a type.
  */
 
 LIB_EXPORT int32_t plc_tag_create(const char *attrib_str, int timeout);
 
 
 
+/*
+ * plc_tag_create_many
+ *
+ * Create num_tags tags at once, one for each attribute string in
+ * attrib_strs.  This is much faster than calling plc_tag_create() for
+ * each tag when there are many tags.  The connections to all the PLCs are
+ * set up at the same time and the first reads of the tags on the same
+ * connection are packed together.  All the tags share one timeout in
+ * milliseconds.
+ *
+ * The handle of each tag, or the error that stopped it from being
+ * created, is put in the same position in tag_ids.  Tags that are not
+ * ready before the timeout get PLCTAG_ERR_TIMEOUT and are destroyed.
+ * With a zero timeout, the tags are created as if plc_tag_create() had
+ * been called with a zero timeout and their status must be checked with
+ * plc_tag_status().
+ *
+ * PLCTAG_STATUS_OK is returned if every tag was created.  If some were
+ * not, PLCTAG_ERR_PARTIAL is returned.
+ */
+
+LIB_EXPORT int plc_tag_create_many(const char *attrib_strs[], int num_tags, int32_t tag_ids[], int timeout);
+
+
+
+/*
+ * plc_tag_create_template
+ *
+ * Parse an attribute string shared by many tags, for example everything
+ * but the name and element count, into a template.  The template handle
+ * is returned.  If it is less than zero, it is one of the PLCTAG_ERR_xyz
+ * errors.  Template handles are not tag handles.
+ *
+ * plc_tag_create_from_template() creates a tag from the template with
+ * the passed name.  If elem_count is greater than zero, it replaces any
+ * element count in the template.  The timeout and the return value are
+ * the same as for plc_tag_create().  Creating tags this way skips parsing
+ * the attribute string and finding the protocol for every tag, and the
+ * byte order worked out for the first tag is reused by the rest.
+ *
+ * plc_tag_destroy_template() frees the template.  Tags created from it
+ * are not affected.
+ */
+
+LIB_EXPORT int32_t plc_tag_create_template(const char *attrib_str);
+LIB_EXPORT int32_t plc_tag_create_from_template(int32_t template_id, const char *name, int elem_count, int timeout);
+LIB_EXPORT int plc_tag_destroy_template(int32_t template_id);
+
+
+
 /*
  * plc_tag_shutdown
  *
@@ -229,6 +322,7 @@ LIB_EXPORT void plc_tag_shutdown(void);
  *      * a tag write operation ending.
  *      * a tag write being aborted.
  *      * a tag being destroyed
+ *      * a read finding changed data, if the tag has change detection.
  *
  * The callback is called outside of the internal tag mutex so it can call any tag functions safely.   However,
  * the callback is called in the context of the internal tag helper thread and not the client library thread(s).
@@ -238,6 +332,30 @@ LIB_EXPORT void plc_tag_shutdown(void);
  * Do not do any operations in the callback that block for any significant time.   This will cause library
  * performance to be poor or even to start failing!
  *
+ * If the library attribute "callback_threads" is set above zero with plc_tag_set_int_attribute(0, ...),
+ * completion, abort and destroy events are handed to a pool of that many callback threads instead.  Then a
+ * slow callback does not hold up the library.  All of a tag's queued events run in order on one thread, but
+ * they run after the operation has finished and possibly after the API call that caused them has returned.
+ * The start events are still called directly because the callback may need to set up the tag data.  Each
+ * thread has a queue of "callback_queue_size" events (default 1024) and events that do not fit are dropped.
+ * The library attributes "callback_dropped_events" and "callback_late_events" count dropped events and
+ * events that waited longer than "callback_late_ms" (default 100) to run.  The queue size and late time
+ * apply the next time "callback_threads" is set.  Do not change "callback_threads" from inside a callback.
+ *
+ * The library attribute "tickler_threads" (1 to 16, default 1) sets how many threads handle automatic reads
+ * and writes and completion checks.  Tags created afterward are spread over them by gateway and path, so
+ * all the tags for one PLC stay on one thread.  Callbacks for tags on different PLCs may then be called at
+ * the same time from different threads.
+ *
+ * Tags created with "change_detect=1" in the attribute string compare each read with the data as of the
+ * last change.  If it is different, PLCTAG_EVENT_DATA_CHANGED is sent after PLCTAG_EVENT_READ_COMPLETED.
+ * Automatic reads (auto_sync_read_ms) on these tags do not send start events or successful completion
+ * events, only PLCTAG_EVENT_DATA_CHANGED and failed completions.  For REAL data, "change_deadband=x" and
+ * "change_deadband_pct=y" make an element count as changed only if it moved more than x, or more than y
+ * percent of its value at its last change.  If both are set, it must move more than both.  Use
+ * "change_deadband_type=lreal" for LREAL data.  Setting a deadband turns on change detection.  The tag
+ * attribute "change_detect" can also be set to 1 or 0 with plc_tag_set_int_attribute().
+ *
  * When the callback is called with the PLCTAG_EVENT_DESTROY_STARTED, do not call any tag functions.  It is
  * not guaranteed that they will work and they will possibly hang or fail.
  *
@@ -259,10 +377,32 @@ LIB_EXPORT void plc_tag_shutdown(void);
 
 #define PLCTAG_EVENT_DESTROYED          (6)
 
+#define PLCTAG_EVENT_DATA_CHANGED       (7)
+
 LIB_EXPORT int plc_tag_register_callback(int32_t tag_id, void (*tag_callback_func)(int32_t tag_id, int event, int status));
 
 
 
+/*
+ * plc_tag_get_changed_elements
+ *
+ * For a tag with change detection (see plc_tag_register_callback() above), find out which elements the
+ * last completed read changed.  bitmap gets one bit per element, set if the element changed.  Element n
+ * is bit (n % 8) of byte (n / 8).  Elements are the tag's elem_size, or REAL or LREAL if deadbands are set.
+ * After the first read, and after the tag changes size, every element counts as changed.
+ *
+ * bitmap_size is the size of bitmap in bytes.  Any bytes past the ones needed for the elements are cleared.
+ * Pass NULL and zero to only get the count.
+ *
+ * Returns the number of changed elements.  PLCTAG_ERR_UNSUPPORTED is returned if the tag does not have
+ * change detection, PLCTAG_ERR_NO_DATA if no read has completed yet and PLCTAG_ERR_TOO_SMALL if the bitmap
+ * cannot hold a bit for every element.
+ */
+
+LIB_EXPORT int plc_tag_get_changed_elements(int32_t tag_id, uint8_t *bitmap, int bitmap_size);
+
+
+
 
 
 
@@ -275,12 +415,96 @@ LIB_EXPORT int plc_tag_register_callback(int32_t tag_id, void (*tag_callback_fun
  *
  * The function returns PLCTAG_STATUS_OK if there was a registered callback and removing it went well.
  * An error of PLCTAG_ERR_NOT_FOUND is returned if there was no registered callback.
+ *
+ * This also removes a callback registered with plc_tag_register_batch_callback().
  */
 
 LIB_EXPORT int plc_tag_unregister_callback(int32_t tag_id);
 
 
 
+
+/*
+ * plc_tag_register_batch_callback
+ *
+ * This registers a callback that takes an array of events instead of one event per call.  Each
+ * event carries the context pointer that was passed when the callback was registered on that
+ * tag, so the callback does not need to look up its own data from the tag ID.
+ *
+ * Events raised in one pass of the library's helper thread, or by one call to plc_tag_read_many()
+ * or plc_tag_write_many(), are collected and each batch callback function is called once with all
+ * of its events from that pass.  Events for any one tag are in the order they happened.  Events
+ * from other API calls are delivered right away in batches of one.  The events array is only valid
+ * during the call.
+ *
+ * Only completions, aborts and destroy events are sent to batch callbacks.  The start events are
+ * only sent to callbacks registered with plc_tag_register_callback().  Batch callbacks are always
+ * called directly and not on the "callback_threads" pool.
+ *
+ * A tag can have either a batch callback or a regular callback.  If the tag already has either,
+ * PLCTAG_ERR_DUPLICATE is returned.  Use plc_tag_unregister_callback() to remove the callback.
+ */
+
+typedef struct {
+    int32_t tag_id;
+    int event;
+    int status;
+    int64_t timestamp_ms;
+    void *context;
+} plc_tag_callback_event_t;
+
+typedef void (*plc_tag_batch_callback_t)(const plc_tag_callback_event_t *events, int num_events);
+
+LIB_EXPORT int plc_tag_register_batch_callback(int32_t tag_id, plc_tag_batch_callback_t batch_callback_func, void *context);
+
+
+
+
+/*
+ * Event queues
+ *
+ * An event queue collects tag events so that an application with its own event
+ * loop does not need to poll plc_tag_status() or take callbacks on the library's
+ * thread.  Tags are bound to a queue with plc_tag_bind_event_queue().  Completed
+ * reads and writes, aborts and tag destruction are pushed into the queue.  Start
+ * events are only sent to callbacks.
+ *
+ * plc_tag_event_queue_get_fd() returns a handle that is readable while there
+ * are events in the queue.  On POSIX systems this is a file descriptor that can
+ * be used with poll(), epoll etc.  On Windows it is an event HANDLE that can be
+ * used with WaitForMultipleObjects().  Do not read from it or close it.
+ *
+ * plc_tag_event_queue_drain() copies up to max_events events out of the queue
+ * and returns how many were copied.  It does not block.  Only one thread may
+ * drain a queue at a time.  Any number of tags can push into the same queue.
+ *
+ * The queue holds capacity events (rounded up to a power of two, zero picks a
+ * default).  If it fills up, new events are dropped and counted.  The count is
+ * returned by plc_tag_event_queue_get_dropped().
+ *
+ * plc_tag_event_queue_destroy() may be called while tags are still bound.  Those
+ * tags stop sending events.  plc_tag_event_queue_create() returns NULL on error.
+ */
+
+typedef struct event_queue_t *plc_tag_event_queue_t;
+
+typedef struct {
+    int32_t tag_id;
+    int event;
+    int status;
+} plc_tag_event_t;
+
+LIB_EXPORT plc_tag_event_queue_t plc_tag_event_queue_create(int capacity);
+LIB_EXPORT int plc_tag_event_queue_destroy(plc_tag_event_queue_t queue);
+LIB_EXPORT intptr_t plc_tag_event_queue_get_fd(plc_tag_event_queue_t queue);
+LIB_EXPORT int plc_tag_event_queue_drain(plc_tag_event_queue_t queue, plc_tag_event_t *events, int max_events);
+LIB_EXPORT int plc_tag_event_queue_get_dropped(plc_tag_event_queue_t queue);
+
+/* bind the tag to the queue, or unbind it if queue is NULL.  A tag is bound to at most one queue. */
+LIB_EXPORT int plc_tag_bind_event_queue(int32_t tag_id, plc_tag_event_queue_t queue);
+
+
+
 /*
  * plc_tag_register_logger
  *
@@ -391,6 +615,18 @@ LIB_EXPORT int plc_tag_destroy(int32_t tag);
  * If the timeout value is zero, then plc_tag_read will normally return
  * PLCTAG_STATUS_PENDING.
  *
+ * If a read or write is already in flight, for instance an automatic read,
+ * the call waits for it instead of returning PLCTAG_ERR_BUSY.  Concurrent
+ * calls share one read from the PLC as long as that read started after
+ * each call was made, so the data is never older than the call.  Set the
+ * tag attribute "share_reads" to 0 to give every call its own read.  With
+ * a zero timeout, the read is started when the tag is free.
+ *
+ * If the tag attribute "read_cache_stale_ms" is set, cached data that is
+ * past read_cache_ms by less than that is returned right away and one
+ * read is started in the background to refresh it.  plc_tag_status()
+ * reports PLCTAG_STATUS_PENDING until the refresh is done.
+ *
  * This is a function provided by the underlying protocol implementation.
  */
 LIB_EXPORT int plc_tag_read(int32_t tag, int timeout);
@@ -423,6 +659,13 @@ LIB_EXPORT int plc_tag_status(int32_t tag);
  * PLCTAG_STATUS_PENDING.  The write is considered done
  * when it has been written to the socket.
  *
+ * If the tag attribute "write_queue" is set to 1, a write called while a
+ * read or write is in flight waits for it instead of returning
+ * PLCTAG_ERR_BUSY.  Writes called while one is in flight are sent as one
+ * write of the latest tag data when it finishes.  Each call returns the
+ * status of the write that sent its data.  With a zero timeout, the write
+ * is started when the tag is free.
+ *
  * This is a function provided by the underlying protocol implementation.
  */
 LIB_EXPORT int plc_tag_write(int32_t tag, int timeout);
@@ -430,10 +673,63 @@ LIB_EXPORT int plc_tag_write(int32_t tag, int timeout);
 
 
 
+/*
+ * plc_tag_read_many
+ *
+ * Start a read on every tag in the tags array before waiting on any of them.
+ * The requests are queued together so that the protocol layer can pack them
+ * into as few packets as possible.  If the timeout is non-zero, wait until all
+ * of the reads are done or the timeout passes, whichever is first.
+ *
+ * The status of each tag is put into the matching entry of the statuses array
+ * if it is not NULL.  Tags that were still in flight when the timeout passed are
+ * aborted and get PLCTAG_ERR_TIMEOUT.  If the timeout is zero, started tags get
+ * PLCTAG_STATUS_PENDING and must be polled with plc_tag_status().
+ *
+ * A tag that already has an operation in flight gets PLCTAG_ERR_BUSY.
+ *
+ * The return value is PLCTAG_STATUS_OK if every tag succeeded, otherwise it is
+ * the first status that was not OK.
+ */
+LIB_EXPORT int plc_tag_read_many(int32_t *tags, int *statuses, int num_tags, int timeout);
+
+
+
+
+/*
+ * plc_tag_write_many
+ *
+ * The same as plc_tag_read_many() but for writes.
+ *
+ * Tags with automatic writes (auto_sync_write_ms) that have local changes are
+ * written as part of the batch instead of waiting for their automatic write.
+ *
+ * If the tags array is NULL, then every tag with pending automatic writes is
+ * written in one burst.  Use this to flush all changes, for instance before
+ * shutting down.  The statuses array must be NULL in this case.
+ */
+LIB_EXPORT int plc_tag_write_many(int32_t *tags, int *statuses, int num_tags, int timeout);
+
+
+
+
 /*
  * Tag data accessors.
  */
 
+/*
+ * When the library attribute "auto_sync_window_ms" is set above zero, the automatic reads
+ * (auto_sync_read_ms) of the tags for each PLC are planned together.  Reads are moved to
+ * multiples of the window so that reads due close together go out in the same packet.  The
+ * reads for each period are packed into as few packets of "auto_sync_packet_size" bytes
+ * (default 500) as possible and the packets are spread evenly over the period.  The reads
+ * still happen once per period but not at whole multiples of it.
+ *
+ * Tags with "auto_sync_read_max_ms" set above auto_sync_read_ms read less often while their data does
+ * not change.  Each automatic read that finds the same data doubles the read period, as long as it stays
+ * within auto_sync_read_max_ms.  The first change drops it back to auto_sync_read_ms.  The tag attribute
+ * "auto_sync_read_current_ms" gives the current period.
+ */
 
 LIB_EXPORT int plc_tag_get_int_attribute(int32_t tag, const char *attrib_name, int default_value);
 LIB_EXPORT int plc_tag_set_int_attribute(int32_t tag, const char *attrib_name, int new_value);
@@ -481,6 +777,51 @@ LIB_EXPORT int plc_tag_set_float32(int32_t tag, int offset, float val);
 LIB_EXPORT int plc_tag_set_raw_bytes(int32_t id, int offset, uint8_t *buffer, int buffer_length);
 LIB_EXPORT int plc_tag_get_raw_bytes(int32_t id, int offset, uint8_t *buffer, int buffer_length);
 
+/*
+ * Typed array accessors.
+ *
+ * These get or set count elements of the given type starting at the byte
+ * offset in the tag data.  The tag is looked up and locked once for the
+ * whole run and each element is converted with the tag's byte order.
+ * This is much faster than calling the single element functions in a loop.
+ *
+ * The buffer must hold at least count elements.  The whole run must fit
+ * within the tag data or PLCTAG_ERR_OUT_OF_BOUNDS is returned and nothing
+ * is copied.  These are not supported on bit tags.
+ *
+ * Returns PLCTAG_STATUS_OK on success or an error code.
+ */
+
+LIB_EXPORT int plc_tag_get_uint64_array(int32_t tag, int offset, uint64_t *buffer, int count);
+LIB_EXPORT int plc_tag_set_uint64_array(int32_t tag, int offset, const uint64_t *buffer, int count);
+
+LIB_EXPORT int plc_tag_get_int64_array(int32_t tag, int offset, int64_t *buffer, int count);
+LIB_EXPORT int plc_tag_set_int64_array(int32_t tag, int offset, const int64_t *buffer, int count);
+
+LIB_EXPORT int plc_tag_get_uint32_array(int32_t tag, int offset, uint32_t *buffer, int count);
+LIB_EXPORT int plc_tag_set_uint32_array(int32_t tag, int offset, const uint32_t *buffer, int count);
+
+LIB_EXPORT int plc_tag_get_int32_array(int32_t tag, int offset, int32_t *buffer, int count);
+LIB_EXPORT int plc_tag_set_int32_array(int32_t tag, int offset, const int32_t *buffer, int count);
+
+LIB_EXPORT int plc_tag_get_uint16_array(int32_t tag, int offset, uint16_t *buffer, int count);
+LIB_EXPORT int plc_tag_set_uint16_array(int32_t tag, int offset, const uint16_t *buffer, int count);
+
+LIB_EXPORT int plc_tag_get_int16_array(int32_t tag, int offset, int16_t *buffer, int count);
+LIB_EXPORT int plc_tag_set_int16_array(int32_t tag, int offset, const int16_t *buffer, int count);
+
+LIB_EXPORT int plc_tag_get_uint8_array(int32_t tag, int offset, uint8_t *buffer, int count);
+LIB_EXPORT int plc_tag_set_uint8_array(int32_t tag, int offset, const uint8_t *buffer, int count);
+
+LIB_EXPORT int plc_tag_get_int8_array(int32_t tag, int offset, int8_t *buffer, int count);
+LIB_EXPORT int plc_tag_set_int8_array(int32_t tag, int offset, const int8_t *buffer, int count);
+
+LIB_EXPORT int plc_tag_get_float64_array(int32_t tag, int offset, double *buffer, int count);
+LIB_EXPORT int plc_tag_set_float64_array(int32_t tag, int offset, const double *buffer, int count);
+
+LIB_EXPORT int plc_tag_get_float32_array(int32_t tag, int offset, float *buffer, int count);
+LIB_EXPORT int plc_tag_set_float32_array(int32_t tag, int offset, const float *buffer, int count);
+
 /* string accessors */
 
 LIB_EXPORT int plc_tag_get_string(int32_t tag_id, int string_start_offset, char *buffer, int buffer_length);
@@ -489,6 +830,65 @@ LIB_EXPORT int plc_tag_get_string_length(int32_t tag_id, int string_start_offset
 LIB_EXPORT int plc_tag_get_string_capacity(int32_t tag_id, int string_start_offset);
 LIB_EXPORT int plc_tag_get_string_total_length(int32_t tag_id, int string_start_offset);
 
+
+
+/*
+ * Pinned tag handles.
+ *
+ * plc_tag_pin() looks up the tag once and returns an opaque handle that holds
+ * a reference to the tag.  The plc_tag_pinned_* accessors work the same way as
+ * the ID-based accessors above, but they go straight to the tag and do not
+ * look up the tag ID or touch the reference count on each call.  This is meant
+ * for tight loops that decode many values from tags that are already read.
+ *
+ * The handle stays valid until plc_tag_unpin() is called, even if the tag is
+ * destroyed in the meantime.  In that case the accessors still work on the
+ * last data, but no further IO will happen on the tag.  Every call to
+ * plc_tag_pin() must be matched by a call to plc_tag_unpin().
+ *
+ * plc_tag_pin() returns NULL if the tag ID is not found.
+ */
+
+typedef struct plc_tag_t *plc_tag_handle_t;
+
+LIB_EXPORT plc_tag_handle_t plc_tag_pin(int32_t tag_id);
+LIB_EXPORT int plc_tag_unpin(plc_tag_handle_t handle);
+
+LIB_EXPORT int plc_tag_pinned_get_size(plc_tag_handle_t handle);
+
+LIB_EXPORT int plc_tag_pinned_get_bit(plc_tag_handle_t handle, int offset_bit);
+LIB_EXPORT int plc_tag_pinned_set_bit(plc_tag_handle_t handle, int offset_bit, int val);
+
+LIB_EXPORT uint64_t plc_tag_pinned_get_uint64(plc_tag_handle_t handle, int offset);
+LIB_EXPORT int plc_tag_pinned_set_uint64(plc_tag_handle_t handle, int offset, uint64_t val);
+
+LIB_EXPORT int64_t plc_tag_pinned_get_int64(plc_tag_handle_t handle, int offset);
+LIB_EXPORT int plc_tag_pinned_set_int64(plc_tag_handle_t handle, int offset, int64_t val);
+
+LIB_EXPORT uint32_t plc_tag_pinned_get_uint32(plc_tag_handle_t handle, int offset);
+LIB_EXPORT int plc_tag_pinned_set_uint32(plc_tag_handle_t handle, int offset, uint32_t val);
+
+LIB_EXPORT int32_t plc_tag_pinned_get_int32(plc_tag_handle_t handle, int offset);
+LIB_EXPORT int plc_tag_pinned_set_int32(plc_tag_handle_t handle, int offset, int32_t val);
+
+LIB_EXPORT uint16_t plc_tag_pinned_get_uint16(plc_tag_handle_t handle, int offset);
+LIB_EXPORT int plc_tag_pinned_set_uint16(plc_tag_handle_t handle, int offset, uint16_t val);
+
+LIB_EXPORT int16_t plc_tag_pinned_get_int16(plc_tag_handle_t handle, int offset);
+LIB_EXPORT int plc_tag_pinned_set_int16(plc_tag_handle_t handle, int offset, int16_t val);
+
+LIB_EXPORT uint8_t plc_tag_pinned_get_uint8(plc_tag_handle_t handle, int offset);
+LIB_EXPORT int plc_tag_pinned_set_uint8(plc_tag_handle_t handle, int offset, uint8_t val);
+
+LIB_EXPORT int8_t plc_tag_pinned_get_int8(plc_tag_handle_t handle, int offset);
+LIB_EXPORT int plc_tag_pinned_set_int8(plc_tag_handle_t handle, int offset, int8_t val);
+
+LIB_EXPORT double plc_tag_pinned_get_float64(plc_tag_handle_t handle, int offset);
+LIB_EXPORT int plc_tag_pinned_set_float64(plc_tag_handle_t handle, int offset, double val);
+
+LIB_EXPORT float plc_tag_pinned_get_float32(plc_tag_handle_t handle, int offset);
+LIB_EXPORT int plc_tag_pinned_set_float32(plc_tag_handle_t handle, int offset, float val);
+
 #ifdef __cplusplus
 }
 #endif
@@ -38,7 +38,9 @@
 #include <lib/libplctag.h>
 #include <platform.h>
 #include <util/attr.h>
+#include <util/byte_shuffle.h>
 #include <util/debug.h>
+#include <util/event_queue.h>
 
 // #define PLCTAG_CANARY (0xACA7CAFE)
 // #define PLCTAG_DATA_LITTLE_ENDIAN   (0)
@@ -96,6 +98,16 @@ struct tag_byte_order_s {
 typedef struct tag_byte_order_s tag_byte_order_t;
 
 
+/* published copy of the tag data for double buffered tags. */
+typedef struct tag_snapshot_t *tag_snapshot_p;
+
+/* the data as of the last change for tags with change detection. */
+typedef struct tag_change_t *tag_change_p;
+
+/* the handles onto a tag created with the share attribute. */
+typedef struct tag_share_t *tag_share_p;
+
+
 
 
 /*
@@ -103,6 +115,20 @@ typedef struct tag_byte_order_s tag_byte_order_t;
  * by the protocol-specific implementations.
  *
  * The base type only has a vtable for operations.
+ *
+ * The byte order kernels are picked from the byte order tables when the
+ * tag is created.  The accessors use them instead of the tables.
+ *
+ * If the tag is double buffered, the getters read from the snapshot
+ * instead of the data buffer and do not take the API mutex.
+ *
+ * read_gen counts the reads started on the tag and read_gen_done is the
+ * count when the last one finished.  A read call can use any read that
+ * started after it was made.  write_gen and write_gen_done do the same
+ * for writes when the tag queues writes.
+ *
+ * read_refresh is set while a read that refreshes stale cached data is
+ * queued or in flight.
  */
 
 #define TAG_BASE_STRUCT uint8_t is_bit:1; \
@@ -111,22 +137,56 @@ typedef struct tag_byte_order_s tag_byte_order_t;
                         uint8_t read_complete:1; \
                         uint8_t write_in_flight:1; \
                         uint8_t write_complete:1; \
+                        uint8_t read_queued:1; \
+                        uint8_t share_reads:1; \
+                        uint8_t write_queued:1; \
+                        uint8_t write_queue:1; \
+                        uint8_t read_refresh:1; \
                         uint8_t bit; \
+                        uint8_t api_waiting; \
                         int8_t status; \
                         int32_t size; \
                         int32_t tag_id; \
                         int32_t auto_sync_read_ms; \
+                        int32_t auto_sync_read_max_ms; \
+                        int32_t auto_sync_read_cur_ms; \
                         int32_t auto_sync_write_ms; \
+                        int32_t auto_sync_phase_ms; \
+                        int32_t read_gen_status; \
+                        int32_t io_waiters; \
+                        uint32_t read_gen; \
+                        uint32_t read_gen_done; \
+                        int32_t write_gen_status; \
+                        uint32_t write_gen; \
+                        uint32_t write_gen_done; \
                         uint8_t *data; \
+                        tag_snapshot_p volatile snapshot; \
+                        tag_change_p change; \
+                        tag_share_p share; \
                         tag_byte_order_t *byte_order; \
+                        byte_shuffle_kernel_t int16_kernel; \
+                        byte_shuffle_kernel_t int32_kernel; \
+                        byte_shuffle_kernel_t int64_kernel; \
+                        byte_shuffle_kernel_t float32_kernel; \
+                        byte_shuffle_kernel_t float64_kernel; \
                         mutex_p ext_mutex; \
                         mutex_p api_mutex; \
+                        mutex_p io_mutex; \
+                        cond_p io_cond; \
                         tag_vtable_p vtable; \
                         void (*callback)(int32_t tag_id, int event, int status); \
+                        plc_tag_batch_callback_t batch_callback; \
+                        void *callback_context; \
+                        event_queue_p event_queue; \
                         int64_t read_cache_expire; \
                         int64_t read_cache_ms; \
+                        int64_t read_cache_stale_ms; \
                         int64_t auto_sync_next_read; \
-                        int64_t auto_sync_next_write
+                        int64_t auto_sync_next_write; \
+                        int64_t tickler_due; \
+                        uint32_t conn_hash; \
+                        uint8_t tickler_shard; \
+                        uint8_t auto_sync_replan
 
 
 
@@ -143,3 +203,8 @@ extern void lib_teardown(void);
 extern int plc_tag_abort_mapped(plc_tag_p tag);
 extern int plc_tag_destroy_mapped(plc_tag_p tag);
 extern int plc_tag_status_mapped(plc_tag_p tag);
+extern void tag_snapshot_destroy(plc_tag_p tag);
+extern void tag_change_destroy(plc_tag_p tag);
+extern void tag_event_queue_release(plc_tag_p tag);
+extern void plc_tag_wake_waiters(plc_tag_p tag);
+extern void plc_tag_wake_tag(int32_t tag_id);
@@ -52,6 +52,10 @@
 #include <fcntl.h>
 #include <time.h>
 
+#if defined(__linux__)
+    #include <sys/eventfd.h>
+#endif
+
 #include <lib/libplctag.h>
 #include <util/debug.h>
 
@@ -742,6 +746,332 @@ int mutex_destroy(mutex_p *m)
 
 
 
+/***************************************************************************
+ ************************* Condition Variables *****************************
+ **************************************************************************/
+
+struct cond_t {
+    pthread_mutex_t p_mutex;
+    pthread_cond_t p_cond;
+    uint32_t seq;
+    int initialized;
+};
+
+
+int cond_create(cond_p *c)
+{
+    pdebug(DEBUG_DETAIL, "Starting.");
+
+    if(!c) {
+        pdebug(DEBUG_WARN, "null condition variable pointer.");
+        return PLCTAG_ERR_NULL_PTR;
+    }
+
+    if(*c) {
+        pdebug(DEBUG_WARN, "Called with non-NULL pointer!");
+    }
+
+    *c = (struct cond_t *)mem_alloc(sizeof(struct cond_t));
+    if(! *c) {
+        pdebug(DEBUG_ERROR, "Unable to allocate condition variable!");
+        return PLCTAG_ERR_NO_MEM;
+    }
+
+    if(pthread_mutex_init(&((*c)->p_mutex), NULL)) {
+        mem_free(*c);
+        *c = NULL;
+        pdebug(DEBUG_ERROR, "Error initializing condition variable mutex.");
+        return PLCTAG_ERR_MUTEX_INIT;
+    }
+
+    if(pthread_cond_init(&((*c)->p_cond), NULL)) {
+        pthread_mutex_destroy(&((*c)->p_mutex));
+        mem_free(*c);
+        *c = NULL;
+        pdebug(DEBUG_ERROR, "Error initializing condition variable.");
+        return PLCTAG_ERR_MUTEX_INIT;
+    }
+
+    (*c)->initialized = 1;
+
+    pdebug(DEBUG_DETAIL, "Done creating condition variable %p.", *c);
+
+    return PLCTAG_STATUS_OK;
+}
+
+
+uint32_t cond_seq(cond_p c)
+{
+    uint32_t seq = 0;
+
+    if(!c || !c->initialized) {
+        return 0;
+    }
+
+    pthread_mutex_lock(&(c->p_mutex));
+    seq = c->seq;
+    pthread_mutex_unlock(&(c->p_mutex));
+
+    return seq;
+}
+
+
+int cond_wait_impl(const char *func, int line_num, cond_p c, uint32_t *seq, int timeout_ms)
+{
+    int rc = PLCTAG_STATUS_OK;
+    struct timeval now;
+    struct timespec deadline;
+
+    pdebug(DEBUG_SPEW, "waiting on condition variable %p, called from %s:%d.", c, func, line_num);
+
+    if(!c || !seq) {
+        pdebug(DEBUG_WARN, "null condition variable or sequence pointer.");
+        return PLCTAG_ERR_NULL_PTR;
+    }
+
+    if(!c->initialized) {
+        return PLCTAG_ERR_MUTEX_INIT;
+    }
+
+    if(timeout_ms < 0) {
+        pdebug(DEBUG_WARN, "called with negative timeout %d!", timeout_ms);
+        return PLCTAG_ERR_BAD_PARAM;
+    }
+
+    gettimeofday(&now, NULL);
+
+    deadline.tv_sec = now.tv_sec + (timeout_ms / 1000);
+    deadline.tv_nsec = ((long)now.tv_usec * 1000) + ((long)(timeout_ms % 1000) * 1000000);
+
+    if(deadline.tv_nsec >= 1000000000) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000;
+    }
+
+    pthread_mutex_lock(&(c->p_mutex));
+
+    while(c->seq == *seq) {
+        int wait_rc = pthread_cond_timedwait(&(c->p_cond), &(c->p_mutex), &deadline);
+
+        if(wait_rc == ETIMEDOUT) {
+            break;
+        } else if(wait_rc) {
+            pdebug(DEBUG_WARN, "Error %d waiting on condition variable!", wait_rc);
+            rc = PLCTAG_ERR_MUTEX_LOCK;
+            break;
+        }
+    }
+
+    if(rc == PLCTAG_STATUS_OK && c->seq == *seq) {
+        rc = PLCTAG_ERR_TIMEOUT;
+    }
+
+    *seq = c->seq;
+
+    pthread_mutex_unlock(&(c->p_mutex));
+
+    return rc;
+}
+
+
+int cond_signal_impl(const char *func, int line_num, cond_p c)
+{
+    pdebug(DEBUG_SPEW, "signaling condition variable %p, called from %s:%d.", c, func, line_num);
+
+    if(!c) {
+        pdebug(DEBUG_WARN, "null condition variable pointer.");
+        return PLCTAG_ERR_NULL_PTR;
+    }
+
+    if(!c->initialized) {
+        return PLCTAG_ERR_MUTEX_INIT;
+    }
+
+    pthread_mutex_lock(&(c->p_mutex));
+    c->seq++;
+    pthread_cond_broadcast(&(c->p_cond));
+    pthread_mutex_unlock(&(c->p_mutex));
+
+    return PLCTAG_STATUS_OK;
+}
+
+
+int cond_destroy(cond_p *c)
+{
+    pdebug(DEBUG_DETAIL, "Starting to destroy condition variable %p.", c);
+
+    if(!c || !*c) {
+        pdebug(DEBUG_WARN, "null condition variable pointer.");
+        return PLCTAG_ERR_NULL_PTR;
+    }
+
+    pthread_cond_destroy(&((*c)->p_cond));
+    pthread_mutex_destroy(&((*c)->p_mutex));
+
+    mem_free(*c);
+
+    *c = NULL;
+
+    pdebug(DEBUG_DETAIL, "Done.");
+
+    return PLCTAG_STATUS_OK;
+}
+
+
+
+
+/***************************************************************************
+ ******************************* Notifiers *********************************
+ **************************************************************************/
+
+/*
+ * Linux has eventfd which is a single file descriptor.  Everything else
+ * uses both ends of a non-blocking pipe.
+ */
+
+struct notifier_t {
+    int read_fd;
+    int write_fd;
+};
+
+
+int notifier_create(notifier_p *n)
+{
+    pdebug(DEBUG_DETAIL, "Starting.");
+
+    if(!n) {
+        pdebug(DEBUG_WARN, "null notifier pointer.");
+        return PLCTAG_ERR_NULL_PTR;
+    }
+
+    *n = (struct notifier_t *)mem_alloc(sizeof(struct notifier_t));
+    if(! *n) {
+        pdebug(DEBUG_ERROR, "Unable to allocate notifier!");
+        return PLCTAG_ERR_NO_MEM;
+    }
+
+#if defined(__linux__)
+    (*n)->read_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    (*n)->write_fd = (*n)->read_fd;
+
+    if((*n)->read_fd < 0) {
+        pdebug(DEBUG_ERROR, "Unable to create eventfd, errno=%d!", errno);
+        mem_free(*n);
+        *n = NULL;
+        return PLCTAG_ERR_CREATE;
+    }
+#else
+    {
+        int fds[2];
+
+        if(pipe(fds)) {
+            pdebug(DEBUG_ERROR, "Unable to create pipe, errno=%d!", errno);
+            mem_free(*n);
+            *n = NULL;
+            return PLCTAG_ERR_CREATE;
+        }
+
+        for(int i=0; i < 2; i++) {
+            fcntl(fds[i], F_SETFL, fcntl(fds[i], F_GETFL, 0) | O_NONBLOCK);
+            fcntl(fds[i], F_SETFD, FD_CLOEXEC);
+        }
+
+        (*n)->read_fd = fds[0];
+        (*n)->write_fd = fds[1];
+    }
+#endif
+
+    pdebug(DEBUG_DETAIL, "Done creating notifier %p with fd %d.", *n, (*n)->read_fd);
+
+    return PLCTAG_STATUS_OK;
+}
+
+
+intptr_t notifier_get_handle(notifier_p n)
+{
+    if(!n) {
+        pdebug(DEBUG_WARN, "null notifier pointer.");
+        return PLCTAG_ERR_NULL_PTR;
+    }
+
+    return (intptr_t)n->read_fd;
+}
+
+
+int notifier_signal(notifier_p n)
+{
+    ssize_t rc = 0;
+
+    if(!n) {
+        pdebug(DEBUG_WARN, "null notifier pointer.");
+        return PLCTAG_ERR_NULL_PTR;
+    }
+
+#if defined(__linux__)
+    {
+        uint64_t one = 1;
+        rc = write(n->write_fd, &one, sizeof(one));
+    }
+#else
+    {
+        uint8_t one = 1;
+        rc = write(n->write_fd, &one, sizeof(one));
+    }
+#endif
+
+    /* a full pipe or counter is still readable, so that is fine. */
+    if(rc < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+        pdebug(DEBUG_WARN, "Unable to signal notifier, errno=%d!", errno);
+        return PLCTAG_ERR_WRITE;
+    }
+
+    return PLCTAG_STATUS_OK;
+}
+
+
+int notifier_clear(notifier_p n)
+{
+    uint64_t buf[8];
+
+    if(!n) {
+        pdebug(DEBUG_WARN, "null notifier pointer.");
+        return PLCTAG_ERR_NULL_PTR;
+    }
+
+    /* read until there is nothing left. */
+    while(read(n->read_fd, buf, sizeof(buf)) > 0) { }
+
+    return PLCTAG_STATUS_OK;
+}
+
+
+int notifier_destroy(notifier_p *n)
+{
+    pdebug(DEBUG_DETAIL, "Starting.");
+
+    if(!n || !*n) {
+        pdebug(DEBUG_WARN, "null notifier pointer.");
+        return PLCTAG_ERR_NULL_PTR;
+    }
+
+    if((*n)->write_fd != (*n)->read_fd) {
+        close((*n)->write_fd);
+    }
+
+    close((*n)->read_fd);
+
+    mem_free(*n);
+
+    *n = NULL;
+
+    pdebug(DEBUG_DETAIL, "Done.");
+
+    return PLCTAG_STATUS_OK;
+}
+
+
+
+
 /***************************************************************************
  ******************************* Threads ***********************************
  **************************************************************************/
@@ -933,6 +1263,57 @@ extern void lock_release(lock_t *lock)
 }
 
 
+/*
+ * atomic_ptr_cas
+ *
+ * Atomically replace the pointer at ptr with new_val if it currently
+ * holds old_val.  Returns the value that was in ptr before the call.
+ * If that is old_val, the swap happened.
+ */
+
+extern void *atomic_ptr_cas(void * volatile *ptr, void *old_val, void *new_val)
+{
+    return __sync_val_compare_and_swap(ptr, old_val, new_val);
+}
+
+
+/*
+ * atomic_int32_add
+ *
+ * Atomically add delta to the value and return the new value.
+ */
+
+extern int32_t atomic_int32_add(volatile int32_t *val, int32_t delta)
+{
+    return __sync_add_and_fetch(val, delta);
+}
+
+
+/*
+ * atomic_int32_cas
+ *
+ * Atomically replace the value with new_val if it currently holds old_val.
+ * Returns the value before the call.  If that is old_val, the swap happened.
+ */
+
+extern int32_t atomic_int32_cas(volatile int32_t *val, int32_t old_val, int32_t new_val)
+{
+    return __sync_val_compare_and_swap(val, old_val, new_val);
+}
+
+
+/*
+ * atomic_fence
+ *
+ * Full memory barrier.  Loads and stores are not moved across it.
+ */
+
+extern void atomic_fence(void)
+{
+    __sync_synchronize();
+}
+
+
 /***************************************************************************
  ******************************* Sockets ***********************************
  **************************************************************************/
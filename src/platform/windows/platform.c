@@ -767,6 +767,262 @@ int mutex_destroy(mutex_p *m)
 
 
 
+/***************************************************************************
+ ************************* Condition Variables *****************************
+ **************************************************************************/
+
+struct cond_t {
+    CRITICAL_SECTION cs;
+    CONDITION_VARIABLE cond;
+    uint32_t seq;
+    int initialized;
+};
+
+
+int cond_create(cond_p *c)
+{
+    pdebug(DEBUG_DETAIL, "Starting.");
+
+    if(!c) {
+        pdebug(DEBUG_WARN, "null condition variable pointer.");
+        return PLCTAG_ERR_NULL_PTR;
+    }
+
+    if(*c) {
+        pdebug(DEBUG_WARN, "Called with non-NULL pointer!");
+    }
+
+    *c = (struct cond_t *)mem_alloc(sizeof(struct cond_t));
+    if(! *c) {
+        pdebug(DEBUG_ERROR, "Unable to allocate condition variable!");
+        return PLCTAG_ERR_NO_MEM;
+    }
+
+    InitializeCriticalSection(&((*c)->cs));
+    InitializeConditionVariable(&((*c)->cond));
+
+    (*c)->initialized = 1;
+
+    pdebug(DEBUG_DETAIL, "Done creating condition variable %p.", *c);
+
+    return PLCTAG_STATUS_OK;
+}
+
+
+uint32_t cond_seq(cond_p c)
+{
+    uint32_t seq = 0;
+
+    if(!c || !c->initialized) {
+        return 0;
+    }
+
+    EnterCriticalSection(&(c->cs));
+    seq = c->seq;
+    LeaveCriticalSection(&(c->cs));
+
+    return seq;
+}
+
+
+int cond_wait_impl(const char *func, int line_num, cond_p c, uint32_t *seq, int timeout_ms)
+{
+    int rc = PLCTAG_STATUS_OK;
+    int64_t end_time = time_ms() + timeout_ms;
+
+    pdebug(DEBUG_SPEW, "waiting on condition variable %p, called from %s:%d.", c, func, line_num);
+
+    if(!c || !seq) {
+        pdebug(DEBUG_WARN, "null condition variable or sequence pointer.");
+        return PLCTAG_ERR_NULL_PTR;
+    }
+
+    if(!c->initialized) {
+        return PLCTAG_ERR_MUTEX_INIT;
+    }
+
+    if(timeout_ms < 0) {
+        pdebug(DEBUG_WARN, "called with negative timeout %d!", timeout_ms);
+        return PLCTAG_ERR_BAD_PARAM;
+    }
+
+    EnterCriticalSection(&(c->cs));
+
+    while(c->seq == *seq) {
+        int64_t remaining = end_time - time_ms();
+
+        if(remaining <= 0) {
+            break;
+        }
+
+        if(!SleepConditionVariableCS(&(c->cond), &(c->cs), (DWORD)remaining)) {
+            if(GetLastError() != ERROR_TIMEOUT) {
+                pdebug(DEBUG_WARN, "Error %d waiting on condition variable!", (int)GetLastError());
+                rc = PLCTAG_ERR_MUTEX_LOCK;
+                break;
+            }
+        }
+    }
+
+    if(rc == PLCTAG_STATUS_OK && c->seq == *seq) {
+        rc = PLCTAG_ERR_TIMEOUT;
+    }
+
+    *seq = c->seq;
+
+    LeaveCriticalSection(&(c->cs));
+
+    return rc;
+}
+
+
+int cond_signal_impl(const char *func, int line_num, cond_p c)
+{
+    pdebug(DEBUG_SPEW, "signaling condition variable %p, called from %s:%d.", c, func, line_num);
+
+    if(!c) {
+        pdebug(DEBUG_WARN, "null condition variable pointer.");
+        return PLCTAG_ERR_NULL_PTR;
+    }
+
+    if(!c->initialized) {
+        return PLCTAG_ERR_MUTEX_INIT;
+    }
+
+    EnterCriticalSection(&(c->cs));
+    c->seq++;
+    WakeAllConditionVariable(&(c->cond));
+    LeaveCriticalSection(&(c->cs));
+
+    return PLCTAG_STATUS_OK;
+}
+
+
+int cond_destroy(cond_p *c)
+{
+    pdebug(DEBUG_DETAIL, "Starting to destroy condition variable %p.", c);
+
+    if(!c || !*c) {
+        pdebug(DEBUG_WARN, "null condition variable pointer.");
+        return PLCTAG_ERR_NULL_PTR;
+    }
+
+    DeleteCriticalSection(&((*c)->cs));
+
+    mem_free(*c);
+
+    *c = NULL;
+
+    pdebug(DEBUG_DETAIL, "Done.");
+
+    return PLCTAG_STATUS_OK;
+}
+
+
+
+
+/***************************************************************************
+ ******************************* Notifiers *********************************
+ **************************************************************************/
+
+struct notifier_t {
+    HANDLE h_event;
+};
+
+
+int notifier_create(notifier_p *n)
+{
+    pdebug(DEBUG_DETAIL, "Starting.");
+
+    if(!n) {
+        pdebug(DEBUG_WARN, "null notifier pointer.");
+        return PLCTAG_ERR_NULL_PTR;
+    }
+
+    *n = (struct notifier_t *)mem_alloc(sizeof(struct notifier_t));
+    if(! *n) {
+        pdebug(DEBUG_ERROR, "Unable to allocate notifier!");
+        return PLCTAG_ERR_NO_MEM;
+    }
+
+    /* manual reset, not signaled. */
+    (*n)->h_event = CreateEvent(NULL, TRUE, FALSE, NULL);
+    if(!(*n)->h_event) {
+        pdebug(DEBUG_ERROR, "Unable to create event, error=%d!", (int)GetLastError());
+        mem_free(*n);
+        *n = NULL;
+        return PLCTAG_ERR_CREATE;
+    }
+
+    pdebug(DEBUG_DETAIL, "Done creating notifier %p.", *n);
+
+    return PLCTAG_STATUS_OK;
+}
+
+
+intptr_t notifier_get_handle(notifier_p n)
+{
+    if(!n) {
+        pdebug(DEBUG_WARN, "null notifier pointer.");
+        return PLCTAG_ERR_NULL_PTR;
+    }
+
+    return (intptr_t)n->h_event;
+}
+
+
+int notifier_signal(notifier_p n)
+{
+    if(!n) {
+        pdebug(DEBUG_WARN, "null notifier pointer.");
+        return PLCTAG_ERR_NULL_PTR;
+    }
+
+    if(!SetEvent(n->h_event)) {
+        pdebug(DEBUG_WARN, "Unable to signal notifier, error=%d!", (int)GetLastError());
+        return PLCTAG_ERR_WRITE;
+    }
+
+    return PLCTAG_STATUS_OK;
+}
+
+
+int notifier_clear(notifier_p n)
+{
+    if(!n) {
+        pdebug(DEBUG_WARN, "null notifier pointer.");
+        return PLCTAG_ERR_NULL_PTR;
+    }
+
+    ResetEvent(n->h_event);
+
+    return PLCTAG_STATUS_OK;
+}
+
+
+int notifier_destroy(notifier_p *n)
+{
+    pdebug(DEBUG_DETAIL, "Starting.");
+
+    if(!n || !*n) {
+        pdebug(DEBUG_WARN, "null notifier pointer.");
+        return PLCTAG_ERR_NULL_PTR;
+    }
+
+    CloseHandle((*n)->h_event);
+
+    mem_free(*n);
+
+    *n = NULL;
+
+    pdebug(DEBUG_DETAIL, "Done.");
+
+    return PLCTAG_STATUS_OK;
+}
+
+
+
+
 /***************************************************************************
  ******************************* Threads ***********************************
  **************************************************************************/
@@ -974,6 +1230,57 @@ extern void lock_release(lock_t *lock)
 }
 
 
+/*
+ * atomic_ptr_cas
+ *
+ * Atomically replace the pointer at ptr with new_val if it currently
+ * holds old_val.  Returns the value that was in ptr before the call.
+ * If that is old_val, the swap happened.
+ */
+
+extern void *atomic_ptr_cas(void * volatile *ptr, void *old_val, void *new_val)
+{
+    return InterlockedCompareExchangePointer((PVOID volatile *)ptr, new_val, old_val);
+}
+
+
+/*
+ * atomic_int32_add
+ *
+ * Atomically add delta to the value and return the new value.
+ */
+
+extern int32_t atomic_int32_add(volatile int32_t *val, int32_t delta)
+{
+    return (int32_t)(InterlockedExchangeAdd((volatile LONG *)val, (LONG)delta) + (LONG)delta);
+}
+
+
+/*
+ * atomic_int32_cas
+ *
+ * Atomically replace the value with new_val if it currently holds old_val.
+ * Returns the value before the call.  If that is old_val, the swap happened.
+ */
+
+extern int32_t atomic_int32_cas(volatile int32_t *val, int32_t old_val, int32_t new_val)
+{
+    return (int32_t)InterlockedCompareExchange((volatile LONG *)val, (LONG)new_val, (LONG)old_val);
+}
+
+
+/*
+ * atomic_fence
+ *
+ * Full memory barrier.  Loads and stores are not moved across it.
+ */
+
+extern void atomic_fence(void)
+{
+    MemoryBarrier();
+}
+
+
 
 
 
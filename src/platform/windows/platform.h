@@ -177,7 +177,7 @@ extern int mutex_unlock_impl(const char *func, int line_num, mutex_p m);
 #endif
 
 #define mutex_lock(m) mutex_lock_impl(__func__, __LINE__, m)
-#define mutex_try_lock(m) mutex_lock_impl(__func__, __LINE__, m)
+#define mutex_try_lock(m) mutex_try_lock_impl(__func__, __LINE__, m)
 #define mutex_unlock(m) mutex_unlock_impl(__func__, __LINE__, m)
 
 /* macros are evil */
@@ -207,6 +207,42 @@ extern int mutex_unlock_impl(const char *func, int line_num, mutex_p m);
 #define critical_block(lock) \
 for(int LINE_ID(__sync_flag_nargle_) = 1; LINE_ID(__sync_flag_nargle_); LINE_ID(__sync_flag_nargle_) = 0, mutex_unlock(lock))  for(int LINE_ID(__sync_rc_nargle_) = mutex_lock(lock); LINE_ID(__sync_rc_nargle_) == PLCTAG_STATUS_OK && LINE_ID(__sync_flag_nargle_) ; LINE_ID(__sync_flag_nargle_) = 0)
 
+/*
+ * condition variables
+ *
+ * These count signals.  A waiter gets the count with cond_seq() before it
+ * checks whatever it is waiting for and passes it to cond_wait().  The wait
+ * returns as soon as there has been a signal since then, so a signal that
+ * comes in between the check and the wait is not lost.  A signal wakes all
+ * waiters.
+ *
+ * cond_wait() returns PLCTAG_ERR_TIMEOUT if there was no signal before the
+ * timeout.
+ */
+typedef struct cond_t *cond_p;
+extern int cond_create(cond_p *c);
+extern uint32_t cond_seq(cond_p c);
+extern int cond_wait_impl(const char *func, int line_num, cond_p c, uint32_t *seq, int timeout_ms);
+extern int cond_signal_impl(const char *func, int line_num, cond_p c);
+extern int cond_destroy(cond_p *c);
+
+#define cond_wait(c, seq, timeout_ms) cond_wait_impl(__func__, __LINE__, c, seq, timeout_ms)
+#define cond_signal(c) cond_signal_impl(__func__, __LINE__, c)
+
+/*
+ * notifiers
+ *
+ * A notifier has a handle that can be polled by an outside event loop.  The
+ * handle is signaled after notifier_signal() until notifier_clear() is called.
+ * On Windows the handle is a manual reset event HANDLE.
+ */
+typedef struct notifier_t *notifier_p;
+extern int notifier_create(notifier_p *n);
+extern intptr_t notifier_get_handle(notifier_p n);
+extern int notifier_signal(notifier_p n);
+extern int notifier_clear(notifier_p n);
+extern int notifier_destroy(notifier_p *n);
+
 /* thread functions/defs */
 typedef struct thread_t *thread_p;
 //typedef PTHREAD_START_ROUTINE thread_func_t;
@@ -236,6 +272,12 @@ extern int lock_acquire_try(lock_t *lock);
 extern int lock_acquire(lock_t *lock);
 extern void lock_release(lock_t *lock);
 
+/* lock-free helpers, all of these act as full memory barriers. */
+extern void *atomic_ptr_cas(void * volatile *ptr, void *old_val, void *new_val);
+extern int32_t atomic_int32_add(volatile int32_t *val, int32_t delta);
+extern int32_t atomic_int32_cas(volatile int32_t *val, int32_t old_val, int32_t new_val);
+extern void atomic_fence(void);
+
 /* socket functions */
 typedef struct sock_t *sock_p;
 extern int socket_create(sock_p *s);
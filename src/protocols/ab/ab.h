@@ -42,6 +42,7 @@
 void ab_teardown(void);
 int ab_init();
 plc_tag_p ab_tag_create(attr attribs);
+const char *ab_plc_type_name(attr attribs);
 
 
 #endif
@@ -41,6 +41,8 @@
 #include <ab/ab_common.h>
 #include <ab/pccc.h>
 #include <ab/cip.h>
+#include <ab/coalesce.h>
+#include <ab/read_group.h>
 #include <ab/defs.h>
 #include <ab/eip_cip.h>
 #include <ab/eip_lgx_pccc.h>
@@ -61,8 +63,6 @@
 
 //volatile ab_session_p sessions = NULL;
 //volatile mutex_p global_session_mut = NULL;
-//
-//volatile vector_p read_group_tags = NULL;
 
 
 /* request/response handling thread */
@@ -84,8 +84,36 @@ volatile int ab_protocol_terminating = 0;
 #define DEFAULT_RETRY_INTERVAL (300)
 
 
+/*
+ * Atomic CIP types that can be declared with the cip_type attribute, by
+ * name or by type code.
+ */
+static const struct {
+    const char *name;
+    uint8_t type_code;
+    int elem_size;
+} declared_cip_types[] = {
+    { "bool",  AB_CIP_DATA_BIT,   1 },
+    { "sint",  AB_CIP_DATA_SINT,  1 },
+    { "int",   AB_CIP_DATA_INT,   2 },
+    { "dint",  AB_CIP_DATA_DINT,  4 },
+    { "lint",  AB_CIP_DATA_LINT,  8 },
+    { "usint", AB_CIP_DATA_USINT, 1 },
+    { "uint",  AB_CIP_DATA_UINT,  2 },
+    { "udint", AB_CIP_DATA_UDINT, 4 },
+    { "ulint", AB_CIP_DATA_ULINT, 8 },
+    { "real",  AB_CIP_DATA_REAL,  4 },
+    { "lreal", AB_CIP_DATA_LREAL, 8 },
+    { "byte",  AB_CIP_DATA_BYTE,  1 },
+    { "word",  AB_CIP_DATA_WORD,  2 },
+    { "dword", AB_CIP_DATA_DWORD, 4 },
+    { "lword", AB_CIP_DATA_LWORD, 8 }
+};
+
+
 /* forward declarations*/
 static int get_tag_data_type(ab_tag_p tag, attr attribs);
+static int set_declared_type(ab_tag_p tag, const char *cip_type);
 
 static void ab_tag_destroy(ab_tag_p tag);
 static int default_abort(plc_tag_p tag);
@@ -127,6 +155,16 @@ int ab_init(void)
         return rc;
     }
 
+    if((rc = coalesce_startup()) != PLCTAG_STATUS_OK) {
+        pdebug(DEBUG_ERROR, "Unable to initialize read coalescing!");
+        return rc;
+    }
+
+    if((rc = read_group_startup()) != PLCTAG_STATUS_OK) {
+        pdebug(DEBUG_ERROR, "Unable to initialize read groups!");
+        return rc;
+    }
+
     pdebug(DEBUG_INFO,"Finished initializing AB protocol library.");
 
     return rc;
@@ -153,6 +191,10 @@ void ab_teardown(void)
 
     pdebug(DEBUG_INFO,"Freeing session information.");
 
+    read_group_teardown();
+
+    coalesce_teardown();
+
     session_teardown();
 
     ab_protocol_terminating = 0;
@@ -454,6 +496,40 @@ plc_tag_p ab_tag_create(attr attribs)
         return (plc_tag_p)tag;
     }
 
+    /* tags in a named read group are always read with the rest of the group. */
+    if(attr_get_str(attribs, "read_group", NULL)) {
+        if(tag->vtable != &eip_cip_vtable || tag->tag_list) {
+            pdebug(DEBUG_WARN, "Read groups are only supported for Logix-class tags!");
+            tag->status = PLCTAG_ERR_UNSUPPORTED;
+            return (plc_tag_p)tag;
+        }
+
+        if((rc = read_group_join(tag, attr_get_str(attribs, "read_group", NULL))) != PLCTAG_STATUS_OK) {
+            pdebug(DEBUG_WARN, "Unable to join read group!");
+            tag->status = (int8_t)rc;
+            return (plc_tag_p)tag;
+        }
+    }
+
+    /* share reads with other tags on the same Logix array unless told not to. */
+    if(!tag->read_group && tag->plc_type == AB_PLC_LGX && tag->vtable == &eip_cip_vtable && !tag->tag_list && attr_get_int(attribs, "coalesce", 1)) {
+        if(coalesce_join(tag) != PLCTAG_STATUS_OK) {
+            pdebug(DEBUG_DETAIL, "Tag reads will not be coalesced.");
+        }
+    }
+
+    /* a tag with a declared type does not need to be read to be set up. */
+    if(attr_get_str(attribs, "cip_type", NULL)) {
+        if((rc = set_declared_type(tag, attr_get_str(attribs, "cip_type", NULL))) != PLCTAG_STATUS_OK) {
+            tag->status = (int8_t)rc;
+            return (plc_tag_p)tag;
+        }
+
+        pdebug(DEBUG_INFO,"Done.");
+
+        return (plc_tag_p)tag;
+    }
+
     /* trigger the first read. */
     tag->first_read = 1;
 
@@ -469,6 +545,73 @@ plc_tag_p ab_tag_create(attr attribs)
 }
 
 
+/*
+ * Set up the type information and data buffer that the first read would
+ * otherwise get.  Writes then go out without reading the tag first.
+ */
+
+int set_declared_type(ab_tag_p tag, const char *cip_type)
+{
+    int type_code = 0;
+    int type_index = -1;
+
+    pdebug(DEBUG_DETAIL, "Starting.");
+
+    if(tag->vtable != &eip_cip_vtable || tag->tag_list || tag->is_bit) {
+        pdebug(DEBUG_WARN, "Only whole Logix-class tags can have a declared type!");
+        return PLCTAG_ERR_UNSUPPORTED;
+    }
+
+    /* the type can be a name or a type code like 0xC4. */
+    if(str_to_int(cip_type, &type_code) != 0) {
+        type_code = -1;
+    }
+
+    for(int i=0; i < (int)(sizeof(declared_cip_types)/sizeof(declared_cip_types[0])); i++) {
+        if(str_cmp_i(cip_type, declared_cip_types[i].name) == 0 || type_code == (int)declared_cip_types[i].type_code) {
+            type_index = i;
+            break;
+        }
+    }
+
+    if(type_index < 0) {
+        pdebug(DEBUG_WARN, "Unsupported CIP type \"%s\"!", cip_type);
+        return PLCTAG_ERR_UNSUPPORTED;
+    }
+
+    /* BOOL arrays are packed 32 to a DWORD and have their own type, so only a single BOOL can be declared. */
+    if(declared_cip_types[type_index].type_code == AB_CIP_DATA_BIT && tag->elem_count > 1) {
+        pdebug(DEBUG_WARN, "BOOL arrays cannot have a declared type!");
+        return PLCTAG_ERR_UNSUPPORTED;
+    }
+
+    if(tag->elem_size > 0 && tag->elem_size != declared_cip_types[type_index].elem_size) {
+        pdebug(DEBUG_WARN, "Element size %d does not match the declared type, using %d.", tag->elem_size, declared_cip_types[type_index].elem_size);
+    }
+
+    tag->elem_size = declared_cip_types[type_index].elem_size;
+    tag->size = tag->elem_count * tag->elem_size;
+
+    tag->data = (uint8_t *)mem_alloc(tag->size);
+    if(!tag->data) {
+        pdebug(DEBUG_WARN, "Unable to allocate tag data!");
+        return PLCTAG_ERR_NO_MEM;
+    }
+
+    /* atomic types have no extra type information. */
+    tag->encoded_type_info[0] = declared_cip_types[type_index].type_code;
+    tag->encoded_type_info[1] = 0;
+    tag->encoded_type_info_size = 2;
+
+    tag->first_read = 0;
+
+    pdebug(DEBUG_DETAIL, "Declared CIP type %s (%x).", declared_cip_types[type_index].name, (int)declared_cip_types[type_index].type_code);
+
+    return PLCTAG_STATUS_OK;
+}
+
+
+
 /*
  * determine the tag's data type and size.  Or at least guess it.
  */
@@ -745,6 +888,10 @@ int ab_tag_abort(ab_tag_p tag)
         }
 
         tag->req = rc_dec(tag->req);
+    } else if(tag->read_group && tag->read_group_waiting) {
+        read_group_abort(tag);
+    } else if(tag->coalesce && tag->coalesce_waiting) {
+        coalesce_abort(tag);
     } else {
         pdebug(DEBUG_DETAIL, "Called without a request in flight.");
     }
@@ -814,6 +961,14 @@ void ab_tag_destroy(ab_tag_p tag)
         return;
     }
 
+    if(tag->read_group) {
+        read_group_leave(tag);
+    }
+
+    if(tag->coalesce) {
+        coalesce_leave(tag);
+    }
+
     session = tag->session;
 
     /* tags should always have a session.  Release it. */
@@ -831,6 +986,16 @@ void ab_tag_destroy(ab_tag_p tag)
         tag->ext_mutex = NULL;
     }
 
+    if(tag->io_mutex) {
+        mutex_destroy(&(tag->io_mutex));
+        tag->io_mutex = NULL;
+    }
+
+    if(tag->io_cond) {
+        cond_destroy(&(tag->io_cond));
+        tag->io_cond = NULL;
+    }
+
     if(tag->api_mutex) {
         mutex_destroy(&(tag->api_mutex));
         tag->api_mutex = NULL;
@@ -841,6 +1006,10 @@ void ab_tag_destroy(ab_tag_p tag)
         tag->byte_order = NULL;
     }
 
+    tag_snapshot_destroy((plc_tag_p)tag);
+    tag_change_destroy((plc_tag_p)tag);
+    tag_event_queue_release((plc_tag_p)tag);
+
     if (tag->data) {
         mem_free(tag->data);
         tag->data = NULL;
@@ -867,6 +1036,9 @@ int ab_get_int_attrib(plc_tag_p raw_tag, const char *attrib_name, int default_va
         res = tag->elem_size;
     } else if(str_cmp_i(attrib_name, "elem_count") == 0) {
         res = tag->elem_count;
+    } else if(str_cmp_i(attrib_name, "read_group_seq") == 0) {
+        /* members with the same value took their data from the same group read. */
+        res = (int)tag->read_group_seq;
     } else {
         pdebug(DEBUG_WARN, "Unsupported attribute name \"%s\"!", attrib_name);
         tag->status = PLCTAG_ERR_UNSUPPORTED;
@@ -928,6 +1100,36 @@ plc_type_t get_plc_type(attr attribs)
 
 
 
+/*
+ * The canonical name of the PLC type in the plc or cpu attribute, so that
+ * different spellings of the same type can be compared.  Returns NULL if
+ * the type is not known.
+ */
+
+const char *ab_plc_type_name(attr attribs)
+{
+    switch(get_plc_type(attribs)) {
+    case AB_PLC_PLC5:
+        return "plc5";
+    case AB_PLC_SLC:
+        return "slc500";
+    case AB_PLC_MLGX:
+        return "micrologix";
+    case AB_PLC_LGX:
+        return "controllogix";
+    case AB_PLC_LGX_PCCC:
+        return "logixpccc";
+    case AB_PLC_MLGX800:
+        return "micro800";
+    case AB_PLC_OMRON_NJNX:
+        return "omron-njnx";
+    default:
+        return NULL;
+    }
+}
+
+
+
 int check_cpu(ab_tag_p tag, attr attribs)
 {
     plc_type_t result = get_plc_type(attribs);
@@ -47,6 +47,10 @@ typedef struct ab_session_t *ab_session_p;
 typedef struct ab_request_t *ab_request_p;
 #define AB_REQUEST_NULL ((ab_request_p)NULL)
 
+typedef struct ab_coalesce_t *ab_coalesce_p;
+
+typedef struct ab_read_group_t *ab_read_group_p;
+
 
 extern int ab_tag_abort(ab_tag_p tag);
 extern int ab_tag_status(ab_tag_p tag);
@@ -98,7 +102,6 @@ extern plc_type_t get_plc_type(attr attribs);
 extern int check_cpu(ab_tag_p tag, attr attribs);
 extern int check_tag_name(ab_tag_p tag, const char *name);
 extern int check_mutex(int debug);
-extern vector_p find_read_group_tags(ab_tag_p tag);
 
 THREAD_FUNC(request_handler_func);
 
@@ -0,0 +1,832 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by Kyle Hayes                                      *
+ *   Author Kyle Hayes  kyle.hayes@gmail.com                               *
+ *                                                                         *
+ * This software is available under either the Mozilla Public License      *
+ * version 2.0 or the GNU LGPL version 2 (or later) license, whichever     *
+ * you choose.                                                             *
+ *                                                                         *
+ * MPL 2.0:                                                                *
+ *                                                                         *
+ *   This Source Code Form is subject to the terms of the Mozilla Public   *
+ *   License, v. 2.0. If a copy of the MPL was not distributed with this   *
+ *   file, You can obtain one at http://mozilla.org/MPL/2.0/.              *
+ *                                                                         *
+ *                                                                         *
+ * LGPL 2:                                                                 *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU Library General Public License as       *
+ *   published by the Free Software Foundation; either version 2 of the    *
+ *   License, or (at your option) any later version.                       *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU Library General Public     *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include <platform.h>
+#include <lib/libplctag.h>
+#include <lib/tag.h>
+#include <ab/defs.h>
+#include <ab/ab_common.h>
+#include <ab/coalesce.h>
+#include <ab/eip_cip.h>
+#include <ab/session.h>
+#include <ab/tag.h>
+#include <util/debug.h>
+#include <util/vector.h>
+
+
+/*
+ * Tags on the same session that read parts of the same array are put in
+ * a group.  The group has a hidden cover tag that reads the union of the
+ * element ranges of its members.  A member read waits for a cover read
+ * that is started after the member read was requested.   That is either
+ * the cover read in flight if it has not been sent yet, or the next one.
+ * When the cover read finishes, each waiting member copies out its part.
+ *
+ * Only Logix tags with one array index at the end of the name, or no
+ * index at all, are grouped.
+ */
+
+#define COALESCE_MAX_ELEMS (500)
+#define COALESCE_MAX_FAILURES (3)
+
+struct ab_coalesce_t {
+    mutex_p mutex;
+
+    /* what the members have in common. */
+    ab_session_p session;
+    int use_connected_msg;
+    uint8_t base_name[MAX_TAG_NAME];
+    int base_name_size;
+    int has_index;
+
+    /* union of the member element ranges, start inclusive, end exclusive. */
+    int start;
+    int end;
+
+    /* the range of the cover read in flight or last done. */
+    int read_start;
+    int read_end;
+
+    ab_tag_p cover;
+    vector_p members;
+
+    /* cover reads are numbered, members wait for a number. */
+    uint32_t gen_started;
+    uint32_t gen_done;
+    int reading;
+    int status;
+    int num_unread;
+
+    int failures;
+    int disabled;
+};
+
+
+static int parse_encoded_name(ab_tag_p tag, int *base_name_size, int *index, int *has_index);
+static ab_coalesce_p group_create(ab_tag_p tag, int base_name_size, int has_index);
+static void group_destroy(ab_coalesce_p group);
+static void cover_destroy(ab_tag_p cover);
+static int start_cover_read_unsafe(ab_coalesce_p group, ab_tag_p tag);
+static void check_cover_read_unsafe(ab_coalesce_p group);
+static ab_tag_p find_next_waiter_unsafe(ab_coalesce_p group);
+static void drop_waiter_unsafe(ab_coalesce_p group, ab_tag_p tag);
+static int copy_slice_unsafe(ab_coalesce_p group, ab_tag_p tag);
+static int gen_reached(uint32_t done, uint32_t wanted);
+
+
+static mutex_p coalesce_mutex = NULL;
+static vector_p groups = NULL;
+
+
+
+int coalesce_startup(void)
+{
+    int rc = PLCTAG_STATUS_OK;
+
+    pdebug(DEBUG_INFO, "Starting.");
+
+    if((rc = mutex_create(&coalesce_mutex)) != PLCTAG_STATUS_OK) {
+        pdebug(DEBUG_ERROR, "Unable to create coalesce mutex %s!", plc_tag_decode_error(rc));
+        return rc;
+    }
+
+    if((groups = vector_create(10, 10)) == NULL) {
+        pdebug(DEBUG_ERROR, "Unable to create coalesce group vector!");
+        return PLCTAG_ERR_NO_MEM;
+    }
+
+    pdebug(DEBUG_INFO, "Done.");
+
+    return rc;
+}
+
+
+void coalesce_teardown(void)
+{
+    pdebug(DEBUG_INFO, "Starting.");
+
+    if(groups) {
+        /* groups go away with their last tag. */
+        if(vector_length(groups) > 0) {
+            pdebug(DEBUG_WARN, "%d coalesce groups still have tags!", vector_length(groups));
+        }
+
+        vector_destroy(groups);
+        groups = NULL;
+    }
+
+    if(coalesce_mutex) {
+        mutex_destroy(&coalesce_mutex);
+        coalesce_mutex = NULL;
+    }
+
+    pdebug(DEBUG_INFO, "Done.");
+}
+
+
+
+/*
+ * coalesce_join
+ *
+ * Put the tag in a group with other tags that read the same array and
+ * whose element range touches this tag's.  Returns PLCTAG_ERR_UNSUPPORTED
+ * if the tag cannot be grouped, in which case it reads on its own.
+ */
+
+int coalesce_join(ab_tag_p tag)
+{
+    int rc = PLCTAG_STATUS_OK;
+    int base_name_size = 0;
+    int index = 0;
+    int has_index = 0;
+    int end = 0;
+    ab_coalesce_p group = NULL;
+
+    pdebug(DEBUG_DETAIL, "Starting.");
+
+    if(!groups || tag->elem_count < 1 || tag->elem_count > COALESCE_MAX_ELEMS) {
+        pdebug(DEBUG_DETAIL, "Tag cannot be coalesced.");
+        return PLCTAG_ERR_UNSUPPORTED;
+    }
+
+    if((rc = parse_encoded_name(tag, &base_name_size, &index, &has_index)) != PLCTAG_STATUS_OK) {
+        pdebug(DEBUG_DETAIL, "Tag name cannot be coalesced.");
+        return rc;
+    }
+
+    end = index + tag->elem_count;
+
+    critical_block(coalesce_mutex) {
+        for(int i=0; i < vector_length(groups); i++) {
+            ab_coalesce_p tmp = vector_get(groups, i);
+            int new_start = (index < tmp->start ? index : tmp->start);
+            int new_end = (end > tmp->end ? end : tmp->end);
+
+            if(tmp->session == tag->session &&
+               tmp->use_connected_msg == tag->use_connected_msg &&
+               tmp->base_name_size == base_name_size &&
+               mem_cmp(tmp->base_name, base_name_size, tag->encoded_name + 1, base_name_size) == 0 &&
+               index <= tmp->end && end >= tmp->start &&
+               (new_end - new_start) <= COALESCE_MAX_ELEMS) {
+                group = tmp;
+                break;
+            }
+        }
+
+        if(!group) {
+            group = group_create(tag, base_name_size, has_index);
+            if(!group) {
+                rc = PLCTAG_ERR_NO_MEM;
+                break;
+            }
+
+            group->start = index;
+            group->end = end;
+
+            vector_put(groups, vector_length(groups), group);
+        }
+
+        critical_block(group->mutex) {
+            if(index < group->start) {
+                group->start = index;
+            }
+
+            if(end > group->end) {
+                group->end = end;
+            }
+
+            group->has_index |= has_index;
+
+            vector_put(group->members, vector_length(group->members), tag);
+        }
+
+        tag->coalesce = group;
+        tag->coalesce_index = index;
+    }
+
+    pdebug(DEBUG_DETAIL, "Done.");
+
+    return rc;
+}
+
+
+
+/*
+ * coalesce_leave
+ *
+ * Called when the tag is destroyed.  The last member takes the group
+ * with it.
+ */
+
+void coalesce_leave(ab_tag_p tag)
+{
+    ab_coalesce_p group = tag->coalesce;
+    int empty = 0;
+
+    pdebug(DEBUG_DETAIL, "Starting.");
+
+    critical_block(coalesce_mutex) {
+        critical_block(group->mutex) {
+            if(tag->coalesce_waiting) {
+                drop_waiter_unsafe(group, tag);
+            }
+
+            for(int i=0; i < vector_length(group->members); i++) {
+                if(vector_get(group->members, i) == tag) {
+                    vector_remove(group->members, i);
+                    break;
+                }
+            }
+
+            /* shrink the range to what is left. */
+            for(int i=0; i < vector_length(group->members); i++) {
+                ab_tag_p member = vector_get(group->members, i);
+                int end = member->coalesce_index + member->elem_count;
+
+                if(i == 0 || member->coalesce_index < group->start) {
+                    group->start = member->coalesce_index;
+                }
+
+                if(i == 0 || end > group->end) {
+                    group->end = end;
+                }
+            }
+
+            empty = (vector_length(group->members) == 0);
+        }
+
+        if(empty) {
+            for(int i=0; i < vector_length(groups); i++) {
+                if(vector_get(groups, i) == group) {
+                    vector_remove(groups, i);
+                    break;
+                }
+            }
+        }
+    }
+
+    tag->coalesce = NULL;
+
+    if(empty) {
+        group_destroy(group);
+    }
+
+    pdebug(DEBUG_DETAIL, "Done.");
+}
+
+
+
+/*
+ * coalesce_read_start
+ *
+ * Called with the tag's API mutex held.  Returns PLCTAG_ERR_UNSUPPORTED
+ * if the tag must do its own read.
+ */
+
+int coalesce_read_start(ab_tag_p tag)
+{
+    int rc = PLCTAG_STATUS_PENDING;
+    ab_coalesce_p group = tag->coalesce;
+
+    pdebug(DEBUG_DETAIL, "Starting.");
+
+    critical_block(group->mutex) {
+        if(group->disabled) {
+            rc = PLCTAG_ERR_UNSUPPORTED;
+            break;
+        }
+
+        check_cover_read_unsafe(group);
+
+        if(group->reading &&
+           tag->coalesce_index >= group->read_start &&
+           tag->coalesce_index + tag->elem_count <= group->read_end &&
+           group->cover->offset == 0 && group->cover->req &&
+           session_request_queued(group->cover->session, group->cover->req)) {
+            /* the cover read has not gone out yet, so it is fresh enough. */
+            tag->coalesce_gen = group->gen_started;
+        } else if(!group->reading && group->num_unread == 0) {
+            rc = start_cover_read_unsafe(group, tag);
+            if(rc != PLCTAG_STATUS_PENDING) {
+                break;
+            }
+
+            tag->coalesce_gen = group->gen_started;
+        } else {
+            tag->coalesce_gen = group->gen_started + 1;
+        }
+
+        tag->coalesce_waiting = 1;
+        tag->read_in_progress = 1;
+    }
+
+    pdebug(DEBUG_DETAIL, "Done.");
+
+    return rc;
+}
+
+
+
+/*
+ * coalesce_tickler
+ *
+ * Called with the tag's API mutex held while the tag waits for a cover
+ * read.  Returns PLCTAG_ERR_UNSUPPORTED if the cover read could not be
+ * used and the tag must do its own read.
+ */
+
+int coalesce_tickler(ab_tag_p tag)
+{
+    int rc = PLCTAG_STATUS_PENDING;
+    ab_coalesce_p group = tag->coalesce;
+    ab_tag_p waiter = NULL;
+
+    pdebug(DEBUG_SPEW, "Starting.");
+
+    critical_block(group->mutex) {
+        check_cover_read_unsafe(group);
+
+        if(!gen_reached(group->gen_done, tag->coalesce_gen)) {
+            if(group->disabled && !(group->reading && tag->coalesce_gen == group->gen_started)) {
+                tag->coalesce_waiting = 0;
+                tag->read_in_progress = 0;
+                rc = PLCTAG_ERR_UNSUPPORTED;
+                break;
+            }
+
+            /* we may be the first to notice that the next read can start. */
+            if(!group->reading && group->num_unread == 0) {
+                rc = start_cover_read_unsafe(group, tag);
+                if(rc != PLCTAG_STATUS_PENDING) {
+                    tag->coalesce_waiting = 0;
+                    tag->read_in_progress = 0;
+                }
+            }
+
+            break;
+        }
+
+        tag->coalesce_waiting = 0;
+        tag->read_in_progress = 0;
+        group->num_unread--;
+
+        if(group->disabled || group->status != PLCTAG_STATUS_OK) {
+            rc = PLCTAG_ERR_UNSUPPORTED;
+        } else {
+            rc = copy_slice_unsafe(group, tag);
+        }
+
+        /* start the next read for anyone that had to wait for it. */
+        if(!group->reading && group->num_unread == 0 && (waiter = find_next_waiter_unsafe(group))) {
+            start_cover_read_unsafe(group, waiter);
+        }
+    }
+
+    pdebug(DEBUG_SPEW, "Done.");
+
+    return rc;
+}
+
+
+
+void coalesce_abort(ab_tag_p tag)
+{
+    ab_coalesce_p group = tag->coalesce;
+
+    pdebug(DEBUG_DETAIL, "Starting.");
+
+    critical_block(group->mutex) {
+        drop_waiter_unsafe(group, tag);
+    }
+
+    tag->read_in_progress = 0;
+
+    pdebug(DEBUG_DETAIL, "Done.");
+}
+
+
+
+
+/*
+ * Find the base name and trailing index in the encoded name.  The
+ * encoded name starts with its length in words and then has symbolic
+ * (0x91) and numeric (0x28/0x29/0x2A) segments.
+ */
+
+int parse_encoded_name(ab_tag_p tag, int *base_name_size, int *index, int *has_index)
+{
+    uint8_t *name = tag->encoded_name;
+    int i = 1;
+    int last_start = 0;
+    int last_symbolic = 0;
+    int prev_symbolic = 0;
+
+    while(i < tag->encoded_name_size) {
+        prev_symbolic = last_symbolic;
+        last_start = i;
+
+        switch(name[i]) {
+        case 0x91:
+            last_symbolic = 1;
+            i += 2 + name[i+1] + (name[i+1] & 0x01);
+            break;
+
+        case 0x28:
+            last_symbolic = 0;
+            i += 2;
+            break;
+
+        case 0x29:
+            last_symbolic = 0;
+            i += 4;
+            break;
+
+        case 0x2A:
+            last_symbolic = 0;
+            i += 6;
+            break;
+
+        default:
+            return PLCTAG_ERR_UNSUPPORTED;
+        }
+    }
+
+    if(last_start == 0) {
+        return PLCTAG_ERR_UNSUPPORTED;
+    }
+
+    if(last_symbolic) {
+        *base_name_size = tag->encoded_name_size - 1;
+        *index = 0;
+        *has_index = 0;
+
+        return PLCTAG_STATUS_OK;
+    }
+
+    /* multi-dimensional arrays are not grouped. */
+    if(!prev_symbolic) {
+        return PLCTAG_ERR_UNSUPPORTED;
+    }
+
+    switch(name[last_start]) {
+    case 0x28:
+        *index = name[last_start + 1];
+        break;
+
+    case 0x29:
+        *index = name[last_start + 2] | (name[last_start + 3] << 8);
+        break;
+
+    default:
+        /* very large indexes are not worth grouping. */
+        return PLCTAG_ERR_UNSUPPORTED;
+    }
+
+    *base_name_size = last_start - 1;
+    *has_index = 1;
+
+    return PLCTAG_STATUS_OK;
+}
+
+
+
+ab_coalesce_p group_create(ab_tag_p tag, int base_name_size, int has_index)
+{
+    ab_coalesce_p group = NULL;
+    ab_tag_p cover = NULL;
+
+    pdebug(DEBUG_DETAIL, "Starting.");
+
+    group = (ab_coalesce_p)mem_alloc((int)sizeof(struct ab_coalesce_t));
+    if(!group) {
+        pdebug(DEBUG_ERROR, "Unable to allocate coalesce group!");
+        return NULL;
+    }
+
+    if(mutex_create(&group->mutex) != PLCTAG_STATUS_OK || !(group->members = vector_create(10, 10))) {
+        pdebug(DEBUG_ERROR, "Unable to create coalesce group mutex or member vector!");
+        group_destroy(group);
+        return NULL;
+    }
+
+    cover = (ab_tag_p)rc_alloc((int)sizeof(struct ab_tag_t), (rc_cleanup_func)cover_destroy);
+    if(!cover) {
+        pdebug(DEBUG_ERROR, "Unable to allocate cover tag!");
+        group_destroy(group);
+        return NULL;
+    }
+
+    cover->vtable = &eip_cip_vtable;
+    cover->plc_type = tag->plc_type;
+    cover->session = rc_inc(tag->session);
+    cover->use_connected_msg = tag->use_connected_msg;
+    cover->allow_packing = tag->allow_packing;
+    cover->elem_size = tag->elem_size;
+    cover->first_read = 1;
+
+    group->cover = cover;
+    group->session = tag->session;
+    group->use_connected_msg = tag->use_connected_msg;
+    mem_copy(group->base_name, tag->encoded_name + 1, base_name_size);
+    group->base_name_size = base_name_size;
+    group->has_index = has_index;
+
+    pdebug(DEBUG_DETAIL, "Done.");
+
+    return group;
+}
+
+
+
+void group_destroy(ab_coalesce_p group)
+{
+    pdebug(DEBUG_DETAIL, "Starting.");
+
+    if(group->cover) {
+        group->cover = rc_dec(group->cover);
+    }
+
+    if(group->members) {
+        vector_destroy(group->members);
+        group->members = NULL;
+    }
+
+    if(group->mutex) {
+        mutex_destroy(&group->mutex);
+        group->mutex = NULL;
+    }
+
+    mem_free(group);
+
+    pdebug(DEBUG_DETAIL, "Done.");
+}
+
+
+
+void cover_destroy(ab_tag_p cover)
+{
+    pdebug(DEBUG_DETAIL, "Starting.");
+
+    ab_tag_abort(cover);
+
+    if(cover->session) {
+        cover->session = rc_dec(cover->session);
+    }
+
+    if(cover->data) {
+        mem_free(cover->data);
+        cover->data = NULL;
+    }
+
+    pdebug(DEBUG_DETAIL, "Done.");
+}
+
+
+
+/*
+ * Start a cover read of the current group range.  The session wakes
+ * the passed tag when the response comes in.
+ */
+
+int start_cover_read_unsafe(ab_coalesce_p group, ab_tag_p tag)
+{
+    int rc = PLCTAG_STATUS_OK;
+    ab_tag_p cover = group->cover;
+
+    pdebug(DEBUG_DETAIL, "Starting.");
+
+    if(cover->first_read || group->start != group->read_start || group->end != group->read_end) {
+        int i = 1 + group->base_name_size;
+        int index = group->start;
+
+        mem_copy(cover->encoded_name + 1, group->base_name, group->base_name_size);
+
+        if(group->has_index) {
+            if(index > 0xFF) {
+                cover->encoded_name[i++] = 0x29;
+                cover->encoded_name[i++] = 0;
+                cover->encoded_name[i++] = (uint8_t)(index & 0xFF);
+                cover->encoded_name[i++] = (uint8_t)((index >> 8) & 0xFF);
+            } else {
+                cover->encoded_name[i++] = 0x28;
+                cover->encoded_name[i++] = (uint8_t)index;
+            }
+        }
+
+        cover->encoded_name[0] = (uint8_t)((i - 1)/2);
+        cover->encoded_name_size = i;
+        cover->elem_count = group->end - group->start;
+
+        /* the buffer is resized by the read. */
+        cover->size = 0;
+
+        group->read_start = group->start;
+        group->read_end = group->end;
+    }
+
+    cover->tag_id = tag->tag_id;
+    cover->offset = 0;
+
+    rc = cover->vtable->read((plc_tag_p)cover);
+    if(rc != PLCTAG_STATUS_PENDING) {
+        pdebug(DEBUG_WARN, "Unable to start cover read, error %s!", plc_tag_decode_error(rc));
+        return rc;
+    }
+
+    group->reading = 1;
+    group->gen_started++;
+
+    pdebug(DEBUG_DETAIL, "Done.");
+
+    return rc;
+}
+
+
+
+/*
+ * If the cover read finished, note how many members need to copy their
+ * data out and wake them up.
+ */
+
+void check_cover_read_unsafe(ab_coalesce_p group)
+{
+    ab_tag_p cover = group->cover;
+    int rc = PLCTAG_STATUS_OK;
+
+    if(!group->reading) {
+        return;
+    }
+
+    rc = cover->vtable->tickler((plc_tag_p)cover);
+
+    if(cover->read_in_progress) {
+        return;
+    }
+
+    pdebug(DEBUG_DETAIL, "Cover read %u done with status %s.", group->gen_started, plc_tag_decode_error(rc));
+
+    group->reading = 0;
+    group->gen_done = group->gen_started;
+    group->status = rc;
+
+    if(rc == PLCTAG_STATUS_OK) {
+        group->failures = 0;
+
+        /* BOOL arrays come back as packed bits, the element math does not work. */
+        if(cover->encoded_type_info_size > 0 && cover->encoded_type_info[0] == AB_CIP_DATA_DWORD) {
+            pdebug(DEBUG_INFO, "Bit arrays are not coalesced.");
+            group->disabled = 1;
+        }
+    } else {
+        /* let the members read on their own so that each gets its own status. */
+        group->failures++;
+
+        if(group->failures >= COALESCE_MAX_FAILURES) {
+            pdebug(DEBUG_WARN, "Cover reads keep failing, members will read on their own.");
+            group->disabled = 1;
+        }
+    }
+
+    group->num_unread = 0;
+
+    for(int i=0; i < vector_length(group->members); i++) {
+        ab_tag_p member = vector_get(group->members, i);
+
+        if(member->coalesce_waiting) {
+            if(member->coalesce_gen == group->gen_done) {
+                group->num_unread++;
+            }
+
+            plc_tag_wake_tag(member->tag_id);
+        }
+    }
+}
+
+
+
+ab_tag_p find_next_waiter_unsafe(ab_coalesce_p group)
+{
+    for(int i=0; i < vector_length(group->members); i++) {
+        ab_tag_p member = vector_get(group->members, i);
+
+        if(member->coalesce_waiting && member->coalesce_gen == group->gen_started + 1) {
+            return member;
+        }
+    }
+
+    return NULL;
+}
+
+
+
+/*
+ * The tag stops waiting.  If it was the last one that needed to copy
+ * from the finished cover read, the next read can start.
+ */
+
+void drop_waiter_unsafe(ab_coalesce_p group, ab_tag_p tag)
+{
+    ab_tag_p waiter = NULL;
+
+    if(!tag->coalesce_waiting) {
+        return;
+    }
+
+    tag->coalesce_waiting = 0;
+
+    if(!group->reading && tag->coalesce_gen == group->gen_done) {
+        group->num_unread--;
+
+        if(group->num_unread == 0 && (waiter = find_next_waiter_unsafe(group))) {
+            start_cover_read_unsafe(group, waiter);
+        }
+    }
+}
+
+
+
+int copy_slice_unsafe(ab_coalesce_p group, ab_tag_p tag)
+{
+    ab_tag_p cover = group->cover;
+    int elem_size = 0;
+    int offset = 0;
+    int size = 0;
+
+    if(cover->elem_count <= 0 || cover->size % cover->elem_count) {
+        pdebug(DEBUG_WARN, "Cover read returned %d bytes for %d elements!", cover->size, cover->elem_count);
+        return PLCTAG_ERR_BAD_DATA;
+    }
+
+    elem_size = cover->size / cover->elem_count;
+    offset = (tag->coalesce_index - group->read_start) * elem_size;
+    size = tag->elem_count * elem_size;
+
+    if(offset < 0 || offset + size > cover->size) {
+        pdebug(DEBUG_WARN, "Tag data is outside of the cover read!");
+        return PLCTAG_ERR_BAD_DATA;
+    }
+
+    if(tag->size != size) {
+        uint8_t *data = (uint8_t *)mem_realloc(tag->data, size);
+
+        if(!data) {
+            pdebug(DEBUG_WARN, "Unable to reallocate tag data memory!");
+            return PLCTAG_ERR_NO_MEM;
+        }
+
+        tag->data = data;
+        tag->size = size;
+    }
+
+    tag->elem_size = elem_size;
+
+    if(tag->encoded_type_info_size == 0) {
+        tag->encoded_type_info_size = cover->encoded_type_info_size;
+        mem_copy(tag->encoded_type_info, cover->encoded_type_info, cover->encoded_type_info_size);
+    }
+
+    mem_copy(tag->data, cover->data + offset, size);
+
+    tag->first_read = 0;
+    tag->offset = 0;
+
+    return PLCTAG_STATUS_OK;
+}
+
+
+
+/* generation numbers wrap. */
+int gen_reached(uint32_t done, uint32_t wanted)
+{
+    return (int32_t)(done - wanted) >= 0;
+}
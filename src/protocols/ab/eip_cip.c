@@ -38,6 +38,8 @@
 #include <ab/defs.h>
 #include <ab/ab_common.h>
 #include <ab/cip.h>
+#include <ab/coalesce.h>
+#include <ab/read_group.h>
 #include <ab/tag.h>
 #include <ab/session.h>
 #include <ab/eip_cip.h>
@@ -143,6 +145,7 @@ static int check_write_status_unconnected(ab_tag_p tag);
 static int calculate_write_data_per_packet(ab_tag_p tag);
 
 static int tag_read_start(ab_tag_p tag);
+static int start_read_request(ab_tag_p tag);
 static int tag_tickler(ab_tag_p tag);
 static int tag_write_start(ab_tag_p tag);
 
@@ -215,6 +218,38 @@ int tag_tickler(ab_tag_p tag)
 
     pdebug(DEBUG_SPEW,"Starting.");
 
+    if (tag->read_in_progress && tag->read_group_waiting) {
+        rc = read_group_tickler(tag);
+
+        tag->status = (int8_t)rc;
+
+        if(!tag->read_in_progress) {
+            tag->read_complete = 1;
+        }
+
+        pdebug(DEBUG_SPEW,"Done.  Waiting for group read.");
+
+        return rc;
+    }
+
+    if (tag->read_in_progress && tag->coalesce_waiting) {
+        rc = coalesce_tickler(tag);
+        if(rc == PLCTAG_ERR_UNSUPPORTED) {
+            pdebug(DEBUG_DETAIL, "Covering read cannot be used, reading the tag by itself.");
+            rc = start_read_request(tag);
+        }
+
+        tag->status = (int8_t)rc;
+
+        if(!tag->read_in_progress) {
+            tag->read_complete = 1;
+        }
+
+        pdebug(DEBUG_SPEW,"Done.  Waiting for covering read.");
+
+        return rc;
+    }
+
     if (tag->read_in_progress) {
         if(tag->use_connected_msg) {
             if(tag->tag_list) {
@@ -257,6 +292,16 @@ int tag_tickler(ab_tag_p tag)
         return rc;
     }
 
+    /* take the data from a group read done for other tags in the group. */
+    if(tag->read_group && !tag->read_complete && !tag->write_complete && read_group_commit(tag)) {
+        tag->status = PLCTAG_STATUS_OK;
+        tag->read_complete = 1;
+
+        pdebug(DEBUG_SPEW, "Done.  Took data from group read.");
+
+        return tag->status;
+    }
+
     pdebug(DEBUG_SPEW, "Done.  No operation in progress.");
 
     return tag->status;
@@ -286,6 +331,45 @@ int tag_read_start(ab_tag_p tag)
         return PLCTAG_ERR_BUSY;
     }
 
+    /* reads of the whole tag in a named group read the whole group. */
+    if(tag->read_group && !tag->pre_write_read && tag->offset == 0) {
+        rc = read_group_read_start(tag);
+
+        pdebug(DEBUG_INFO, "Done.");
+
+        return rc;
+    }
+
+    /* reads of the whole tag can share a read with other tags on the same array. */
+    if(tag->coalesce && !tag->pre_write_read && tag->offset == 0) {
+        rc = coalesce_read_start(tag);
+        if(rc != PLCTAG_ERR_UNSUPPORTED) {
+            pdebug(DEBUG_INFO, "Done.");
+            return rc;
+        }
+    }
+
+    rc = start_read_request(tag);
+
+    pdebug(DEBUG_INFO, "Done.");
+
+    return rc;
+}
+
+
+
+/*
+ * start_read_request
+ *
+ * Queue a read request for the tag's own data.
+ */
+
+int start_read_request(ab_tag_p tag)
+{
+    int rc = PLCTAG_STATUS_OK;
+
+    pdebug(DEBUG_DETAIL, "Starting");
+
     /* mark the tag read in progress */
     tag->read_in_progress = 1;
 
@@ -308,7 +392,7 @@ int tag_read_start(ab_tag_p tag)
         return rc;
     }
 
-    pdebug(DEBUG_INFO, "Done.");
+    pdebug(DEBUG_DETAIL, "Done.");
 
     return PLCTAG_STATUS_PENDING;
 }
@@ -468,6 +552,12 @@ int build_read_request_connected(ab_tag_p tag, int byte_offset)
     /* set the session so that we know what session the request is aiming at */
     //req->session = tag->session;
 
+    /*
+     * reply header, data type and the rest of the data, so that the session does not
+     * over pack.  Logix tags do not know their size until the first read, so guess.
+     */
+    req->response_size = 8 + (tag->size > 0 ? tag->size : tag->elem_count * tag->elem_size) - byte_offset;
+
     req->allow_packing = tag->allow_packing;
 
     /* add the request to the session's list. */
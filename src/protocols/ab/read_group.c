@@ -0,0 +1,742 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by Kyle Hayes                                      *
+ *   Author Kyle Hayes  kyle.hayes@gmail.com                               *
+ *                                                                         *
+ * This software is available under either the Mozilla Public License      *
+ * version 2.0 or the GNU LGPL version 2 (or later) license, whichever     *
+ * you choose.                                                             *
+ *                                                                         *
+ * MPL 2.0:                                                                *
+ *                                                                         *
+ *   This Source Code Form is subject to the terms of the Mozilla Public   *
+ *   License, v. 2.0. If a copy of the MPL was not distributed with this   *
+ *   file, You can obtain one at http://mozilla.org/MPL/2.0/.              *
+ *                                                                         *
+ *                                                                         *
+ * LGPL 2:                                                                 *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU Library General Public License as       *
+ *   published by the Free Software Foundation; either version 2 of the    *
+ *   License, or (at your option) any later version.                       *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU Library General Public     *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+
+#include <platform.h>
+#include <lib/libplctag.h>
+#include <lib/tag.h>
+#include <ab/defs.h>
+#include <ab/ab_common.h>
+#include <ab/eip_cip.h>
+#include <ab/read_group.h>
+#include <ab/session.h>
+#include <ab/tag.h>
+#include <util/debug.h>
+#include <util/vector.h>
+
+
+/*
+ * Each member of a group has a hidden reader tag with the same name and
+ * element count.  A group read starts a read on every reader while the
+ * session queue is held, so all the requests are queued together and the
+ * session packs them into as few packets as it can.  When every reader is
+ * done, the group read is done.  The members all take their data from
+ * that read and get the same group sequence number.
+ *
+ * Like coalesced reads, a member read waits for a group read that is
+ * started after the member read was requested.  Members that did not ask
+ * for a read take the new data when they are next ticked and are free.
+ */
+
+struct ab_read_group_t {
+    mutex_p mutex;
+
+    /* what the members have in common. */
+    char *name;
+    ab_session_p session;
+    int use_connected_msg;
+
+    vector_p members;
+
+    /* group reads are numbered, members wait for a number. */
+    uint32_t gen_started;
+    uint32_t gen_done;
+    int reading;
+    int num_unread;
+};
+
+
+static ab_read_group_p group_create(ab_tag_p tag, const char *name);
+static void group_destroy(ab_read_group_p group);
+static ab_tag_p reader_create(ab_tag_p tag);
+static void reader_destroy(ab_tag_p reader);
+static int start_group_read_unsafe(ab_read_group_p group);
+static int group_read_queued_unsafe(ab_read_group_p group);
+static void check_group_read_unsafe(ab_read_group_p group);
+static ab_tag_p find_next_waiter_unsafe(ab_read_group_p group);
+static void drop_waiter_unsafe(ab_read_group_p group, ab_tag_p tag);
+static int copy_member_unsafe(ab_read_group_p group, ab_tag_p tag);
+static int gen_reached(uint32_t done, uint32_t wanted);
+
+
+static mutex_p read_group_mutex = NULL;
+static vector_p groups = NULL;
+
+
+
+int read_group_startup(void)
+{
+    int rc = PLCTAG_STATUS_OK;
+
+    pdebug(DEBUG_INFO, "Starting.");
+
+    if((rc = mutex_create(&read_group_mutex)) != PLCTAG_STATUS_OK) {
+        pdebug(DEBUG_ERROR, "Unable to create read group mutex %s!", plc_tag_decode_error(rc));
+        return rc;
+    }
+
+    if((groups = vector_create(10, 10)) == NULL) {
+        pdebug(DEBUG_ERROR, "Unable to create read group vector!");
+        return PLCTAG_ERR_NO_MEM;
+    }
+
+    pdebug(DEBUG_INFO, "Done.");
+
+    return rc;
+}
+
+
+void read_group_teardown(void)
+{
+    pdebug(DEBUG_INFO, "Starting.");
+
+    if(groups) {
+        /* groups go away with their last tag. */
+        if(vector_length(groups) > 0) {
+            pdebug(DEBUG_WARN, "%d read groups still have tags!", vector_length(groups));
+        }
+
+        vector_destroy(groups);
+        groups = NULL;
+    }
+
+    if(read_group_mutex) {
+        mutex_destroy(&read_group_mutex);
+        read_group_mutex = NULL;
+    }
+
+    pdebug(DEBUG_INFO, "Done.");
+}
+
+
+
+/*
+ * read_group_join
+ *
+ * Put the tag in the named group on its session, creating the group if
+ * this is the first member.
+ */
+
+int read_group_join(ab_tag_p tag, const char *name)
+{
+    int rc = PLCTAG_STATUS_OK;
+    ab_read_group_p group = NULL;
+    ab_tag_p reader = NULL;
+
+    pdebug(DEBUG_DETAIL, "Starting.");
+
+    if(!groups) {
+        pdebug(DEBUG_WARN, "Read groups are not set up!");
+        return PLCTAG_ERR_NOT_FOUND;
+    }
+
+    reader = reader_create(tag);
+    if(!reader) {
+        pdebug(DEBUG_ERROR, "Unable to create the group reader for the tag!");
+        return PLCTAG_ERR_NO_MEM;
+    }
+
+    critical_block(read_group_mutex) {
+        for(int i=0; i < vector_length(groups); i++) {
+            ab_read_group_p tmp = vector_get(groups, i);
+
+            if(tmp->session == tag->session &&
+               tmp->use_connected_msg == tag->use_connected_msg &&
+               str_cmp(tmp->name, name) == 0) {
+                group = tmp;
+                break;
+            }
+        }
+
+        if(!group) {
+            group = group_create(tag, name);
+            if(!group) {
+                rc = PLCTAG_ERR_NO_MEM;
+                break;
+            }
+
+            vector_put(groups, vector_length(groups), group);
+        }
+
+        critical_block(group->mutex) {
+            vector_put(group->members, vector_length(group->members), tag);
+        }
+
+        tag->read_group = group;
+        tag->read_group_reader = reader;
+    }
+
+    if(rc != PLCTAG_STATUS_OK) {
+        rc_dec(reader);
+    }
+
+    pdebug(DEBUG_DETAIL, "Done.");
+
+    return rc;
+}
+
+
+
+/*
+ * read_group_leave
+ *
+ * Called when the tag is destroyed.  The last member takes the group
+ * with it.
+ */
+
+void read_group_leave(ab_tag_p tag)
+{
+    ab_read_group_p group = tag->read_group;
+    ab_tag_p reader = NULL;
+    int empty = 0;
+
+    pdebug(DEBUG_DETAIL, "Starting.");
+
+    critical_block(read_group_mutex) {
+        critical_block(group->mutex) {
+            drop_waiter_unsafe(group, tag);
+
+            for(int i=0; i < vector_length(group->members); i++) {
+                if(vector_get(group->members, i) == tag) {
+                    vector_remove(group->members, i);
+                    break;
+                }
+            }
+
+            /* the reader is only used under the group mutex. */
+            reader = tag->read_group_reader;
+            tag->read_group_reader = NULL;
+
+            empty = (vector_length(group->members) == 0);
+        }
+
+        if(empty) {
+            for(int i=0; i < vector_length(groups); i++) {
+                if(vector_get(groups, i) == group) {
+                    vector_remove(groups, i);
+                    break;
+                }
+            }
+        }
+    }
+
+    tag->read_group = NULL;
+
+    if(reader) {
+        rc_dec(reader);
+    }
+
+    if(empty) {
+        group_destroy(group);
+    }
+
+    pdebug(DEBUG_DETAIL, "Done.");
+}
+
+
+
+/*
+ * read_group_read_start
+ *
+ * Called with the tag's API mutex held.  The tag waits for a group read
+ * that has not been sent yet, or for the next one.
+ */
+
+int read_group_read_start(ab_tag_p tag)
+{
+    int rc = PLCTAG_STATUS_PENDING;
+    ab_read_group_p group = tag->read_group;
+
+    pdebug(DEBUG_DETAIL, "Starting.");
+
+    critical_block(group->mutex) {
+        check_group_read_unsafe(group);
+
+        /* this read gets newer data than any the tag has not taken yet. */
+        tag->read_group_pending = 0;
+
+        if(group->reading && group_read_queued_unsafe(group)) {
+            /* the group read has not gone out yet, so it is fresh enough. */
+            tag->read_group_gen = group->gen_started;
+        } else if(!group->reading && group->num_unread == 0) {
+            rc = start_group_read_unsafe(group);
+            if(rc != PLCTAG_STATUS_PENDING) {
+                break;
+            }
+
+            tag->read_group_gen = group->gen_started;
+        } else {
+            tag->read_group_gen = group->gen_started + 1;
+        }
+
+        tag->read_group_waiting = 1;
+        tag->read_in_progress = 1;
+    }
+
+    pdebug(DEBUG_DETAIL, "Done.");
+
+    return rc;
+}
+
+
+
+/*
+ * read_group_tickler
+ *
+ * Called with the tag's API mutex held while the tag waits for a group
+ * read.
+ */
+
+int read_group_tickler(ab_tag_p tag)
+{
+    int rc = PLCTAG_STATUS_PENDING;
+    ab_read_group_p group = tag->read_group;
+
+    pdebug(DEBUG_SPEW, "Starting.");
+
+    critical_block(group->mutex) {
+        check_group_read_unsafe(group);
+
+        if(!gen_reached(group->gen_done, tag->read_group_gen)) {
+            /* we may be the first to notice that the next read can start. */
+            if(!group->reading && group->num_unread == 0) {
+                rc = start_group_read_unsafe(group);
+                if(rc != PLCTAG_STATUS_PENDING) {
+                    tag->read_group_waiting = 0;
+                    tag->read_in_progress = 0;
+                }
+            }
+
+            break;
+        }
+
+        tag->read_group_waiting = 0;
+        tag->read_in_progress = 0;
+        tag->read_group_pending = 0;
+        group->num_unread--;
+
+        rc = copy_member_unsafe(group, tag);
+
+        /* start the next read for anyone that had to wait for it. */
+        if(!group->reading && group->num_unread == 0 && find_next_waiter_unsafe(group)) {
+            start_group_read_unsafe(group);
+        }
+    }
+
+    pdebug(DEBUG_SPEW, "Done.");
+
+    return rc;
+}
+
+
+
+/*
+ * read_group_commit
+ *
+ * Called with the tag's API mutex held when the tag has no operation in
+ * flight.  If a group read for other members finished since the tag last
+ * took its data, take it now.  Returns non-zero if the tag data changed.
+ */
+
+int read_group_commit(ab_tag_p tag)
+{
+    ab_read_group_p group = tag->read_group;
+    int committed = 0;
+
+    pdebug(DEBUG_SPEW, "Starting.");
+
+    critical_block(group->mutex) {
+        check_group_read_unsafe(group);
+
+        /* while a group read is coming in, the readers hold a mix of old and new data. */
+        if(!tag->read_group_pending || group->reading) {
+            break;
+        }
+
+        tag->read_group_pending = 0;
+
+        /* local changes that have not been written yet win. */
+        if(tag->tag_is_dirty || tag->write_in_flight) {
+            break;
+        }
+
+        committed = (copy_member_unsafe(group, tag) == PLCTAG_STATUS_OK);
+    }
+
+    pdebug(DEBUG_SPEW, "Done.");
+
+    return committed;
+}
+
+
+
+void read_group_abort(ab_tag_p tag)
+{
+    ab_read_group_p group = tag->read_group;
+
+    pdebug(DEBUG_DETAIL, "Starting.");
+
+    critical_block(group->mutex) {
+        drop_waiter_unsafe(group, tag);
+    }
+
+    tag->read_in_progress = 0;
+
+    pdebug(DEBUG_DETAIL, "Done.");
+}
+
+
+
+
+ab_read_group_p group_create(ab_tag_p tag, const char *name)
+{
+    ab_read_group_p group = NULL;
+
+    pdebug(DEBUG_DETAIL, "Starting.");
+
+    group = (ab_read_group_p)mem_alloc((int)sizeof(struct ab_read_group_t));
+    if(!group) {
+        pdebug(DEBUG_ERROR, "Unable to allocate read group!");
+        return NULL;
+    }
+
+    if(mutex_create(&group->mutex) != PLCTAG_STATUS_OK || !(group->members = vector_create(10, 10)) || !(group->name = str_dup(name))) {
+        pdebug(DEBUG_ERROR, "Unable to create read group mutex, member vector or name!");
+        group_destroy(group);
+        return NULL;
+    }
+
+    group->session = tag->session;
+    group->use_connected_msg = tag->use_connected_msg;
+
+    pdebug(DEBUG_DETAIL, "Done.");
+
+    return group;
+}
+
+
+
+void group_destroy(ab_read_group_p group)
+{
+    pdebug(DEBUG_DETAIL, "Starting.");
+
+    if(group->members) {
+        vector_destroy(group->members);
+        group->members = NULL;
+    }
+
+    if(group->name) {
+        mem_free(group->name);
+        group->name = NULL;
+    }
+
+    if(group->mutex) {
+        mutex_destroy(&group->mutex);
+        group->mutex = NULL;
+    }
+
+    mem_free(group);
+
+    pdebug(DEBUG_DETAIL, "Done.");
+}
+
+
+
+/*
+ * The reader reads the same thing as the tag.  It is only touched with
+ * the group mutex held.
+ */
+
+ab_tag_p reader_create(ab_tag_p tag)
+{
+    ab_tag_p reader = NULL;
+
+    reader = (ab_tag_p)rc_alloc((int)sizeof(struct ab_tag_t), (rc_cleanup_func)reader_destroy);
+    if(!reader) {
+        return NULL;
+    }
+
+    reader->vtable = &eip_cip_vtable;
+    reader->plc_type = tag->plc_type;
+    reader->session = rc_inc(tag->session);
+    reader->use_connected_msg = tag->use_connected_msg;
+    reader->allow_packing = tag->allow_packing;
+    reader->elem_count = tag->elem_count;
+    reader->elem_size = tag->elem_size;
+    reader->first_read = 1;
+
+    mem_copy(reader->encoded_name, tag->encoded_name, tag->encoded_name_size);
+    reader->encoded_name_size = tag->encoded_name_size;
+
+    return reader;
+}
+
+
+
+void reader_destroy(ab_tag_p reader)
+{
+    pdebug(DEBUG_DETAIL, "Starting.");
+
+    ab_tag_abort(reader);
+
+    if(reader->session) {
+        reader->session = rc_dec(reader->session);
+    }
+
+    if(reader->data) {
+        mem_free(reader->data);
+        reader->data = NULL;
+    }
+
+    pdebug(DEBUG_DETAIL, "Done.");
+}
+
+
+
+/*
+ * Start a read on every member's reader.  The session is held so that
+ * it does not send any of the requests until they are all queued.  The
+ * session wakes each member when its response comes in.
+ */
+
+int start_group_read_unsafe(ab_read_group_p group)
+{
+    int rc = PLCTAG_STATUS_PENDING;
+    int num_started = 0;
+
+    pdebug(DEBUG_DETAIL, "Starting.");
+
+    session_hold_requests(group->session);
+
+    for(int i=0; i < vector_length(group->members); i++) {
+        ab_tag_p member = vector_get(group->members, i);
+        ab_tag_p reader = member->read_group_reader;
+
+        reader->tag_id = member->tag_id;
+        reader->offset = 0;
+
+        reader->status = (int8_t)reader->vtable->read((plc_tag_p)reader);
+        if(reader->status != PLCTAG_STATUS_PENDING) {
+            pdebug(DEBUG_WARN, "Unable to start the group read for member %d, error %s!", member->tag_id, plc_tag_decode_error(reader->status));
+            rc = reader->status;
+        } else {
+            num_started++;
+        }
+    }
+
+    session_release_requests(group->session);
+
+    if(num_started == 0) {
+        pdebug(DEBUG_WARN, "Unable to start group read!");
+        return (rc == PLCTAG_STATUS_PENDING ? PLCTAG_ERR_NOT_FOUND : rc);
+    }
+
+    group->reading = 1;
+    group->gen_started++;
+
+    pdebug(DEBUG_DETAIL, "Group read %u of %d members started.", group->gen_started, num_started);
+
+    return PLCTAG_STATUS_PENDING;
+}
+
+
+
+/*
+ * The requests are queued all together, so if one is still queued the
+ * whole group read has not been sent.
+ */
+
+int group_read_queued_unsafe(ab_read_group_p group)
+{
+    for(int i=0; i < vector_length(group->members); i++) {
+        ab_tag_p member = vector_get(group->members, i);
+        ab_tag_p reader = member->read_group_reader;
+
+        if(reader->read_in_progress && reader->offset == 0 && reader->req) {
+            return session_request_queued(group->session, reader->req);
+        }
+    }
+
+    return 0;
+}
+
+
+
+/*
+ * If every reader is done, the group read is done.  Note how many
+ * waiting members need to copy their data out and wake up every member.
+ */
+
+void check_group_read_unsafe(ab_read_group_p group)
+{
+    int done = 1;
+
+    if(!group->reading) {
+        return;
+    }
+
+    for(int i=0; i < vector_length(group->members); i++) {
+        ab_tag_p member = vector_get(group->members, i);
+        ab_tag_p reader = member->read_group_reader;
+
+        if(reader->read_in_progress) {
+            reader->status = (int8_t)reader->vtable->tickler((plc_tag_p)reader);
+
+            if(reader->read_in_progress) {
+                done = 0;
+            }
+        }
+    }
+
+    if(!done) {
+        return;
+    }
+
+    group->reading = 0;
+    group->gen_done = group->gen_started;
+    group->num_unread = 0;
+
+    pdebug(DEBUG_DETAIL, "Group read %u done.", group->gen_done);
+
+    for(int i=0; i < vector_length(group->members); i++) {
+        ab_tag_p member = vector_get(group->members, i);
+
+        if(member->read_group_waiting) {
+            if(member->read_group_gen == group->gen_done) {
+                group->num_unread++;
+            }
+        } else {
+            member->read_group_pending = 1;
+        }
+
+        plc_tag_wake_tag(member->tag_id);
+    }
+}
+
+
+
+ab_tag_p find_next_waiter_unsafe(ab_read_group_p group)
+{
+    for(int i=0; i < vector_length(group->members); i++) {
+        ab_tag_p member = vector_get(group->members, i);
+
+        if(member->read_group_waiting && member->read_group_gen == group->gen_started + 1) {
+            return member;
+        }
+    }
+
+    return NULL;
+}
+
+
+
+/*
+ * The tag stops waiting.  If it was the last one that needed to copy
+ * from the finished group read, the next read can start.
+ */
+
+void drop_waiter_unsafe(ab_read_group_p group, ab_tag_p tag)
+{
+    tag->read_group_pending = 0;
+
+    if(!tag->read_group_waiting) {
+        return;
+    }
+
+    tag->read_group_waiting = 0;
+
+    if(!group->reading && tag->read_group_gen == group->gen_done) {
+        group->num_unread--;
+
+        if(group->num_unread == 0 && find_next_waiter_unsafe(group)) {
+            start_group_read_unsafe(group);
+        }
+    }
+}
+
+
+
+/*
+ * Copy the data of the last group read from the reader to the tag.  The
+ * reader status is the member's status.
+ */
+
+int copy_member_unsafe(ab_read_group_p group, ab_tag_p tag)
+{
+    ab_tag_p reader = tag->read_group_reader;
+
+    if(reader->status != PLCTAG_STATUS_OK) {
+        pdebug(DEBUG_WARN, "Group read failed for this member with error %s!", plc_tag_decode_error(reader->status));
+        return reader->status;
+    }
+
+    if(reader->size <= 0 || !reader->data) {
+        pdebug(DEBUG_WARN, "Group read returned no data!");
+        return PLCTAG_ERR_BAD_DATA;
+    }
+
+    if(tag->size != reader->size) {
+        uint8_t *data = (uint8_t *)mem_realloc(tag->data, reader->size);
+
+        if(!data) {
+            pdebug(DEBUG_WARN, "Unable to reallocate tag data memory!");
+            return PLCTAG_ERR_NO_MEM;
+        }
+
+        tag->data = data;
+        tag->size = reader->size;
+    }
+
+    tag->elem_size = reader->elem_size;
+
+    if(tag->encoded_type_info_size == 0) {
+        tag->encoded_type_info_size = reader->encoded_type_info_size;
+        mem_copy(tag->encoded_type_info, reader->encoded_type_info, reader->encoded_type_info_size);
+    }
+
+    mem_copy(tag->data, reader->data, reader->size);
+
+    tag->first_read = 0;
+    tag->offset = 0;
+    tag->read_group_seq = group->gen_done;
+
+    return PLCTAG_STATUS_OK;
+}
+
+
+
+/* generation numbers wrap. */
+int gen_reached(uint32_t done, uint32_t wanted)
+{
+    return (int32_t)(done - wanted) >= 0;
+}
@@ -921,6 +921,71 @@ int session_add_request(ab_session_p sess, ab_request_p req)
 }
 
 
+/*
+ * session_request_queued
+ *
+ * Returns non-zero if the request is still waiting in the queue and
+ * has not been sent to the PLC.
+ */
+int session_request_queued(ab_session_p sess, ab_request_p req)
+{
+    int queued = 0;
+
+    pdebug(DEBUG_SPEW, "Starting.");
+
+    critical_block(sess->mutex) {
+        for(int i=0; i < vector_length(sess->requests); i++) {
+            if(vector_get(sess->requests, i) == req) {
+                queued = 1;
+                break;
+            }
+        }
+    }
+
+    pdebug(DEBUG_SPEW, "Done.");
+
+    return queued;
+}
+
+
+/*
+ * session_hold_requests
+ *
+ * Keep the session from sending queued requests until they are released.
+ * This lets a caller queue several requests so that they go out together.
+ * Holds nest.
+ */
+void session_hold_requests(ab_session_p sess)
+{
+    pdebug(DEBUG_SPEW, "Starting.");
+
+    critical_block(sess->mutex) {
+        sess->hold_requests++;
+    }
+
+    pdebug(DEBUG_SPEW, "Done.");
+}
+
+
+/*
+ * session_release_requests
+ *
+ * Undo one call to session_hold_requests().
+ */
+void session_release_requests(ab_session_p sess)
+{
+    pdebug(DEBUG_SPEW, "Starting.");
+
+    critical_block(sess->mutex) {
+        if(sess->hold_requests > 0) {
+            sess->hold_requests--;
+        }
+    }
+
+    pdebug(DEBUG_SPEW, "Done.");
+}
+
+
 /*
  * session_remove_request_unsafe
  *
@@ -1278,6 +1343,7 @@ int process_requests(ab_session_p session)
     ab_request_p bundled_requests[MAX_REQUESTS] = {NULL};
     int num_bundled_requests = 0;
     int remaining_space = 0;
+    int remaining_resp_space = 0;
 
     debug_set_tag_id(0);
 
@@ -1297,8 +1363,8 @@ int process_requests(ab_session_p session)
 
     /* grab a request off the front of the list. */
     critical_block(session->mutex) {
-        /* is there anything to do? */
-        if(vector_length(session->requests)) {
+        /* is there anything to do?  Nothing goes out while requests are held. */
+        if(vector_length(session->requests) && !session->hold_requests) {
             /* get rid of all aborted requests. */
             purge_aborted_requests_unsafe(session);
 
@@ -1307,18 +1373,22 @@ int process_requests(ab_session_p session)
             /* how much space do we have to work with. */
             remaining_space = session->max_payload_size - (int)sizeof(cip_multi_req_header);
 
+            /* the responses must fit too.  Reads can get back much more than they send. */
+            remaining_resp_space = session->max_payload_size - (int)sizeof(cip_multi_resp_header);
+
             if(vector_length(session->requests)) {
                 do {
                     request = vector_get(session->requests, 0);
 
                     remaining_space = remaining_space - get_payload_size(request);
+                    remaining_resp_space = remaining_resp_space - (request->response_size + 2); /* 2 for the multipacket offset. */
 
                     /*
                      * If we have a non-packable request, only queue it if it is the first one.
                      * If the request is packable, keep queuing as long as there is space.
                      */
 
-                    if(num_bundled_requests == 0 || (request->allow_packing && remaining_space > 0)) {
+                    if(num_bundled_requests == 0 || (request->allow_packing && remaining_space > 0 && remaining_resp_space >= 0)) {
                         //pdebug(DEBUG_DETAIL, "packed %d requests with remaining space %d", num_bundled_requests+1, remaining_space);
                         bundled_requests[num_bundled_requests] = request;
                         num_bundled_requests++;
@@ -1326,7 +1396,7 @@ int process_requests(ab_session_p session)
                         /* remove it from the queue. */
                         vector_remove(session->requests, 0);
                     }
-                } while(vector_length(session->requests) && remaining_space > 0 && num_bundled_requests < MAX_REQUESTS && request->allow_packing);
+                } while(vector_length(session->requests) && remaining_space > 0 && remaining_resp_space >= 0 && num_bundled_requests < MAX_REQUESTS && request->allow_packing);
             } else {
                 pdebug(DEBUG_DETAIL, "All requests in queue were aborted, nothing to do.");
             }
@@ -1419,6 +1489,9 @@ int process_requests(ab_session_p session)
                     bundled_requests[i]->status = rc;
                     bundled_requests[i]->request_size = 0;
                     bundled_requests[i]->resp_received = 1;
+
+                    plc_tag_wake_tag(bundled_requests[i]->tag_id);
+
                     bundled_requests[i] = rc_dec(bundled_requests[i]);
                 }
             }
@@ -1550,6 +1623,9 @@ int unpack_response(ab_session_p session, ab_request_p request, int sub_packet)
         request->resp_received = 1;
     }
 
+    /* wake up anything waiting on the tag. */
+    plc_tag_wake_tag(request->tag_id);
+
     pdebug(DEBUG_DETAIL, "Done.");
 
     return PLCTAG_STATUS_OK;
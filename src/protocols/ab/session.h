@@ -98,6 +98,9 @@ struct ab_session_t {
     volatile int terminating;
     mutex_p mutex;
 
+    /* while non-zero, queued requests are not sent. */
+    int hold_requests;
+
     /* disconnect handling */
     int auto_disconnect_enabled;
     int auto_disconnect_timeout_ms;
@@ -119,6 +122,7 @@ struct ab_request_t {
     /* allow requests to be packed in the session */
     int allow_packing;
     int packing_num;
+    int response_size; /* expected CIP response bytes, zero if small or unknown. */
 
     /* time stamp for debugging output */
     int64_t time_sent;
@@ -141,5 +145,8 @@ extern int session_find_or_create(ab_session_p *session, attr attribs);
 extern int session_get_max_payload(ab_session_p session);
 extern int session_create_request(ab_session_p session, int tag_id, ab_request_p *request);
 extern int session_add_request(ab_session_p sess, ab_request_p req);
+extern int session_request_queued(ab_session_p sess, ab_request_p req);
+extern void session_hold_requests(ab_session_p sess);
+extern void session_release_requests(ab_session_p sess);
 
 #endif
@@ -79,8 +79,6 @@ struct ab_tag_t {
     uint8_t encoded_name[MAX_TAG_NAME];
     int encoded_name_size;
 
-//    const char *read_group;
-
     /* storage for the encoded type. */
     uint8_t encoded_type_info[MAX_TAG_TYPE_INFO];
     int encoded_type_info_size;
@@ -113,6 +111,20 @@ struct ab_tag_t {
     int read_in_progress;
     int write_in_progress;
     /*int connect_in_progress;*/
+
+    /* reads shared with other tags on the same array, see coalesce.c */
+    ab_coalesce_p coalesce;
+    int coalesce_index;
+    int coalesce_waiting;
+    uint32_t coalesce_gen;
+
+    /* reads done together with the other tags in the same named group, see read_group.c */
+    ab_read_group_p read_group;
+    ab_tag_p read_group_reader;
+    int read_group_waiting;
+    int read_group_pending;
+    uint32_t read_group_gen;
+    uint32_t read_group_seq;
 };
 
 
@@ -391,11 +391,25 @@ void modbus_tag_destructor(void *tag_arg)
         tag->ext_mutex = NULL;
     }
 
+    if(tag->io_mutex) {
+        mutex_destroy(&(tag->io_mutex));
+        tag->io_mutex = NULL;
+    }
+
+    if(tag->io_cond) {
+        cond_destroy(&(tag->io_cond));
+        tag->io_cond = NULL;
+    }
+
     if(tag->byte_order && tag->byte_order->is_allocated) {
         mem_free(tag->byte_order);
         tag->byte_order = NULL;
     }
 
+    tag_snapshot_destroy((plc_tag_p)tag);
+    tag_change_destroy((plc_tag_p)tag);
+    tag_event_queue_release((plc_tag_p)tag);
+
     pdebug(DEBUG_INFO, "Done.");
 }
 
@@ -1064,6 +1078,9 @@ int check_read_response(modbus_plc_p plc, modbus_tag_p tag)
                 tag->status = (int8_t)rc;
                 tag->request_num = 0;
             }
+
+            /* wake up anything waiting on the tag. */
+            plc_tag_wake_tag(tag->tag_id);
         } else {
             /*
              * keep doing a read, but clear the busy flag so that we
@@ -1261,6 +1278,9 @@ int check_write_response(modbus_plc_p plc, modbus_tag_p tag)
                 tag->write_complete = 1;
                 tag->status = (int8_t)rc;
             }
+
+            /* wake up anything waiting on the tag. */
+            plc_tag_wake_tag(tag->tag_id);
         } else {
             /*
              * keep doing a write, but clear the busy flag so that we
@@ -158,6 +158,14 @@ static void system_tag_destroy(plc_tag_p ptag)
         mutex_destroy(&ptag->ext_mutex);
     }
 
+    if(ptag->io_mutex) {
+        mutex_destroy(&ptag->io_mutex);
+    }
+
+    if(ptag->io_cond) {
+        cond_destroy(&ptag->io_cond);
+    }
+
     if(ptag->api_mutex) {
         mutex_destroy(&ptag->api_mutex);
     }
@@ -167,6 +175,10 @@ static void system_tag_destroy(plc_tag_p ptag)
         tag->byte_order = NULL;
     }
 
+    tag_snapshot_destroy(ptag);
+    tag_change_destroy(ptag);
+    tag_event_queue_release(ptag);
+
     return;
 }
 
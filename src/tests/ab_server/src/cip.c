@@ -73,6 +73,7 @@ const uint8_t CIP_FORWARD_OPEN_EX[] = { 0x5B, 0x02, 0x20, 0x06, 0x24, 0x01 };
 #define CIP_ERR_0x01            ((uint8_t)0x01)
 #define CIP_ERR_FRAG            ((uint8_t)0x06)
 #define CIP_ERR_UNSUPPORTED     ((uint8_t)0x08)
+#define CIP_ERR_EMBEDDED        ((uint8_t)0x1E)
 #define CIP_ERR_EXTENDED        ((uint8_t)0xff)
 
 #define CIP_ERR_EX_TOO_LONG     ((uint16_t)0x2105)
@@ -87,6 +88,7 @@ static slice_s handle_forward_open(slice_s input, slice_s output, plc_s *plc);
 static slice_s handle_forward_close(slice_s input, slice_s output, plc_s *plc);
 static slice_s handle_read_request(slice_s input, slice_s output, plc_s *plc);
 static slice_s handle_write_request(slice_s input, slice_s output, plc_s *plc);
+static slice_s handle_multi_request(slice_s input, slice_s output, plc_s *plc);
 
 static bool process_tag_segment(plc_s *plc, slice_s input, tag_def_s **tag, size_t *start_read_offset);
 static slice_s make_cip_error(slice_s output, uint8_t cip_cmd, uint8_t cip_err, bool extend, uint16_t extended_error);
@@ -106,6 +108,8 @@ slice_s cip_dispatch_request(slice_s input, slice_s output, plc_s *plc)
         return handle_write_request(input, output, plc);
     } else if(slice_match_bytes(input, CIP_WRITE_FRAG, sizeof(CIP_WRITE_FRAG))) {
         return handle_write_request(input, output, plc);
+    } else if(slice_match_bytes(input, CIP_MULTI, sizeof(CIP_MULTI))) {
+        return handle_multi_request(input, output, plc);
     } else if(slice_match_bytes(input, CIP_FORWARD_OPEN, sizeof(CIP_FORWARD_OPEN))) {
         return handle_forward_open(input, output, plc);
     } else if(slice_match_bytes(input, CIP_FORWARD_OPEN_EX, sizeof(CIP_FORWARD_OPEN_EX))) {
@@ -448,7 +452,7 @@ slice_s handle_read_request(slice_s input, slice_s output, plc_s *plc)
 
     /* do we need to fragment the result? */
     remaining_size = total_request_size - byte_offset;
-    packet_capacity = slice_len(output) - 6; /* MAGIC - CIP header plus data type bytes is 6 bytes. */
+    packet_capacity = (slice_len(output) > 6 ? slice_len(output) - 6 : 0); /* MAGIC - CIP header plus data type bytes is 6 bytes. */
 
     info("packet_capacity = %d", packet_capacity);
 
@@ -483,7 +487,7 @@ slice_s handle_read_request(slice_s input, slice_s output, plc_s *plc)
 
     /* FIXME - use memcpy */
     for(size_t i=0; i < amount_to_copy; i++) {
-        slice_set_uint8(output, offset + i, tag->data[byte_offset + i]);
+        slice_set_uint8(output, offset + i, tag->data[read_start_offset + byte_offset + i]);
     }
 
     offset += amount_to_copy;
@@ -567,7 +571,7 @@ slice_s handle_write_request(slice_s input, slice_s output, plc_s *plc)
     info("total_request_size = %d", total_request_size);
 
     /* check the amount */
-    if(byte_offset + total_request_size > tag_data_length) {
+    if(write_start_offset + byte_offset + total_request_size > tag_data_length) {
         info("request tries to write too much data!");
         return make_cip_error(output, write_cmd | CIP_DONE, CIP_ERR_EXTENDED, true, CIP_ERR_EX_TOO_LONG);
     }
@@ -576,7 +580,7 @@ slice_s handle_write_request(slice_s input, slice_s output, plc_s *plc)
     info("byte_offset = %d", byte_offset);
     info("offset = %d", offset);
     info("total_request_size = %d", total_request_size);
-    memcpy(&tag->data[byte_offset], slice_get_bytes(input, offset), total_request_size);
+    memcpy(&tag->data[write_start_offset + byte_offset], slice_get_bytes(input, offset), total_request_size);
 
     /* start making the response. */
     offset = 0;
@@ -759,6 +763,108 @@ bool match_path(slice_s input, bool need_pad, uint8_t *path, uint8_t path_len)
 
 
 
+#define CIP_MULTI_MIN_SIZE (10)
+#define CIP_MULTI_MAX_SIZE (4002)
+
+/*
+ * A multiple service request packs several reads and/or writes into one
+ * packet.  The request and response both have a count of services followed
+ * by the offset of each service.  The offsets are counted from the start of
+ * the count field.
+ *
+ * The input and output share the same buffer, so the request is copied out
+ * before any responses are written.
+ */
+
+slice_s handle_multi_request(slice_s packet, slice_s output, plc_s *plc)
+{
+    uint8_t request_buf[CIP_MULTI_MAX_SIZE];
+    slice_s input;
+    size_t req_base = sizeof(CIP_MULTI);
+    size_t resp_base = 4; /* MAGIC - service, reserved, status and extended status size bytes. */
+    size_t header_size = 0;
+    size_t offset = 0;
+    uint16_t num_requests = 0;
+    bool had_error = false;
+
+    if(slice_len(packet) < CIP_MULTI_MIN_SIZE || slice_len(packet) > CIP_MULTI_MAX_SIZE) {
+        info("Bad size, %d, for the CIP multiple service request!", slice_len(packet));
+        return make_cip_error(output, CIP_MULTI[0] | CIP_DONE, CIP_ERR_UNSUPPORTED, false, 0);
+    }
+
+    memcpy(request_buf, slice_get_bytes(packet, 0), slice_len(packet));
+    input = slice_make(request_buf, (ssize_t)slice_len(packet));
+
+    num_requests = slice_get_uint16_le(input, req_base);
+    header_size = (size_t)(2 + (2 * num_requests));
+
+    if(num_requests == 0 || slice_len(input) < req_base + header_size) {
+        info("Request service count %d does not fit in the CIP multiple service request!", num_requests);
+        return make_cip_error(output, CIP_MULTI[0] | CIP_DONE, CIP_ERR_UNSUPPORTED, false, 0);
+    }
+
+    if(slice_len(output) < resp_base + header_size) {
+        info("Response to %d services will not fit in the output buffer!", num_requests);
+        return make_cip_error(output, CIP_MULTI[0] | CIP_DONE, CIP_ERR_UNSUPPORTED, false, 0);
+    }
+
+    /* the first response goes right after the offsets. */
+    offset = header_size;
+
+    for(uint16_t i=0; i < num_requests; i++) {
+        size_t req_start = slice_get_uint16_le(input, req_base + 2 + (size_t)(i * 2));
+        size_t req_end = slice_len(input) - req_base;
+        slice_s request;
+        slice_s response;
+        slice_s response_space;
+
+        if(i + 1 < num_requests) {
+            req_end = slice_get_uint16_le(input, req_base + 2 + (size_t)((i + 1) * 2));
+        }
+
+        if(req_start < header_size || req_end <= req_start || req_base + req_end > slice_len(input)) {
+            info("Service %d has a bad offset in the CIP multiple service request!", i);
+            return make_cip_error(output, CIP_MULTI[0] | CIP_DONE, CIP_ERR_UNSUPPORTED, false, 0);
+        }
+
+        request = slice_from_slice(input, req_base + req_start, req_end - req_start);
+        response_space = slice_from_slice(output, resp_base + offset, slice_len(output) - (resp_base + offset));
+
+        info("Processing service %d of %d in the CIP multiple service request.", i + 1, num_requests);
+
+        if(slice_match_bytes(request, CIP_READ, sizeof(CIP_READ)) || slice_match_bytes(request, CIP_READ_FRAG, sizeof(CIP_READ_FRAG))) {
+            response = handle_read_request(request, response_space, plc);
+        } else if(slice_match_bytes(request, CIP_WRITE, sizeof(CIP_WRITE)) || slice_match_bytes(request, CIP_WRITE_FRAG, sizeof(CIP_WRITE_FRAG))) {
+            response = handle_write_request(request, response_space, plc);
+        } else {
+            response = make_cip_error(response_space, (uint8_t)(slice_get_uint8(request, 0) | (uint8_t)CIP_DONE), (uint8_t)CIP_ERR_UNSUPPORTED, false, (uint16_t)0);
+        }
+
+        if(slice_has_err(response)) {
+            return response;
+        }
+
+        if(slice_get_uint8(response, 2) != CIP_OK) {
+            had_error = true;
+        }
+
+        slice_set_uint16_le(output, resp_base + 2 + (size_t)(i * 2), (uint16_t)offset);
+
+        offset += slice_len(response);
+    }
+
+    slice_set_uint8(output, 0, CIP_MULTI[0] | CIP_DONE);
+    slice_set_uint8(output, 1, 0); /* reserved, must be zero. */
+    slice_set_uint8(output, 2, (had_error ? CIP_ERR_EMBEDDED : CIP_OK));
+    slice_set_uint8(output, 3, 0); /* no additional bytes of sub-error. */
+    slice_set_uint16_le(output, resp_base, num_requests);
+
+    return slice_from_slice(output, 0, resp_base + offset);
+}
+
+
+
+
 slice_s make_cip_error(slice_s output, uint8_t cip_cmd, uint8_t cip_err, bool extend, uint16_t extended_error)
 {
     size_t result_size = 0;
@@ -40,6 +40,7 @@
 
 #include <util/attr.h>
 #include <platform.h>
+#include <ctype.h>
 #include <stdio.h>
 #include <util/debug.h>
 
@@ -207,6 +208,55 @@ extern attr attr_create_from_str(const char *attr_str)
 
 
 
+/*
+ * attr_copy
+ *
+ * Make a new attr structure with the same entries, in the same order, as
+ * the passed one.  This is cheaper than parsing the attribute string again.
+ */
+extern attr attr_copy(attr attrs)
+{
+    attr res = NULL;
+    attr_entry *tail = NULL;
+
+    if(!attrs) {
+        return NULL;
+    }
+
+    res = attr_create();
+    if(!res) {
+        return NULL;
+    }
+
+    tail = &(res->head);
+
+    for(attr_entry e = attrs->head; e; e = e->next) {
+        attr_entry n = (attr_entry)mem_alloc(sizeof(struct attr_entry_t));
+
+        if(!n) {
+            attr_destroy(res);
+            return NULL;
+        }
+
+        /* link it in first so that attr_destroy() cleans it up. */
+        *tail = n;
+        tail = &(n->next);
+
+        n->name = str_dup(e->name);
+        n->val = str_dup(e->val);
+
+        if(!n->name || !n->val) {
+            attr_destroy(res);
+            return NULL;
+        }
+    }
+
+    return res;
+}
+
+
+
+
 
 /*
  * attr_set
@@ -416,6 +466,93 @@ extern int attr_remove(attr attrs, const char *name)
 }
 
 
+/*
+ * attr_to_sorted_str
+ *
+ * Build an attribute string with the entries sorted by name so that
+ * attribute sets that differ only in order give the same string.  Entries
+ * named in the NULL terminated skip list are left out.  Whitespace in the
+ * values is left out too, so "path=1, 0" and "path=1,0" match.  The caller
+ * must free the result.
+ */
+extern char *attr_to_sorted_str(attr attrs, const char **skip_names)
+{
+    attr_entry e;
+    attr_entry *entries = NULL;
+    int num_entries = 0;
+    int length = 1;
+    char *res = NULL;
+    char *cur = NULL;
+
+    if(!attrs) {
+        return NULL;
+    }
+
+    for(e = attrs->head; e; e = e->next) {
+        num_entries++;
+    }
+
+    entries = (attr_entry *)mem_alloc((num_entries ? num_entries : 1) * (int)sizeof(attr_entry));
+    if(!entries) {
+        return NULL;
+    }
+
+    num_entries = 0;
+
+    for(e = attrs->head; e; e = e->next) {
+        int skip = 0;
+        int i;
+
+        for(i = 0; skip_names && skip_names[i]; i++) {
+            if(str_cmp(e->name, skip_names[i]) == 0) {
+                skip = 1;
+                break;
+            }
+        }
+
+        if(skip) {
+            continue;
+        }
+
+        /* insertion sort, attribute lists are short. */
+        for(i = num_entries; i > 0 && str_cmp(entries[i-1]->name, e->name) > 0; i--) {
+            entries[i] = entries[i-1];
+        }
+
+        entries[i] = e;
+        num_entries++;
+
+        length += str_length(e->name) + str_length(e->val) + 2;
+    }
+
+    res = (char *)mem_alloc(length);
+    if(res) {
+        cur = res;
+
+        for(int i = 0; i < num_entries; i++) {
+            int remaining = length - (int)(cur - res);
+
+            snprintf_platform(cur, (size_t)remaining, "%s%s=", (i ? "&" : ""), entries[i]->name);
+            cur += str_length(cur);
+
+            for(const char *val = entries[i]->val; val && *val; val++) {
+                if(!isspace((unsigned char)*val)) {
+                    *cur = *val;
+                    cur++;
+                }
+            }
+
+            *cur = 0;
+        }
+    }
+
+    mem_free(entries);
+
+    return res;
+}
+
+
+
 /*
  * attr_delete
  *
@@ -40,6 +40,7 @@ typedef struct attr_t *attr;
 attr_entry find_entry(attr a, const char *name);
 extern attr attr_create(void);
 extern attr attr_create_from_str(const char *attr_str);
+extern attr attr_copy(attr attrs);
 extern int attr_set_str(attr attrs, const char *name, const char *val);
 extern int attr_set_int(attr attrs, const char *name, int val);
 extern int attr_set_float(attr attrs, const char *name, float val);
@@ -47,6 +48,7 @@ extern const char *attr_get_str(attr attrs, const char *name, const char *def);
 extern int attr_get_int(attr attrs, const char *name, int def);
 extern float attr_get_float(attr attrs, const char *name, float def);
 extern int attr_remove(attr attrs, const char *name);
+extern char *attr_to_sorted_str(attr attrs, const char **skip_names);
 extern void attr_destroy(attr attrs);
 
 
@@ -0,0 +1,552 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by Kyle Hayes                                      *
+ *   Author Kyle Hayes  kyle.hayes@gmail.com                               *
+ *                                                                         *
+ * This software is available under either the Mozilla Public License      *
+ * version 2.0 or the GNU LGPL version 2 (or later) license, whichever     *
+ * you choose.                                                             *
+ *                                                                         *
+ * MPL 2.0:                                                                *
+ *                                                                         *
+ *   This Source Code Form is subject to the terms of the Mozilla Public   *
+ *   License, v. 2.0. If a copy of the MPL was not distributed with this   *
+ *   file, You can obtain one at http://mozilla.org/MPL/2.0/.              *
+ *                                                                         *
+ *                                                                         *
+ * LGPL 2:                                                                 *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU Library General Public License as       *
+ *   published by the Free Software Foundation; either version 2 of the    *
+ *   License, or (at your option) any later version.                       *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU Library General Public     *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include <string.h>
+#include <lib/libplctag.h>
+#include <platform.h>
+#include <util/byte_shuffle.h>
+#include <util/debug.h>
+
+/*
+ * Each order table is turned into a permutation of the bytes within one
+ * element as laid out in host memory: host byte j comes from PLC byte
+ * perm[j].  Three permutations cover nearly all PLCs:
+ *
+ *   identity      - Logix, Omron and PCCC integers on a little-endian host.
+ *   reversed      - Modbus, or any little-endian PLC on a big-endian host.
+ *   words swapped - PLC-5 floats.
+ *
+ * Those get kernels that do one unaligned load or store plus, at most, a
+ * byte swap.  Everything else walks the order table byte by byte as the
+ * accessors always did.
+ *
+ * The loads and stores use memcpy() directly so that the compiler can turn
+ * them into single instructions.
+ */
+
+#define MAX_ELEM_SIZE (8)
+
+#if defined(__GNUC__) || defined(__clang__)
+    #define swap16(v) __builtin_bswap16(v)
+    #define swap32(v) __builtin_bswap32(v)
+    #define swap64(v) __builtin_bswap64(v)
+#elif defined(_MSC_VER)
+    #include <stdlib.h>
+    #define swap16(v) _byteswap_ushort(v)
+    #define swap32(v) _byteswap_ulong(v)
+    #define swap64(v) _byteswap_uint64(v)
+#else
+    inline static uint16_t swap16(uint16_t v)
+    {
+        return (uint16_t)((v << 8) | (v >> 8));
+    }
+
+    inline static uint32_t swap32(uint32_t v)
+    {
+        v = ((v & 0x00FF00FFu) << 8) | ((v >> 8) & 0x00FF00FFu);
+        return (v << 16) | (v >> 16);
+    }
+
+    inline static uint64_t swap64(uint64_t v)
+    {
+        return ((uint64_t)swap32((uint32_t)v) << 32) | (uint64_t)swap32((uint32_t)(v >> 32));
+    }
+#endif
+
+
+inline static uint32_t word_swap32(uint32_t v)
+{
+    return (v << 16) | (v >> 16);
+}
+
+
+inline static uint64_t word_swap64(uint64_t v)
+{
+    v = swap64(v);
+
+    return ((v & 0x00FF00FF00FF00FFull) << 8) | ((v >> 8) & 0x00FF00FF00FF00FFull);
+}
+
+
+static byte_shuffle_kind_t classify(const int *order, int elem_size);
+
+static uint64_t get16_native(const uint8_t *data, const int *order);
+static uint64_t get16_swap(const uint8_t *data, const int *order);
+static uint64_t get16_generic(const uint8_t *data, const int *order);
+static uint64_t get32_native(const uint8_t *data, const int *order);
+static uint64_t get32_swap(const uint8_t *data, const int *order);
+static uint64_t get32_word_swap(const uint8_t *data, const int *order);
+static uint64_t get32_generic(const uint8_t *data, const int *order);
+static uint64_t get64_native(const uint8_t *data, const int *order);
+static uint64_t get64_swap(const uint8_t *data, const int *order);
+static uint64_t get64_word_swap(const uint8_t *data, const int *order);
+static uint64_t get64_generic(const uint8_t *data, const int *order);
+
+static void set16_native(uint8_t *data, const int *order, uint64_t val);
+static void set16_swap(uint8_t *data, const int *order, uint64_t val);
+static void set16_generic(uint8_t *data, const int *order, uint64_t val);
+static void set32_native(uint8_t *data, const int *order, uint64_t val);
+static void set32_swap(uint8_t *data, const int *order, uint64_t val);
+static void set32_word_swap(uint8_t *data, const int *order, uint64_t val);
+static void set32_generic(uint8_t *data, const int *order, uint64_t val);
+static void set64_native(uint8_t *data, const int *order, uint64_t val);
+static void set64_swap(uint8_t *data, const int *order, uint64_t val);
+static void set64_word_swap(uint8_t *data, const int *order, uint64_t val);
+static void set64_generic(uint8_t *data, const int *order, uint64_t val);
+
+static void swap_array(const byte_shuffle_kernel_t *kernel, const uint8_t *src, uint8_t *dest, int count);
+
+
+int byte_shuffle_kernel_init(byte_shuffle_kernel_t *kernel, const int *order, int elem_size)
+{
+    if(!kernel || !order) {
+        pdebug(DEBUG_WARN, "Called with null pointer!");
+        return PLCTAG_ERR_NULL_PTR;
+    }
+
+    kernel->kind = classify(order, elem_size);
+    kernel->elem_size = elem_size;
+    kernel->order = order;
+
+    switch(elem_size) {
+        case 2:
+            switch(kernel->kind) {
+                case BYTE_SHUFFLE_NATIVE: kernel->get = get16_native; kernel->set = set16_native; break;
+                case BYTE_SHUFFLE_SWAP: kernel->get = get16_swap; kernel->set = set16_swap; break;
+                default: kernel->get = get16_generic; kernel->set = set16_generic; break;
+            }
+            break;
+
+        case 4:
+            switch(kernel->kind) {
+                case BYTE_SHUFFLE_NATIVE: kernel->get = get32_native; kernel->set = set32_native; break;
+                case BYTE_SHUFFLE_SWAP: kernel->get = get32_swap; kernel->set = set32_swap; break;
+                case BYTE_SHUFFLE_WORD_SWAP: kernel->get = get32_word_swap; kernel->set = set32_word_swap; break;
+                default: kernel->get = get32_generic; kernel->set = set32_generic; break;
+            }
+            break;
+
+        case 8:
+            switch(kernel->kind) {
+                case BYTE_SHUFFLE_NATIVE: kernel->get = get64_native; kernel->set = set64_native; break;
+                case BYTE_SHUFFLE_SWAP: kernel->get = get64_swap; kernel->set = set64_swap; break;
+                case BYTE_SHUFFLE_WORD_SWAP: kernel->get = get64_word_swap; kernel->set = set64_word_swap; break;
+                default: kernel->get = get64_generic; kernel->set = set64_generic; break;
+            }
+            break;
+
+        default:
+            pdebug(DEBUG_WARN, "Unsupported element size %d!", elem_size);
+            return PLCTAG_ERR_BAD_PARAM;
+    }
+
+    pdebug(DEBUG_DETAIL, "Using kernel type %d for %d byte elements.", (int)kernel->kind, elem_size);
+
+    return PLCTAG_STATUS_OK;
+}
+
+
+void byte_shuffle_decode(const byte_shuffle_kernel_t *kernel, const uint8_t *plc_data, uint8_t *host_data, int count)
+{
+    if(!kernel) {
+        memmove(host_data, plc_data, (size_t)(unsigned int)count);
+        return;
+    }
+
+    switch(kernel->kind) {
+        case BYTE_SHUFFLE_NATIVE:
+            memmove(host_data, plc_data, (size_t)(unsigned int)(kernel->elem_size * count));
+            break;
+
+        case BYTE_SHUFFLE_SWAP:
+        case BYTE_SHUFFLE_WORD_SWAP:
+            swap_array(kernel, plc_data, host_data, count);
+            break;
+
+        default:
+            for(int i=0; i < count; i++) {
+                uint64_t val = kernel->get(plc_data, kernel->order);
+
+                switch(kernel->elem_size) {
+                    case 2: { uint16_t v16 = (uint16_t)val; memcpy(host_data, &v16, sizeof(v16)); break; }
+                    case 4: { uint32_t v32 = (uint32_t)val; memcpy(host_data, &v32, sizeof(v32)); break; }
+                    default: memcpy(host_data, &val, sizeof(val)); break;
+                }
+
+                plc_data += kernel->elem_size;
+                host_data += kernel->elem_size;
+            }
+            break;
+    }
+}
+
+
+void byte_shuffle_encode(const byte_shuffle_kernel_t *kernel, const uint8_t *host_data, uint8_t *plc_data, int count)
+{
+    if(!kernel) {
+        memmove(plc_data, host_data, (size_t)(unsigned int)count);
+        return;
+    }
+
+    switch(kernel->kind) {
+        case BYTE_SHUFFLE_NATIVE:
+            memmove(plc_data, host_data, (size_t)(unsigned int)(kernel->elem_size * count));
+            break;
+
+        case BYTE_SHUFFLE_SWAP:
+        case BYTE_SHUFFLE_WORD_SWAP:
+            /* both swaps undo themselves. */
+            swap_array(kernel, host_data, plc_data, count);
+            break;
+
+        default:
+            for(int i=0; i < count; i++) {
+                uint64_t val = 0;
+
+                switch(kernel->elem_size) {
+                    case 2: { uint16_t v16 = 0; memcpy(&v16, host_data, sizeof(v16)); val = v16; break; }
+                    case 4: { uint32_t v32 = 0; memcpy(&v32, host_data, sizeof(v32)); val = v32; break; }
+                    default: memcpy(&val, host_data, sizeof(val)); break;
+                }
+
+                kernel->set(plc_data, kernel->order, val);
+
+                plc_data += kernel->elem_size;
+                host_data += kernel->elem_size;
+            }
+            break;
+    }
+}
+
+
+
+
+/***********************************************************************
+ *************************** Helper Functions **************************
+ **********************************************************************/
+
+
+byte_shuffle_kind_t classify(const int *order, int elem_size)
+{
+    const uint16_t endian_test = 1;
+    int host_is_little_endian = (*((const uint8_t *)&endian_test) == 1);
+    int perm[MAX_ELEM_SIZE] = {0};
+    int is_native = 1;
+    int is_swap = 1;
+    int is_word_swap = (elem_size >= 4);
+
+    if(elem_size > MAX_ELEM_SIZE) {
+        return BYTE_SHUFFLE_GENERIC;
+    }
+
+    for(int i=0; i < elem_size; i++) {
+        int host_index = (host_is_little_endian ? i : (elem_size - 1 - i));
+
+        perm[host_index] = order[i];
+    }
+
+    for(int i=0; i < elem_size; i++) {
+        if(perm[i] != i) {
+            is_native = 0;
+        }
+
+        if(perm[i] != elem_size - 1 - i) {
+            is_swap = 0;
+        }
+
+        if(perm[i] != (elem_size - 2 - (i & ~1)) + (i & 1)) {
+            is_word_swap = 0;
+        }
+    }
+
+    if(is_native) {
+        return BYTE_SHUFFLE_NATIVE;
+    }
+
+    if(is_swap) {
+        return BYTE_SHUFFLE_SWAP;
+    }
+
+    if(is_word_swap) {
+        return BYTE_SHUFFLE_WORD_SWAP;
+    }
+
+    return BYTE_SHUFFLE_GENERIC;
+}
+
+
+
+uint64_t get16_native(const uint8_t *data, const int *order)
+{
+    uint16_t val = 0;
+
+    (void)order;
+
+    memcpy(&val, data, sizeof(val));
+
+    return val;
+}
+
+
+uint64_t get16_swap(const uint8_t *data, const int *order)
+{
+    return (uint16_t)swap16((uint16_t)get16_native(data, order));
+}
+
+
+uint64_t get16_generic(const uint8_t *data, const int *order)
+{
+    return ((uint64_t)(data[order[0]]) << 0) +
+           ((uint64_t)(data[order[1]]) << 8);
+}
+
+
+uint64_t get32_native(const uint8_t *data, const int *order)
+{
+    uint32_t val = 0;
+
+    (void)order;
+
+    memcpy(&val, data, sizeof(val));
+
+    return val;
+}
+
+
+uint64_t get32_swap(const uint8_t *data, const int *order)
+{
+    return swap32((uint32_t)get32_native(data, order));
+}
+
+
+uint64_t get32_word_swap(const uint8_t *data, const int *order)
+{
+    return word_swap32((uint32_t)get32_native(data, order));
+}
+
+
+uint64_t get32_generic(const uint8_t *data, const int *order)
+{
+    return ((uint64_t)(data[order[0]]) << 0 ) +
+           ((uint64_t)(data[order[1]]) << 8 ) +
+           ((uint64_t)(data[order[2]]) << 16) +
+           ((uint64_t)(data[order[3]]) << 24);
+}
+
+
+uint64_t get64_native(const uint8_t *data, const int *order)
+{
+    uint64_t val = 0;
+
+    (void)order;
+
+    memcpy(&val, data, sizeof(val));
+
+    return val;
+}
+
+
+uint64_t get64_swap(const uint8_t *data, const int *order)
+{
+    return swap64(get64_native(data, order));
+}
+
+
+uint64_t get64_word_swap(const uint8_t *data, const int *order)
+{
+    return word_swap64(get64_native(data, order));
+}
+
+
+uint64_t get64_generic(const uint8_t *data, const int *order)
+{
+    return ((uint64_t)(data[order[0]]) << 0 ) +
+           ((uint64_t)(data[order[1]]) << 8 ) +
+           ((uint64_t)(data[order[2]]) << 16) +
+           ((uint64_t)(data[order[3]]) << 24) +
+           ((uint64_t)(data[order[4]]) << 32) +
+           ((uint64_t)(data[order[5]]) << 40) +
+           ((uint64_t)(data[order[6]]) << 48) +
+           ((uint64_t)(data[order[7]]) << 56);
+}
+
+
+
+void set16_native(uint8_t *data, const int *order, uint64_t val)
+{
+    uint16_t val16 = (uint16_t)val;
+
+    (void)order;
+
+    memcpy(data, &val16, sizeof(val16));
+}
+
+
+void set16_swap(uint8_t *data, const int *order, uint64_t val)
+{
+    set16_native(data, order, (uint16_t)swap16((uint16_t)val));
+}
+
+
+void set16_generic(uint8_t *data, const int *order, uint64_t val)
+{
+    data[order[0]] = (uint8_t)((val >> 0) & 0xFF);
+    data[order[1]] = (uint8_t)((val >> 8) & 0xFF);
+}
+
+
+void set32_native(uint8_t *data, const int *order, uint64_t val)
+{
+    uint32_t val32 = (uint32_t)val;
+
+    (void)order;
+
+    memcpy(data, &val32, sizeof(val32));
+}
+
+
+void set32_swap(uint8_t *data, const int *order, uint64_t val)
+{
+    set32_native(data, order, swap32((uint32_t)val));
+}
+
+
+void set32_word_swap(uint8_t *data, const int *order, uint64_t val)
+{
+    set32_native(data, order, word_swap32((uint32_t)val));
+}
+
+
+void set32_generic(uint8_t *data, const int *order, uint64_t val)
+{
+    data[order[0]] = (uint8_t)((val >> 0 ) & 0xFF);
+    data[order[1]] = (uint8_t)((val >> 8 ) & 0xFF);
+    data[order[2]] = (uint8_t)((val >> 16) & 0xFF);
+    data[order[3]] = (uint8_t)((val >> 24) & 0xFF);
+}
+
+
+void set64_native(uint8_t *data, const int *order, uint64_t val)
+{
+    (void)order;
+
+    memcpy(data, &val, sizeof(val));
+}
+
+
+void set64_swap(uint8_t *data, const int *order, uint64_t val)
+{
+    set64_native(data, order, swap64(val));
+}
+
+
+void set64_word_swap(uint8_t *data, const int *order, uint64_t val)
+{
+    set64_native(data, order, word_swap64(val));
+}
+
+
+void set64_generic(uint8_t *data, const int *order, uint64_t val)
+{
+    data[order[0]] = (uint8_t)((val >> 0 ) & 0xFF);
+    data[order[1]] = (uint8_t)((val >> 8 ) & 0xFF);
+    data[order[2]] = (uint8_t)((val >> 16) & 0xFF);
+    data[order[3]] = (uint8_t)((val >> 24) & 0xFF);
+    data[order[4]] = (uint8_t)((val >> 32) & 0xFF);
+    data[order[5]] = (uint8_t)((val >> 40) & 0xFF);
+    data[order[6]] = (uint8_t)((val >> 48) & 0xFF);
+    data[order[7]] = (uint8_t)((val >> 56) & 0xFF);
+}
+
+
+
+/*
+ * Swap every element of a run.  The loops are kept separate and simple so
+ * that the compiler can vectorize them.
+ */
+
+void swap_array(const byte_shuffle_kernel_t *kernel, const uint8_t *src, uint8_t *dest, int count)
+{
+    int word_swap = (kernel->kind == BYTE_SHUFFLE_WORD_SWAP);
+
+    switch(kernel->elem_size) {
+        case 2:
+            for(int i=0; i < count; i++) {
+                uint16_t val = 0;
+                memcpy(&val, src + (i * 2), sizeof(val));
+                val = (uint16_t)swap16(val);
+                memcpy(dest + (i * 2), &val, sizeof(val));
+            }
+            break;
+
+        case 4:
+            if(word_swap) {
+                for(int i=0; i < count; i++) {
+                    uint32_t val = 0;
+                    memcpy(&val, src + (i * 4), sizeof(val));
+                    val = word_swap32(val);
+                    memcpy(dest + (i * 4), &val, sizeof(val));
+                }
+            } else {
+                for(int i=0; i < count; i++) {
+                    uint32_t val = 0;
+                    memcpy(&val, src + (i * 4), sizeof(val));
+                    val = swap32(val);
+                    memcpy(dest + (i * 4), &val, sizeof(val));
+                }
+            }
+            break;
+
+        case 8:
+            if(word_swap) {
+                for(int i=0; i < count; i++) {
+                    uint64_t val = 0;
+                    memcpy(&val, src + (i * 8), sizeof(val));
+                    val = word_swap64(val);
+                    memcpy(dest + (i * 8), &val, sizeof(val));
+                }
+            } else {
+                for(int i=0; i < count; i++) {
+                    uint64_t val = 0;
+                    memcpy(&val, src + (i * 8), sizeof(val));
+                    val = swap64(val);
+                    memcpy(dest + (i * 8), &val, sizeof(val));
+                }
+            }
+            break;
+
+        default:
+            pdebug(DEBUG_WARN, "Unsupported element size %d!", kernel->elem_size);
+            break;
+    }
+}
@@ -0,0 +1,76 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by Kyle Hayes                                      *
+ *   Author Kyle Hayes  kyle.hayes@gmail.com                               *
+ *                                                                         *
+ * This software is available under either the Mozilla Public License      *
+ * version 2.0 or the GNU LGPL version 2 (or later) license, whichever     *
+ * you choose.                                                             *
+ *                                                                         *
+ * MPL 2.0:                                                                *
+ *                                                                         *
+ *   This Source Code Form is subject to the terms of the Mozilla Public   *
+ *   License, v. 2.0. If a copy of the MPL was not distributed with this   *
+ *   file, You can obtain one at http://mozilla.org/MPL/2.0/.              *
+ *                                                                         *
+ *                                                                         *
+ * LGPL 2:                                                                 *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU Library General Public License as       *
+ *   published by the Free Software Foundation; either version 2 of the    *
+ *   License, or (at your option) any later version.                       *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU Library General Public     *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#ifndef __UTIL_BYTE_SHUFFLE_H__
+#define __UTIL_BYTE_SHUFFLE_H__ 1
+
+#include <stdint.h>
+
+/*
+ * Convert values between a PLC byte order and the host's.
+ *
+ * The order tables are the same as the ones in the tag byte order
+ * definitions: order[n] is the offset in the PLC data of the nth byte of
+ * the value, counting from the least significant byte.
+ *
+ * Almost every PLC uses one of a few layouts, so each order table is
+ * classified once and a kernel for that layout is picked.  Anything
+ * unusual falls back to walking the order table.
+ */
+
+typedef enum {
+    BYTE_SHUFFLE_NATIVE,      /* same as the host, a plain load or store. */
+    BYTE_SHUFFLE_SWAP,        /* all bytes reversed. */
+    BYTE_SHUFFLE_WORD_SWAP,   /* 16-bit words reversed, bytes within words kept. */
+    BYTE_SHUFFLE_GENERIC      /* anything else, use the order table. */
+} byte_shuffle_kind_t;
+
+typedef struct {
+    byte_shuffle_kind_t kind;
+    int elem_size;
+    const int *order;
+    uint64_t (*get)(const uint8_t *data, const int *order);
+    void (*set)(uint8_t *data, const int *order, uint64_t val);
+} byte_shuffle_kernel_t;
+
+extern int byte_shuffle_kernel_init(byte_shuffle_kernel_t *kernel, const int *order, int elem_size);
+
+/*
+ * a NULL kernel means single byte elements that are copied as is.
+ *
+ * The source and destination may be the same buffer.
+ */
+extern void byte_shuffle_decode(const byte_shuffle_kernel_t *kernel, const uint8_t *plc_data, uint8_t *host_data, int count);
+extern void byte_shuffle_encode(const byte_shuffle_kernel_t *kernel, const uint8_t *host_data, uint8_t *plc_data, int count);
+
+#endif
@@ -0,0 +1,360 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by Kyle Hayes                                      *
+ *   Author Kyle Hayes  kyle.hayes@gmail.com                               *
+ *                                                                         *
+ * This software is available under either the Mozilla Public License      *
+ * version 2.0 or the GNU LGPL version 2 (or later) license, whichever     *
+ * you choose.                                                             *
+ *                                                                         *
+ * MPL 2.0:                                                                *
+ *                                                                         *
+ *   This Source Code Form is subject to the terms of the Mozilla Public   *
+ *   License, v. 2.0. If a copy of the MPL was not distributed with this   *
+ *   file, You can obtain one at http://mozilla.org/MPL/2.0/.              *
+ *                                                                         *
+ *                                                                         *
+ * LGPL 2:                                                                 *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU Library General Public License as       *
+ *   published by the Free Software Foundation; either version 2 of the    *
+ *   License, or (at your option) any later version.                       *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU Library General Public     *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include <lib/libplctag.h>
+#include <platform.h>
+#include <util/callback_executor.h>
+#include <util/debug.h>
+#include <util/rc.h>
+
+/*
+ * Each worker has a ring of pending callbacks protected by its own mutex.
+ * Producers only hold that mutex long enough to copy an entry in, so a slow
+ * callback only holds up the other tags that hash to the same worker.
+ *
+ * Shutting down sets the terminating flag under each worker's mutex.  After
+ * that, submissions to the worker fail and the worker exits once its ring is
+ * empty, so nothing that was accepted is lost.
+ */
+
+#define CALLBACK_EXECUTOR_MAX_THREADS (64)
+#define CALLBACK_EXECUTOR_DEFAULT_QUEUE_SIZE (1024)
+#define CALLBACK_EXECUTOR_MAX_QUEUE_SIZE (1 << 20)
+#define CALLBACK_EXECUTOR_WAIT_MS (200)
+
+struct callback_entry_t {
+    callback_executor_func_t callback;
+    int32_t tag_id;
+    int event;
+    int status;
+    int64_t queued_time;
+};
+
+struct callback_worker_t {
+    struct callback_executor_t *executor;
+
+    mutex_p mutex;
+    cond_p cond;
+    thread_p thread;
+
+    int terminating;
+
+    int head;
+    int count;
+    struct callback_entry_t *entries;
+};
+
+struct callback_executor_t {
+    int num_threads;
+    int queue_size;
+    int late_ms;
+
+    volatile int32_t dropped;
+    volatile int32_t late;
+
+    struct callback_worker_t *workers;
+};
+
+
+static void callback_executor_destroy(void *executor_arg);
+static int callback_worker_init(callback_executor_p executor, struct callback_worker_t *worker);
+static void callback_worker_shutdown(struct callback_worker_t *worker);
+static THREAD_FUNC(callback_worker_func);
+
+
+callback_executor_p callback_executor_create(int num_threads, int queue_size, int late_ms)
+{
+    callback_executor_p executor = NULL;
+    int rc = PLCTAG_STATUS_OK;
+
+    pdebug(DEBUG_INFO, "Starting.");
+
+    if(num_threads <= 0 || num_threads > CALLBACK_EXECUTOR_MAX_THREADS) {
+        pdebug(DEBUG_WARN, "Number of threads, %d, must be between 1 and %d!", num_threads, CALLBACK_EXECUTOR_MAX_THREADS);
+        return NULL;
+    }
+
+    if(queue_size <= 0) {
+        queue_size = CALLBACK_EXECUTOR_DEFAULT_QUEUE_SIZE;
+    }
+
+    if(queue_size > CALLBACK_EXECUTOR_MAX_QUEUE_SIZE) {
+        pdebug(DEBUG_WARN, "Queue size %d is too large!", queue_size);
+        return NULL;
+    }
+
+    executor = (callback_executor_p)rc_alloc((int)sizeof(struct callback_executor_t), callback_executor_destroy);
+    if(!executor) {
+        pdebug(DEBUG_ERROR, "Unable to allocate callback executor!");
+        return NULL;
+    }
+
+    executor->queue_size = queue_size;
+    executor->late_ms = late_ms;
+
+    executor->workers = (struct callback_worker_t *)mem_alloc(num_threads * (int)sizeof(struct callback_worker_t));
+    if(!executor->workers) {
+        pdebug(DEBUG_ERROR, "Unable to allocate %d callback workers!", num_threads);
+        rc_dec(executor);
+        return NULL;
+    }
+
+    /* num_threads only counts the workers that were set up, so that cleanup works part way through. */
+    for(int i=0; i < num_threads; i++) {
+        rc = callback_worker_init(executor, &executor->workers[i]);
+        if(rc != PLCTAG_STATUS_OK) {
+            pdebug(DEBUG_ERROR, "Unable to set up callback worker %d, error %s!", i, plc_tag_decode_error(rc));
+            callback_worker_shutdown(&executor->workers[i]);
+            rc_dec(executor);
+            return NULL;
+        }
+
+        executor->num_threads++;
+    }
+
+    pdebug(DEBUG_INFO, "Done.");
+
+    return executor;
+}
+
+
+
+int callback_executor_submit(callback_executor_p executor, callback_executor_func_t callback, int32_t tag_id, int event, int status)
+{
+    struct callback_worker_t *worker = NULL;
+    int rc = PLCTAG_STATUS_OK;
+
+    pdebug(DEBUG_SPEW, "Starting.");
+
+    if(!executor || !callback) {
+        pdebug(DEBUG_WARN, "Null executor or callback pointer!");
+        return PLCTAG_ERR_NULL_PTR;
+    }
+
+    /* keep all of a tag's events on one worker to keep them in order. */
+    worker = &executor->workers[(uint32_t)tag_id % (uint32_t)executor->num_threads];
+
+    critical_block(worker->mutex) {
+        if(worker->terminating) {
+            rc = PLCTAG_ERR_NOT_ALLOWED;
+        } else if(worker->count >= executor->queue_size) {
+            rc = PLCTAG_ERR_NO_RESOURCES;
+        } else {
+            struct callback_entry_t *entry = &worker->entries[(worker->head + worker->count) % executor->queue_size];
+
+            entry->callback = callback;
+            entry->tag_id = tag_id;
+            entry->event = event;
+            entry->status = status;
+            entry->queued_time = time_ms();
+
+            worker->count++;
+        }
+    }
+
+    if(rc == PLCTAG_STATUS_OK) {
+        cond_signal(worker->cond);
+    } else if(rc == PLCTAG_ERR_NO_RESOURCES) {
+        atomic_int32_add(&executor->dropped, 1);
+        pdebug(DEBUG_WARN, "Callback queue full, dropping event %d for tag %d!", event, (int)tag_id);
+    }
+
+    pdebug(DEBUG_SPEW, "Done.");
+
+    return rc;
+}
+
+
+
+int callback_executor_get_dropped(callback_executor_p executor)
+{
+    if(!executor) {
+        return PLCTAG_ERR_NULL_PTR;
+    }
+
+    return (int)atomic_int32_add(&executor->dropped, 0);
+}
+
+
+int callback_executor_get_late(callback_executor_p executor)
+{
+    if(!executor) {
+        return PLCTAG_ERR_NULL_PTR;
+    }
+
+    return (int)atomic_int32_add(&executor->late, 0);
+}
+
+
+
+/***********************************************************************
+ ************************ Helper Functions *****************************
+ **********************************************************************/
+
+
+void callback_executor_destroy(void *executor_arg)
+{
+    callback_executor_p executor = (callback_executor_p)executor_arg;
+
+    pdebug(DEBUG_INFO, "Starting.");
+
+    if(!executor) {
+        pdebug(DEBUG_WARN, "Null executor pointer!");
+        return;
+    }
+
+    if(executor->workers) {
+        for(int i=0; i < executor->num_threads; i++) {
+            callback_worker_shutdown(&executor->workers[i]);
+        }
+
+        mem_free(executor->workers);
+        executor->workers = NULL;
+    }
+
+    pdebug(DEBUG_INFO, "Done.");
+}
+
+
+
+int callback_worker_init(callback_executor_p executor, struct callback_worker_t *worker)
+{
+    int rc = PLCTAG_STATUS_OK;
+
+    worker->executor = executor;
+
+    worker->entries = (struct callback_entry_t *)mem_alloc(executor->queue_size * (int)sizeof(struct callback_entry_t));
+    if(!worker->entries) {
+        pdebug(DEBUG_ERROR, "Unable to allocate callback queue!");
+        return PLCTAG_ERR_NO_MEM;
+    }
+
+    rc = mutex_create(&worker->mutex);
+    if(rc != PLCTAG_STATUS_OK) {
+        pdebug(DEBUG_ERROR, "Unable to create callback worker mutex!");
+        return rc;
+    }
+
+    rc = cond_create(&worker->cond);
+    if(rc != PLCTAG_STATUS_OK) {
+        pdebug(DEBUG_ERROR, "Unable to create callback worker condition variable!");
+        return rc;
+    }
+
+    rc = thread_create(&worker->thread, callback_worker_func, 32*1024, worker);
+    if(rc != PLCTAG_STATUS_OK) {
+        pdebug(DEBUG_ERROR, "Unable to create callback worker thread!");
+        return rc;
+    }
+
+    return PLCTAG_STATUS_OK;
+}
+
+
+
+/* this handles partially set up workers too. */
+void callback_worker_shutdown(struct callback_worker_t *worker)
+{
+    if(worker->thread) {
+        critical_block(worker->mutex) {
+            worker->terminating = 1;
+        }
+
+        cond_signal(worker->cond);
+
+        thread_join(worker->thread);
+        thread_destroy(&worker->thread);
+        worker->thread = NULL;
+    }
+
+    if(worker->cond) {
+        cond_destroy(&worker->cond);
+        worker->cond = NULL;
+    }
+
+    if(worker->mutex) {
+        mutex_destroy(&worker->mutex);
+        worker->mutex = NULL;
+    }
+
+    if(worker->entries) {
+        mem_free(worker->entries);
+        worker->entries = NULL;
+    }
+}
+
+
+
+THREAD_FUNC(callback_worker_func)
+{
+    struct callback_worker_t *worker = (struct callback_worker_t *)arg;
+    callback_executor_p executor = worker->executor;
+    int done = 0;
+
+    debug_set_tag_id(0);
+
+    pdebug(DEBUG_INFO, "Starting.");
+
+    while(!done) {
+        uint32_t seq = cond_seq(worker->cond);
+        struct callback_entry_t entry;
+        int have_entry = 0;
+
+        critical_block(worker->mutex) {
+            if(worker->count > 0) {
+                entry = worker->entries[worker->head];
+                worker->head = (worker->head + 1) % executor->queue_size;
+                worker->count--;
+                have_entry = 1;
+            } else if(worker->terminating) {
+                done = 1;
+            }
+        }
+
+        if(have_entry) {
+            if(executor->late_ms > 0 && time_ms() - entry.queued_time > executor->late_ms) {
+                atomic_int32_add(&executor->late, 1);
+            }
+
+            debug_set_tag_id(entry.tag_id);
+            entry.callback(entry.tag_id, entry.event, entry.status);
+            debug_set_tag_id(0);
+        } else if(!done) {
+            cond_wait(worker->cond, &seq, CALLBACK_EXECUTOR_WAIT_MS);
+        }
+    }
+
+    pdebug(DEBUG_INFO, "Done.");
+
+    THREAD_RETURN(0);
+}
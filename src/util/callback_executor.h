@@ -0,0 +1,62 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by Kyle Hayes                                      *
+ *   Author Kyle Hayes  kyle.hayes@gmail.com                               *
+ *                                                                         *
+ * This software is available under either the Mozilla Public License      *
+ * version 2.0 or the GNU LGPL version 2 (or later) license, whichever     *
+ * you choose.                                                             *
+ *                                                                         *
+ * MPL 2.0:                                                                *
+ *                                                                         *
+ *   This Source Code Form is subject to the terms of the Mozilla Public   *
+ *   License, v. 2.0. If a copy of the MPL was not distributed with this   *
+ *   file, You can obtain one at http://mozilla.org/MPL/2.0/.              *
+ *                                                                         *
+ *                                                                         *
+ * LGPL 2:                                                                 *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU Library General Public License as       *
+ *   published by the Free Software Foundation; either version 2 of the    *
+ *   License, or (at your option) any later version.                       *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU Library General Public     *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#ifndef __UTIL_CALLBACK_EXECUTOR_H__
+#define __UTIL_CALLBACK_EXECUTOR_H__ 1
+
+#include <stdint.h>
+
+/*
+ * A callback executor runs tag callbacks on a pool of worker threads
+ * instead of in the thread that raised the event.
+ *
+ * Each worker has its own bounded queue.  All events for one tag ID go to
+ * the same worker, so a tag's callbacks run in the order that they were
+ * submitted and never at the same time.  When a worker's queue is full the
+ * event is dropped and counted.  Events that wait longer than late_ms in a
+ * queue before they run are counted as late.
+ *
+ * Executors are reference counted (see rc.h).  When the last reference is
+ * released, the workers run whatever is left in their queues and then exit.
+ */
+
+typedef void (*callback_executor_func_t)(int32_t tag_id, int event, int status);
+
+typedef struct callback_executor_t *callback_executor_p;
+
+extern callback_executor_p callback_executor_create(int num_threads, int queue_size, int late_ms);
+extern int callback_executor_submit(callback_executor_p executor, callback_executor_func_t callback, int32_t tag_id, int event, int status);
+extern int callback_executor_get_dropped(callback_executor_p executor);
+extern int callback_executor_get_late(callback_executor_p executor);
+
+#endif
@@ -0,0 +1,318 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by Kyle Hayes                                      *
+ *   Author Kyle Hayes  kyle.hayes@gmail.com                               *
+ *                                                                         *
+ * This software is available under either the Mozilla Public License      *
+ * version 2.0 or the GNU LGPL version 2 (or later) license, whichever     *
+ * you choose.                                                             *
+ *                                                                         *
+ * MPL 2.0:                                                                *
+ *                                                                         *
+ *   This Source Code Form is subject to the terms of the Mozilla Public   *
+ *   License, v. 2.0. If a copy of the MPL was not distributed with this   *
+ *   file, You can obtain one at http://mozilla.org/MPL/2.0/.              *
+ *                                                                         *
+ *                                                                         *
+ * LGPL 2:                                                                 *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU Library General Public License as       *
+ *   published by the Free Software Foundation; either version 2 of the    *
+ *   License, or (at your option) any later version.                       *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU Library General Public     *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include <lib/libplctag.h>
+#include <platform.h>
+#include <util/debug.h>
+#include <util/event_queue.h>
+#include <util/rc.h>
+
+/*
+ * This is a bounded multiple producer, single consumer ring.
+ *
+ * Each entry has a sequence number.  A producer claims the entry at the tail
+ * with a compare and swap on the tail position when the entry's sequence
+ * says that it is free.  It fills in the event and then bumps the sequence
+ * to publish it.  The consumer only reads entries whose sequence says they
+ * are published, and bumps the sequence by the capacity to free them again.
+ *
+ * Positions are free running and wrap.  All comparisons are done on the
+ * difference so that wrapping does not matter.
+ *
+ * The notifier is signaled when the queue goes from empty to not empty.  The
+ * consumer clears it when it finds the queue empty and then checks again, so
+ * that an event pushed between the two does not get stuck without a signal.
+ */
+
+#define EVENT_QUEUE_DEFAULT_CAPACITY (256)
+#define EVENT_QUEUE_MAX_CAPACITY (1 << 20)
+
+struct event_queue_entry_t {
+    volatile int32_t seq;
+    plc_tag_event_t event;
+};
+
+struct event_queue_t {
+    int32_t capacity;
+    int32_t mask;
+
+    volatile int32_t head;
+    volatile int32_t tail;
+
+    volatile int32_t signaled;
+    volatile int32_t dropped;
+    volatile int32_t closed;
+
+    notifier_p notifier;
+
+    struct event_queue_entry_t *entries;
+};
+
+
+static void event_queue_destroy(void *queue_arg);
+static void event_queue_notify(event_queue_p queue);
+
+
+event_queue_p event_queue_create(int capacity)
+{
+    event_queue_p queue = NULL;
+    int32_t actual_capacity = 1;
+    int rc = PLCTAG_STATUS_OK;
+
+    pdebug(DEBUG_INFO, "Starting.");
+
+    if(capacity <= 0) {
+        capacity = EVENT_QUEUE_DEFAULT_CAPACITY;
+    }
+
+    if(capacity > EVENT_QUEUE_MAX_CAPACITY) {
+        pdebug(DEBUG_WARN, "Capacity %d is too large!", capacity);
+        return NULL;
+    }
+
+    /* round up to a power of two so that we can mask positions. */
+    while(actual_capacity < capacity) {
+        actual_capacity <<= 1;
+    }
+
+    queue = (event_queue_p)rc_alloc((int)sizeof(struct event_queue_t), event_queue_destroy);
+    if(!queue) {
+        pdebug(DEBUG_ERROR, "Unable to allocate event queue!");
+        return NULL;
+    }
+
+    queue->capacity = actual_capacity;
+    queue->mask = actual_capacity - 1;
+
+    queue->entries = (struct event_queue_entry_t *)mem_alloc(actual_capacity * (int)sizeof(struct event_queue_entry_t));
+    if(!queue->entries) {
+        pdebug(DEBUG_ERROR, "Unable to allocate %d event queue entries!", actual_capacity);
+        rc_dec(queue);
+        return NULL;
+    }
+
+    for(int32_t i=0; i < actual_capacity; i++) {
+        queue->entries[i].seq = i;
+    }
+
+    rc = notifier_create(&queue->notifier);
+    if(rc != PLCTAG_STATUS_OK) {
+        pdebug(DEBUG_ERROR, "Unable to create event queue notifier, error %s!", plc_tag_decode_error(rc));
+        rc_dec(queue);
+        return NULL;
+    }
+
+    pdebug(DEBUG_INFO, "Done.");
+
+    return queue;
+}
+
+
+
+int event_queue_push(event_queue_p queue, int32_t tag_id, int event, int status)
+{
+    struct event_queue_entry_t *entry = NULL;
+    int32_t pos = 0;
+
+    if(!queue) {
+        return PLCTAG_ERR_NULL_PTR;
+    }
+
+    if(queue->closed) {
+        return PLCTAG_ERR_NOT_ALLOWED;
+    }
+
+    pos = queue->tail;
+
+    for(;;) {
+        int32_t diff = 0;
+
+        entry = &(queue->entries[pos & queue->mask]);
+        diff = (int32_t)((uint32_t)entry->seq - (uint32_t)pos);
+
+        if(diff == 0) {
+            /* the entry is free, try to claim it. */
+            int32_t old_pos = atomic_int32_cas(&queue->tail, pos, (int32_t)((uint32_t)pos + 1));
+
+            if(old_pos == pos) {
+                break;
+            }
+
+            pos = old_pos;
+        } else if(diff < 0) {
+            /* the consumer has not freed this entry yet, the ring is full. */
+            atomic_int32_add(&queue->dropped, 1);
+            pdebug(DEBUG_WARN, "Event queue is full, dropping event %d for tag %d!", event, (int)tag_id);
+            return PLCTAG_ERR_NO_RESOURCES;
+        } else {
+            /* another producer got here first. */
+            pos = queue->tail;
+        }
+    }
+
+    entry->event.tag_id = tag_id;
+    entry->event.event = event;
+    entry->event.status = status;
+
+    /* make the event visible before the sequence that publishes it. */
+    atomic_fence();
+
+    entry->seq = (int32_t)((uint32_t)pos + 1);
+
+    event_queue_notify(queue);
+
+    return PLCTAG_STATUS_OK;
+}
+
+
+
+int event_queue_pop(event_queue_p queue, plc_tag_event_t *events, int max_events)
+{
+    int count = 0;
+    int32_t pos = 0;
+
+    if(!queue || !events) {
+        return PLCTAG_ERR_NULL_PTR;
+    }
+
+    if(max_events <= 0) {
+        return PLCTAG_ERR_BAD_PARAM;
+    }
+
+    pos = queue->head;
+
+    while(count < max_events) {
+        struct event_queue_entry_t *entry = &(queue->entries[pos & queue->mask]);
+
+        if(entry->seq != (int32_t)((uint32_t)pos + 1)) {
+            /* nothing published here yet. */
+            break;
+        }
+
+        atomic_fence();
+
+        events[count] = entry->event;
+        count++;
+
+        /* free the entry for the next trip around the ring. */
+        atomic_fence();
+        entry->seq = (int32_t)((uint32_t)pos + (uint32_t)queue->capacity);
+
+        pos = (int32_t)((uint32_t)pos + 1);
+    }
+
+    queue->head = pos;
+
+    if(count < max_events) {
+        /* we emptied the queue, so clear the signal then look once more. */
+        queue->signaled = 0;
+        notifier_clear(queue->notifier);
+
+        atomic_fence();
+
+        /*
+         * A producer may have signaled just before we cleared the notifier.
+         * Its event is in the ring, so signal again for it.
+         */
+        if(queue->entries[pos & queue->mask].seq == (int32_t)((uint32_t)pos + 1)) {
+            queue->signaled = 1;
+            notifier_signal(queue->notifier);
+        }
+    }
+
+    return count;
+}
+
+
+
+intptr_t event_queue_get_handle(event_queue_p queue)
+{
+    if(!queue) {
+        return PLCTAG_ERR_NULL_PTR;
+    }
+
+    return notifier_get_handle(queue->notifier);
+}
+
+
+
+int event_queue_get_dropped(event_queue_p queue)
+{
+    if(!queue) {
+        return PLCTAG_ERR_NULL_PTR;
+    }
+
+    return (int)atomic_int32_add(&queue->dropped, 0);
+}
+
+
+
+void event_queue_close(event_queue_p queue)
+{
+    if(queue) {
+        atomic_int32_cas(&queue->closed, 0, 1);
+    }
+}
+
+
+
+/*
+ * Signal the notifier if nobody has yet since the consumer last cleared it.
+ */
+
+void event_queue_notify(event_queue_p queue)
+{
+    if(atomic_int32_cas(&queue->signaled, 0, 1) == 0) {
+        notifier_signal(queue->notifier);
+    }
+}
+
+
+
+void event_queue_destroy(void *queue_arg)
+{
+    event_queue_p queue = (event_queue_p)queue_arg;
+
+    pdebug(DEBUG_INFO, "Starting.");
+
+    if(queue->notifier) {
+        notifier_destroy(&queue->notifier);
+    }
+
+    if(queue->entries) {
+        mem_free(queue->entries);
+        queue->entries = NULL;
+    }
+
+    pdebug(DEBUG_INFO, "Done.");
+}
@@ -0,0 +1,60 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by Kyle Hayes                                      *
+ *   Author Kyle Hayes  kyle.hayes@gmail.com                               *
+ *                                                                         *
+ * This software is available under either the Mozilla Public License      *
+ * version 2.0 or the GNU LGPL version 2 (or later) license, whichever     *
+ * you choose.                                                             *
+ *                                                                         *
+ * MPL 2.0:                                                                *
+ *                                                                         *
+ *   This Source Code Form is subject to the terms of the Mozilla Public   *
+ *   License, v. 2.0. If a copy of the MPL was not distributed with this   *
+ *   file, You can obtain one at http://mozilla.org/MPL/2.0/.              *
+ *                                                                         *
+ *                                                                         *
+ * LGPL 2:                                                                 *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU Library General Public License as       *
+ *   published by the Free Software Foundation; either version 2 of the    *
+ *   License, or (at your option) any later version.                       *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU Library General Public     *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#ifndef __UTIL_EVENT_QUEUE_H__
+#define __UTIL_EVENT_QUEUE_H__ 1
+
+#include <stdint.h>
+#include <lib/libplctag.h>
+
+/*
+ * An event queue is a bounded ring of tag events (see plc_tag_event_t) with
+ * any number of producers and one consumer.  Neither side takes a mutex.
+ *
+ * The queue has a notifier handle (see platform.h) that is readable while
+ * there are events to pop, so that it can be put in an outside event loop.
+ *
+ * Queues are reference counted (see rc.h).  After event_queue_close() all
+ * pushes are dropped, but the memory stays until the last reference goes.
+ */
+
+typedef struct event_queue_t *event_queue_p;
+
+extern event_queue_p event_queue_create(int capacity);
+extern int event_queue_push(event_queue_p queue, int32_t tag_id, int event, int status);
+extern int event_queue_pop(event_queue_p queue, plc_tag_event_t *events, int max_events);
+extern intptr_t event_queue_get_handle(event_queue_p queue);
+extern int event_queue_get_dropped(event_queue_p queue);
+extern void event_queue_close(event_queue_p queue);
+
+#endif
@@ -0,0 +1,261 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by Kyle Hayes                                      *
+ *   Author Kyle Hayes  kyle.hayes@gmail.com                               *
+ *                                                                         *
+ * This software is available under either the Mozilla Public License      *
+ * version 2.0 or the GNU LGPL version 2 (or later) license, whichever     *
+ * you choose.                                                             *
+ *                                                                         *
+ * MPL 2.0:                                                                *
+ *                                                                         *
+ *   This Source Code Form is subject to the terms of the Mozilla Public   *
+ *   License, v. 2.0. If a copy of the MPL was not distributed with this   *
+ *   file, You can obtain one at http://mozilla.org/MPL/2.0/.              *
+ *                                                                         *
+ *                                                                         *
+ * LGPL 2:                                                                 *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU Library General Public License as       *
+ *   published by the Free Software Foundation; either version 2 of the    *
+ *   License, or (at your option) any later version.                       *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU Library General Public     *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include <stdlib.h>
+#include <lib/libplctag.h>
+#include <platform.h>
+#include <util/debug.h>
+#include <util/poll_plan.h>
+
+/*
+ * The planner keeps the load of each window over one cycle of all the
+ * periods.  If the periods do not have a short common cycle, this is
+ * capped and the plan only approximates how periods line up.
+ */
+#define POLL_PLAN_MAX_CYCLE (4096)
+
+
+static int compare_entries(const void *a, const void *b);
+static int get_cycle_slots(poll_plan_entry_t *entries, int count, int window_ms);
+static int get_gcd(int a, int b);
+static int packets_for(int64_t load, int packet_size);
+
+
+int poll_plan(poll_plan_entry_t *entries, int count, int window_ms, int packet_size)
+{
+    int rc = PLCTAG_STATUS_OK;
+    int cycle = 0;
+    int64_t *cycle_load = NULL;
+    int64_t *packet_load = NULL;
+    int end = 0;
+
+    pdebug(DEBUG_DETAIL, "Starting.");
+
+    if(count < 0 || window_ms <= 0 || packet_size <= 0) {
+        pdebug(DEBUG_WARN, "Called with bad count, window or packet size!");
+        return PLCTAG_ERR_BAD_PARAM;
+    }
+
+    if(count == 0) {
+        pdebug(DEBUG_DETAIL, "Done.");
+        return PLCTAG_STATUS_OK;
+    }
+
+    if(!entries) {
+        pdebug(DEBUG_WARN, "Null entries pointer!");
+        return PLCTAG_ERR_NULL_PTR;
+    }
+
+    /* by period, biggest first in each period. */
+    qsort(entries, (size_t)(unsigned int)count, sizeof(poll_plan_entry_t), compare_entries);
+
+    cycle = get_cycle_slots(entries, count, window_ms);
+
+    cycle_load = (int64_t *)mem_alloc(cycle * (int)sizeof(int64_t));
+    if(!cycle_load) {
+        pdebug(DEBUG_ERROR, "Unable to allocate memory for the poll plan!");
+        return PLCTAG_ERR_NO_MEM;
+    }
+
+    for(int start = 0; start < count && rc == PLCTAG_STATUS_OK; start = end) {
+        int period = entries[start].period_ms;
+        int slots = (period / window_ms > 0 ? period / window_ms : 1);
+        int reps = (cycle / slots > 0 ? cycle / slots : 1);
+        int64_t total = 0;
+        int packets = 0;
+        int spacing = 0;
+        int best_rotation = 0;
+        int64_t best_extra = INT64_MAX;
+        int64_t best_peak = INT64_MAX;
+
+        for(end = start; end < count && entries[end].period_ms == period; end++) {
+            total += entries[end].cost;
+        }
+
+        /* as few packets as will hold everything, but no more than one per window. */
+        packets = packets_for(total, packet_size);
+        if(packets < 1) {
+            packets = 1;
+        }
+
+        if(packets > slots) {
+            packets = slots;
+        }
+
+        spacing = slots / packets;
+
+        packet_load = (int64_t *)mem_alloc(packets * (int)sizeof(int64_t));
+        if(!packet_load) {
+            pdebug(DEBUG_ERROR, "Unable to allocate memory for the poll plan packets!");
+            rc = PLCTAG_ERR_NO_MEM;
+            break;
+        }
+
+        /* biggest first, each into the emptiest packet.  Keep the packet index in the phase for now. */
+        for(int i = start; i < end; i++) {
+            int emptiest = 0;
+
+            for(int k = 1; k < packets; k++) {
+                if(packet_load[k] < packet_load[emptiest]) {
+                    emptiest = k;
+                }
+            }
+
+            packet_load[emptiest] += entries[i].cost;
+            entries[i].phase_ms = emptiest;
+        }
+
+        /*
+         * the packets are evenly spaced.  Shift them all together to where
+         * they add the fewest packets to the ones already placed.  Break
+         * ties by the lowest peak load.
+         */
+        for(int rotation = 0; rotation < spacing; rotation++) {
+            int64_t extra = 0;
+            int64_t peak = 0;
+
+            for(int k = 0; k < packets; k++) {
+                int slot = (k * spacing) + rotation;
+
+                for(int rep = 0; rep < reps; rep++) {
+                    int64_t old_load = cycle_load[(slot + (rep * slots)) % cycle];
+                    int64_t new_load = old_load + packet_load[k];
+
+                    extra += packets_for(new_load, packet_size) - packets_for(old_load, packet_size);
+
+                    if(new_load > peak) {
+                        peak = new_load;
+                    }
+                }
+            }
+
+            if(extra < best_extra || (extra == best_extra && peak < best_peak)) {
+                best_rotation = rotation;
+                best_extra = extra;
+                best_peak = peak;
+            }
+        }
+
+        for(int k = 0; k < packets; k++) {
+            int slot = (k * spacing) + best_rotation;
+
+            for(int rep = 0; rep < reps; rep++) {
+                cycle_load[(slot + (rep * slots)) % cycle] += packet_load[k];
+            }
+        }
+
+        for(int i = start; i < end; i++) {
+            entries[i].phase_ms = ((entries[i].phase_ms * spacing) + best_rotation) * window_ms;
+        }
+
+        pdebug(DEBUG_DETAIL, "Planned %d entries with period %dms into %d packets.", end - start, period, packets);
+
+        mem_free(packet_load);
+        packet_load = NULL;
+    }
+
+    mem_free(cycle_load);
+
+    pdebug(DEBUG_DETAIL, "Done.");
+
+    return rc;
+}
+
+
+
+int compare_entries(const void *a, const void *b)
+{
+    const poll_plan_entry_t *entry_a = (const poll_plan_entry_t *)a;
+    const poll_plan_entry_t *entry_b = (const poll_plan_entry_t *)b;
+
+    if(entry_a->period_ms != entry_b->period_ms) {
+        return (entry_a->period_ms < entry_b->period_ms ? -1 : 1);
+    }
+
+    if(entry_a->cost != entry_b->cost) {
+        return (entry_a->cost > entry_b->cost ? -1 : 1);
+    }
+
+    /* keep the plan stable from run to run. */
+    if(entry_a->id != entry_b->id) {
+        return (entry_a->id < entry_b->id ? -1 : 1);
+    }
+
+    return 0;
+}
+
+
+
+/* the number of windows after which all the periods line up again. */
+int get_cycle_slots(poll_plan_entry_t *entries, int count, int window_ms)
+{
+    int64_t cycle = 1;
+
+    for(int i = 0; i < count; i++) {
+        int slots = entries[i].period_ms / window_ms;
+
+        if(slots < 1) {
+            slots = 1;
+        }
+
+        cycle = (cycle / get_gcd((int)cycle, slots)) * slots;
+
+        if(cycle > POLL_PLAN_MAX_CYCLE) {
+            pdebug(DEBUG_DETAIL, "Periods do not line up within %d windows.", POLL_PLAN_MAX_CYCLE);
+            return POLL_PLAN_MAX_CYCLE;
+        }
+    }
+
+    return (int)cycle;
+}
+
+
+
+int get_gcd(int a, int b)
+{
+    while(b) {
+        int tmp = a % b;
+
+        a = b;
+        b = tmp;
+    }
+
+    return a;
+}
+
+
+
+int packets_for(int64_t load, int packet_size)
+{
+    return (int)((load + packet_size - 1) / packet_size);
+}
@@ -0,0 +1,66 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by Kyle Hayes                                      *
+ *   Author Kyle Hayes  kyle.hayes@gmail.com                               *
+ *                                                                         *
+ * This software is available under either the Mozilla Public License      *
+ * version 2.0 or the GNU LGPL version 2 (or later) license, whichever     *
+ * you choose.                                                             *
+ *                                                                         *
+ * MPL 2.0:                                                                *
+ *                                                                         *
+ *   This Source Code Form is subject to the terms of the Mozilla Public   *
+ *   License, v. 2.0. If a copy of the MPL was not distributed with this   *
+ *   file, You can obtain one at http://mozilla.org/MPL/2.0/.              *
+ *                                                                         *
+ *                                                                         *
+ * LGPL 2:                                                                 *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU Library General Public License as       *
+ *   published by the Free Software Foundation; either version 2 of the    *
+ *   License, or (at your option) any later version.                       *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU Library General Public     *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#ifndef __UTIL_POLL_PLAN_H__
+#define __UTIL_POLL_PLAN_H__ 1
+
+#include <stdint.h>
+
+/*
+ * Plan the phases of periodic reads so that they pack well.
+ *
+ * Each entry is something read every period_ms.  Its cost is roughly how
+ * many bytes its request and response take in a packet.  The planner sets
+ * phase_ms so that the entry is read at times that are phase_ms past a
+ * whole multiple of period_ms.
+ *
+ * Phases are multiples of window_ms.  Entries with the same period are
+ * packed into as few packets of packet_size bytes as possible and the
+ * packets are spread evenly over the period.  Each period's packets are
+ * then lined up with the ones already placed where there is room in them.
+ *
+ * The entries are sorted in place.  Each id must be unique.  Entries that
+ * are otherwise equal are sorted by id so that the same entries always get
+ * the same plan.
+ */
+
+typedef struct {
+    int32_t id;
+    int period_ms;
+    int cost;
+    int phase_ms;
+} poll_plan_entry_t;
+
+extern int poll_plan(poll_plan_entry_t *entries, int count, int window_ms, int packet_size);
+
+#endif
@@ -0,0 +1,397 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by Kyle Hayes                                      *
+ *   Author Kyle Hayes  kyle.hayes@gmail.com                               *
+ *                                                                         *
+ * This software is available under either the Mozilla Public License      *
+ * version 2.0 or the GNU LGPL version 2 (or later) license, whichever     *
+ * you choose.                                                             *
+ *                                                                         *
+ * MPL 2.0:                                                                *
+ *                                                                         *
+ *   This Source Code Form is subject to the terms of the Mozilla Public   *
+ *   License, v. 2.0. If a copy of the MPL was not distributed with this   *
+ *   file, You can obtain one at http://mozilla.org/MPL/2.0/.              *
+ *                                                                         *
+ *                                                                         *
+ * LGPL 2:                                                                 *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU Library General Public License as       *
+ *   published by the Free Software Foundation; either version 2 of the    *
+ *   License, or (at your option) any later version.                       *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU Library General Public     *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include <lib/libplctag.h>
+#include <platform.h>
+#include <util/debug.h>
+#include <util/rc.h>
+#include <util/slot_table.h>
+
+/*
+ * This implements an ID to reference table where lookups do not take a mutex.
+ *
+ * Slots live in fixed size blocks.  Blocks are added as the table grows and
+ * are never moved or freed until the table is destroyed, so a slot never
+ * disappears out from under a reader.
+ *
+ * A reader bumps the slot's reader count before it looks at the slot's
+ * reference.  Removal claims the slot, checks that it still holds the ID
+ * being removed and then waits until the reader count drops to zero before
+ * freeing the slot and handing the table's reference back to the caller.
+ * Thus a reader never calls rc_inc() on memory that could have been freed.
+ */
+
+#define SLOT_BLOCK_BITS (9)
+#define SLOT_BLOCK_SIZE (1 << SLOT_BLOCK_BITS)
+#define SLOT_MAX_BLOCKS (256) /* the tag limit in libplctag.h depends on this. */
+#define SLOT_INDEX_BITS (SLOT_BLOCK_BITS + 8)
+#define SLOT_INDEX_MASK ((1 << SLOT_INDEX_BITS) - 1)
+#define SLOT_MAX_GENERATION (0x7FE) /* keeps all IDs below 0x0FFFFFFF */
+
+/* a slot that is claimed by a put but not published yet. */
+#define SLOT_CLAIMED ((void *)(intptr_t)1)
+
+struct slot_t {
+    void * volatile ref;
+    volatile int32_t id;
+    volatile int32_t readers;
+};
+
+struct slot_table_t {
+    struct slot_t * volatile blocks[SLOT_MAX_BLOCKS];
+    volatile int32_t num_blocks;
+    volatile int32_t next_index;
+    lock_t grow_lock;
+};
+
+
+static struct slot_t *find_slot(slot_table_p table, int index);
+static void *get_slot_ref(struct slot_t *slot, int32_t id);
+static int grow_table(slot_table_p table, int32_t seen_blocks);
+
+
+slot_table_p slot_table_create(void)
+{
+    slot_table_p table = NULL;
+
+    pdebug(DEBUG_INFO, "Starting");
+
+    table = mem_alloc((int)sizeof(struct slot_table_t));
+    if(!table) {
+        pdebug(DEBUG_ERROR, "Unable to allocate memory for slot table!");
+        return NULL;
+    }
+
+    table->grow_lock = LOCK_INIT;
+
+    if(grow_table(table, 0) != PLCTAG_STATUS_OK) {
+        pdebug(DEBUG_ERROR, "Unable to allocate first slot block!");
+        slot_table_destroy(table);
+        return NULL;
+    }
+
+    pdebug(DEBUG_INFO, "Done");
+
+    return table;
+}
+
+
+
+int32_t slot_table_put(slot_table_p table, void *ref)
+{
+    int rc = PLCTAG_STATUS_OK;
+
+    pdebug(DEBUG_SPEW, "Starting");
+
+    if(!table || !ref) {
+        pdebug(DEBUG_WARN, "Slot table or reference pointer null or invalid.");
+        return PLCTAG_ERR_NULL_PTR;
+    }
+
+    do {
+        int32_t seen_blocks = table->num_blocks;
+        int capacity = seen_blocks * SLOT_BLOCK_SIZE;
+
+        for(int attempt = 0; attempt < capacity; attempt++) {
+            int index = (int)((uint32_t)atomic_int32_add(&table->next_index, 1) % (uint32_t)capacity);
+            struct slot_t *slot = NULL;
+
+            /* zero is never a valid ID. */
+            if(index == 0) {
+                continue;
+            }
+
+            slot = find_slot(table, index);
+
+            /* claim the slot first so that no reader can see the new reference with the old ID. */
+            if(slot && atomic_ptr_cas(&slot->ref, NULL, SLOT_CLAIMED) == NULL) {
+                int32_t generation = ((slot->id >> SLOT_INDEX_BITS) % SLOT_MAX_GENERATION) + 1;
+                int32_t new_id = (generation << SLOT_INDEX_BITS) | index;
+
+                slot->id = new_id;
+                atomic_ptr_cas(&slot->ref, SLOT_CLAIMED, ref);
+
+                pdebug(DEBUG_SPEW, "Done with new ID %d.", new_id);
+
+                return new_id;
+            }
+        }
+
+        /* no free slot, add another block. */
+        rc = grow_table(table, seen_blocks);
+    } while(rc == PLCTAG_STATUS_OK);
+
+    pdebug(DEBUG_WARN, "Unable to find or make a free slot, error %s!", plc_tag_decode_error(rc));
+
+    return rc;
+}
+
+
+
+void *slot_table_get(slot_table_p table, int32_t id)
+{
+    struct slot_t *slot = NULL;
+
+    if(!table) {
+        pdebug(DEBUG_WARN, "Slot table pointer null or invalid.");
+        return NULL;
+    }
+
+    if(id <= 0) {
+        return NULL;
+    }
+
+    slot = find_slot(table, id & SLOT_INDEX_MASK);
+    if(!slot) {
+        return NULL;
+    }
+
+    return get_slot_ref(slot, id);
+}
+
+
+
+void *slot_table_get_index(slot_table_p table, int index)
+{
+    struct slot_t *slot = NULL;
+
+    if(!table) {
+        pdebug(DEBUG_WARN, "Slot table pointer null or invalid.");
+        return NULL;
+    }
+
+    slot = find_slot(table, index);
+    if(!slot) {
+        return NULL;
+    }
+
+    return get_slot_ref(slot, 0);
+}
+
+
+
+int slot_table_capacity(slot_table_p table)
+{
+    if(!table) {
+        pdebug(DEBUG_WARN, "Slot table pointer null or invalid.");
+        return PLCTAG_ERR_NULL_PTR;
+    }
+
+    return table->num_blocks * SLOT_BLOCK_SIZE;
+}
+
+
+
+
+int slot_table_max_slots(void)
+{
+    return SLOT_MAX_BLOCKS * SLOT_BLOCK_SIZE;
+}
+
+
+
+int slot_table_id_index(int32_t id)
+{
+    return (int)(id & SLOT_INDEX_MASK);
+}
+
+
+
+void *slot_table_remove(slot_table_p table, int32_t id)
+{
+    struct slot_t *slot = NULL;
+    void *ref = NULL;
+
+    pdebug(DEBUG_SPEW, "Starting");
+
+    if(!table) {
+        pdebug(DEBUG_WARN, "Slot table pointer null or invalid.");
+        return NULL;
+    }
+
+    if(id <= 0) {
+        return NULL;
+    }
+
+    slot = find_slot(table, id & SLOT_INDEX_MASK);
+    if(!slot) {
+        return NULL;
+    }
+
+    ref = slot->ref;
+
+    if(!ref || ref == SLOT_CLAIMED || slot->id != id) {
+        pdebug(DEBUG_SPEW, "ID %d not found.", id);
+        return NULL;
+    }
+
+    /* only one remover can win.  Claiming the slot keeps puts out of it. */
+    if(atomic_ptr_cas(&slot->ref, ref, SLOT_CLAIMED) != ref) {
+        pdebug(DEBUG_SPEW, "ID %d was removed by someone else.", id);
+        return NULL;
+    }
+
+    /* the slot may have been freed and reused with the same reference since we looked. */
+    if(slot->id != id) {
+        atomic_ptr_cas(&slot->ref, SLOT_CLAIMED, ref);
+        pdebug(DEBUG_SPEW, "ID %d not found.", id);
+        return NULL;
+    }
+
+    /* wait for any reader that might have seen the old reference. */
+    while(slot->readers > 0) {
+        sleep_ms(1);
+    }
+
+    atomic_ptr_cas(&slot->ref, SLOT_CLAIMED, NULL);
+
+    pdebug(DEBUG_SPEW, "Done");
+
+    return ref;
+}
+
+
+
+int slot_table_destroy(slot_table_p table)
+{
+    pdebug(DEBUG_INFO, "Starting");
+
+    if(!table) {
+        pdebug(DEBUG_WARN, "Called with null pointer!");
+        return PLCTAG_ERR_NULL_PTR;
+    }
+
+    for(int i=0; i < SLOT_MAX_BLOCKS; i++) {
+        if(table->blocks[i]) {
+            mem_free(table->blocks[i]);
+            table->blocks[i] = NULL;
+        }
+    }
+
+    mem_free(table);
+
+    pdebug(DEBUG_INFO, "Done");
+
+    return PLCTAG_STATUS_OK;
+}
+
+
+
+
+/***********************************************************************
+ *************************** Helper Functions **************************
+ **********************************************************************/
+
+
+struct slot_t *find_slot(slot_table_p table, int index)
+{
+    int block = index >> SLOT_BLOCK_BITS;
+    struct slot_t *slots = NULL;
+
+    if(index < 0 || block >= table->num_blocks) {
+        return NULL;
+    }
+
+    slots = table->blocks[block];
+    if(!slots) {
+        return NULL;
+    }
+
+    return &slots[index & (SLOT_BLOCK_SIZE - 1)];
+}
+
+
+/*
+ * Get a new reference from the slot.  If id is non-zero, it must match
+ * the ID stored in the slot.
+ */
+
+void *get_slot_ref(struct slot_t *slot, int32_t id)
+{
+    void *ref = NULL;
+
+    atomic_int32_add(&slot->readers, 1);
+
+    ref = slot->ref;
+
+    if(ref && ref != SLOT_CLAIMED) {
+        ref = rc_inc(ref);
+
+        /* the slot may have been reused for a different ID. */
+        if(id && slot->id != id) {
+            /* the table still holds its reference, so this cannot free anything. */
+            rc_dec(ref);
+            ref = NULL;
+        }
+    } else {
+        ref = NULL;
+    }
+
+    atomic_int32_add(&slot->readers, -1);
+
+    return ref;
+}
+
+
+int grow_table(slot_table_p table, int32_t seen_blocks)
+{
+    int rc = PLCTAG_STATUS_OK;
+
+    spin_block(&table->grow_lock) {
+        /* someone else may have added a block already. */
+        if(table->num_blocks == seen_blocks) {
+            if(seen_blocks >= SLOT_MAX_BLOCKS) {
+                pdebug(DEBUG_WARN, "Slot table is full!");
+                rc = PLCTAG_ERR_NO_RESOURCES;
+            } else {
+                struct slot_t *slots = mem_alloc(SLOT_BLOCK_SIZE * (int)sizeof(struct slot_t));
+
+                if(slots) {
+                    pdebug(DEBUG_DETAIL, "Adding slot block %d.", seen_blocks);
+
+                    table->blocks[seen_blocks] = slots;
+
+                    /* start handing out slots from the new block. */
+                    table->next_index = seen_blocks * SLOT_BLOCK_SIZE;
+
+                    atomic_int32_add(&table->num_blocks, 1);
+                } else {
+                    pdebug(DEBUG_ERROR, "Unable to allocate slot block!");
+                    rc = PLCTAG_ERR_NO_MEM;
+                }
+            }
+        }
+    }
+
+    return rc;
+}
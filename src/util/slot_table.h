@@ -0,0 +1,66 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by Kyle Hayes                                      *
+ *   Author Kyle Hayes  kyle.hayes@gmail.com                               *
+ *                                                                         *
+ * This software is available under either the Mozilla Public License      *
+ * version 2.0 or the GNU LGPL version 2 (or later) license, whichever     *
+ * you choose.                                                             *
+ *                                                                         *
+ * MPL 2.0:                                                                *
+ *                                                                         *
+ *   This Source Code Form is subject to the terms of the Mozilla Public   *
+ *   License, v. 2.0. If a copy of the MPL was not distributed with this   *
+ *   file, You can obtain one at http://mozilla.org/MPL/2.0/.              *
+ *                                                                         *
+ *                                                                         *
+ * LGPL 2:                                                                 *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU Library General Public License as       *
+ *   published by the Free Software Foundation; either version 2 of the    *
+ *   License, or (at your option) any later version.                       *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU Library General Public     *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#ifndef __UTIL_SLOT_TABLE_H__
+#define __UTIL_SLOT_TABLE_H__ 1
+
+#include <stdint.h>
+
+/*
+ * A slot table maps small positive integer IDs to reference counted
+ * objects (see rc.h).  Lookups do not take any mutex.
+ *
+ * IDs are made from a slot index in the low bits and a per-slot generation
+ * in the high bits so that a stale ID does not find a newer object that
+ * reused the same slot.
+ *
+ * The table holds the reference that is passed to slot_table_put().  That
+ * reference is handed back by slot_table_remove().  The getters return a
+ * new reference that the caller must release with rc_dec().
+ */
+
+typedef struct slot_table_t *slot_table_p;
+
+extern slot_table_p slot_table_create(void);
+extern int32_t slot_table_put(slot_table_p table, void *ref);
+extern void *slot_table_get(slot_table_p table, int32_t id);
+extern void *slot_table_get_index(slot_table_p table, int index);
+extern int slot_table_capacity(slot_table_p table);
+extern void *slot_table_remove(slot_table_p table, int32_t id);
+extern int slot_table_destroy(slot_table_p table);
+
+/* IDs map to slot indexes below slot_table_max_slots(), for side tables. */
+extern int slot_table_max_slots(void);
+extern int slot_table_id_index(int32_t id);
+
+#endif
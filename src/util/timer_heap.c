@@ -0,0 +1,250 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by Kyle Hayes                                      *
+ *   Author Kyle Hayes  kyle.hayes@gmail.com                               *
+ *                                                                         *
+ * This software is available under either the Mozilla Public License      *
+ * version 2.0 or the GNU LGPL version 2 (or later) license, whichever     *
+ * you choose.                                                             *
+ *                                                                         *
+ * MPL 2.0:                                                                *
+ *                                                                         *
+ *   This Source Code Form is subject to the terms of the Mozilla Public   *
+ *   License, v. 2.0. If a copy of the MPL was not distributed with this   *
+ *   file, You can obtain one at http://mozilla.org/MPL/2.0/.              *
+ *                                                                         *
+ *                                                                         *
+ * LGPL 2:                                                                 *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU Library General Public License as       *
+ *   published by the Free Software Foundation; either version 2 of the    *
+ *   License, or (at your option) any later version.                       *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU Library General Public     *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include <lib/libplctag.h>
+#include <platform.h>
+#include <util/debug.h>
+#include <util/timer_heap.h>
+
+struct timer_heap_entry_t {
+    int64_t due;
+    int32_t id;
+};
+
+struct timer_heap_t {
+    int len;
+    int capacity;
+    struct timer_heap_entry_t *entries;
+};
+
+
+static int ensure_capacity(timer_heap_p heap, int capacity);
+
+
+timer_heap_p timer_heap_create(int capacity)
+{
+    timer_heap_p heap = NULL;
+
+    pdebug(DEBUG_SPEW, "Starting.");
+
+    if(capacity <= 0) {
+        pdebug(DEBUG_WARN, "Called with zero or negative capacity!");
+        return NULL;
+    }
+
+    heap = (timer_heap_p)mem_alloc((int)sizeof(struct timer_heap_t));
+    if(!heap) {
+        pdebug(DEBUG_ERROR, "Unable to allocate memory for timer heap!");
+        return NULL;
+    }
+
+    heap->entries = (struct timer_heap_entry_t *)mem_alloc(capacity * (int)sizeof(struct timer_heap_entry_t));
+    if(!heap->entries) {
+        pdebug(DEBUG_ERROR, "Unable to allocate memory for timer heap entries!");
+        mem_free(heap);
+        return NULL;
+    }
+
+    heap->capacity = capacity;
+
+    pdebug(DEBUG_SPEW, "Done.");
+
+    return heap;
+}
+
+
+
+int timer_heap_push(timer_heap_p heap, int64_t due, int32_t id)
+{
+    int rc = PLCTAG_STATUS_OK;
+    int index = 0;
+
+    if(!heap) {
+        pdebug(DEBUG_WARN, "Null timer heap pointer!");
+        return PLCTAG_ERR_NULL_PTR;
+    }
+
+    rc = ensure_capacity(heap, heap->len + 1);
+    if(rc != PLCTAG_STATUS_OK) {
+        return rc;
+    }
+
+    /* sift the new entry up from the bottom. */
+    index = heap->len++;
+
+    while(index > 0) {
+        int parent = (index - 1) / 2;
+
+        if(heap->entries[parent].due <= due) {
+            break;
+        }
+
+        heap->entries[index] = heap->entries[parent];
+        index = parent;
+    }
+
+    heap->entries[index].due = due;
+    heap->entries[index].id = id;
+
+    return PLCTAG_STATUS_OK;
+}
+
+
+
+int timer_heap_peek(timer_heap_p heap, int64_t *due, int32_t *id)
+{
+    if(!heap) {
+        pdebug(DEBUG_WARN, "Null timer heap pointer!");
+        return PLCTAG_ERR_NULL_PTR;
+    }
+
+    if(heap->len == 0) {
+        return PLCTAG_ERR_NOT_FOUND;
+    }
+
+    if(due) {
+        *due = heap->entries[0].due;
+    }
+
+    if(id) {
+        *id = heap->entries[0].id;
+    }
+
+    return PLCTAG_STATUS_OK;
+}
+
+
+
+int timer_heap_pop(timer_heap_p heap, int64_t *due, int32_t *id)
+{
+    struct timer_heap_entry_t last;
+    int rc = PLCTAG_STATUS_OK;
+    int index = 0;
+
+    rc = timer_heap_peek(heap, due, id);
+    if(rc != PLCTAG_STATUS_OK) {
+        return rc;
+    }
+
+    /* move the last entry to the top and sift it down. */
+    last = heap->entries[--heap->len];
+
+    while(1) {
+        int child = (index * 2) + 1;
+
+        if(child >= heap->len) {
+            break;
+        }
+
+        if(child + 1 < heap->len && heap->entries[child + 1].due < heap->entries[child].due) {
+            child++;
+        }
+
+        if(last.due <= heap->entries[child].due) {
+            break;
+        }
+
+        heap->entries[index] = heap->entries[child];
+        index = child;
+    }
+
+    if(heap->len > 0) {
+        heap->entries[index] = last;
+    }
+
+    return PLCTAG_STATUS_OK;
+}
+
+
+
+int timer_heap_length(timer_heap_p heap)
+{
+    if(!heap) {
+        pdebug(DEBUG_WARN, "Null timer heap pointer!");
+        return PLCTAG_ERR_NULL_PTR;
+    }
+
+    return heap->len;
+}
+
+
+
+void timer_heap_destroy(timer_heap_p heap)
+{
+    pdebug(DEBUG_SPEW, "Starting.");
+
+    if(!heap) {
+        pdebug(DEBUG_WARN, "Null timer heap pointer!");
+        return;
+    }
+
+    if(heap->entries) {
+        mem_free(heap->entries);
+    }
+
+    mem_free(heap);
+
+    pdebug(DEBUG_SPEW, "Done.");
+}
+
+
+
+/***********************************************************************
+ ************************ Helper Functions *****************************
+ **********************************************************************/
+
+
+int ensure_capacity(timer_heap_p heap, int capacity)
+{
+    struct timer_heap_entry_t *new_entries = NULL;
+    int new_capacity = heap->capacity;
+
+    if(capacity <= heap->capacity) {
+        return PLCTAG_STATUS_OK;
+    }
+
+    while(new_capacity < capacity) {
+        new_capacity *= 2;
+    }
+
+    new_entries = (struct timer_heap_entry_t *)mem_realloc(heap->entries, new_capacity * (int)sizeof(struct timer_heap_entry_t));
+    if(!new_entries) {
+        pdebug(DEBUG_ERROR, "Unable to grow timer heap to %d entries!", new_capacity);
+        return PLCTAG_ERR_NO_MEM;
+    }
+
+    heap->entries = new_entries;
+    heap->capacity = new_capacity;
+
+    return PLCTAG_STATUS_OK;
+}
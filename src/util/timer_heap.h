@@ -0,0 +1,56 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by Kyle Hayes                                      *
+ *   Author Kyle Hayes  kyle.hayes@gmail.com                               *
+ *                                                                         *
+ * This software is available under either the Mozilla Public License      *
+ * version 2.0 or the GNU LGPL version 2 (or later) license, whichever     *
+ * you choose.                                                             *
+ *                                                                         *
+ * MPL 2.0:                                                                *
+ *                                                                         *
+ *   This Source Code Form is subject to the terms of the Mozilla Public   *
+ *   License, v. 2.0. If a copy of the MPL was not distributed with this   *
+ *   file, You can obtain one at http://mozilla.org/MPL/2.0/.              *
+ *                                                                         *
+ *                                                                         *
+ * LGPL 2:                                                                 *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU Library General Public License as       *
+ *   published by the Free Software Foundation; either version 2 of the    *
+ *   License, or (at your option) any later version.                       *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU Library General Public     *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#ifndef __UTIL_TIMER_HEAP_H__
+#define __UTIL_TIMER_HEAP_H__ 1
+
+#include <stdint.h>
+
+/*
+ * A binary min-heap of (due time, ID) pairs.  The entry with the earliest
+ * due time is always on top.  Entries with the same due time come out in
+ * no particular order.
+ *
+ * This does no locking.  The caller must serialize access.
+ */
+
+typedef struct timer_heap_t *timer_heap_p;
+
+extern timer_heap_p timer_heap_create(int capacity);
+extern int timer_heap_push(timer_heap_p heap, int64_t due, int32_t id);
+extern int timer_heap_peek(timer_heap_p heap, int64_t *due, int32_t *id);
+extern int timer_heap_pop(timer_heap_p heap, int64_t *due, int32_t *id);
+extern int timer_heap_length(timer_heap_p heap);
+extern void timer_heap_destroy(timer_heap_p heap);
+
+#endif
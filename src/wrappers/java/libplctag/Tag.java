@@ -94,6 +94,7 @@ static {
     public static final int PLCTAG_ERR_WRITE           = (-37);
     public static final int PLCTAG_ERR_PARTIAL         = (-38);
     public static final int PLCTAG_ERR_BUSY            = (-39);
+    public static final int PLCTAG_ERR_TOO_MANY_TAGS   = (-40);
 
     // debug levels
     public static final int PLCTAG_DEBUG_NONE          = (0);
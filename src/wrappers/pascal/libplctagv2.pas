@@ -16,7 +16,7 @@ const
   {$ENDIF}
 
 type
-  TLibPLCStatus    = -39..1;
+  TLibPLCStatus    = -40..1;
   TLibPLCDebug     =   0..5;
   TLibPLCEvents    =   1..6;
 
@@ -68,6 +68,7 @@ const
   PLCTAG_ERR_WRITE           = TLibPLCStatus(-37);
   PLCTAG_ERR_PARTIAL         = TLibPLCStatus(-38);
   PLCTAG_ERR_BUSY            = TLibPLCStatus(-39);
+  PLCTAG_ERR_TOO_MANY_TAGS   = TLibPLCStatus(-40);
 
   PLCTAG_EVENT_READ_STARTED    = TLibPLCEvents(1);
   PLCTAG_EVENT_READ_COMPLETED  = TLibPLCEvents(2);